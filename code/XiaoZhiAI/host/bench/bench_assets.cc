@@ -0,0 +1,253 @@
+#include "bench_util.h"
+#include "host_board.h"
+#include "host_runtime.h"
+#include "assets.h"
+#include "lz4_block.h"
+
+#include <esp_partition.h>
+
+#include <algorithm>
+#include <cstring>
+
+/*
+ * Assets download from the HTTP server of the loopback network into the assets partition,
+ * and the expansion of LZ4 compressed ("ZL") assets on first use. The image is built here
+ * in the layout of build_default_assets.py: a header, the table of files and the files,
+ * each behind a "ZZ" or "ZL" magic.
+ */
+
+#define ASSETS_URL "http://assets.bench/assets.bin"
+// What the mmap of the shim can map at once
+#define ASSETS_PARTITION_SIZE (4 * 1024 * 1024)
+
+struct AssetFile {
+    std::string name;
+    std::string data;
+    bool compressed;
+};
+
+// Greedy LZ4 block compressor, enough to produce test input for Lz4DecompressBlock
+static std::string Lz4CompressBlock(const uint8_t* src, size_t size) {
+    std::string out;
+    std::vector<int32_t> table(1 << 16, -1);
+    size_t anchor = 0;
+    size_t pos = 0;
+    // The format ends with at least 5 literals and the last match starts 12 bytes before the end
+    const size_t match_limit = size > 12 ? size - 12 : 0;
+    auto put_length = [&out](size_t length) {
+        while (length >= 255) {
+            out.push_back((char)255);
+            length -= 255;
+        }
+        out.push_back((char)length);
+    };
+    auto put_literals = [&](size_t end, size_t match_length) {
+        size_t literal_length = end - anchor;
+        out.push_back((char)((std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_length, 15)));
+        if (literal_length >= 15) {
+            put_length(literal_length - 15);
+        }
+        out.append(reinterpret_cast<const char*>(src + anchor), literal_length);
+    };
+
+    while (pos < match_limit) {
+        uint32_t sequence;
+        memcpy(&sequence, src + pos, sizeof(sequence));
+        uint32_t hash = (sequence * 2654435761u) >> 16;
+        int32_t candidate = table[hash];
+        table[hash] = pos;
+        if (candidate < 0 || pos - candidate > 65535 || memcmp(src + candidate, src + pos, 4) != 0) {
+            pos++;
+            continue;
+        }
+        size_t match_length = 4;
+        while (pos + match_length < size - 5 && src[candidate + match_length] == src[pos + match_length]) {
+            match_length++;
+        }
+        put_literals(pos, match_length - 4);
+        uint16_t offset = pos - candidate;
+        out.push_back((char)(offset & 0xFF));
+        out.push_back((char)(offset >> 8));
+        if (match_length - 4 >= 15) {
+            put_length(match_length - 4 - 15);
+        }
+        pos += match_length;
+        anchor = pos;
+    }
+    put_literals(size, 0);
+    return out;
+}
+
+// Deterministic stand-ins for the assets: a font bitmap, emoji images and the index
+static std::vector<AssetFile> MakeFiles(bool quick) {
+    std::vector<AssetFile> files;
+    uint32_t seed = 1;
+    auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 24;
+    };
+
+    // Glyphs of 4-bit pixels, mostly blank with strokes
+    std::string font(quick ? 256 * 1024 : 2 * 1024 * 1024, '\0');
+    for (size_t i = 0; i < font.size(); i++) {
+        font[i] = (i % 24 < 6 || next() < 16) ? (char)next() : '\0';
+    }
+    files.push_back({"font_puhui_common_20_4.bin", font, true});
+
+    // RGB565 images of flat regions and gradients
+    int emoji_count = quick ? 4 : 21;
+    for (int e = 0; e < emoji_count; e++) {
+        std::string image(64 * 1024, '\0');
+        for (size_t i = 0; i < image.size(); i += 2) {
+            size_t pixel = i / 2;
+            uint16_t color = ((pixel / 256 + e) % 8 < 5) ? 0xFFFF : (uint16_t)((pixel % 256) * 31 / 255 << 11 | e);
+            memcpy(&image[i], &color, sizeof(color));
+        }
+        files.push_back({"emoji_" + std::to_string(e) + ".raw", image, true});
+    }
+
+    files.push_back({"index.json", "{\"version\":2,\"text_font\":\"font_puhui_common_20_4.bin\"}", false});
+    return files;
+}
+
+struct AssetsTableEntry {
+    char asset_name[32];
+    uint32_t asset_size;
+    uint32_t asset_offset;
+    uint16_t asset_width;
+    uint16_t asset_height;
+};
+
+static std::string BuildImage(const std::vector<AssetFile>& files, size_t& raw_bytes, size_t& stored_bytes) {
+    std::string table;
+    std::string data;
+    raw_bytes = 0;
+    stored_bytes = 0;
+    for (auto& file : files) {
+        std::string stored;
+        if (file.compressed) {
+            uint32_t raw_size = file.data.size();
+            stored.append(reinterpret_cast<const char*>(&raw_size), sizeof(raw_size));
+            stored += Lz4CompressBlock(reinterpret_cast<const uint8_t*>(file.data.data()), file.data.size());
+        } else {
+            stored = file.data;
+        }
+        AssetsTableEntry entry = {};
+        strncpy(entry.asset_name, file.name.c_str(), sizeof(entry.asset_name) - 1);
+        entry.asset_size = stored.size();
+        entry.asset_offset = data.size();
+        table.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        data += file.compressed ? "ZL" : "ZZ";
+        data += stored;
+        raw_bytes += file.data.size();
+        stored_bytes += stored.size();
+    }
+
+    std::string body = table + data;
+    uint32_t checksum = 0;
+    for (unsigned char c : body) {
+        checksum += c;
+    }
+    uint32_t header[3] = {(uint32_t)files.size(), checksum & 0xFFFF, (uint32_t)body.size()};
+    return std::string(reinterpret_cast<const char*>(header), sizeof(header)) + body;
+}
+
+int main(int argc, char** argv) {
+    auto options = BenchParseArgs(argc, argv);
+    BenchReport report("assets");
+    bool ok = true;
+
+    std::vector<AssetFile> files;
+    std::string image;
+    size_t raw_bytes;
+    size_t stored_bytes;
+    {
+        HostUncountedScope uncounted;
+        files = MakeFiles(options.quick);
+        image = BuildImage(files, raw_bytes, stored_bytes);
+    }
+    report.Add("image.bytes", image.size(), "bytes");
+    report.Add("image.compression_ratio", (double)raw_bytes / stored_bytes, "x");
+
+    host_partition_register("assets", ESP_PARTITION_TYPE_DATA, ASSETS_PARTITION_SIZE);
+    HostBoard::GetInstance().network().AddHttpHandler(ASSETS_URL, [&image](const LoopbackHttpRequest& request) {
+        LoopbackHttpResponse response;
+        response.headers["Content-Type"] = "application/octet-stream";
+        response.body = image;
+        return response;
+    });
+
+    auto& assets = Assets::GetInstance();
+    auto start_allocations = HostGetAllocations();
+    int64_t start = BenchNowUs();
+    int last_progress = -1;
+    ok = assets.Download(ASSETS_URL, [&last_progress](int progress, size_t speed) {
+        last_progress = progress;
+    }) && ok;
+    int64_t elapsed = BenchNowUs() - start;
+    auto allocations = HostGetAllocations();
+    ok = ok && assets.checksum_valid() && last_progress == 100;
+    report.Add("download.mb_per_s", image.size() / (elapsed / 1e6) / (1024 * 1024), "MB/s");
+    report.Add("download.allocs", allocations.count - start_allocations.count, "allocs");
+
+    // First use expands into PSRAM, later uses return the cached copy
+    BenchLatency first_use;
+    BenchLatency cached_use;
+    size_t expanded_bytes = 0;
+    int64_t expand_us = 0;
+    start_allocations = HostGetAllocations();
+    for (auto& file : files) {
+        void* ptr = nullptr;
+        size_t size = 0;
+        start = BenchNowUs();
+        bool found = assets.GetAssetData(file.name, ptr, size);
+        elapsed = BenchNowUs() - start;
+        if (!found || size != file.data.size() || memcmp(ptr, file.data.data(), size) != 0) {
+            printf("Asset %s does not match\n", file.name.c_str());
+            ok = false;
+            continue;
+        }
+        HostUncountedScope uncounted;
+        if (file.compressed) {
+            first_use.Add(elapsed);
+            expanded_bytes += size;
+            expand_us += elapsed;
+        }
+    }
+    allocations = HostGetAllocations();
+    for (auto& file : files) {
+        void* ptr = nullptr;
+        size_t size = 0;
+        start = BenchNowUs();
+        assets.GetAssetData(file.name, ptr, size);
+        elapsed = BenchNowUs() - start;
+        HostUncountedScope uncounted;
+        cached_use.Add(elapsed);
+    }
+    report.Add("expand.mb_per_s", expanded_bytes / (expand_us / 1e6) / (1024 * 1024), "MB/s");
+    report.Add("expand.allocs_per_asset", (double)(allocations.count - start_allocations.count) / first_use.count(), "allocs");
+    report.AddLatency("expand.first_use_us", first_use);
+    report.AddLatency("expand.cached_use_us", cached_use);
+
+    // The decoder alone on the largest asset, without the partition and the cache
+    auto& font = files.front();
+    std::string compressed;
+    std::string output(font.data.size(), '\0');
+    {
+        HostUncountedScope uncounted;
+        compressed = Lz4CompressBlock(reinterpret_cast<const uint8_t*>(font.data.data()), font.data.size());
+    }
+    int rounds = options.quick ? 5 : 50;
+    start = BenchNowUs();
+    for (int i = 0; i < rounds; i++) {
+        int ret = Lz4DecompressBlock(reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size(),
+            reinterpret_cast<uint8_t*>(&output[0]), output.size());
+        ok = ok && ret == (int)font.data.size();
+    }
+    elapsed = BenchNowUs() - start;
+    ok = ok && output == font.data;
+    report.Add("lz4_decode.mb_per_s", (double)font.data.size() * rounds / (elapsed / 1e6) / (1024 * 1024), "MB/s");
+
+    ok = report.Write(options) && ok;
+    BenchExit(ok ? 0 : 1);
+}
@@ -0,0 +1,232 @@
+#include "bench_util.h"
+#include "bench_signal.h"
+#include "host_board.h"
+#include "host_runtime.h"
+#include "audio_service.h"
+#include "opus_stream_encoder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/*
+ * AudioService end to end on the WavAudioCodec of the host board.
+ * Uplink latency runs from the capture of the last sample of a frame until its packet is
+ * taken from the send queue, which is where the protocol sends from. Downlink latency runs
+ * from pushing a packet to the decode queue until its last sample has been played.
+ * Both are measured with the codec paced in real time, the throughput runs unpaced.
+ */
+
+// Records when a stream of samples passed each sample count
+class SampleClock {
+public:
+    void Add(int samples) {
+        HostUncountedScope uncounted;
+        std::lock_guard<std::mutex> lock(mutex_);
+        total_ += samples;
+        marks_.push_back({total_, BenchNowUs()});
+    }
+
+    // Time at which the stream reached the sample count, -1 if it did not yet
+    int64_t TimeOf(uint64_t sample) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& mark : marks_) {
+            if (mark.samples >= sample) {
+                return mark.time_us;
+            }
+        }
+        return -1;
+    }
+
+    uint64_t total() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return total_;
+    }
+
+private:
+    struct Mark {
+        uint64_t samples;
+        int64_t time_us;
+    };
+    std::mutex mutex_;
+    uint64_t total_ = 0;
+    std::deque<Mark> marks_;
+};
+
+struct Window {
+    int64_t start_us;
+    HostAllocations start_allocations;
+
+    static Window Begin() {
+        return Window{BenchNowUs(), HostGetAllocations()};
+    }
+
+    void End(BenchReport& report, const std::string& name, int frames, int frame_duration_ms) {
+        double seconds = (BenchNowUs() - start_us) / 1e6;
+        auto allocations = HostGetAllocations();
+        report.Add(name + ".frames_per_s", frames / seconds, "frames/s");
+        report.Add(name + ".realtime_factor", frames * frame_duration_ms / 1000.0 / seconds, "x");
+        report.Add(name + ".allocs_per_frame", (double)(allocations.count - start_allocations.count) / frames, "allocs");
+        report.Add(name + ".alloc_bytes_per_frame", (double)(allocations.bytes - start_allocations.bytes) / frames, "bytes");
+    }
+};
+
+static void WaitFor(const std::function<bool()>& condition, int timeout_ms) {
+    int64_t deadline = BenchNowUs() + timeout_ms * 1000LL;
+    while (!condition() && BenchNowUs() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+int main(int argc, char** argv) {
+    auto options = BenchParseArgs(argc, argv);
+    int latency_frames = options.quick ? 20 : 200;
+    int throughput_frames = options.quick ? 100 : 2000;
+    BenchReport report("audio_service");
+    bool ok = true;
+
+    auto& board = HostBoard::GetInstance();
+    auto& codec = board.audio_codec();
+
+    SampleClock capture_clock;
+    BenchSignal capture_signal(codec.input_sample_rate());
+    codec.SetInputSource([&](int16_t* dest, int samples) {
+        capture_signal.Generate(dest, samples);
+        capture_clock.Add(samples);
+    });
+    SampleClock playback_clock;
+    codec.SetOutputSink([&](const int16_t* data, int samples) {
+        playback_clock.Add(samples);
+    });
+
+    // Never destroyed, its tasks run until the process exits
+    auto audio_service = new AudioService();
+    audio_service->Initialize(&codec);
+    audio_service->Start();
+
+    // The uplink consumer stands in for the main task that sends the packets
+    std::mutex send_mutex;
+    std::condition_variable send_cv;
+    bool send_ready = false;
+    std::atomic<int> sent_packets{0};
+    std::atomic<bool> measure_uplink{true};
+    BenchLatency uplink_latency;
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [&]() {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        send_ready = true;
+        send_cv.notify_one();
+    };
+    audio_service->SetCallbacks(callbacks);
+
+    std::thread consumer([&]() {
+        HostUncountedScope uncounted;
+        uint64_t captured_samples = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(send_mutex);
+                send_cv.wait(lock, [&]() { return send_ready; });
+                send_ready = false;
+            }
+            while (auto packet = audio_service->PopPacketFromSendQueue()) {
+                int64_t now = BenchNowUs();
+                captured_samples += packet->frame_duration * codec.input_sample_rate() / 1000;
+                if (measure_uplink) {
+                    int64_t captured = capture_clock.TimeOf(captured_samples);
+                    if (captured >= 0) {
+                        uplink_latency.Add(now - captured);
+                    }
+                }
+                sent_packets++;
+            }
+        }
+    });
+    consumer.detach();
+
+    // Uplink in real time
+    audio_service->EnableVoiceProcessing(true);
+    WaitFor([&]() { return sent_packets >= latency_frames; }, latency_frames * OPUS_FRAME_DURATION_MS + 5000);
+    measure_uplink = false;
+    ok = ok && uplink_latency.count() > 0;
+    report.AddLatency("uplink.latency_us", uplink_latency);
+
+    // Uplink as fast as the tasks go
+    codec.SetPaced(false);
+    int start_packets = sent_packets;
+    auto window = Window::Begin();
+    WaitFor([&]() { return sent_packets >= start_packets + throughput_frames; }, 60000);
+    int uplink_frames = sent_packets - start_packets;
+    window.End(report, "uplink", uplink_frames, OPUS_FRAME_DURATION_MS);
+    ok = ok && uplink_frames >= throughput_frames;
+    audio_service->EnableVoiceProcessing(false);
+    codec.SetPaced(true);
+
+    // The packets the server would send, encoded like the uplink
+    int downlink_packets = latency_frames + throughput_frames;
+    std::vector<std::vector<uint8_t>> opus_packets;
+    {
+        HostUncountedScope uncounted;
+        OpusStreamEncoder encoder(16000);
+        BenchSignal signal(16000);
+        std::vector<int16_t> pcm(16000 / 1000 * OPUS_FRAME_DURATION_MS);
+        while ((int)opus_packets.size() < downlink_packets) {
+            signal.Generate(pcm.data(), pcm.size());
+            encoder.Encode(pcm, [&](std::vector<uint8_t>&& opus, int duration_ms) {
+                opus_packets.push_back(std::move(opus));
+            });
+        }
+    }
+    auto make_packet = [&](int index) {
+        HostUncountedScope uncounted;
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->sample_rate = 16000;
+        packet->frame_duration = OPUS_FRAME_DURATION_MS;
+        packet->payload = opus_packets[index];
+        return packet;
+    };
+    const uint64_t samples_per_packet = codec.output_sample_rate() / 1000 * OPUS_FRAME_DURATION_MS;
+
+    // Downlink in real time, the packets arrive at the rate they play
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint64_t playback_start = playback_clock.total();
+    std::vector<int64_t> push_times(latency_frames);
+    int64_t next_push = BenchNowUs();
+    for (int i = 0; i < latency_frames; i++) {
+        int64_t delay = next_push - BenchNowUs();
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(delay));
+        }
+        auto packet = make_packet(i);
+        push_times[i] = BenchNowUs();
+        audio_service->PushPacketToDecodeQueue(std::move(packet), true);
+        next_push += OPUS_FRAME_DURATION_MS * 1000;
+    }
+    uint64_t playback_end = playback_start + latency_frames * samples_per_packet;
+    WaitFor([&]() { return playback_clock.total() >= playback_end; }, 5000);
+    BenchLatency downlink_latency;
+    for (int i = 0; i < latency_frames; i++) {
+        int64_t played = playback_clock.TimeOf(playback_start + (i + 1) * samples_per_packet);
+        if (played >= 0) {
+            downlink_latency.Add(played - push_times[i]);
+        }
+    }
+    ok = ok && (int)downlink_latency.count() == latency_frames;
+    report.AddLatency("downlink.latency_us", downlink_latency);
+
+    // Downlink as fast as the tasks go
+    codec.SetPaced(false);
+    playback_start = playback_clock.total();
+    playback_end = playback_start + throughput_frames * samples_per_packet;
+    window = Window::Begin();
+    for (int i = latency_frames; i < downlink_packets; i++) {
+        audio_service->PushPacketToDecodeQueue(make_packet(i), true);
+    }
+    WaitFor([&]() { return playback_clock.total() >= playback_end; }, 60000);
+    window.End(report, "downlink", throughput_frames, OPUS_FRAME_DURATION_MS);
+    ok = ok && playback_clock.total() >= playback_end;
+
+    ok = report.Write(options) && ok;
+    BenchExit(ok ? 0 : 1);
+}
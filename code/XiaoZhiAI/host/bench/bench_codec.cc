@@ -0,0 +1,124 @@
+#include "bench_util.h"
+#include "bench_signal.h"
+#include "host_runtime.h"
+#include "opus_stream_encoder.h"
+
+#include <opus_encoder.h>
+#include <opus_decoder.h>
+#include <opus_resampler.h>
+
+#include <cstdio>
+
+/*
+ * Opus encoding, decoding and resampling with the settings of AudioService:
+ * 16 kHz uplink at complexity 0, 60 ms frames, and 16 kHz to 24 kHz playback.
+ */
+
+#define FRAME_DURATION_MS 60
+
+struct CodecRun {
+    int frames = 0;
+    int64_t elapsed_us = 0;
+    HostAllocations allocations;
+};
+
+template <typename Function>
+static CodecRun Measure(int frames, Function&& function) {
+    CodecRun run;
+    auto start_allocations = HostGetAllocations();
+    int64_t start = BenchNowUs();
+    for (int i = 0; i < frames; i++) {
+        function(i);
+    }
+    run.elapsed_us = BenchNowUs() - start;
+    auto end_allocations = HostGetAllocations();
+    run.frames = frames;
+    run.allocations.count = end_allocations.count - start_allocations.count;
+    run.allocations.bytes = end_allocations.bytes - start_allocations.bytes;
+    return run;
+}
+
+static void AddRun(BenchReport& report, const std::string& name, const CodecRun& run) {
+    double seconds = run.elapsed_us / 1e6;
+    report.Add(name + ".frames_per_s", run.frames / seconds, "frames/s");
+    // Audio seconds processed per wall second, above 1 keeps up in real time on one core
+    report.Add(name + ".realtime_factor", run.frames * FRAME_DURATION_MS / 1000.0 / seconds, "x");
+    report.Add(name + ".allocs_per_frame", (double)run.allocations.count / run.frames, "allocs");
+    report.Add(name + ".alloc_bytes_per_frame", (double)run.allocations.bytes / run.frames, "bytes");
+}
+
+int main(int argc, char** argv) {
+    auto options = BenchParseArgs(argc, argv);
+    int frames = options.quick ? 50 : 1000;
+    BenchReport report("codec");
+
+    const int input_samples = 16000 / 1000 * FRAME_DURATION_MS;
+    const int output_samples = 24000 / 1000 * FRAME_DURATION_MS;
+    std::vector<std::vector<int16_t>> pcm_frames(frames);
+    std::vector<std::vector<uint8_t>> opus_frames;
+    {
+        HostUncountedScope uncounted;
+        BenchSignal signal(16000);
+        for (auto& frame : pcm_frames) {
+            frame.resize(input_samples);
+            signal.Generate(frame.data(), frame.size());
+        }
+        opus_frames.reserve(frames);
+    }
+
+    // The stream encoder of the uplink
+    OpusStreamEncoder stream_encoder(16000);
+    stream_encoder.SetComplexity(0);
+    auto run = Measure(frames, [&](int i) {
+        stream_encoder.Encode(pcm_frames[i], [&](std::vector<uint8_t>&& opus, int duration_ms) {
+            HostUncountedScope uncounted;
+            opus_frames.push_back(std::move(opus));
+        });
+    });
+    AddRun(report, "stream_encoder", run);
+
+    // The wrapper of the esp-opus-encoder component, as used before OpusStreamEncoder
+    OpusEncoderWrapper encoder(16000, 1, FRAME_DURATION_MS);
+    encoder.SetComplexity(0);
+    run = Measure(frames, [&](int i) {
+        std::vector<int16_t> pcm;
+        {
+            HostUncountedScope uncounted;
+            pcm = pcm_frames[i];
+        }
+        encoder.Encode(std::move(pcm), [](std::vector<uint8_t>&& opus) {});
+    });
+    AddRun(report, "encoder_wrapper", run);
+
+    // Decoding the packets at the 24 kHz of the speaker
+    OpusDecoderWrapper decoder(24000, 1, FRAME_DURATION_MS);
+    std::vector<int16_t> pcm_out;
+    int decoded = opus_frames.size();
+    run = Measure(decoded, [&](int i) {
+        std::vector<uint8_t> opus;
+        {
+            HostUncountedScope uncounted;
+            opus = opus_frames[i];
+        }
+        decoder.Decode(std::move(opus), pcm_out);
+    });
+    AddRun(report, "decoder", run);
+
+    // Resampling 16 kHz packets for a 24 kHz speaker
+    OpusResampler resampler;
+    resampler.Configure(16000, 24000);
+    std::vector<int16_t> resampled(output_samples);
+    run = Measure(frames, [&](int i) {
+        resampler.Process(pcm_frames[i].data(), pcm_frames[i].size(), resampled.data());
+    });
+    AddRun(report, "resampler", run);
+
+    size_t opus_bytes = 0;
+    for (auto& opus : opus_frames) {
+        opus_bytes += opus.size();
+    }
+    report.Add("stream_encoder.bitrate", opus_bytes * 8.0 / (opus_frames.size() * FRAME_DURATION_MS / 1000.0), "bps");
+
+    bool ok = report.Write(options) && !opus_frames.empty() && !pcm_out.empty();
+    BenchExit(ok ? 0 : 1);
+}
@@ -0,0 +1,141 @@
+#include "bench_util.h"
+#include "host_board.h"
+#include "host_runtime.h"
+#include "application.h"
+#include "mcp_server.h"
+
+#include <cJSON.h>
+
+#include <condition_variable>
+#include <mutex>
+
+/*
+ * JSON-RPC requests through McpServer, from parsing the request until the reply reaches
+ * the protocol. The replies are sent by the main task of the host Application, like on the
+ * device, and sync tools run on it too. Async tools run on the MCP workers.
+ */
+
+class ReplyWaiter {
+public:
+    ReplyWaiter() {
+        HostSetMcpSink([this](const std::string& payload) {
+            HostUncountedScope uncounted;
+            cJSON* root = cJSON_Parse(payload.c_str());
+            auto id = cJSON_GetObjectItem(root, "id");
+            auto error = cJSON_GetObjectItem(root, "error");
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (cJSON_IsNumber(id)) {
+                last_id_ = id->valueint;
+                last_error_ = error != nullptr;
+                last_size_ = payload.size();
+            }
+            cJSON_Delete(root);
+            cv_.notify_all();
+        });
+    }
+
+    // Sends the request and waits for its reply, returns the microseconds taken or -1
+    int64_t Call(int id, const std::string& request, size_t* reply_size = nullptr) {
+        int64_t start = BenchNowUs();
+        McpServer::GetInstance().ParseMessage(request);
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_for(lock, std::chrono::seconds(2), [&]() { return last_id_ == id; }) || last_error_) {
+            return -1;
+        }
+        if (reply_size != nullptr) {
+            *reply_size = last_size_;
+        }
+        return BenchNowUs() - start;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int last_id_ = -1;
+    bool last_error_ = false;
+    size_t last_size_ = 0;
+};
+
+static bool Measure(BenchReport& report, ReplyWaiter& waiter, const std::string& name, int count, int& next_id,
+    const std::function<std::string(int id)>& request) {
+    BenchLatency latency;
+    HostAllocations allocations;
+    size_t reply_size = 0;
+    for (int i = 0; i < count; i++) {
+        int id = next_id++;
+        std::string message;
+        {
+            HostUncountedScope uncounted;
+            message = request(id);
+        }
+        auto start_allocations = HostGetAllocations();
+        int64_t us = waiter.Call(id, message, &reply_size);
+        auto end_allocations = HostGetAllocations();
+        if (us < 0) {
+            printf("%s: request %d failed\n", name.c_str(), id);
+            return false;
+        }
+        HostUncountedScope uncounted;
+        latency.Add(us);
+        allocations.count += end_allocations.count - start_allocations.count;
+        allocations.bytes += end_allocations.bytes - start_allocations.bytes;
+    }
+    report.AddLatency(name + ".latency_us", latency);
+    report.Add(name + ".allocs_per_call", (double)allocations.count / count, "allocs");
+    report.Add(name + ".alloc_bytes_per_call", (double)allocations.bytes / count, "bytes");
+    report.Add(name + ".reply_bytes", reply_size, "bytes");
+    return true;
+}
+
+static std::string Request(int id, const std::string& method, const std::string& params) {
+    return "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) + ",\"method\":\"" + method + "\",\"params\":" + params + "}";
+}
+
+int main(int argc, char** argv) {
+    auto options = BenchParseArgs(argc, argv);
+    int count = options.quick ? 20 : 500;
+    BenchReport report("mcp");
+    bool ok = true;
+
+    HostBoard::GetInstance();
+    auto& app = Application::GetInstance();
+    app.Initialize();
+
+    auto& mcp_server = McpServer::GetInstance();
+    mcp_server.AddCommonTools();
+    mcp_server.AddTool("bench.add", "Adds two numbers", PropertyList({
+        Property("a", kPropertyTypeInteger),
+        Property("b", kPropertyTypeInteger),
+    }), [](const PropertyList& properties) -> ReturnValue {
+        return properties["a"].value<int>() + properties["b"].value<int>();
+    });
+    McpToolOptions async_options;
+    async_options.async = true;
+    async_options.max_concurrency = 2;
+    mcp_server.AddTool("bench.echo", "Returns the text", PropertyList({
+        Property("text", kPropertyTypeString),
+    }), [](const PropertyList& properties) -> ReturnValue {
+        return properties["text"].value<std::string>();
+    }, async_options);
+
+    ReplyWaiter waiter;
+    int next_id = 1;
+    ok = ok && Measure(report, waiter, "initialize", count, next_id, [](int id) {
+        return Request(id, "initialize", "{\"capabilities\":{}}");
+    });
+    ok = ok && Measure(report, waiter, "tools_list", count, next_id, [](int id) {
+        return Request(id, "tools/list", "{\"cursor\":\"\"}");
+    });
+    ok = ok && Measure(report, waiter, "call_sync", count, next_id, [](int id) {
+        return Request(id, "tools/call", "{\"name\":\"bench.add\",\"arguments\":{\"a\":1,\"b\":2}}");
+    });
+    ok = ok && Measure(report, waiter, "call_async", count, next_id, [](int id) {
+        return Request(id, "tools/call", "{\"name\":\"bench.echo\",\"arguments\":{\"text\":\"hello\"}}");
+    });
+    ok = ok && Measure(report, waiter, "call_device_status", count, next_id, [](int id) {
+        return Request(id, "tools/call", "{\"name\":\"self.get_device_status\",\"arguments\":{}}");
+    });
+
+    ok = report.Write(options) && ok;
+    BenchExit(ok ? 0 : 1);
+}
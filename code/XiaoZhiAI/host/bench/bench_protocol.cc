@@ -0,0 +1,290 @@
+#include "bench_util.h"
+#include "host_board.h"
+#include "host_runtime.h"
+#include "settings.h"
+#include "websocket_protocol.h"
+#include "mqtt_protocol.h"
+
+#include <cJSON.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+/*
+ * The protocols against echo servers on the loopback network: WebSocket with binary
+ * protocol versions 1, 2 and 3, and MQTT with the encrypted UDP audio channel.
+ * The servers send back what the device sends, so the round trip covers the framing,
+ * encryption and parsing of both directions on the device side. Server work is not
+ * counted in the allocations.
+ */
+
+#define WS_HOST "ws.bench"
+#define WS_PORT 8080
+#define MQTT_HOST "mqtt.bench"
+#define MQTT_PORT 8883
+#define UDP_HOST "udp.bench"
+#define UDP_PORT 8884
+// A 60 ms Opus frame of speech at the default bitrate
+#define AUDIO_PAYLOAD_SIZE 120
+
+static std::string ServerHello(const char* transport) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", "hello");
+    cJSON_AddStringToObject(root, "transport", transport);
+    cJSON_AddStringToObject(root, "session_id", "bench");
+    cJSON* audio_params = cJSON_CreateObject();
+    cJSON_AddStringToObject(audio_params, "format", "opus");
+    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
+    cJSON_AddNumberToObject(audio_params, "channels", 1);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", 60);
+    cJSON_AddItemToObject(root, "audio_params", audio_params);
+    if (strcmp(transport, "udp") == 0) {
+        cJSON* udp = cJSON_CreateObject();
+        cJSON_AddStringToObject(udp, "server", UDP_HOST);
+        cJSON_AddNumberToObject(udp, "port", UDP_PORT);
+        cJSON_AddStringToObject(udp, "key", "00112233445566778899AABBCCDDEEFF");
+        // The first byte is the packet type of the audio packets
+        cJSON_AddStringToObject(udp, "nonce", "01000000000000000000000000000000");
+        cJSON_AddItemToObject(root, "udp", udp);
+    }
+    auto json = cJSON_PrintUnformatted(root);
+    std::string message(json);
+    cJSON_free(json);
+    cJSON_Delete(root);
+    return message;
+}
+
+static bool IsHello(const std::string& text) {
+    cJSON* root = cJSON_Parse(text.c_str());
+    auto type = cJSON_GetObjectItem(root, "type");
+    bool hello = cJSON_IsString(type) && strcmp(type->valuestring, "hello") == 0;
+    cJSON_Delete(root);
+    return hello;
+}
+
+class EchoWebSocketSession : public LoopbackWebSocketSession {
+public:
+    using LoopbackWebSocketSession::LoopbackWebSocketSession;
+
+protected:
+    void OnText(const std::string& text) override {
+        SendText(IsHello(text) ? ServerHello("websocket") : text);
+    }
+
+    void OnBinary(const std::string& data) override {
+        SendBinary(data.data(), data.size());
+    }
+};
+
+class EchoWebSocketServer : public LoopbackServer {
+public:
+    std::unique_ptr<LoopbackSession> Accept(LoopbackLink* link) override {
+        return std::make_unique<EchoWebSocketSession>(link);
+    }
+};
+
+// The packets are encrypted with the nonce they carry, sent back as they are they decrypt again
+class EchoUdpSession : public LoopbackSession {
+public:
+    explicit EchoUdpSession(LoopbackLink* link) : link_(link) {}
+
+    void OnData(const std::string& data) override {
+        link_->Deliver(data);
+    }
+
+private:
+    LoopbackLink* link_;
+};
+
+class EchoUdpServer : public LoopbackServer {
+public:
+    std::unique_ptr<LoopbackSession> Accept(LoopbackLink* link) override {
+        return std::make_unique<EchoUdpSession>(link);
+    }
+};
+
+class EchoMqttBroker : public LoopbackMqttBroker {
+public:
+    void OnPublish(LoopbackMqttClient* client, const std::string& topic, const std::string& payload) override {
+        client->Deliver("server-device", IsHello(payload) ? ServerHello("udp") : payload);
+    }
+};
+
+// Packets and messages coming back from the echo server
+class EchoState {
+public:
+    void Expect(uint32_t index) {
+        HostUncountedScope uncounted;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (send_times_.size() <= index) {
+            send_times_.resize(index + 1);
+        }
+        send_times_[index] = BenchNowUs();
+    }
+
+    void Received(uint32_t index) {
+        int64_t now = BenchNowUs();
+        HostUncountedScope uncounted;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index < send_times_.size()) {
+            last_rtt_us_ = now - send_times_[index];
+        }
+        received_++;
+        cv_.notify_all();
+    }
+
+    // Waits until the count of received items reaches the target, returns the last round trip
+    int64_t WaitReceived(int target, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]() { return received_ >= target; })) {
+            return -1;
+        }
+        return last_rtt_us_;
+    }
+
+    int received() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return received_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<int64_t> send_times_;
+    int received_ = 0;
+    int64_t last_rtt_us_ = 0;
+};
+
+static std::unique_ptr<AudioStreamPacket> MakePacket(uint32_t index) {
+    HostUncountedScope uncounted;
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sample_rate = 16000;
+    packet->frame_duration = 60;
+    packet->timestamp = index;
+    packet->payload.resize(AUDIO_PAYLOAD_SIZE, 0x5A);
+    memcpy(packet->payload.data(), &index, sizeof(index));
+    return packet;
+}
+
+static bool RunTransport(BenchReport& report, const std::string& name, Protocol& protocol, const BenchOptions& options) {
+    int rtt_count = options.quick ? 50 : 1000;
+    int burst_count = options.quick ? 200 : 5000;
+    int json_count = options.quick ? 20 : 500;
+
+    EchoState audio;
+    EchoState json;
+    protocol.OnIncomingAudio([&audio](std::unique_ptr<AudioStreamPacket> packet) {
+        uint32_t index = 0;
+        if (packet->payload.size() >= sizeof(index)) {
+            memcpy(&index, packet->payload.data(), sizeof(index));
+            audio.Received(index);
+        }
+    });
+    protocol.OnIncomingJson([&json](const cJSON* root) {
+        auto payload = cJSON_GetObjectItem(root, "payload");
+        auto id = cJSON_GetObjectItem(payload, "id");
+        if (cJSON_IsNumber(id)) {
+            json.Received(id->valueint);
+        }
+    });
+
+    if (!protocol.Start()) {
+        printf("%s: failed to start\n", name.c_str());
+        return false;
+    }
+    int64_t start = BenchNowUs();
+    if (!protocol.OpenAudioChannel()) {
+        printf("%s: failed to open the audio channel\n", name.c_str());
+        return false;
+    }
+    report.Add(name + ".open_us", BenchNowUs() - start, "us");
+
+    // One packet in flight
+    BenchLatency rtt;
+    uint32_t index = 0;
+    for (int i = 0; i < rtt_count; i++, index++) {
+        audio.Expect(index);
+        protocol.SendAudio(MakePacket(index));
+        int64_t us = audio.WaitReceived(index + 1, 1000);
+        if (us < 0) {
+            printf("%s: packet %u did not come back\n", name.c_str(), (unsigned)index);
+            return false;
+        }
+        HostUncountedScope uncounted;
+        rtt.Add(us);
+    }
+    report.AddLatency(name + ".audio_rtt_us", rtt);
+
+    // Packets sent back to back
+    auto start_allocations = HostGetAllocations();
+    start = BenchNowUs();
+    for (int i = 0; i < burst_count; i++, index++) {
+        protocol.SendAudio(MakePacket(index));
+    }
+    if (audio.WaitReceived(index, 10000) < 0) {
+        printf("%s: %d of %d packets came back\n", name.c_str(), audio.received() - rtt_count, burst_count);
+        return false;
+    }
+    double seconds = (BenchNowUs() - start) / 1e6;
+    auto allocations = HostGetAllocations();
+    report.Add(name + ".packets_per_s", burst_count / seconds, "packets/s");
+    report.Add(name + ".allocs_per_packet", (double)(allocations.count - start_allocations.count) / burst_count, "allocs");
+    report.Add(name + ".alloc_bytes_per_packet", (double)(allocations.bytes - start_allocations.bytes) / burst_count, "bytes");
+
+    // MCP messages, the server sends the same message back
+    BenchLatency json_rtt;
+    for (int i = 0; i < json_count; i++) {
+        json.Expect(i);
+        protocol.SendMcpMessage("{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(i) + ",\"method\":\"ping\"}");
+        int64_t us = json.WaitReceived(i + 1, 1000);
+        if (us < 0) {
+            printf("%s: message %d did not come back\n", name.c_str(), i);
+            return false;
+        }
+        HostUncountedScope uncounted;
+        json_rtt.Add(us);
+    }
+    report.AddLatency(name + ".json_rtt_us", json_rtt);
+
+    protocol.CloseAudioChannel();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    auto options = BenchParseArgs(argc, argv);
+    BenchReport report("protocol");
+    bool ok = true;
+
+    EchoWebSocketServer websocket_server;
+    EchoUdpServer udp_server;
+    EchoMqttBroker mqtt_broker;
+    auto& network = HostBoard::GetInstance().network();
+    network.AddTcpServer(WS_HOST, WS_PORT, &websocket_server);
+    network.AddUdpServer(UDP_HOST, UDP_PORT, &udp_server);
+    network.SetMqttBroker(MQTT_HOST, MQTT_PORT, &mqtt_broker);
+
+    for (int version = 1; version <= 3; version++) {
+        {
+            Settings settings("websocket", true);
+            settings.SetString("url", "ws://" WS_HOST ":" + std::to_string(WS_PORT) + "/xiaozhi/v1/");
+            settings.SetString("token", "bench");
+            settings.SetInt("version", version);
+        }
+        WebsocketProtocol protocol;
+        ok = RunTransport(report, "websocket_v" + std::to_string(version), protocol, options) && ok;
+    }
+
+    {
+        Settings settings("mqtt", true);
+        settings.SetString("endpoint", MQTT_HOST ":" + std::to_string(MQTT_PORT));
+        settings.SetString("client_id", "bench");
+        settings.SetString("publish_topic", "device-server");
+    }
+    // The MQTT protocol schedules reconnects on the application, it stays alive until exit
+    auto mqtt = new MqttProtocol();
+    ok = RunTransport(report, "mqtt_udp", *mqtt, options) && ok;
+
+    ok = report.Write(options) && ok;
+    BenchExit(ok ? 0 : 1);
+}
@@ -0,0 +1,36 @@
+#ifndef BENCH_SIGNAL_H
+#define BENCH_SIGNAL_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// A deterministic speech-like test signal: voiced syllables of a few harmonics with a
+// little noise, separated by pauses, so DTX and VAD see both speech and silence
+class BenchSignal {
+public:
+    explicit BenchSignal(int sample_rate) : sample_rate_(sample_rate) {}
+
+    void Generate(int16_t* dest, size_t samples) {
+        for (size_t i = 0; i < samples; i++, position_++) {
+            double t = (double)position_ / sample_rate_;
+            // 1.2 s cycles of 0.8 s speech and 0.4 s pause
+            double cycle = std::fmod(t, 1.2);
+            double envelope = cycle < 0.8 ? std::sin(M_PI * cycle / 0.8) : 0.0;
+            double pitch = 140.0 + 30.0 * std::sin(2 * M_PI * 0.7 * t);
+            phase_ += 2 * M_PI * pitch / sample_rate_;
+            double voiced = 0.6 * std::sin(phase_) + 0.3 * std::sin(2 * phase_) + 0.15 * std::sin(3 * phase_);
+            seed_ = seed_ * 1664525u + 1013904223u;
+            double noise = ((seed_ >> 16) / 32768.0 - 1.0) * 0.02;
+            dest[i] = (int16_t)((voiced * envelope + noise) * 12000);
+        }
+    }
+
+private:
+    int sample_rate_;
+    uint64_t position_ = 0;
+    double phase_ = 0;
+    uint32_t seed_ = 1;
+};
+
+#endif // BENCH_SIGNAL_H
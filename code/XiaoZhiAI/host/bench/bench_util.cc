@@ -0,0 +1,157 @@
+#include "bench_util.h"
+#include "host_runtime.h"
+
+#include <cJSON.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Operator new is replaced in the benchmarks only, so the library itself stays usable elsewhere
+static void* CountedAllocate(size_t size) {
+    HostCountAllocation(size);
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return CountedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return CountedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// cJSON allocates with malloc, which the counters do not see otherwise
+static void* CountedMalloc(size_t size) {
+    HostCountAllocation(size);
+    return malloc(size);
+}
+
+BenchOptions BenchParseArgs(int argc, char** argv) {
+    cJSON_Hooks hooks = {CountedMalloc, free};
+    cJSON_InitHooks(&hooks);
+
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.json_path = argv[++i];
+        } else {
+            options.args.push_back(argv[i]);
+        }
+    }
+    return options;
+}
+
+int64_t BenchNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double BenchLatency::Percentile(double percent) {
+    if (samples_.empty()) {
+        return 0;
+    }
+    if (!sorted_) {
+        std::sort(samples_.begin(), samples_.end());
+        sorted_ = true;
+    }
+    size_t index = std::min(samples_.size() - 1, (size_t)(percent / 100.0 * samples_.size()));
+    return samples_[index];
+}
+
+double BenchLatency::Mean() const {
+    if (samples_.empty()) {
+        return 0;
+    }
+    double sum = 0;
+    for (auto sample : samples_) {
+        sum += sample;
+    }
+    return sum / samples_.size();
+}
+
+int64_t BenchLatency::Max() const {
+    return samples_.empty() ? 0 : *std::max_element(samples_.begin(), samples_.end());
+}
+
+void BenchReport::Add(const std::string& metric, double value, const std::string& unit) {
+    metrics_.push_back({suite_ + "." + metric, value, unit});
+}
+
+void BenchReport::AddLatency(const std::string& name, BenchLatency& latency) {
+    Add(name + ".p50", latency.Percentile(50), "us");
+    Add(name + ".p95", latency.Percentile(95), "us");
+    Add(name + ".max", latency.Max(), "us");
+    Add(name + ".mean", latency.Mean(), "us");
+}
+
+bool BenchReport::Write(const BenchOptions& options) {
+    for (auto& metric : metrics_) {
+        printf("%-48s %14.2f %s\n", metric.name.c_str(), metric.value, metric.unit.c_str());
+    }
+    fflush(stdout);
+    if (options.json_path.empty()) {
+        return true;
+    }
+
+    FILE* file = fopen(options.json_path.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to write %s\n", options.json_path.c_str());
+        return false;
+    }
+    fprintf(file, "{\n");
+    for (size_t i = 0; i < metrics_.size(); i++) {
+        fprintf(file, "  \"%s\": {\"value\": %.3f, \"unit\": \"%s\"}%s\n", metrics_[i].name.c_str(),
+            metrics_[i].value, metrics_[i].unit.c_str(), i + 1 < metrics_.size() ? "," : "");
+    }
+    fprintf(file, "}\n");
+    fclose(file);
+    return true;
+}
+
+void BenchExit(int code) {
+    fflush(stdout);
+    fflush(stderr);
+    std::_Exit(code);
+}
@@ -0,0 +1,62 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Helpers shared by the benchmarks. Every benchmark prints "<suite>.<metric> <value> <unit>"
+ * lines and, with --json <file>, writes the same metrics as a JSON object for CI.
+ * --quick runs a short version, which is what ctest uses.
+ */
+
+struct BenchOptions {
+    bool quick = false;
+    std::string json_path;
+    std::vector<std::string> args;  // Arguments the helpers did not consume
+};
+
+BenchOptions BenchParseArgs(int argc, char** argv);
+
+int64_t BenchNowUs();
+
+// Latency samples in microseconds
+class BenchLatency {
+public:
+    void Add(int64_t us) { samples_.push_back(us); }
+    size_t count() const { return samples_.size(); }
+    double Percentile(double percent);
+    double Mean() const;
+    int64_t Max() const;
+
+private:
+    std::vector<int64_t> samples_;
+    bool sorted_ = false;
+};
+
+class BenchReport {
+public:
+    explicit BenchReport(const std::string& suite) : suite_(suite) {}
+
+    void Add(const std::string& metric, double value, const std::string& unit);
+    // Adds <name>.p50, .p95, .max and .mean of the samples
+    void AddLatency(const std::string& name, BenchLatency& latency);
+    // Prints the metrics and writes the JSON file if asked for
+    bool Write(const BenchOptions& options);
+
+private:
+    struct Metric {
+        std::string name;
+        double value;
+        std::string unit;
+    };
+    std::string suite_;
+    std::vector<Metric> metrics_;
+};
+
+// Flushes the output and ends the process without running static destructors, the
+// device singletons are never destroyed on the device either and their tasks still run
+[[noreturn]] void BenchExit(int code);
+
+#endif // BENCH_UTIL_H
@@ -0,0 +1,109 @@
+#include "application.h"
+#include "host_runtime.h"
+
+#include <esp_log.h>
+#include <esp_system.h>
+
+#define TAG "Application"
+
+/*
+ * The part of application.cc the host build needs: the main task with its scheduled
+ * callbacks, and MCP messages going to the sink of the host runtime instead of a protocol.
+ * The boot graph, activation and OTA are left to the device.
+ */
+
+static std::mutex mcp_sink_mutex;
+static std::function<void(const std::string&)> mcp_sink;
+
+void HostSetMcpSink(std::function<void(const std::string& payload)> sink) {
+    std::lock_guard<std::mutex> lock(mcp_sink_mutex);
+    mcp_sink = std::move(sink);
+}
+
+static void SendToMcpSink(const std::string& payload) {
+    std::function<void(const std::string&)> sink;
+    {
+        std::lock_guard<std::mutex> lock(mcp_sink_mutex);
+        sink = mcp_sink;
+    }
+    if (sink) {
+        sink(payload);
+    }
+}
+
+Application::Application() {
+    event_group_ = xEventGroupCreate();
+}
+
+Application::~Application() {
+    vEventGroupDelete(event_group_);
+}
+
+bool Application::SetDeviceState(DeviceState state) {
+    return state_machine_.TransitionTo(state);
+}
+
+void Application::Initialize() {
+    SetDeviceState(kDeviceStateStarting);
+    xTaskCreate([](void* arg) {
+        static_cast<Application*>(arg)->Run();
+        vTaskDelete(NULL);
+    }, "main", 8192, this, 3, nullptr);
+    // The host has no activation, it passes through like a device that is already activated
+    SetDeviceState(kDeviceStateActivating);
+    SetDeviceState(kDeviceStateIdle);
+}
+
+void Application::Run() {
+    while (true) {
+        auto bits = xEventGroupWaitBits(event_group_, MAIN_EVENT_SCHEDULE, pdTRUE, pdFALSE, portMAX_DELAY);
+        if (bits & MAIN_EVENT_SCHEDULE) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto tasks = std::move(main_tasks_);
+            lock.unlock();
+            for (auto& task : tasks) {
+                task();
+            }
+        }
+    }
+}
+
+void Application::Schedule(std::function<void()>&& callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        main_tasks_.push_back(std::move(callback));
+    }
+    xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
+}
+
+void Application::Reboot() {
+    ESP_LOGI(TAG, "Rebooting...");
+    audio_service_.Stop();
+    esp_restart();
+}
+
+bool Application::UpgradeFirmware(const std::string& url, const std::string& version, const std::string& delta_url) {
+    ESP_LOGW(TAG, "Firmware upgrade is not supported on the host: %s", url.c_str());
+    return false;
+}
+
+void Application::SendMcpMessage(const std::string& payload) {
+    // Always schedule to run in main task, like on the device
+    Schedule([payload]() {
+        SendToMcpSink(payload);
+    });
+}
+
+void Application::SendMcpMessage(TextStream&& payload) {
+    auto stream = std::make_shared<TextStream>(std::move(payload));
+    Schedule([stream]() {
+        SendToMcpSink(stream->ToString());
+    });
+}
+
+void Application::PlaySound(const std::string_view& sound) {
+    audio_service_.PlaySound(sound);
+}
+
+Ota::~Ota() {
+}
@@ -0,0 +1,95 @@
+#include "host_board.h"
+#include "system_info.h"
+#include "settings.h"
+#include "display.h"
+
+#include <esp_log.h>
+#include <esp_app_desc.h>
+
+#include <random>
+
+#define TAG "Board"
+
+// Board methods of boards/common/board.cc, which needs the chip and partition APIs
+
+Board::Board() {
+    Settings settings("board", true);
+    uuid_ = settings.GetString("uuid");
+    if (uuid_.empty()) {
+        uuid_ = GenerateUuid();
+        settings.SetString("uuid", uuid_);
+    }
+    ESP_LOGI(TAG, "UUID=%s SKU=host", uuid_.c_str());
+}
+
+std::string Board::GenerateUuid() {
+    // UUID v4 需要 16 字节的随机数据
+    uint8_t uuid[16];
+    std::random_device random;
+    for (auto& byte : uuid) {
+        byte = random() & 0xFF;
+    }
+
+    // 设置版本 (版本 4) 和变体位
+    uuid[6] = (uuid[6] & 0x0F) | 0x40;    // 版本 4
+    uuid[8] = (uuid[8] & 0x3F) | 0x80;    // 变体 1
+
+    char uuid_str[37];
+    snprintf(uuid_str, sizeof(uuid_str),
+        "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+        uuid[0], uuid[1], uuid[2], uuid[3],
+        uuid[4], uuid[5], uuid[6], uuid[7],
+        uuid[8], uuid[9], uuid[10], uuid[11],
+        uuid[12], uuid[13], uuid[14], uuid[15]);
+    return std::string(uuid_str);
+}
+
+bool Board::GetBatteryLevel(int &level, bool& charging, bool& discharging) {
+    return false;
+}
+
+bool Board::GetTemperature(float& esp32temp) {
+    return false;
+}
+
+Display* Board::GetDisplay() {
+    static NoDisplay display;
+    return &display;
+}
+
+Camera* Board::GetCamera() {
+    return nullptr;
+}
+
+Led* Board::GetLed() {
+    static NoLed led;
+    return &led;
+}
+
+std::string Board::GetSystemInfoJson() {
+    auto app_desc = esp_app_get_description();
+    std::string json = R"({"version":2,"language":"en-US",)";
+    json += R"("flash_size":)" + std::to_string(SystemInfo::GetFlashSize()) + R"(,)";
+    json += R"("minimum_free_heap_size":")" + std::to_string(SystemInfo::GetMinimumFreeHeapSize()) + R"(",)";
+    json += R"("mac_address":")" + SystemInfo::GetMacAddress() + R"(",)";
+    json += R"("uuid":")" + uuid_ + R"(",)";
+    json += R"("chip_model_name":")" + SystemInfo::GetChipModelName() + R"(",)";
+    json += R"("application":{"name":")" + std::string(app_desc->project_name) + R"(",)";
+    json += R"("version":")" + std::string(app_desc->version) + R"("},)";
+    json += R"("board":)" + GetBoardJson();
+    json += R"(})";
+    return json;
+}
+
+HostBoard::HostBoard() : audio_codec_(16000, 24000, true) {
+}
+
+std::string HostBoard::GetBoardJson() {
+    return R"({"type":"host","name":"host","mac":")" + SystemInfo::GetMacAddress() + R"("})";
+}
+
+std::string HostBoard::GetDeviceStatusJson() {
+    return R"({"audio_speaker":{"volume":)" + std::to_string(audio_codec_.output_volume()) + R"(},"network":{"type":"wifi"}})";
+}
+
+DECLARE_BOARD(HostBoard);
@@ -0,0 +1,38 @@
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+#include "board.h"
+#include "wav_audio_codec.h"
+#include "loopback_network.h"
+
+/*
+ * The board of the host build: a Wi-Fi board whose network is a LoopbackNetwork and
+ * whose audio codec is a WavAudioCodec. The codec runs at 16 kHz in and 24 kHz out
+ * like most boards and is paced in real time.
+ */
+class HostBoard : public Board {
+public:
+    static HostBoard& GetInstance() {
+        return static_cast<HostBoard&>(Board::GetInstance());
+    }
+
+    HostBoard();
+
+    std::string GetBoardType() override { return "wifi"; }
+    AudioCodec* GetAudioCodec() override { return &audio_codec_; }
+    NetworkInterface* GetNetwork() override { return &network_; }
+    void StartNetwork() override {}
+    const char* GetNetworkStateIcon() override { return ""; }
+    void SetPowerSaveLevel(PowerSaveLevel level) override {}
+    std::string GetBoardJson() override;
+    std::string GetDeviceStatusJson() override;
+
+    WavAudioCodec& audio_codec() { return audio_codec_; }
+    LoopbackNetwork& network() { return network_; }
+
+private:
+    WavAudioCodec audio_codec_;
+    LoopbackNetwork network_;
+};
+
+#endif // HOST_BOARD_H
@@ -0,0 +1,39 @@
+#include "system_info.h"
+
+#include <esp_system.h>
+
+// The host has no chip, the values stand for a board with 16 MB flash
+
+size_t SystemInfo::GetFlashSize() {
+    return 16 * 1024 * 1024;
+}
+
+size_t SystemInfo::GetMinimumFreeHeapSize() {
+    return esp_get_minimum_free_heap_size();
+}
+
+size_t SystemInfo::GetFreeHeapSize() {
+    return esp_get_free_heap_size();
+}
+
+std::string SystemInfo::GetMacAddress() {
+    return "02:00:00:00:00:01";
+}
+
+std::string SystemInfo::GetChipModelName() {
+    return "host";
+}
+
+std::string SystemInfo::GetUserAgent() {
+    return "host/host";
+}
+
+esp_err_t SystemInfo::PrintTaskCpuUsage(TickType_t xTicksToWait) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void SystemInfo::PrintTaskList() {
+}
+
+void SystemInfo::PrintHeapStats() {
+}
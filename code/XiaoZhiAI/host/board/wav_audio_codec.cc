@@ -0,0 +1,186 @@
+#include "wav_audio_codec.h"
+
+#include <esp_log.h>
+
+#include <cstring>
+#include <thread>
+
+#define TAG "WavAudioCodec"
+
+// A transfer later than this restarts the pacing instead of catching up, like a DMA overrun
+#define WAV_AUDIO_MAX_LAG_MS 100
+
+struct WavChunkHeader {
+    char id[4];
+    uint32_t size;
+} __attribute__((packed));
+
+struct WavFormat {
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+} __attribute__((packed));
+
+WavAudioCodec::WavAudioCodec(int input_sample_rate, int output_sample_rate, bool paced) : paced_(paced) {
+    duplex_ = true;
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+}
+
+WavAudioCodec::~WavAudioCodec() {
+    CloseOutputWav();
+}
+
+bool WavAudioCodec::OpenInputWav(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+        return false;
+    }
+
+    char riff[12];
+    bool has_format = false;
+    std::vector<int16_t> samples;
+    if (fread(riff, 1, sizeof(riff), file) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+        fclose(file);
+        return false;
+    }
+
+    WavChunkHeader chunk;
+    while (fread(&chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+        if (memcmp(chunk.id, "fmt ", 4) == 0) {
+            WavFormat format;
+            if (chunk.size < sizeof(format) || fread(&format, 1, sizeof(format), file) != sizeof(format)) {
+                break;
+            }
+            if (format.format != 1 || format.channels != 1 || format.bits_per_sample != 16 ||
+                (int)format.sample_rate != input_sample_rate_) {
+                ESP_LOGE(TAG, "%s must be 16-bit mono PCM at %d Hz", path.c_str(), input_sample_rate_);
+                fclose(file);
+                return false;
+            }
+            has_format = true;
+            fseek(file, chunk.size - sizeof(format) + (chunk.size & 1), SEEK_CUR);
+        } else if (memcmp(chunk.id, "data", 4) == 0 && has_format) {
+            samples.resize(chunk.size / sizeof(int16_t));
+            samples.resize(fread(samples.data(), sizeof(int16_t), samples.size(), file));
+            break;
+        } else {
+            fseek(file, chunk.size + (chunk.size & 1), SEEK_CUR);
+        }
+    }
+    fclose(file);
+
+    if (samples.empty()) {
+        ESP_LOGE(TAG, "No samples in %s", path.c_str());
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    input_samples_ = std::move(samples);
+    input_position_ = 0;
+    return true;
+}
+
+bool WavAudioCodec::OpenOutputWav(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (output_file_ != nullptr) {
+        fclose(output_file_);
+    }
+    output_file_ = fopen(path.c_str(), "wb");
+    if (output_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create %s", path.c_str());
+        return false;
+    }
+    output_bytes_ = 0;
+    WriteOutputHeader();
+    return true;
+}
+
+void WavAudioCodec::CloseOutputWav() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (output_file_ != nullptr) {
+        fclose(output_file_);
+        output_file_ = nullptr;
+    }
+}
+
+void WavAudioCodec::SetInputSource(std::function<void(int16_t* dest, int samples)> source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    input_source_ = std::move(source);
+}
+
+void WavAudioCodec::SetOutputSink(std::function<void(const int16_t* data, int samples)> sink) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_sink_ = std::move(sink);
+}
+
+int WavAudioCodec::Read(int16_t* dest, int samples) {
+    Pace(input_deadline_, samples, input_sample_rate_ * input_channels_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (input_source_) {
+        input_source_(dest, samples);
+    } else if (!input_samples_.empty()) {
+        for (int i = 0; i < samples; i++) {
+            dest[i] = input_samples_[input_position_];
+            input_position_ = (input_position_ + 1) % input_samples_.size();
+        }
+    } else {
+        memset(dest, 0, samples * sizeof(int16_t));
+    }
+    return samples;
+}
+
+int WavAudioCodec::Write(const int16_t* data, int samples) {
+    Pace(output_deadline_, samples, output_sample_rate_ * output_channels_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (output_sink_) {
+        output_sink_(data, samples);
+    }
+    if (output_file_ != nullptr) {
+        fwrite(data, sizeof(int16_t), samples, output_file_);
+        output_bytes_ += samples * sizeof(int16_t);
+        // The header is kept current, the file is complete even if the process is killed
+        WriteOutputHeader();
+    }
+    return samples;
+}
+
+void WavAudioCodec::WriteOutputHeader() {
+    WavFormat format = {
+        .format = 1,
+        .channels = (uint16_t)output_channels_,
+        .sample_rate = (uint32_t)output_sample_rate_,
+        .byte_rate = (uint32_t)(output_sample_rate_ * output_channels_ * sizeof(int16_t)),
+        .block_align = (uint16_t)(output_channels_ * sizeof(int16_t)),
+        .bits_per_sample = 16,
+    };
+    uint32_t riff_size = 4 + sizeof(WavChunkHeader) * 2 + sizeof(format) + output_bytes_;
+    WavChunkHeader riff = {{'R', 'I', 'F', 'F'}, riff_size};
+    WavChunkHeader fmt = {{'f', 'm', 't', ' '}, sizeof(format)};
+    WavChunkHeader data = {{'d', 'a', 't', 'a'}, output_bytes_};
+
+    fseek(output_file_, 0, SEEK_SET);
+    fwrite(&riff, sizeof(riff), 1, output_file_);
+    fwrite("WAVE", 4, 1, output_file_);
+    fwrite(&fmt, sizeof(fmt), 1, output_file_);
+    fwrite(&format, sizeof(format), 1, output_file_);
+    fwrite(&data, sizeof(data), 1, output_file_);
+    fseek(output_file_, 0, SEEK_END);
+    fflush(output_file_);
+}
+
+void WavAudioCodec::Pace(Clock::time_point& deadline, int samples, int sample_rate) {
+    if (!paced_ || sample_rate <= 0) {
+        return;
+    }
+    auto now = Clock::now();
+    if (deadline + std::chrono::milliseconds(WAV_AUDIO_MAX_LAG_MS) < now) {
+        deadline = now;
+    }
+    deadline += std::chrono::microseconds(samples * 1000000LL / sample_rate);
+    std::this_thread::sleep_until(deadline);
+}
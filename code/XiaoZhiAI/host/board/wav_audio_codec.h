@@ -0,0 +1,57 @@
+#ifndef WAV_AUDIO_CODEC_H
+#define WAV_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * An audio codec without hardware. The microphone plays a 16-bit mono WAV file in a loop,
+ * or what the input source generates, and silence otherwise. The speaker writes to a WAV
+ * file and hands its samples to the output sink. When paced, reads and writes take as
+ * long as the samples last, like the I2S DMA on the device.
+ */
+class WavAudioCodec : public AudioCodec {
+public:
+    WavAudioCodec(int input_sample_rate, int output_sample_rate, bool paced);
+    virtual ~WavAudioCodec();
+
+    // The file must have the input sample rate
+    bool OpenInputWav(const std::string& path);
+    bool OpenOutputWav(const std::string& path);
+    void CloseOutputWav();
+
+    // The source replaces the input file, the sink sees the samples before the output file
+    void SetInputSource(std::function<void(int16_t* dest, int samples)> source);
+    void SetOutputSink(std::function<void(const int16_t* data, int samples)> sink);
+    void SetPaced(bool paced) { paced_ = paced; }
+
+protected:
+    int Read(int16_t* dest, int samples) override;
+    int Write(const int16_t* data, int samples) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<bool> paced_;
+    std::mutex mutex_;
+    std::vector<int16_t> input_samples_;
+    size_t input_position_ = 0;
+    FILE* output_file_ = nullptr;
+    uint32_t output_bytes_ = 0;
+    std::function<void(int16_t*, int)> input_source_;
+    std::function<void(const int16_t*, int)> output_sink_;
+    Clock::time_point input_deadline_;
+    Clock::time_point output_deadline_;
+
+    void Pace(Clock::time_point& deadline, int samples, int sample_rate);
+    void WriteOutputHeader();
+};
+
+#endif // WAV_AUDIO_CODEC_H
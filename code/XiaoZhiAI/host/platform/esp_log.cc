@@ -0,0 +1,71 @@
+#include <esp_log.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <esp_timer.h>
+
+static std::mutex log_mutex;
+static std::map<std::string, esp_log_level_t> tag_levels;
+static std::atomic<int> highest_tag_level{ESP_LOG_NONE};
+
+static esp_log_level_t DefaultLevel() {
+    static esp_log_level_t level = []() {
+        const char* env = getenv("HOST_LOG_LEVEL");
+        if (env == nullptr) {
+            return ESP_LOG_WARN;
+        }
+        switch (env[0]) {
+        case 'N': return ESP_LOG_NONE;
+        case 'E': return ESP_LOG_ERROR;
+        case 'W': return ESP_LOG_WARN;
+        case 'I': return ESP_LOG_INFO;
+        case 'D': return ESP_LOG_DEBUG;
+        case 'V': return ESP_LOG_VERBOSE;
+        default: return ESP_LOG_WARN;
+        }
+    }();
+    return level;
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    tag_levels[tag] = level;
+    if (level > highest_tag_level) {
+        highest_tag_level = level;
+    }
+}
+
+int host_log_enabled(esp_log_level_t level) {
+    // Cheap check before the arguments are formatted, per tag levels are applied when the line is written
+    return level <= DefaultLevel() || level <= highest_tag_level;
+}
+
+void host_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    static const char kLetters[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+    std::lock_guard<std::mutex> lock(log_mutex);
+    esp_log_level_t limit = DefaultLevel();
+    auto it = tag_levels.find("*");
+    if (it != tag_levels.end()) {
+        limit = it->second;
+    }
+    it = tag_levels.find(tag);
+    if (it != tag_levels.end()) {
+        limit = it->second;
+    }
+    if (level > limit) {
+        return;
+    }
+
+    fprintf(stderr, "%c (%lld) %s: ", kLetters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
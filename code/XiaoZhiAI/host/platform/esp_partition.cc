@@ -0,0 +1,118 @@
+#include <esp_partition.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define HOST_FLASH_SECTOR_SIZE 4096
+
+namespace {
+
+struct HostPartition {
+    esp_partition_t info;
+    std::vector<uint8_t> data;
+};
+
+std::mutex partitions_mutex;
+std::map<std::string, std::unique_ptr<HostPartition>> partitions;
+
+HostPartition* Find(const esp_partition_t* partition) {
+    std::lock_guard<std::mutex> lock(partitions_mutex);
+    auto it = partitions.find(partition->label);
+    if (it == partitions.end() || &it->second->info != partition) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+}
+
+const esp_partition_t* host_partition_register(const char* label, esp_partition_type_t type, uint32_t size) {
+    std::lock_guard<std::mutex> lock(partitions_mutex);
+    auto& partition = partitions[label];
+    if (partition == nullptr) {
+        partition = std::make_unique<HostPartition>();
+        memset(&partition->info, 0, sizeof(partition->info));
+        strncpy(partition->info.label, label, sizeof(partition->info.label) - 1);
+        partition->info.type = type;
+        partition->info.subtype = ESP_PARTITION_SUBTYPE_ANY;
+        partition->info.erase_size = HOST_FLASH_SECTOR_SIZE;
+    }
+    // Partitions are whole sectors and start erased, also when registered again
+    size = (size + HOST_FLASH_SECTOR_SIZE - 1) / HOST_FLASH_SECTOR_SIZE * HOST_FLASH_SECTOR_SIZE;
+    partition->info.size = size;
+    partition->data.assign(size, 0xFF);
+    return &partition->info;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    std::lock_guard<std::mutex> lock(partitions_mutex);
+    for (auto& [name, partition] : partitions) {
+        if (label != nullptr && name != label) {
+            continue;
+        }
+        if (type != ESP_PARTITION_TYPE_ANY && partition->info.type != type) {
+            continue;
+        }
+        return &partition->info;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    auto host = Find(partition);
+    if (host == nullptr || src_offset + size > host->data.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, host->data.data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    auto host = Find(partition);
+    if (host == nullptr || dst_offset + size > host->data.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto bytes = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < size; i++) {
+        host->data[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    auto host = Find(partition);
+    if (host == nullptr || offset + size > host->data.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset % HOST_FLASH_SECTOR_SIZE != 0 || size % HOST_FLASH_SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(host->data.data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void** out_ptr,
+                             esp_partition_mmap_handle_t* out_handle) {
+    static esp_partition_mmap_handle_t next_handle = 1;
+    auto host = Find(partition);
+    if (host == nullptr || offset + size > host->data.size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The mapping is the partition memory itself, so writes show up like through the flash cache
+    *out_ptr = host->data.data() + offset;
+    std::lock_guard<std::mutex> lock(partitions_mutex);
+    *out_handle = next_handle++;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+}
+
+uint32_t esp_partition_get_main_flash_sector_size(void) {
+    return HOST_FLASH_SECTOR_SIZE;
+}
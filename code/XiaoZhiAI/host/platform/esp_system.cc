@@ -0,0 +1,145 @@
+#include <esp_system.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_app_desc.h>
+#include <esp_pthread.h>
+#include <esp_pm.h>
+#include <driver/i2s_common.h>
+#include <spi_flash_mmap.h>
+
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#define TAG "HostSystem"
+
+static std::mutex shutdown_mutex;
+static std::vector<shutdown_handler_t> shutdown_handlers;
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle) {
+    std::lock_guard<std::mutex> lock(shutdown_mutex);
+    for (auto handler : shutdown_handlers) {
+        if (handler == handle) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    shutdown_handlers.push_back(handle);
+    return ESP_OK;
+}
+
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handle) {
+    std::lock_guard<std::mutex> lock(shutdown_mutex);
+    for (auto it = shutdown_handlers.begin(); it != shutdown_handlers.end(); ++it) {
+        if (*it == handle) {
+            shutdown_handlers.erase(it);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+void esp_restart(void) {
+    std::vector<shutdown_handler_t> handlers;
+    {
+        std::lock_guard<std::mutex> lock(shutdown_mutex);
+        handlers = shutdown_handlers;
+    }
+    // Like ESP-IDF the handlers run in reverse order of registration
+    for (auto it = handlers.rbegin(); it != handlers.rend(); ++it) {
+        (*it)();
+    }
+    ESP_LOGW(TAG, "Restart requested, exiting");
+    std::_Exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 8 * 1024 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void) {
+    return 8 * 1024 * 1024;
+}
+
+const esp_app_desc_t* esp_app_get_description(void) {
+    static const esp_app_desc_t desc = {
+        .magic_word = 0xABCD5432,
+        .secure_version = 0,
+        .reserv1 = {},
+        .version = "host",
+        .project_name = "xiaozhi",
+        .time = __TIME__,
+        .date = __DATE__,
+        .idf_ver = "host",
+        .app_elf_sha256 = {},
+        .reserv2 = {},
+    };
+    return &desc;
+}
+
+esp_pthread_cfg_t esp_pthread_get_default_config(void) {
+    esp_pthread_cfg_t cfg = {
+        .stack_size = 4096,
+        .prio = 5,
+        .inherit_cfg = false,
+        .thread_name = nullptr,
+        .pin_to_core = -1,
+        .stack_alloc_caps = 0,
+    };
+    return cfg;
+}
+
+esp_err_t esp_pthread_set_cfg(const esp_pthread_cfg_t* cfg) {
+    return ESP_OK;
+}
+
+esp_err_t esp_pthread_get_cfg(esp_pthread_cfg_t* cfg) {
+    *cfg = esp_pthread_get_default_config();
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_configure(const void* config) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char* name, esp_pm_lock_handle_t* out_handle) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t handle) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+uint32_t spi_flash_mmap_get_free_pages(spi_flash_mmap_memory_t memory) {
+    return 64;
+}
@@ -0,0 +1,172 @@
+#include <esp_timer.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+struct HostTimer {
+    esp_timer_create_args_t args;
+    bool active = false;
+    bool deleted = false;
+    int64_t due_us = 0;
+    int64_t period_us = 0;      // 0 for one-shot timers
+};
+
+namespace {
+
+class TimerService {
+public:
+    static TimerService& GetInstance() {
+        // Never destroyed, the dispatch thread runs until the process exits
+        static TimerService* instance = new TimerService();
+        return *instance;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::set<HostTimer*> timers_;
+    HostTimer* running_ = nullptr;
+    std::thread::id dispatch_thread_;
+
+    void Start(HostTimer* timer, int64_t timeout_us, int64_t period_us) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timer->active = true;
+            timer->due_us = esp_timer_get_time() + timeout_us;
+            timer->period_us = period_us;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    TimerService() {
+        std::thread thread([this]() { Dispatch(); });
+        dispatch_thread_ = thread.get_id();
+        thread.detach();
+    }
+
+    void Dispatch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            HostTimer* next = nullptr;
+            for (auto timer : timers_) {
+                if (timer->active && (next == nullptr || timer->due_us < next->due_us)) {
+                    next = timer;
+                }
+            }
+            if (next == nullptr) {
+                cv_.wait(lock);
+                continue;
+            }
+            int64_t now = esp_timer_get_time();
+            if (next->due_us > now) {
+                cv_.wait_for(lock, std::chrono::microseconds(next->due_us - now));
+                continue;
+            }
+
+            if (next->period_us > 0) {
+                next->due_us += next->period_us;
+                if (next->args.skip_unhandled_events && next->due_us <= now) {
+                    next->due_us = now + next->period_us;
+                }
+            } else {
+                next->active = false;
+            }
+            running_ = next;
+            lock.unlock();
+            next->args.callback(next->args.arg);
+            lock.lock();
+            running_ = nullptr;
+            if (next->deleted) {
+                timers_.erase(next);
+                delete next;
+            }
+            cv_.notify_all();
+        }
+    }
+};
+
+}
+
+int64_t esp_timer_get_time(void) {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto& service = TimerService::GetInstance();
+    auto timer = new HostTimer();
+    timer->args = *create_args;
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    service.timers_.insert(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (esp_timer_is_active(timer)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    TimerService::GetInstance().Start(timer, timeout_us, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    if (timer == nullptr || period == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (esp_timer_is_active(timer)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    TimerService::GetInstance().Start(timer, period, period);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto& service = TimerService::GetInstance();
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto& service = TimerService::GetInstance();
+    std::unique_lock<std::mutex> lock(service.mutex_);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (service.running_ == timer) {
+        if (std::this_thread::get_id() == service.dispatch_thread_) {
+            // Deleted from its own callback, freed once the callback returns
+            timer->deleted = true;
+            return ESP_OK;
+        }
+        service.cv_.wait(lock, [&service, timer]() { return service.running_ != timer; });
+    }
+    service.timers_.erase(timer);
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    auto& service = TimerService::GetInstance();
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    return timer->active;
+}
@@ -0,0 +1,207 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HostTask {
+    std::string name;
+    std::atomic<UBaseType_t> priority{0};
+    pthread_t thread = {};
+    std::atomic<bool> deleted{false};
+
+    std::mutex notify_mutex;
+    std::condition_variable notify_cv;
+    uint32_t notify_value = 0;
+};
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+// Tasks are never freed, other tasks may still notify a task after it has ended
+static thread_local HostTask* current_task = nullptr;
+static const auto start_time = std::chrono::steady_clock::now();
+
+static std::chrono::milliseconds TicksToDuration(TickType_t ticks) {
+    return std::chrono::milliseconds(pdTICKS_TO_MS(ticks));
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* created_task) {
+    // Threads get the default pthread stack, host builds need more stack than the firmware
+    auto task = new HostTask();
+    task->name = name != nullptr ? name : "";
+    task->priority = priority;
+    try {
+        std::thread thread([task, function, arg]() {
+            task->thread = pthread_self();
+            current_task = task;
+            function(arg);
+        });
+        thread.detach();
+    } catch (const std::system_error&) {
+        delete task;
+        return pdFAIL;
+    }
+    if (created_task != nullptr) {
+        *created_task = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core_id) {
+    return xTaskCreate(function, name, stack_depth, arg, priority, created_task);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    task->deleted = true;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(TicksToDuration(ticks));
+}
+
+TickType_t xTaskGetTickCount(void) {
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return pdMS_TO_TICKS(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    // Threads not created by xTaskCreate, like main(), become tasks on first use
+    if (current_task == nullptr) {
+        current_task = new HostTask();
+        current_task->name = "main";
+        current_task->priority = 1;
+        current_task->thread = pthread_self();
+    }
+    return current_task;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    if (task == nullptr) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return const_cast<char*>(task->name.c_str());
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    if (task == nullptr) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return task->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    if (task == nullptr) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    task->priority = priority;
+}
+
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task) {
+    if (task == nullptr) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    clockid_t clock;
+    struct timespec ts;
+    if (task->deleted || pthread_getcpuclockid(task->thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> lock(task->notify_mutex);
+        task->notify_value++;
+    }
+    task->notify_cv.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    auto task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->notify_mutex);
+    auto ready = [task]() { return task->notify_value != 0; };
+    if (ticks_to_wait == portMAX_DELAY) {
+        task->notify_cv.wait(lock, ready);
+    } else {
+        task->notify_cv.wait_for(lock, TicksToDuration(ticks_to_wait), ready);
+    }
+    uint32_t value = task->notify_value;
+    if (value != 0) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t result;
+    {
+        std::lock_guard<std::mutex> lock(group->mutex);
+        group->bits |= bits;
+        result = group->bits;
+    }
+    group->cv.notify_all();
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [group, bits, wait_for_all]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool ok;
+    if (ticks_to_wait == portMAX_DELAY) {
+        group->cv.wait(lock, satisfied);
+        ok = true;
+    } else {
+        ok = group->cv.wait_for(lock, TicksToDuration(ticks_to_wait), satisfied);
+    }
+    // Like FreeRTOS the bits are returned as they were before clearing
+    EventBits_t result = group->bits;
+    if (ok && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
@@ -0,0 +1,109 @@
+#include <esp_heap_caps.h>
+#include "host_runtime.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+// Budgets of an ESP32-S3 with 8 MB of PSRAM
+#define HOST_INTERNAL_HEAP_BYTES (320 * 1024)
+#define HOST_SPIRAM_HEAP_BYTES (8 * 1024 * 1024)
+
+namespace {
+
+struct HeapPool {
+    size_t budget;
+    size_t used = 0;
+    size_t peak = 0;
+};
+
+struct HeapState {
+    std::mutex mutex;
+    HeapPool internal{HOST_INTERNAL_HEAP_BYTES};
+    HeapPool spiram{HOST_SPIRAM_HEAP_BYTES};
+    std::unordered_map<void*, std::pair<size_t, HeapPool*>> allocations;
+};
+
+HeapState& GetState() {
+    // Never destroyed, memory may still be freed while the process exits
+    static HeapState* state = new HeapState();
+    return *state;
+}
+
+HeapPool& PoolFor(HeapState& state, uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? state.spiram : state.internal;
+}
+
+void* Allocate(size_t alignment, size_t size, uint32_t caps) {
+    HostCountAllocation(size);
+    // The bookkeeping is not an allocation of the device
+    HostUncountedScope uncounted;
+    auto& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto& pool = PoolFor(state, caps);
+    if (size == 0 || pool.used + size > pool.budget) {
+        return nullptr;
+    }
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, std::max(alignment, sizeof(void*)), size) != 0) {
+        return nullptr;
+    }
+    pool.used += size;
+    pool.peak = std::max(pool.peak, pool.used);
+    state.allocations[ptr] = {size, &pool};
+    return ptr;
+}
+
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return Allocate(alignof(max_align_t), size, caps);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    void* ptr = Allocate(alignof(max_align_t), n * size, caps);
+    if (ptr != nullptr) {
+        std::fill_n(static_cast<char*>(ptr), n * size, 0);
+    }
+    return ptr;
+}
+
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    return Allocate(alignment, size, caps);
+}
+
+void heap_caps_free(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    HostUncountedScope uncounted;
+    auto& state = GetState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.allocations.find(ptr);
+        if (it != state.allocations.end()) {
+            it->second.second->used -= it->second.first;
+            state.allocations.erase(it);
+        }
+    }
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    auto& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto& pool = PoolFor(state, caps);
+    return pool.budget - pool.used;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    auto& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto& pool = PoolFor(state, caps);
+    return pool.budget - pool.peak;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
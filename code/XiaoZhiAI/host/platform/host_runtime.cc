@@ -0,0 +1,41 @@
+#include "host_runtime.h"
+
+#include <atomic>
+
+static thread_local int uncounted_depth = 0;
+static std::atomic<uint64_t> allocation_count{0};
+static std::atomic<uint64_t> allocation_bytes{0};
+
+void HostCountAllocation(size_t size) {
+    if (uncounted_depth == 0) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+HostAllocations HostGetAllocations() {
+    HostAllocations allocations;
+    allocations.count = allocation_count.load(std::memory_order_relaxed);
+    allocations.bytes = allocation_bytes.load(std::memory_order_relaxed);
+    return allocations;
+}
+
+HostUncountedScope::HostUncountedScope() {
+    uncounted_depth++;
+}
+
+HostUncountedScope::~HostUncountedScope() {
+    uncounted_depth--;
+}
+
+bool HostUncountedScope::active() {
+    return uncounted_depth > 0;
+}
+
+HostCountedScope::HostCountedScope() : saved_depth_(uncounted_depth) {
+    uncounted_depth = 0;
+}
+
+HostCountedScope::~HostCountedScope() {
+    uncounted_depth = saved_depth_;
+}
@@ -0,0 +1,51 @@
+#ifndef HOST_RUNTIME_H
+#define HOST_RUNTIME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/*
+ * Hooks of the host runtime that have no counterpart on the device.
+ */
+
+// Receives what Application::SendMcpMessage() would send to the server
+void HostSetMcpSink(std::function<void(const std::string& payload)> sink);
+
+struct HostAllocations {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Counts an allocation of the device code, unless a HostUncountedScope is alive on the
+// calling thread. heap_caps_malloc() counts itself, operator new is counted by the benchmarks.
+void HostCountAllocation(size_t size);
+// Allocations counted since the process started
+HostAllocations HostGetAllocations();
+
+// Allocations made while a scope is alive on the calling thread are not counted by the
+// benchmarks, the loopback servers use it so only the device side shows up in the numbers
+class HostUncountedScope {
+public:
+    HostUncountedScope();
+    ~HostUncountedScope();
+    HostUncountedScope(const HostUncountedScope&) = delete;
+    HostUncountedScope& operator=(const HostUncountedScope&) = delete;
+
+    static bool active();
+};
+
+// Like the reverse of HostUncountedScope, for device callbacks invoked from harness threads
+class HostCountedScope {
+public:
+    HostCountedScope();
+    ~HostCountedScope();
+    HostCountedScope(const HostCountedScope&) = delete;
+    HostCountedScope& operator=(const HostCountedScope&) = delete;
+
+private:
+    int saved_depth_;
+};
+
+#endif // HOST_RUNTIME_H
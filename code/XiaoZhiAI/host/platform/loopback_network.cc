@@ -0,0 +1,733 @@
+#include "loopback_network.h"
+#include "host_runtime.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#define TAG "Loopback"
+
+static std::string MakeAddress(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+LoopbackDelivery::~LoopbackDelivery() {
+    Stop();
+}
+
+void LoopbackDelivery::Start() {
+    Stop();
+    HostUncountedScope uncounted;
+    auto state = std::make_shared<State>();
+    state_ = state;
+    thread_ = std::thread([state]() {
+        HostUncountedScope uncounted;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (true) {
+            state->cv.wait(lock, [&state]() { return state->stopped || !state->tasks.empty(); });
+            if (state->stopped) {
+                break;
+            }
+            auto task = std::move(state->tasks.front());
+            state->tasks.pop_front();
+            lock.unlock();
+            {
+                HostCountedScope counted;
+                task();
+            }
+            task = nullptr;
+            lock.lock();
+        }
+    });
+}
+
+void LoopbackDelivery::Stop() {
+    if (!state_) {
+        return;
+    }
+    HostUncountedScope uncounted;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stopped = true;
+        state_->tasks.clear();
+    }
+    state_->cv.notify_all();
+    if (thread_.get_id() == std::this_thread::get_id()) {
+        // The task that stops the delivery is still running, the thread ends after it
+        thread_.detach();
+    } else if (thread_.joinable()) {
+        thread_.join();
+    }
+    state_.reset();
+}
+
+void LoopbackDelivery::Push(std::function<void()> task) {
+    if (!state_) {
+        return;
+    }
+    HostUncountedScope uncounted;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->stopped) {
+            return;
+        }
+        state_->tasks.push_back(std::move(task));
+    }
+    state_->cv.notify_one();
+}
+
+// A stream connection, data sent by the server before the device set its callback is kept until then
+class LoopbackTcp : public Tcp, public LoopbackLink {
+public:
+    LoopbackTcp(LoopbackNetwork* network) : network_(network) {}
+
+    ~LoopbackTcp() {
+        Disconnect();
+    }
+
+    bool Connect(const std::string& host, int port) override {
+        Disconnect();
+        auto server = network_->FindTcpServer(host, port);
+        if (server == nullptr) {
+            ESP_LOGE(TAG, "No TCP server at %s:%d", host.c_str(), port);
+            last_error_ = -1;
+            return false;
+        }
+        HostUncountedScope uncounted;
+        delivery_.Start();
+        session_ = server->Accept(this);
+        if (!session_) {
+            delivery_.Stop();
+            last_error_ = -1;
+            return false;
+        }
+        connected_ = true;
+        return true;
+    }
+
+    void Disconnect() override {
+        std::unique_ptr<LoopbackSession> session;
+        {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            if (!connected_) {
+                return;
+            }
+            connected_ = false;
+            session = std::move(session_);
+        }
+        delivery_.Stop();
+        {
+            HostUncountedScope uncounted;
+            session->OnClose();
+            session.reset();
+        }
+        // Like EspTcp, a local disconnect is reported too
+        auto callback = disconnect_callback_;
+        if (callback) {
+            callback();
+        }
+    }
+
+    int Send(const std::string& data) override {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (!connected_ || !session_) {
+            last_error_ = -1;
+            return -1;
+        }
+        HostUncountedScope uncounted;
+        session_->OnData(data);
+        return data.size();
+    }
+
+    void OnStream(std::function<void(const std::string& data)> callback) override {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        stream_callback_ = std::move(callback);
+        if (stream_callback_ && !pending_.empty()) {
+            delivery_.Push([this, data = std::move(pending_)]() {
+                DeliverToDevice(data);
+            });
+            pending_.clear();
+        }
+    }
+
+    int GetLastError() override {
+        return last_error_;
+    }
+
+    void Deliver(std::string data) override {
+        delivery_.Push([this, data = std::move(data)]() {
+            DeliverToDevice(data);
+        });
+    }
+
+    void Close() override {
+        delivery_.Push([this]() {
+            std::unique_ptr<LoopbackSession> session;
+            {
+                std::lock_guard<std::mutex> lock(send_mutex_);
+                if (!connected_) {
+                    return;
+                }
+                connected_ = false;
+                session = std::move(session_);
+            }
+            {
+                HostUncountedScope uncounted;
+                session.reset();
+            }
+            // The device may delete the connection from its callback
+            auto callback = disconnect_callback_;
+            if (callback) {
+                callback();
+            }
+        });
+    }
+
+private:
+    LoopbackNetwork* network_;
+    LoopbackDelivery delivery_;
+    std::unique_ptr<LoopbackSession> session_;
+    std::mutex send_mutex_;
+    std::mutex callback_mutex_;
+    std::string pending_;
+    int last_error_ = 0;
+
+    void DeliverToDevice(const std::string& data) {
+        std::function<void(const std::string&)> callback;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            if (!stream_callback_) {
+                HostUncountedScope uncounted;
+                pending_ += data;
+                return;
+            }
+            callback = stream_callback_;
+        }
+        callback(data);
+    }
+};
+
+// A datagram connection, every Send is one message to the server and every Deliver one to the device
+class LoopbackUdp : public Udp, public LoopbackLink {
+public:
+    LoopbackUdp(LoopbackNetwork* network) : network_(network) {}
+
+    ~LoopbackUdp() {
+        Disconnect();
+    }
+
+    bool Connect(const std::string& host, int port) override {
+        Disconnect();
+        auto server = network_->FindUdpServer(host, port);
+        if (server == nullptr) {
+            ESP_LOGE(TAG, "No UDP server at %s:%d", host.c_str(), port);
+            last_error_ = -1;
+            return false;
+        }
+        HostUncountedScope uncounted;
+        delivery_.Start();
+        session_ = server->Accept(this);
+        if (!session_) {
+            delivery_.Stop();
+            last_error_ = -1;
+            return false;
+        }
+        connected_ = true;
+        return true;
+    }
+
+    void Disconnect() override {
+        std::unique_ptr<LoopbackSession> session;
+        {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            if (!connected_) {
+                return;
+            }
+            connected_ = false;
+            session = std::move(session_);
+        }
+        delivery_.Stop();
+        HostUncountedScope uncounted;
+        session->OnClose();
+        session.reset();
+    }
+
+    int Send(const std::string& data) override {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (!connected_ || !session_) {
+            last_error_ = -1;
+            return -1;
+        }
+        HostUncountedScope uncounted;
+        session_->OnData(data);
+        return data.size();
+    }
+
+    int GetLastError() override {
+        return last_error_;
+    }
+
+    void Deliver(std::string data) override {
+        delivery_.Push([this, data = std::move(data)]() {
+            // Datagrams that arrive before the device listens are lost, as on a socket
+            if (message_callback_) {
+                message_callback_(data);
+            }
+        });
+    }
+
+    void Close() override {
+        // UDP has no connection to close, the device only stops hearing from the server
+        delivery_.Push([this]() {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            connected_ = false;
+        });
+    }
+
+private:
+    LoopbackNetwork* network_;
+    LoopbackDelivery delivery_;
+    std::unique_ptr<LoopbackSession> session_;
+    std::mutex send_mutex_;
+    int last_error_ = 0;
+};
+
+// The request is answered by the handler when it is opened, the body is then read from memory.
+// Data written after Open() is accepted but does not reach the handler.
+class LoopbackHttp : public Http {
+public:
+    LoopbackHttp(LoopbackNetwork* network) : network_(network) {
+        static std::atomic<int> next_connection{1};
+        request_.connection = next_connection++;
+    }
+
+    void SetTimeout(int timeout_ms) override {}
+
+    void SetHeader(const std::string& key, const std::string& value) override {
+        request_.headers[key] = value;
+    }
+
+    void SetContent(std::string&& content) override {
+        request_.content = std::move(content);
+    }
+
+    void SetKeepAlive(bool enable) override {
+        keep_alive_ = enable;
+    }
+
+    bool Open(const std::string& method, const std::string& url) override {
+        auto handler = network_->FindHttpHandler(url);
+        if (!handler) {
+            ESP_LOGE(TAG, "No HTTP handler for %s", url.c_str());
+            last_error_ = -1;
+            return false;
+        }
+        HostUncountedScope uncounted;
+        request_.method = method;
+        request_.url = url;
+        response_ = handler(request_);
+        if (response_.headers.find("Content-Length") == response_.headers.end()) {
+            response_.headers["Content-Length"] = std::to_string(response_.body.size());
+        }
+        if (response_.headers.find("Connection") == response_.headers.end()) {
+            response_.headers["Connection"] = keep_alive_ ? "keep-alive" : "close";
+        }
+        read_offset_ = 0;
+        is_open_ = true;
+        return true;
+    }
+
+    void Close() override {
+        HostUncountedScope uncounted;
+        is_open_ = false;
+        request_.content.clear();
+        response_ = LoopbackHttpResponse();
+        read_offset_ = 0;
+    }
+
+    int Read(char* buffer, size_t buffer_size) override {
+        if (!is_open_) {
+            last_error_ = -1;
+            return -1;
+        }
+        size_t size = std::min(buffer_size, response_.body.size() - read_offset_);
+        memcpy(buffer, response_.body.data() + read_offset_, size);
+        read_offset_ += size;
+        return size;
+    }
+
+    int Write(const char* buffer, size_t buffer_size) override {
+        if (!is_open_) {
+            last_error_ = -1;
+            return -1;
+        }
+        return buffer_size;
+    }
+
+    int GetStatusCode() override {
+        return is_open_ ? response_.status_code : -1;
+    }
+
+    std::string GetResponseHeader(const std::string& key) const override {
+        for (const auto& header : response_.headers) {
+            if (strcasecmp(header.first.c_str(), key.c_str()) == 0) {
+                return header.second;
+            }
+        }
+        return "";
+    }
+
+    size_t GetBodyLength() override {
+        return response_.body.size();
+    }
+
+    std::string ReadAll() override {
+        std::string body = response_.body.substr(read_offset_);
+        read_offset_ = response_.body.size();
+        return body;
+    }
+
+    int GetLastError() override {
+        return last_error_;
+    }
+
+private:
+    LoopbackNetwork* network_;
+    LoopbackHttpRequest request_;
+    LoopbackHttpResponse response_;
+    size_t read_offset_ = 0;
+    bool keep_alive_ = false;
+    bool is_open_ = false;
+    int last_error_ = 0;
+};
+
+void LoopbackNetwork::AddTcpServer(const std::string& host, int port, LoopbackServer* server) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tcp_servers_[MakeAddress(host, port)] = server;
+}
+
+void LoopbackNetwork::AddUdpServer(const std::string& host, int port, LoopbackServer* server) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    udp_servers_[MakeAddress(host, port)] = server;
+}
+
+void LoopbackNetwork::SetMqttBroker(const std::string& host, int port, LoopbackMqttBroker* broker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mqtt_brokers_[MakeAddress(host, port)] = broker;
+}
+
+void LoopbackNetwork::AddHttpHandler(const std::string& url_prefix, LoopbackHttpHandler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    http_handlers_[url_prefix] = std::move(handler);
+}
+
+void LoopbackNetwork::RemoveServers() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tcp_servers_.clear();
+    udp_servers_.clear();
+    mqtt_brokers_.clear();
+    http_handlers_.clear();
+}
+
+std::unique_ptr<Http> LoopbackNetwork::CreateHttp(int connect_id) {
+    return std::make_unique<LoopbackHttp>(this);
+}
+
+std::unique_ptr<Tcp> LoopbackNetwork::CreateTcp(int connect_id) {
+    return std::make_unique<LoopbackTcp>(this);
+}
+
+std::unique_ptr<Tcp> LoopbackNetwork::CreateSsl(int connect_id) {
+    return std::make_unique<LoopbackTcp>(this);
+}
+
+std::unique_ptr<Udp> LoopbackNetwork::CreateUdp(int connect_id) {
+    return std::make_unique<LoopbackUdp>(this);
+}
+
+std::unique_ptr<Mqtt> LoopbackNetwork::CreateMqtt(int connect_id) {
+    return std::make_unique<LoopbackMqttClient>(this);
+}
+
+std::unique_ptr<WebSocket> LoopbackNetwork::CreateWebSocket(int connect_id) {
+    return std::make_unique<WebSocket>(this, connect_id);
+}
+
+LoopbackServer* LoopbackNetwork::FindTcpServer(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tcp_servers_.find(MakeAddress(host, port));
+    return it != tcp_servers_.end() ? it->second : nullptr;
+}
+
+LoopbackServer* LoopbackNetwork::FindUdpServer(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = udp_servers_.find(MakeAddress(host, port));
+    return it != udp_servers_.end() ? it->second : nullptr;
+}
+
+LoopbackMqttBroker* LoopbackNetwork::FindMqttBroker(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = mqtt_brokers_.find(MakeAddress(host, port));
+    return it != mqtt_brokers_.end() ? it->second : nullptr;
+}
+
+LoopbackHttpHandler LoopbackNetwork::FindHttpHandler(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const LoopbackHttpHandler* best = nullptr;
+    size_t best_length = 0;
+    for (const auto& [prefix, handler] : http_handlers_) {
+        if (url.compare(0, prefix.size(), prefix) == 0 && (best == nullptr || prefix.size() > best_length)) {
+            best = &handler;
+            best_length = prefix.size();
+        }
+    }
+    return best != nullptr ? *best : LoopbackHttpHandler();
+}
+
+LoopbackMqttClient::LoopbackMqttClient(LoopbackNetwork* network) : network_(network) {
+}
+
+LoopbackMqttClient::~LoopbackMqttClient() {
+    Disconnect();
+}
+
+bool LoopbackMqttClient::Connect(const std::string broker_address, int broker_port, const std::string client_id, const std::string username, const std::string password) {
+    Disconnect();
+    auto broker = network_->FindMqttBroker(broker_address, broker_port);
+    if (broker == nullptr) {
+        ESP_LOGE(TAG, "No MQTT broker at %s:%d", broker_address.c_str(), broker_port);
+        last_error_ = -1;
+        return false;
+    }
+    HostUncountedScope uncounted;
+    delivery_.Start();
+    if (!broker->OnConnect(this, client_id)) {
+        delivery_.Stop();
+        last_error_ = -1;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        broker_ = broker;
+        connected_ = true;
+    }
+    // The connected event comes from the client task, like with esp-mqtt
+    delivery_.Push([this]() {
+        if (on_connected_callback_) {
+            on_connected_callback_();
+        }
+    });
+    return true;
+}
+
+void LoopbackMqttClient::Disconnect() {
+    LoopbackMqttBroker* broker;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!connected_) {
+            return;
+        }
+        connected_ = false;
+        broker = broker_;
+        broker_ = nullptr;
+    }
+    delivery_.Stop();
+    HostUncountedScope uncounted;
+    broker->OnDisconnect(this);
+}
+
+bool LoopbackMqttClient::Publish(const std::string topic, const std::string payload, int qos) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!connected_) {
+        last_error_ = -1;
+        return false;
+    }
+    HostUncountedScope uncounted;
+    broker_->OnPublish(this, topic, payload);
+    return true;
+}
+
+bool LoopbackMqttClient::Subscribe(const std::string topic, int qos) {
+    // The broker decides what reaches the client
+    return IsConnected();
+}
+
+bool LoopbackMqttClient::Unsubscribe(const std::string topic) {
+    return IsConnected();
+}
+
+bool LoopbackMqttClient::IsConnected() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connected_;
+}
+
+void LoopbackMqttClient::Deliver(const std::string& topic, const std::string& payload) {
+    delivery_.Push([this, topic, payload]() {
+        if (on_message_callback_) {
+            on_message_callback_(topic, payload);
+        }
+    });
+}
+
+void LoopbackMqttClient::CloseFromBroker() {
+    delivery_.Push([this]() {
+        LoopbackMqttBroker* broker;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!connected_) {
+                return;
+            }
+            connected_ = false;
+            broker = broker_;
+            broker_ = nullptr;
+        }
+        {
+            HostUncountedScope uncounted;
+            broker->OnDisconnect(this);
+        }
+        auto callback = on_disconnected_callback_;
+        if (callback) {
+            callback();
+        }
+    });
+}
+
+void LoopbackWebSocketSession::OnData(const std::string& data) {
+    buffer_ += data;
+
+    if (!handshake_done_) {
+        auto end = buffer_.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            return;
+        }
+        std::map<std::string, std::string> headers;
+        size_t pos = buffer_.find("\r\n");
+        while (pos < end) {
+            size_t line_end = buffer_.find("\r\n", pos + 2);
+            std::string line = buffer_.substr(pos + 2, line_end - pos - 2);
+            auto colon = line.find(':');
+            if (colon != std::string::npos) {
+                auto value = line.find_first_not_of(' ', colon + 1);
+                headers[line.substr(0, colon)] = value != std::string::npos ? line.substr(value) : "";
+            }
+            pos = line_end;
+        }
+        buffer_.erase(0, end + 4);
+
+        if (!OnHandshake(headers)) {
+            link_->Deliver("HTTP/1.1 401 Unauthorized\r\nContent-Length: 0\r\n\r\n");
+            link_->Close();
+            return;
+        }
+        // The client does not check Sec-WebSocket-Accept
+        link_->Deliver("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n");
+        handshake_done_ = true;
+    }
+
+    while (buffer_.size() >= 2) {
+        auto bytes = reinterpret_cast<const uint8_t*>(buffer_.data());
+        bool fin = (bytes[0] & 0x80) != 0;
+        uint8_t opcode = bytes[0] & 0x0F;
+        bool masked = (bytes[1] & 0x80) != 0;
+        uint64_t length = bytes[1] & 0x7F;
+        size_t header_size = 2;
+        if (length == 126) {
+            if (buffer_.size() < 4) {
+                return;
+            }
+            length = (bytes[2] << 8) | bytes[3];
+            header_size = 4;
+        } else if (length == 127) {
+            if (buffer_.size() < 10) {
+                return;
+            }
+            length = 0;
+            for (int i = 0; i < 8; i++) {
+                length = (length << 8) | bytes[2 + i];
+            }
+            header_size = 10;
+        }
+        size_t mask_offset = header_size;
+        if (masked) {
+            header_size += 4;
+        }
+        if (buffer_.size() < header_size + length) {
+            return;
+        }
+
+        std::string payload = buffer_.substr(header_size, length);
+        if (masked) {
+            for (size_t i = 0; i < payload.size(); i++) {
+                payload[i] ^= bytes[mask_offset + (i % 4)];
+            }
+        }
+        buffer_.erase(0, header_size + length);
+
+        switch (opcode) {
+            case 0x0:
+            case 0x1:
+            case 0x2:
+                if (opcode != 0x0) {
+                    message_binary_ = opcode == 0x2;
+                    message_.clear();
+                }
+                message_ += payload;
+                if (fin) {
+                    if (message_binary_) {
+                        OnBinary(message_);
+                    } else {
+                        OnText(message_);
+                    }
+                    message_.clear();
+                }
+                break;
+            case 0x8:
+                SendFrame(0x8, payload.data(), payload.size());
+                link_->Close();
+                return;
+            case 0x9:
+                SendFrame(0xA, payload.data(), payload.size());
+                break;
+            case 0xA:
+                break;
+            default:
+                ESP_LOGW(TAG, "Unknown opcode from device: %d", opcode);
+                break;
+        }
+    }
+}
+
+void LoopbackWebSocketSession::SendText(const std::string& text) {
+    SendFrame(0x1, text.data(), text.size());
+}
+
+void LoopbackWebSocketSession::SendBinary(const void* data, size_t size) {
+    SendFrame(0x2, data, size);
+}
+
+void LoopbackWebSocketSession::SendClose() {
+    SendFrame(0x8, nullptr, 0);
+}
+
+void LoopbackWebSocketSession::SendFrame(uint8_t opcode, const void* data, size_t size) {
+    HostUncountedScope uncounted;
+    std::string frame;
+    frame.reserve(size + 10);
+    frame.push_back(static_cast<char>(0x80 | opcode));
+    if (size < 126) {
+        frame.push_back(static_cast<char>(size));
+    } else if (size <= 0xFFFF) {
+        frame.push_back(static_cast<char>(126));
+        frame.push_back(static_cast<char>(size >> 8));
+        frame.push_back(static_cast<char>(size & 0xFF));
+    } else {
+        frame.push_back(static_cast<char>(127));
+        for (int i = 7; i >= 0; i--) {
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(size) >> (i * 8)) & 0xFF));
+        }
+    }
+    frame.append(static_cast<const char*>(data), size);
+    link_->Deliver(std::move(frame));
+}
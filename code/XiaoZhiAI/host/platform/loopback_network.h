@@ -0,0 +1,187 @@
+#ifndef LOOPBACK_NETWORK_H
+#define LOOPBACK_NETWORK_H
+
+#include <network_interface.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+/*
+ * A NetworkInterface whose servers live in the same process. Servers are registered by
+ * host and port, a connection from the device creates a session on the server. What the
+ * device sends is handed to the session on the sending thread, what the server sends is
+ * queued and delivered to the device callbacks on a thread per connection, like the
+ * receive task of a real socket.
+ */
+
+// Server side of one connection
+class LoopbackLink {
+public:
+    virtual ~LoopbackLink() = default;
+    // Queue data for the device, never blocks
+    virtual void Deliver(std::string data) = 0;
+    // Close the connection from the server, the device sees a disconnect
+    virtual void Close() = 0;
+};
+
+class LoopbackSession {
+public:
+    virtual ~LoopbackSession() = default;
+    // Data from the device, runs on the sending thread of the device
+    virtual void OnData(const std::string& data) = 0;
+    // The device closed the connection, the link must not be used any more
+    virtual void OnClose() {}
+};
+
+// A TCP or UDP server, accepts every connection made to its address
+class LoopbackServer {
+public:
+    virtual ~LoopbackServer() = default;
+    virtual std::unique_ptr<LoopbackSession> Accept(LoopbackLink* link) = 0;
+};
+
+class LoopbackMqttClient;
+
+class LoopbackMqttBroker {
+public:
+    virtual ~LoopbackMqttBroker() = default;
+    virtual bool OnConnect(LoopbackMqttClient* client, const std::string& client_id) { return true; }
+    virtual void OnPublish(LoopbackMqttClient* client, const std::string& topic, const std::string& payload) = 0;
+    virtual void OnDisconnect(LoopbackMqttClient* client) {}
+};
+
+struct LoopbackHttpRequest {
+    int connection;         // Same for the requests made over one Http object, like a kept-alive socket
+    std::string method;
+    std::string url;
+    std::map<std::string, std::string> headers;
+    std::string content;
+};
+
+struct LoopbackHttpResponse {
+    int status_code = 200;
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+using LoopbackHttpHandler = std::function<LoopbackHttpResponse(const LoopbackHttpRequest& request)>;
+
+// Queue and thread that run the device callbacks of one connection in order
+class LoopbackDelivery {
+public:
+    LoopbackDelivery() = default;
+    ~LoopbackDelivery();
+
+    void Start();
+    // Drops the tasks not run yet. Returns once the thread has ended, unless called from a task.
+    void Stop();
+    void Push(std::function<void()> task);
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> tasks;
+        bool stopped = false;
+    };
+    std::shared_ptr<State> state_;
+    std::thread thread_;
+};
+
+class LoopbackNetwork : public NetworkInterface {
+public:
+    LoopbackNetwork() = default;
+    ~LoopbackNetwork() = default;
+
+    // TCP and TLS connections are not told apart, both reach the server of the address
+    void AddTcpServer(const std::string& host, int port, LoopbackServer* server);
+    void AddUdpServer(const std::string& host, int port, LoopbackServer* server);
+    void SetMqttBroker(const std::string& host, int port, LoopbackMqttBroker* broker);
+    // Requests to URLs starting with the prefix, the longest matching prefix wins
+    void AddHttpHandler(const std::string& url_prefix, LoopbackHttpHandler handler);
+    void RemoveServers();
+
+    std::unique_ptr<Http> CreateHttp(int connect_id = -1) override;
+    std::unique_ptr<Tcp> CreateTcp(int connect_id = -1) override;
+    std::unique_ptr<Tcp> CreateSsl(int connect_id = -1) override;
+    std::unique_ptr<Udp> CreateUdp(int connect_id = -1) override;
+    std::unique_ptr<Mqtt> CreateMqtt(int connect_id = -1) override;
+    std::unique_ptr<WebSocket> CreateWebSocket(int connect_id = -1) override;
+
+    LoopbackServer* FindTcpServer(const std::string& host, int port);
+    LoopbackServer* FindUdpServer(const std::string& host, int port);
+    LoopbackMqttBroker* FindMqttBroker(const std::string& host, int port);
+    LoopbackHttpHandler FindHttpHandler(const std::string& url);
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, LoopbackServer*> tcp_servers_;
+    std::map<std::string, LoopbackServer*> udp_servers_;
+    std::map<std::string, LoopbackMqttBroker*> mqtt_brokers_;
+    std::map<std::string, LoopbackHttpHandler> http_handlers_;
+};
+
+class LoopbackMqttClient : public Mqtt {
+public:
+    LoopbackMqttClient(LoopbackNetwork* network);
+    ~LoopbackMqttClient();
+
+    bool Connect(const std::string broker_address, int broker_port, const std::string client_id, const std::string username, const std::string password) override;
+    void Disconnect() override;
+    bool Publish(const std::string topic, const std::string payload, int qos = 0) override;
+    bool Subscribe(const std::string topic, int qos = 0) override;
+    bool Unsubscribe(const std::string topic) override;
+    bool IsConnected() override;
+    int GetLastError() override { return last_error_; }
+
+    // Called by the broker, messages are delivered to OnMessage on the client thread
+    void Deliver(const std::string& topic, const std::string& payload);
+    // Called by the broker to drop the client
+    void CloseFromBroker();
+
+private:
+    LoopbackNetwork* network_;
+    LoopbackMqttBroker* broker_ = nullptr;
+    LoopbackDelivery delivery_;
+    std::mutex mutex_;
+    bool connected_ = false;
+    int last_error_ = 0;
+};
+
+// Server side of the WebSocket protocol for LoopbackServer sessions: answers the handshake
+// and turns frames into messages. Frames to the device are not masked.
+class LoopbackWebSocketSession : public LoopbackSession {
+public:
+    LoopbackWebSocketSession(LoopbackLink* link) : link_(link) {}
+
+    void OnData(const std::string& data) override;
+
+    void SendText(const std::string& text);
+    void SendBinary(const void* data, size_t size);
+    void SendClose();
+
+protected:
+    // The handshake request with its headers, return false to reject it
+    virtual bool OnHandshake(const std::map<std::string, std::string>& headers) { return true; }
+    virtual void OnText(const std::string& text) = 0;
+    virtual void OnBinary(const std::string& data) = 0;
+
+    LoopbackLink* link_;
+
+private:
+    bool handshake_done_ = false;
+    std::string buffer_;
+    std::string message_;
+    bool message_binary_ = false;
+
+    void SendFrame(uint8_t opcode, const void* data, size_t size);
+};
+
+#endif // LOOPBACK_NETWORK_H
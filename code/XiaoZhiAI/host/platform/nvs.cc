@@ -0,0 +1,261 @@
+#include <nvs_flash.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct NvsEntry {
+    nvs_type_t type;
+    int32_t number;
+    std::string text;
+};
+
+struct NvsHandle {
+    std::string ns;
+    nvs_open_mode_t mode;
+    bool dirty = false;
+};
+
+std::mutex nvs_mutex;
+// Written values are visible at once, the commit count shows how often a caller committed changes
+std::map<std::string, std::map<std::string, NvsEntry>> namespaces;
+std::map<nvs_handle_t, NvsHandle> handles;
+nvs_handle_t next_handle = 1;
+uint32_t commit_count = 0;
+
+NvsHandle* FindHandle(nvs_handle_t handle) {
+    auto it = handles.find(handle);
+    return it != handles.end() ? &it->second : nullptr;
+}
+
+const NvsEntry* FindEntry(nvs_handle_t handle, const char* key, nvs_type_t type, esp_err_t& err) {
+    auto h = FindHandle(handle);
+    if (h == nullptr) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+        return nullptr;
+    }
+    auto& entries = namespaces[h->ns];
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+        return nullptr;
+    }
+    if (it->second.type != type) {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+        return nullptr;
+    }
+    err = ESP_OK;
+    return &it->second;
+}
+
+esp_err_t SetEntry(nvs_handle_t handle, const char* key, NvsEntry entry) {
+    auto h = FindHandle(handle);
+    if (h == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (h->mode != NVS_READWRITE) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    namespaces[h->ns][key] = std::move(entry);
+    h->dirty = true;
+    return ESP_OK;
+}
+
+}
+
+struct HostNvsIterator {
+    std::vector<nvs_entry_info_t> entries;
+    size_t index = 0;
+};
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    namespaces.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* namespace_name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    if (strlen(namespace_name) >= NVS_NS_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    // Like NVS, a namespace that was never written cannot be opened read-only
+    if (open_mode == NVS_READONLY && namespaces.find(namespace_name) == namespaces.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    namespaces[namespace_name];
+    *out_handle = next_handle++;
+    handles[*out_handle] = NvsHandle{namespace_name, open_mode};
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    handles.erase(handle);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    esp_err_t err;
+    auto entry = FindEntry(handle, key, NVS_TYPE_STR, err);
+    if (entry == nullptr) {
+        return err;
+    }
+    size_t required = entry->text.size() + 1;
+    if (out_value == nullptr) {
+        *length = required;
+        return ESP_OK;
+    }
+    if (*length < required) {
+        *length = required;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, entry->text.c_str(), required);
+    *length = required;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    esp_err_t err;
+    auto entry = FindEntry(handle, key, NVS_TYPE_I32, err);
+    if (entry != nullptr) {
+        *out_value = entry->number;
+    }
+    return err;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* out_value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    esp_err_t err;
+    auto entry = FindEntry(handle, key, NVS_TYPE_U8, err);
+    if (entry != nullptr) {
+        *out_value = (uint8_t)entry->number;
+    }
+    return err;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return SetEntry(handle, key, NvsEntry{NVS_TYPE_STR, 0, value});
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return SetEntry(handle, key, NvsEntry{NVS_TYPE_I32, value, ""});
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return SetEntry(handle, key, NvsEntry{NVS_TYPE_U8, value, ""});
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto h = FindHandle(handle);
+    if (h == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (h->mode != NVS_READWRITE) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (namespaces[h->ns].erase(key) == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    h->dirty = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto h = FindHandle(handle);
+    if (h == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (h->mode != NVS_READWRITE) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    namespaces[h->ns].clear();
+    h->dirty = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto h = FindHandle(handle);
+    if (h == nullptr) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (h->dirty) {
+        commit_count++;
+        h->dirty = false;
+    }
+    return ESP_OK;
+}
+
+uint32_t host_nvs_commit_count(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return commit_count;
+}
+
+esp_err_t nvs_entry_find(const char* part_name, const char* namespace_name, nvs_type_t type, nvs_iterator_t* output_iterator) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto iterator = new HostNvsIterator();
+    for (auto& [ns, entries] : namespaces) {
+        if (namespace_name != nullptr && ns != namespace_name) {
+            continue;
+        }
+        for (auto& [key, entry] : entries) {
+            if (type != NVS_TYPE_ANY && entry.type != type) {
+                continue;
+            }
+            nvs_entry_info_t info = {};
+            strncpy(info.namespace_name, ns.c_str(), sizeof(info.namespace_name) - 1);
+            strncpy(info.key, key.c_str(), sizeof(info.key) - 1);
+            info.type = entry.type;
+            iterator->entries.push_back(info);
+        }
+    }
+    if (iterator->entries.empty()) {
+        delete iterator;
+        *output_iterator = nullptr;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = iterator;
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t* iterator) {
+    if (iterator == nullptr || *iterator == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (++(*iterator)->index >= (*iterator)->entries.size()) {
+        delete *iterator;
+        *iterator = nullptr;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t* out_info) {
+    if (iterator == nullptr || out_info == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_info = iterator->entries[iterator->index];
+    return ESP_OK;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator) {
+    delete iterator;
+}
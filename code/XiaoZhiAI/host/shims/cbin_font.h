@@ -0,0 +1,3 @@
+#pragma once
+
+// The host build has no LVGL, cbin_font.h is only used under HAVE_LVGL
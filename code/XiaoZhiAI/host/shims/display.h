@@ -0,0 +1,84 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+/*
+ * Stand-in for main/display/display.h without LVGL. HAVE_LVGL stays undefined, so the
+ * screen tools and skins compiled into mcp_server.cc and assets.cc are left out like on
+ * boards without a display. The methods log like the defaults in display.cc.
+ */
+
+#include "status_model.h"
+
+#include <esp_log.h>
+
+#include <string>
+
+class Theme {
+public:
+    Theme(const std::string& name) : name_(name) {}
+    virtual ~Theme() = default;
+
+    inline std::string name() const { return name_; }
+private:
+    std::string name_;
+};
+
+class Display {
+public:
+    Display() = default;
+    virtual ~Display() = default;
+
+    virtual void SetStatus(const char* status) { ESP_LOGD("Display", "SetStatus: %s", status); }
+    virtual void ShowNotification(const char* notification, int duration_ms = 3000) {
+        ESP_LOGD("Display", "ShowNotification: %s", notification);
+    }
+    virtual void ShowNotification(const std::string &notification, int duration_ms = 3000) {
+        ShowNotification(notification.c_str(), duration_ms);
+    }
+    virtual void SetEmotion(const char* emotion) { ESP_LOGD("Display", "SetEmotion: %s", emotion); }
+    virtual void SetChatMessage(const char* role, const char* content) {
+        ESP_LOGD("Display", "%s: %s", role, content);
+    }
+    virtual void SetTheme(Theme* theme) { current_theme_ = theme; }
+    virtual Theme* GetTheme() { return current_theme_; }
+    virtual void OnStatusChanged(uint32_t changed, const StatusState& state) {}
+    virtual void SetPowerSaveMode(bool on) {}
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+
+protected:
+    int width_ = 0;
+    int height_ = 0;
+
+    Theme* current_theme_ = nullptr;
+
+    friend class DisplayLockGuard;
+    virtual bool Lock(int timeout_ms = 0) = 0;
+    virtual void Unlock() = 0;
+};
+
+class DisplayLockGuard {
+public:
+    DisplayLockGuard(Display *display) : display_(display) {
+        if (!display_->Lock(30000)) {
+            ESP_LOGE("Display", "Failed to lock display");
+        }
+    }
+    ~DisplayLockGuard() {
+        display_->Unlock();
+    }
+
+private:
+    Display *display_;
+};
+
+class NoDisplay : public Display {
+private:
+    virtual bool Lock(int timeout_ms = 0) override {
+        return true;
+    }
+    virtual void Unlock() override {}
+};
+
+#endif
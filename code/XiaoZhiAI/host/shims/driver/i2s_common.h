@@ -0,0 +1,21 @@
+#ifndef HOST_DRIVER_I2S_COMMON_H
+#define HOST_DRIVER_I2S_COMMON_H
+
+// Only the channel handle, host codecs do not use I2S and leave their handles empty
+
+#include <esp_err.h>
+
+typedef struct HostI2sChannel* i2s_chan_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle);
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_DRIVER_I2S_COMMON_H
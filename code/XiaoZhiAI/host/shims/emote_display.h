@@ -0,0 +1,4 @@
+#pragma once
+
+// The host build has no LVGL, emote_display.h is only used under HAVE_LVGL or CONFIG_USE_EMOTE_MESSAGE_STYLE
+#include "display.h"
@@ -0,0 +1,32 @@
+#ifndef HOST_ESP_PTHREAD_H
+#define HOST_ESP_PTHREAD_H
+
+// std::thread is a plain pthread on the host, the ESP-IDF thread configuration has no effect
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <esp_err.h>
+
+typedef struct {
+    size_t stack_size;
+    size_t prio;
+    bool inherit_cfg;
+    const char* thread_name;
+    int pin_to_core;
+    int stack_alloc_caps;
+} esp_pthread_cfg_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_pthread_cfg_t esp_pthread_get_default_config(void);
+esp_err_t esp_pthread_set_cfg(const esp_pthread_cfg_t* cfg);
+esp_err_t esp_pthread_get_cfg(esp_pthread_cfg_t* cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_ESP_PTHREAD_H
@@ -0,0 +1,9 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+// Only included for its types by the esp-sr headers, queues are not used by the host build
+#include "FreeRTOS.h"
+
+typedef struct HostQueue* QueueHandle_t;
+
+#endif // HOST_FREERTOS_QUEUE_H
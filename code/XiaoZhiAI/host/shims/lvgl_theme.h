@@ -0,0 +1,4 @@
+#pragma once
+
+// The host build has no LVGL, lvgl_theme.h is only used under HAVE_LVGL
+#include "display.h"
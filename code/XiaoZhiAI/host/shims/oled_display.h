@@ -0,0 +1,4 @@
+#pragma once
+
+// The host build has no LVGL, oled_display.h is only used under HAVE_LVGL
+#include "display.h"
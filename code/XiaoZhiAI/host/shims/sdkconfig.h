@@ -0,0 +1,10 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+/*
+ * The host build has no Kconfig. Options that change the compiled code are passed by
+ * CMake as -DCONFIG_...=1 (see host/CMakeLists.txt), everything else is off, which
+ * selects the generic target without the audio front end.
+ */
+
+#endif // HOST_SDKCONFIG_H
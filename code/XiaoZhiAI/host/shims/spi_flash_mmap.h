@@ -0,0 +1,24 @@
+#ifndef HOST_SPI_FLASH_MMAP_H
+#define HOST_SPI_FLASH_MMAP_H
+
+#include <stdint.h>
+
+#define SPI_FLASH_MMU_PAGE_SIZE 0x10000
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Memory mapped partitions do not take MMU pages on the host
+uint32_t spi_flash_mmap_get_free_pages(spi_flash_mmap_memory_t memory);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SPI_FLASH_MMAP_H
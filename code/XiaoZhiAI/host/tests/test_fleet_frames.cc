@@ -0,0 +1,222 @@
+#include "host_board.h"
+#include "settings.h"
+#include "websocket_protocol.h"
+#include "test_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * The frames of scripts/fleet_load/fleet_load.py against the firmware. WebsocketProtocol
+ * runs one listening turn against a loopback server that writes down every frame it gets,
+ * the tool prints the frames it sends for the same turn with its frames command, and the
+ * two must be the same byte for byte: handshake headers, hello, listen messages and the
+ * binary audio frames of protocol versions 1, 2 and 3.
+ */
+
+int test_failures = 0;
+
+#define WS_HOST "fleet.test"
+#define WS_PORT 8080
+#define TOKEN "test-token"
+#define SESSION_ID "fleet"
+#define P3_FILE "fleet_frames.p3"
+#define PACKET_COUNT 24
+#define FRAME_DURATION_MS 60
+
+static std::string Hex(const std::string& data) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char c : data) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0x0F];
+    }
+    return hex;
+}
+
+// Writes the frames down in the format of the frames command of the tool
+class RecordingSession : public LoopbackWebSocketSession {
+public:
+    RecordingSession(LoopbackLink* link, std::vector<std::string>* frames, std::mutex* mutex)
+        : LoopbackWebSocketSession(link), frames_(frames), mutex_(mutex) {}
+
+protected:
+    bool OnHandshake(const std::map<std::string, std::string>& headers) override {
+        // Device-Id and Client-Id differ per device in the tool
+        for (auto name : {"Authorization", "Protocol-Version"}) {
+            auto it = headers.find(name);
+            Add(std::string("header ") + name + ": " + (it != headers.end() ? it->second : ""));
+        }
+        return true;
+    }
+
+    void OnText(const std::string& text) override {
+        Add("text " + text);
+        if (text.find("\"type\":\"hello\"") != std::string::npos) {
+            SendText("{\"type\":\"hello\",\"transport\":\"websocket\",\"session_id\":\"" SESSION_ID "\","
+                "\"audio_params\":{\"format\":\"opus\",\"sample_rate\":24000,\"channels\":1,\"frame_duration\":60}}");
+        }
+    }
+
+    void OnBinary(const std::string& data) override {
+        Add("binary " + Hex(data));
+    }
+
+private:
+    std::vector<std::string>* frames_;
+    std::mutex* mutex_;
+
+    void Add(std::string frame) {
+        std::lock_guard<std::mutex> lock(*mutex_);
+        frames_->push_back(std::move(frame));
+    }
+};
+
+class RecordingServer : public LoopbackServer {
+public:
+    std::unique_ptr<LoopbackSession> Accept(LoopbackLink* link) override {
+        return std::make_unique<RecordingSession>(link, &frames_, &mutex_);
+    }
+
+    std::vector<std::string> TakeFrames() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::move(frames_);
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::string> frames_;
+};
+
+// Opus packets of varying sizes, one longer than 255 bytes for the 16 bit length fields
+static std::vector<std::string> MakePackets() {
+    std::vector<std::string> packets;
+    uint32_t seed = 12345;
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        size_t size = i == PACKET_COUNT / 2 ? 300 : 1 + (i * 37) % 200;
+        std::string packet(size, '\0');
+        for (auto& c : packet) {
+            seed = seed * 1103515245 + 12345;
+            c = (char)(seed >> 16);
+        }
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+static bool WriteP3(const std::vector<std::string>& packets) {
+    FILE* file = fopen(P3_FILE, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    for (const auto& packet : packets) {
+        uint8_t header[4] = { 0, 0, (uint8_t)(packet.size() >> 8), (uint8_t)packet.size() };
+        fwrite(header, 1, sizeof(header), file);
+        fwrite(packet.data(), 1, packet.size(), file);
+    }
+    return fclose(file) == 0;
+}
+
+static bool ToolFrames(const std::string& python, const std::string& script, int version, std::vector<std::string>& frames) {
+    std::string command = "\"" + python + "\" \"" + script + "\" frames -a " P3_FILE " --session-id " SESSION_ID
+        " --token " TOKEN " --protocol-version " + std::to_string(version);
+#if CONFIG_USE_SERVER_AEC
+    command += " --feature aec";
+#endif
+#if CONFIG_USE_VAD_GATED_UPLINK
+    command += " --feature vad_gate";
+#endif
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return false;
+    }
+    std::string output;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, n);
+    }
+    if (pclose(pipe) != 0) {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos < output.size()) {
+        auto end = output.find('\n', pos);
+        if (end == std::string::npos) {
+            end = output.size();
+        }
+        frames.push_back(output.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return true;
+}
+
+static void DeviceFrames(RecordingServer& server, const std::vector<std::string>& packets, int version,
+    std::vector<std::string>& frames) {
+    {
+        Settings settings("websocket", true);
+        settings.SetString("url", "ws://" WS_HOST ":" + std::to_string(WS_PORT) + "/xiaozhi/v1/");
+        settings.SetString("token", TOKEN);
+        settings.SetInt("version", version);
+    }
+    WebsocketProtocol protocol;
+    if (!protocol.Start() || !protocol.OpenAudioChannel()) {
+        return;
+    }
+    // The loopback server gets the frames on the sending thread, they are all written down on return
+    protocol.SendStartListening(kListeningModeManualStop);
+    for (size_t i = 0; i < packets.size(); i++) {
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->sample_rate = 16000;
+        packet->frame_duration = FRAME_DURATION_MS;
+        packet->timestamp = i * FRAME_DURATION_MS;
+        packet->payload.assign(packets[i].begin(), packets[i].end());
+        protocol.SendAudio(std::move(packet));
+    }
+    protocol.SendStopListening();
+    protocol.CloseAudioChannel();
+    frames = server.TakeFrames();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: %s <python> <fleet_load.py>\n", argv[0]);
+        return 2;
+    }
+
+    auto packets = MakePackets();
+    if (!WriteP3(packets)) {
+        printf("FAIL: could not write %s\n", P3_FILE);
+        return 1;
+    }
+
+    RecordingServer server;
+    HostBoard::GetInstance().network().AddTcpServer(WS_HOST, WS_PORT, &server);
+
+    for (int version = 1; version <= 3; version++) {
+        std::vector<std::string> expected;
+        std::vector<std::string> actual;
+        DeviceFrames(server, packets, version, expected);
+        if (!ToolFrames(argv[1], argv[2], version, actual)) {
+            printf("FAIL: fleet_load.py frames failed for version %d\n", version);
+            return 1;
+        }
+        // Headers, hello, listen start, the audio frames and listen stop
+        CHECK(expected.size() == packets.size() + 5, "v%d: the device sent %zu frames", version, expected.size());
+        CHECK(actual.size() == expected.size(), "v%d: the tool sent %zu frames, the device %zu",
+            version, actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size() && i < actual.size(); i++) {
+            CHECK(actual[i] == expected[i], "v%d frame %zu differs\n  device: %.200s\n  tool:   %.200s",
+                version, i, expected[i].c_str(), actual[i].c_str());
+        }
+    }
+
+    printf(test_failures == 0 ? "PASS\n" : "%d checks failed\n", test_failures);
+    fflush(stdout);
+    // The board and the application are never destroyed on the device, skip their destructors
+    _Exit(test_failures == 0 ? 0 : 1);
+}
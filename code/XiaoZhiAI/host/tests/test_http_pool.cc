@@ -0,0 +1,75 @@
+#include "http_pool.h"
+#include "host_board.h"
+#include "test_util.h"
+
+#include <cstdlib>
+#include <string>
+
+/*
+ * Connection reuse of HttpPool against the HTTP handlers of the loopback network. Every
+ * loopback Http object stands for one socket and reports its number with each request,
+ * so the handler sees whether a request came over a pooled connection or a new one.
+ */
+
+int test_failures = 0;
+
+#define ORIGIN "http://pool.test"
+#define BODY_SIZE 4096
+
+static int last_connection = 0;
+
+// Runs a GET and returns the connection it was served on, reading the body as far as asked
+static int Get(const std::string& path, size_t read_bytes, bool read_to_end) {
+    auto http = HttpPool::GetInstance().CreateHttp(0);
+    if (!http->Open("GET", ORIGIN + path)) {
+        return -1;
+    }
+    if (read_to_end) {
+        http->ReadAll();
+    } else {
+        std::string buffer(read_bytes, '\0');
+        http->Read(&buffer[0], buffer.size());
+    }
+    http->Close();
+    return last_connection;
+}
+
+int main() {
+    auto& network = HostBoard::GetInstance().network();
+    network.AddHttpHandler(ORIGIN "/", [](const LoopbackHttpRequest& request) {
+        last_connection = request.connection;
+        LoopbackHttpResponse response;
+        response.body.assign(BODY_SIZE, 'x');
+        if (request.url.find("/close") != std::string::npos) {
+            response.headers["Connection"] = "close";
+        }
+        return response;
+    });
+
+    // A drained keep-alive response leaves the connection for the next request
+    int first = Get("/a", 0, true);
+    int second = Get("/b", 0, true);
+    CHECK(first > 0 && second == first, "drained connection %d was not reused, got %d", first, second);
+
+    // Unread bytes of a body would be taken for the next response
+    int partial = Get("/c", BODY_SIZE / 2, false);
+    CHECK(partial == first, "pooled connection %d was not used, got %d", first, partial);
+    int after_partial = Get("/d", 0, true);
+    CHECK(after_partial != partial, "connection %d was reused with half of a body unread", partial);
+
+    // Reading the body to the end with Read() also counts as drained
+    int read = Get("/e", BODY_SIZE * 2, false);
+    Get("/f", BODY_SIZE * 2, false);
+    int after_read = Get("/g", 0, true);
+    CHECK(after_read == read, "connection %d drained with Read was not reused, got %d", read, after_read);
+
+    // The server closes its end after the response
+    int closed = Get("/close", 0, true);
+    int after_close = Get("/h", 0, true);
+    CHECK(after_close != closed, "connection %d was pooled after Connection: close", closed);
+
+    printf(test_failures == 0 ? "PASS\n" : "%d checks failed\n", test_failures);
+    fflush(stdout);
+    // The board and the pool are never destroyed on the device, skip their destructors
+    _Exit(test_failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,331 @@
+#include "ota_delta.h"
+#include "lz4_block.h"
+#include "test_util.h"
+
+#include <esp_log.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * Patches made by scripts/ota_delta/ota_delta.py, applied chunk by chunk with the checks of
+ * Ota::UpgradeDelta: the header, the chunk sizes, Lz4DecompressBlock and OtaDeltaDecoder.
+ * The source and target partitions are vectors, comparing the result with the target stands
+ * in for the SHA256 check at the end of the upgrade. Truncated and corrupted patches have to
+ * fail without the decoder reading or writing outside of the images.
+ *
+ * Usage: test_ota_delta <python> <ota_delta.py>
+ */
+
+typedef std::vector<uint8_t> Bytes;
+
+int test_failures = 0;
+
+enum ApplyResult {
+    kApplyDone,        // Decoded to the end, the hash check decides
+    kApplyRejected,    // Refused by the header, chunk, LZ4 or record checks
+    kApplyTruncated,   // The patch ended before the target was complete
+};
+
+struct ApplyState {
+    size_t patch_offset = 0;
+    size_t source_position = 0;
+    size_t target_position = 0;
+};
+
+class PatchApplier {
+public:
+    PatchApplier(const Bytes& source, const Bytes& patch, size_t target_capacity)
+        : source_(source), patch_(patch), target_(target_capacity) {}
+
+    // Applies the patch from a resume point, or from the start, stopping after max_chunks
+    ApplyResult Apply(ApplyState& state, int max_chunks = -1) {
+        size_t position = 0;
+        if (!Read(position, &header_, sizeof(header_))) {
+            return kApplyTruncated;
+        }
+        if (memcmp(header_.magic, OTA_DELTA_MAGIC, sizeof(header_.magic)) != 0 ||
+            header_.chunk_size == 0 || header_.chunk_size > OTA_DELTA_MAX_CHUNK_SIZE ||
+            header_.source_size != source_.size() || header_.target_size > target_.size()) {
+            return kApplyRejected;
+        }
+        if (state.patch_offset == 0) {
+            state.patch_offset = sizeof(header_);
+        }
+        position = state.patch_offset;
+
+        Bytes payload(header_.chunk_size);
+        Bytes records(header_.chunk_size);
+        OtaDeltaDecoder decoder(header_.source_size, header_.target_size,
+            [this](size_t offset, uint8_t* data, size_t size) {
+                if (offset + size > header_.source_size) {
+                    out_of_bounds_ = true;
+                    return false;
+                }
+                memcpy(data, source_.data() + offset, size);
+                return true;
+            },
+            [this](const uint8_t* data, size_t size) {
+                if (write_position_ + size > header_.target_size) {
+                    out_of_bounds_ = true;
+                    return false;
+                }
+                memcpy(target_.data() + write_position_, data, size);
+                write_position_ += size;
+                return true;
+            });
+        decoder.Seek(state.source_position, state.target_position);
+        write_position_ = state.target_position;
+
+        for (int chunks = 0; !decoder.done() && chunks != max_chunks; chunks++) {
+            OtaDeltaChunkHeader chunk;
+            if (!Read(position, &chunk, sizeof(chunk))) {
+                return kApplyTruncated;
+            }
+            if (chunk.raw_size > header_.chunk_size || chunk.payload_size > chunk.raw_size) {
+                return kApplyRejected;
+            }
+            if (!Read(position, payload.data(), chunk.payload_size)) {
+                return kApplyTruncated;
+            }
+            const uint8_t* data = payload.data();
+            if (chunk.payload_size < chunk.raw_size) {
+                if (Lz4DecompressBlock(payload.data(), chunk.payload_size, records.data(), chunk.raw_size) != (int)chunk.raw_size) {
+                    return kApplyRejected;
+                }
+                data = records.data();
+            }
+            if (!decoder.ApplyChunk(data, chunk.raw_size)) {
+                return kApplyRejected;
+            }
+            CHECK(write_position_ == decoder.target_position(), "decoder lost track of the target position");
+            state.patch_offset = position;
+            state.source_position = decoder.source_position();
+            state.target_position = decoder.target_position();
+        }
+        return kApplyDone;
+    }
+
+    bool Matches(const Bytes& target) const {
+        return header_.target_size == target.size() && memcmp(target_.data(), target.data(), target.size()) == 0;
+    }
+
+    bool out_of_bounds() const { return out_of_bounds_; }
+
+private:
+    const Bytes& source_;
+    const Bytes& patch_;
+    Bytes target_;
+    OtaDeltaHeader header_ = {};
+    size_t write_position_ = 0;
+    bool out_of_bounds_ = false;
+
+    bool Read(size_t& position, void* data, size_t size) {
+        if (position > patch_.size() || patch_.size() - position < size) {
+            return false;
+        }
+        memcpy(data, patch_.data() + position, size);
+        position += size;
+        return true;
+    }
+};
+
+static uint32_t Random(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+// Code-like bytes with repeated instruction patterns, then a string table
+static Bytes MakeSource(size_t size) {
+    Bytes image(size);
+    uint32_t seed = 7;
+    for (size_t i = 0; i < size * 3 / 4; i += 4) {
+        uint32_t word = (Random(seed) % 4 == 0) ? Random(seed) : 0x0040C000 | (Random(seed) & 0x3F);
+        memcpy(&image[i], &word, sizeof(word));
+    }
+    const char* text = "Failed to open HTTP connection\0Invalid patch header\0Delta upgrade successful\0";
+    for (size_t i = size * 3 / 4; i < size; i++) {
+        image[i] = text[i % 76];
+    }
+    return image;
+}
+
+// Relocated addresses, an inserted and a removed function, and a longer string table
+static Bytes MakeTarget(const Bytes& source) {
+    Bytes image = source;
+    uint32_t seed = 11;
+    for (size_t i = 0; i + 4 <= image.size() / 2; i += 1024) {
+        image[i] += 0x40;
+    }
+    Bytes inserted(300);
+    for (auto& byte : inserted) {
+        byte = Random(seed);
+    }
+    image.insert(image.begin() + image.size() / 3, inserted.begin(), inserted.end());
+    image.erase(image.begin() + image.size() * 2 / 3, image.begin() + image.size() * 2 / 3 + 500);
+    for (int i = 0; i < 2048; i++) {
+        image.push_back("Resuming at patch offset "[i % 25]);
+    }
+    return image;
+}
+
+static bool WriteFile(const std::string& path, const Bytes& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && ok;
+}
+
+static bool ReadFile(const std::string& path, Bytes& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    data.clear();
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool MakePatch(const std::string& python, const std::string& script, const Bytes& source, const Bytes& target,
+    int chunk_size, Bytes& patch) {
+    std::string name = "ota_delta_" + std::to_string(chunk_size);
+    if (!WriteFile(name + "_source.bin", source) || !WriteFile(name + "_target.bin", target)) {
+        return false;
+    }
+    std::string command = "\"" + python + "\" \"" + script + "\" diff " + name + "_source.bin " + name + "_target.bin " +
+        name + ".xzd --chunk-size " + std::to_string(chunk_size);
+    return system(command.c_str()) == 0 && ReadFile(name + ".xzd", patch);
+}
+
+// The device checks the running partition and the written image against these
+static bool SameHashes(const Bytes& patch, const Bytes& original) {
+    auto a = reinterpret_cast<const OtaDeltaHeader*>(patch.data());
+    auto b = reinterpret_cast<const OtaDeltaHeader*>(original.data());
+    return memcmp(a->source_sha256, b->source_sha256, sizeof(a->source_sha256)) == 0 &&
+        memcmp(a->target_sha256, b->target_sha256, sizeof(a->target_sha256)) == 0;
+}
+
+static void TestPatch(const Bytes& source, const Bytes& target, const Bytes& patch, int chunk_size) {
+    size_t capacity = target.size() * 2;
+
+    // Whole patch
+    {
+        PatchApplier applier(source, patch, capacity);
+        ApplyState state;
+        CHECK(applier.Apply(state) == kApplyDone && applier.Matches(target), "chunk %d: patch did not apply", chunk_size);
+    }
+
+    // Interrupted after every few chunks and resumed from the saved positions
+    {
+        PatchApplier applier(source, patch, capacity);
+        ApplyState state;
+        int attempts = 0;
+        ApplyResult result;
+        do {
+            result = applier.Apply(state, 3);
+            attempts++;
+        } while (result == kApplyDone && state.patch_offset < patch.size() && attempts < 10000);
+        CHECK(result == kApplyDone && applier.Matches(target), "chunk %d: resumed patch did not apply", chunk_size);
+    }
+
+    // Cut anywhere before the end, including right after the header and at chunk boundaries
+    int truncated = 0;
+    for (size_t size = 0; size < patch.size(); size += (size < 256 ? 1 : 37)) {
+        Bytes cut(patch.begin(), patch.begin() + size);
+        PatchApplier applier(source, cut, capacity);
+        ApplyState state;
+        ApplyResult result = applier.Apply(state);
+        CHECK(result != kApplyDone, "chunk %d: patch cut at %zu applied", chunk_size, size);
+        CHECK(!applier.out_of_bounds(), "chunk %d: patch cut at %zu went outside of the images", chunk_size, size);
+        truncated++;
+    }
+
+    // Single bytes changed, the corruption is caught by the checks or by the target hash
+    int rejected = 0, mismatched = 0, harmless = 0;
+    uint32_t seed = chunk_size;
+    for (int i = 0; i < 2000; i++) {
+        Bytes corrupted = patch;
+        size_t position = Random(seed) % corrupted.size();
+        corrupted[position] ^= 1 << (Random(seed) % 8);
+        PatchApplier applier(source, corrupted, capacity);
+        ApplyState state;
+        ApplyResult result = applier.Apply(state);
+        CHECK(!applier.out_of_bounds(), "chunk %d: corruption at %zu went outside of the images", chunk_size, position);
+        if (result != kApplyDone) {
+            rejected++;
+        } else if (!applier.Matches(target) || !SameHashes(corrupted, patch)) {
+            mismatched++;
+        } else {
+            // Decodes to the same records, like a match copying equal bytes from another offset
+            harmless++;
+        }
+    }
+    printf("chunk %d: patch %zu bytes, %d truncations failed, of 2000 corruptions %d rejected, %d caught by the hash "
+        "and %d harmless\n", chunk_size, patch.size(), truncated, rejected, mismatched, harmless);
+}
+
+// The decoder alone on the LZ4 chunks of a patch, cut and with too little room
+static void TestLz4(const Bytes& patch) {
+    int blocks = 0;
+    size_t position = sizeof(OtaDeltaHeader);
+    while (position + sizeof(OtaDeltaChunkHeader) <= patch.size()) {
+        OtaDeltaChunkHeader chunk;
+        memcpy(&chunk, &patch[position], sizeof(chunk));
+        position += sizeof(chunk);
+        const uint8_t* block = &patch[position];
+        position += chunk.payload_size;
+        if (chunk.payload_size == chunk.raw_size) {
+            continue;
+        }
+        blocks++;
+
+        Bytes output(chunk.raw_size);
+        CHECK(Lz4DecompressBlock(block, chunk.payload_size, output.data(), output.size()) == (int)chunk.raw_size,
+            "LZ4 block at %zu did not decode", position);
+        for (size_t size = 0; size < chunk.payload_size; size++) {
+            Bytes cut(block, block + size);
+            CHECK(Lz4DecompressBlock(cut.data(), cut.size(), output.data(), output.size()) != (int)chunk.raw_size,
+                "LZ4 block at %zu cut to %zu decoded", position, size);
+        }
+        Bytes small(chunk.raw_size - 1);
+        CHECK(Lz4DecompressBlock(block, chunk.payload_size, small.data(), small.size()) == -1,
+            "LZ4 block at %zu overran its output", position);
+    }
+    CHECK(blocks > 0, "patch has no LZ4 chunks");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: %s <python> <ota_delta.py>\n", argv[0]);
+        return 2;
+    }
+    // Every corrupted patch would log its error
+    esp_log_level_set("OtaDelta", ESP_LOG_NONE);
+
+    Bytes source = MakeSource(64 * 1024);
+    Bytes target = MakeTarget(source);
+    // The smallest chunk the tool allows, and its default
+    for (int chunk_size : {256, 16 * 1024}) {
+        Bytes patch;
+        if (!MakePatch(argv[1], argv[2], source, target, chunk_size, patch)) {
+            printf("FAIL: ota_delta.py could not make the patch with chunk size %d\n", chunk_size);
+            return 1;
+        }
+        TestPatch(source, target, patch, chunk_size);
+        TestLz4(patch);
+    }
+
+    printf(test_failures == 0 ? "PASS\n" : "%d checks failed\n", test_failures);
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstdio>
+
+// Checks of the host tests, a failure is printed and counted and the test goes on
+extern int test_failures;
+
+#define CHECK(condition, ...) do { \
+    if (!(condition)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+    } \
+} while (0)
+
+#endif // TEST_UTIL_H
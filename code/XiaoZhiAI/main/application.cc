@@ -9,6 +9,10 @@
 #include "mcp_server.h"
 #include "assets.h"
 #include "settings.h"
+#include "performance_profiler.h"
+#include "local_intents.h"
+#include "status_model.h"
+#include "progress_channel.h"
 
 #include <cstring>
 #include <esp_log.h>
@@ -68,11 +72,7 @@ void Application::Initialize() {
     // Print board name/version info
     display->SetChatMessage("system", SystemInfo::GetUserAgent().c_str());
 
-    // Setup the audio service
-    auto codec = board.GetAudioCodec();
-    audio_service_.Initialize(codec);
-    audio_service_.Start();
-
+    // Setup the audio service callbacks, the codec itself is started by the boot graph
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
@@ -83,6 +83,34 @@ void Application::Initialize() {
     callbacks.on_vad_change = [this](bool speaking) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_VAD_CHANGE);
     };
+    callbacks.on_speech_onset = [this]() {
+        xEventGroupSetBits(event_group_, MAIN_EVENT_SPEECH_ONSET);
+    };
+    callbacks.on_command_detected = [this](const std::string& action, const std::string& text) {
+        // 离线命令在本地执行，不经过服务器；无法处理的命令按唤醒词交给服务器
+        if (!LocalIntents::GetInstance().CanHandle(action)) {
+            return false;
+        }
+        auto detected_us = esp_timer_get_time();
+        Schedule([this, action, text, detected_us]() {
+            if (!LocalIntents::GetInstance().Execute(action)) {
+                return;
+            }
+            auto display = Board::GetInstance().GetDisplay();
+            display->ShowNotification(text);
+            audio_service_.PlaySound(Lang::Sounds::OGG_POPUP);
+            ESP_LOGI(TAG, "Offline command %s done in %lld ms", text.c_str(),
+                (esp_timer_get_time() - detected_us) / 1000);
+        });
+        return true;
+    };
+    callbacks.on_uplink_gate_change = [this](bool open) {
+        Schedule([this, open]() {
+            if (protocol_) {
+                protocol_->SendVadState(open);
+            }
+        });
+    };
     audio_service_.SetCallbacks(callbacks);
 
     // Add state change listeners
@@ -90,8 +118,26 @@ void Application::Initialize() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_STATE_CHANGED);
     });
 
-    // Start the clock timer to update the status bar
-    esp_timer_start_periodic(clock_timer_handle_, 1000000);
+    // The status bar is driven by the status model, the display redraws only the items that changed
+    auto& status_model = StatusModel::GetInstance();
+    status_model.Subscribe([display](uint32_t changed, const StatusState& state) {
+        display->OnStatusChanged(changed, state);
+    });
+    status_model.Start();
+
+    // Download and upgrade progress is shown from the progress task, off the flash write loop
+    ProgressChannel::GetInstance().SetConsumer([display](const ProgressReport& report) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", report.progress, report.speed / 1024);
+        display->SetChatMessage("system", buffer);
+    });
+
+    // The clock tick only feeds statistics, it runs slowly while idle to let the CPU sleep
+    esp_timer_start_periodic(clock_timer_handle_, CLOCK_TICK_IDLE_INTERVAL_MS * 1000);
+
+#if CONFIG_USE_PERFORMANCE_PROFILER
+    PerformanceProfiler::GetInstance().Start(CONFIG_PERFORMANCE_PROFILER_INTERVAL_MS);
+#endif
 
     // Add MCP common tools (only once during initialization)
     auto& mcp_server = McpServer::GetInstance();
@@ -156,11 +202,61 @@ void Application::Initialize() {
         }
     });
 
-    // Start network asynchronously
-    board.StartNetwork();
+    // Start the codec, assets and network concurrently, the network comes up asynchronously
+    StartBootGraph();
 
     // Update the status bar immediately to show the network state
-    display->UpdateStatusBar(true);
+    status_model.Refresh(kStatusItemAll);
+}
+
+void Application::StartBootGraph() {
+    // Applying the assets partition only needs the network when a new package is pending
+    bool assets_download_pending = false;
+    if (Assets::GetInstance().partition_valid()) {
+        Settings settings("assets", false);
+        assets_download_pending = !settings.GetString("download_url").empty();
+    }
+
+    int codec_stage = boot_graph_.AddStage("codec", [this]() {
+        audio_service_.Initialize(Board::GetInstance().GetAudioCodec());
+        audio_service_.Start();
+    });
+    // Network errors are reported with sounds, so the codec has to be up first
+    boot_graph_.AddStage("network", []() {
+        Board::GetInstance().StartNetwork();
+    }, {codec_stage});
+    network_connected_stage_ = boot_graph_.AddSignal("connected");
+
+    std::vector<int> assets_dependencies;
+    if (assets_download_pending) {
+        assets_dependencies.push_back(network_connected_stage_);
+    }
+    int assets_stage = boot_graph_.AddStage("assets", [this]() {
+        CheckAssetsVersion();
+    }, assets_dependencies);
+    int wake_word_stage = boot_graph_.AddStage("wake_word", [this]() {
+        audio_service_.InitializeWakeWord();
+    }, {codec_stage, assets_stage});
+
+    std::vector<int> ota_dependencies = {network_connected_stage_};
+    if (assets_download_pending) {
+        // Do not check the firmware while the device is busy upgrading the assets
+        ota_dependencies.push_back(assets_stage);
+    }
+    int ota_stage = boot_graph_.AddStage("ota", [this]() {
+        ota_ = std::make_unique<Ota>();
+        CheckNewVersion();
+    }, ota_dependencies);
+    int protocol_stage = boot_graph_.AddStage("protocol", [this]() {
+        InitializeProtocol();
+    }, {ota_stage});
+    boot_ready_stage_ = boot_graph_.AddStage("ready", [this]() {
+        xEventGroupSetBits(event_group_, MAIN_EVENT_ACTIVATION_DONE);
+    }, {assets_stage, wake_word_stage, protocol_stage}, 2048);
+
+    boot_graph_.Start();
+    // The main loop uses the audio service right away
+    boot_graph_.Wait(codec_stage);
 }
 
 void Application::Run() {
@@ -169,6 +265,7 @@ void Application::Run() {
         MAIN_EVENT_SEND_AUDIO |
         MAIN_EVENT_WAKE_WORD_DETECTED |
         MAIN_EVENT_VAD_CHANGE |
+        MAIN_EVENT_SPEECH_ONSET |
         MAIN_EVENT_CLOCK_TICK |
         MAIN_EVENT_ERROR |
         MAIN_EVENT_NETWORK_CONNECTED |
@@ -234,6 +331,13 @@ void Application::Run() {
             }
         }
 
+        if (bits & MAIN_EVENT_SPEECH_ONSET) {
+            // Someone started talking, connect while the wake word is still being spoken
+            if (protocol_ && GetDeviceState() == kDeviceStateIdle) {
+                protocol_->PrewarmAudioChannel();
+            }
+        }
+
         if (bits & MAIN_EVENT_SCHEDULE) {
             std::unique_lock<std::mutex> lock(mutex_);
             auto tasks = std::move(main_tasks_);
@@ -244,13 +348,19 @@ void Application::Run() {
         }
 
         if (bits & MAIN_EVENT_CLOCK_TICK) {
-            clock_ticks_++;
-            auto display = Board::GetInstance().GetDisplay();
-            display->UpdateStatusBar();
-        
+#if CONFIG_USE_ADAPTIVE_OPUS_ENCODER
+            // Feed the last second of link statistics to the uplink rate controller
+            if (protocol_ && protocol_->IsAudioChannelOpened()) {
+                audio_service_.UpdateLinkStats(protocol_->TakeAudioLinkStats());
+            }
+#endif
+
             // Print debug info every 10 seconds
-            if (clock_ticks_ % 10 == 0) {
+            int64_t now_us = esp_timer_get_time();
+            if (now_us - last_debug_stats_us_ >= 10 * 1000000LL) {
+                last_debug_stats_us_ = now_us;
                 SystemInfo::PrintHeapStats();
+                audio_service_.PrintDebugStatistics();
             }
         }
     }
@@ -261,24 +371,13 @@ void Application::HandleNetworkConnectedEvent() {
     auto state = GetDeviceState();
 
     if (state == kDeviceStateStarting || state == kDeviceStateWifiConfiguring) {
-        // Network is ready, start activation
+        // Network is ready, the boot stages waiting for it start now
         SetDeviceState(kDeviceStateActivating);
-        if (activation_task_handle_ != nullptr) {
-            ESP_LOGW(TAG, "Activation task already running");
-            return;
-        }
-
-        xTaskCreate([](void* arg) {
-            Application* app = static_cast<Application*>(arg);
-            app->ActivationTask();
-            app->activation_task_handle_ = nullptr;
-            vTaskDelete(NULL);
-        }, "activation", 4096 * 2, this, 2, &activation_task_handle_);
+        boot_graph_.Complete(network_connected_stage_);
     }
 
     // Update the status bar immediately to show the network state
-    auto display = Board::GetInstance().GetDisplay();
-    display->UpdateStatusBar(true);
+    StatusModel::GetInstance().Refresh(kStatusItemNetwork);
 }
 
 void Application::HandleNetworkDisconnectedEvent() {
@@ -290,12 +389,12 @@ void Application::HandleNetworkDisconnectedEvent() {
     }
 
     // Update the status bar immediately to show the network state
-    auto display = Board::GetInstance().GetDisplay();
-    display->UpdateStatusBar(true);
+    StatusModel::GetInstance().Refresh(kStatusItemNetwork);
 }
 
 void Application::HandleActivationDoneEvent() {
-    ESP_LOGI(TAG, "Activation done");
+    ESP_LOGI(TAG, "Activation done, wake word ready at %lld ms after boot", boot_graph_.GetDoneTimeMs(boot_ready_stage_));
+    boot_graph_.PrintTimings();
 
     SystemInfo::PrintHeapStats();
     SetDeviceState(kDeviceStateIdle);
@@ -316,23 +415,6 @@ void Application::HandleActivationDoneEvent() {
     board.SetPowerSaveLevel(PowerSaveLevel::LOW_POWER);
 }
 
-void Application::ActivationTask() {
-    // Create OTA object for activation process
-    ota_ = std::make_unique<Ota>();
-
-    // Check for new assets version
-    CheckAssetsVersion();
-
-    // Check for new firmware version
-    CheckNewVersion();
-
-    // Initialize the protocol
-    InitializeProtocol();
-
-    // Signal completion to main loop
-    xEventGroupSetBits(event_group_, MAIN_EVENT_ACTIVATION_DONE);
-}
-
 void Application::CheckAssetsVersion() {
     // Only allow CheckAssetsVersion to be called once
     if (assets_version_checked_) {
@@ -366,13 +448,11 @@ void Application::CheckAssetsVersion() {
         board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
         display->SetChatMessage("system", Lang::Strings::PLEASE_WAIT);
 
-        bool success = assets.Download(download_url, [display](int progress, size_t speed) -> void {
-            std::thread([display, progress, speed]() {
-                char buffer[32];
-                snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
-                display->SetChatMessage("system", buffer);
-            }).detach();
+        auto& progress_channel = ProgressChannel::GetInstance();
+        bool success = assets.Download(download_url, [&progress_channel](int progress, size_t speed) -> void {
+            progress_channel.Publish(progress, speed);
         });
+        progress_channel.Drain();
 
         board.SetPowerSaveLevel(PowerSaveLevel::LOW_POWER);
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -429,7 +509,7 @@ void Application::CheckNewVersion() {
         retry_delay = 10; // Reset retry delay
 
         if (ota_->HasNewVersion()) {
-            if (UpgradeFirmware(ota_->GetFirmwareUrl(), ota_->GetFirmwareVersion())) {
+            if (UpgradeFirmware(ota_->GetFirmwareUrl(), ota_->GetFirmwareVersion(), ota_->GetFirmwareDeltaUrl())) {
                 return; // This line will never be reached after reboot
             }
             // If upgrade failed, continue to normal operation
@@ -560,7 +640,8 @@ void Application::InitializeProtocol() {
             }
         } else if (strcmp(type->valuestring, "mcp") == 0) {
             auto payload = cJSON_GetObjectItem(root, "payload");
-            if (cJSON_IsObject(payload)) {
+            // A JSON-RPC request or a batch of them
+            if (cJSON_IsObject(payload) || cJSON_IsArray(payload)) {
                 McpServer::GetInstance().ParseMessage(payload);
             }
         } else if (strcmp(type->valuestring, "system") == 0) {
@@ -795,7 +876,13 @@ void Application::HandleWakeWordDetectedEvent() {
 
 void Application::HandleStateChangedEvent() {
     DeviceState new_state = state_machine_.GetState();
-    clock_ticks_ = 0;
+
+    // Link statistics need the 1 second tick during a conversation
+    int clock_interval_ms = new_state == kDeviceStateIdle ? CLOCK_TICK_IDLE_INTERVAL_MS : CLOCK_TICK_ACTIVE_INTERVAL_MS;
+    if (clock_interval_ms != clock_interval_ms_) {
+        clock_interval_ms_ = clock_interval_ms;
+        esp_timer_restart(clock_timer_handle_, clock_interval_ms * 1000);
+    }
 
     auto& board = Board::GetInstance();
     auto display = board.GetDisplay();
@@ -823,6 +910,7 @@ void Application::HandleStateChangedEvent() {
             if (!audio_service_.IsAudioProcessorRunning()) {
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
+                audio_service_.EnableUplinkGate(listening_mode_ == kListeningModeRealtime);
                 audio_service_.EnableVoiceProcessing(true);
                 audio_service_.EnableWakeWordDetection(false);
             }
@@ -887,7 +975,7 @@ void Application::Reboot() {
     esp_restart();
 }
 
-bool Application::UpgradeFirmware(const std::string& url, const std::string& version) {
+bool Application::UpgradeFirmware(const std::string& url, const std::string& version, const std::string& delta_url) {
     auto& board = Board::GetInstance();
     auto display = board.GetDisplay();
 
@@ -911,15 +999,28 @@ bool Application::UpgradeFirmware(const std::string& url, const std::string& ver
 
     board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
     audio_service_.Stop();
+    // The upgrade writes flash for minutes, changes still waiting for the commit timer would
+    // be lost if it ends in a power loss or a crash
+    Settings::Flush();
     vTaskDelay(pdMS_TO_TICKS(1000));
 
-    bool upgrade_success = Ota::Upgrade(upgrade_url, [display](int progress, size_t speed) {
-        std::thread([display, progress, speed]() {
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
-            display->SetChatMessage("system", buffer);
-        }).detach();
-    });
+    auto& progress_channel = ProgressChannel::GetInstance();
+    auto progress_callback = [&progress_channel](int progress, size_t speed) {
+        progress_channel.Publish(progress, speed);
+    };
+
+    bool upgrade_success = false;
+    esp_err_t delta_result = ESP_ERR_NOT_SUPPORTED;
+    if (!delta_url.empty()) {
+        delta_result = Ota::UpgradeDelta(delta_url, progress_callback);
+        upgrade_success = delta_result == ESP_OK;
+    }
+    // A delta interrupted by the network resumes on the next attempt, only an unusable
+    // patch falls back to downloading the full image
+    if (delta_result == ESP_ERR_NOT_SUPPORTED) {
+        upgrade_success = Ota::Upgrade(upgrade_url, progress_callback);
+    }
+    progress_channel.Drain();
 
     if (!upgrade_success) {
         // Upgrade failed, restart audio service and continue running
@@ -1011,6 +1112,15 @@ void Application::SendMcpMessage(const std::string& payload) {
     });
 }
 
+void Application::SendMcpMessage(TextStream&& payload) {
+    auto stream = std::make_shared<TextStream>(std::move(payload));
+    Schedule([this, stream]() {
+        if (protocol_) {
+            protocol_->SendMcpMessage(std::move(*stream));
+        }
+    });
+}
+
 void Application::SetAecMode(AecMode mode) {
     aec_mode_ = mode;
     Schedule([this]() {
@@ -16,6 +16,7 @@
 #include "audio_service.h"
 #include "device_state.h"
 #include "device_state_machine.h"
+#include "boot_graph.h"
 
 // Main event bits
 #define MAIN_EVENT_SCHEDULE             (1 << 0)
@@ -31,6 +32,11 @@
 #define MAIN_EVENT_START_LISTENING      (1 << 10)
 #define MAIN_EVENT_STOP_LISTENING       (1 << 11)
 #define MAIN_EVENT_STATE_CHANGED        (1 << 12)
+#define MAIN_EVENT_SPEECH_ONSET         (1 << 13)
+
+// The clock tick feeds link statistics during a conversation, the status bar has its own schedule
+#define CLOCK_TICK_ACTIVE_INTERVAL_MS   1000
+#define CLOCK_TICK_IDLE_INTERVAL_MS     10000
 
 
 enum AecMode {
@@ -52,7 +58,8 @@ public:
     /**
      * Initialize the application
      * This sets up display, audio, network callbacks, etc.
-     * Network connection starts asynchronously.
+     * Assets, network and activation run as boot stages in the background,
+     * the function returns once the audio codec is started.
      */
     void Initialize();
 
@@ -105,9 +112,11 @@ public:
 
     void Reboot();
     void WakeWordInvoke(const std::string& wake_word);
-    bool UpgradeFirmware(const std::string& url, const std::string& version = "");
+    // A delta patch is tried first if given, the full image is the fallback
+    bool UpgradeFirmware(const std::string& url, const std::string& version = "", const std::string& delta_url = "");
     bool CanEnterSleepMode();
     void SendMcpMessage(const std::string& payload);
+    void SendMcpMessage(TextStream&& payload);
     void SetAecMode(AecMode mode);
     AecMode GetAecMode() const { return aec_mode_; }
     void PlaySound(const std::string_view& sound);
@@ -140,8 +149,11 @@ private:
     bool aborted_ = false;
     bool assets_version_checked_ = false;
     bool play_popup_on_listening_ = false;  // Flag to play popup sound after state changes to listening
-    int clock_ticks_ = 0;
-    TaskHandle_t activation_task_handle_ = nullptr;
+    int clock_interval_ms_ = CLOCK_TICK_IDLE_INTERVAL_MS;
+    int64_t last_debug_stats_us_ = 0;
+    BootGraph boot_graph_;
+    int network_connected_stage_ = -1;
+    int boot_ready_stage_ = -1;
 
 
     // Event handlers
@@ -154,8 +166,8 @@ private:
     void HandleActivationDoneEvent();
     void HandleWakeWordDetectedEvent();
 
-    // Activation task (runs in background)
-    void ActivationTask();
+    // Startup stages (run in background), see StartBootGraph()
+    void StartBootGraph();
 
     // Helper methods
     void CheckAssetsVersion();
@@ -1,9 +1,12 @@
 #include "assets.h"
 #include "board.h"
+#include "http_pool.h"
 #include "display.h"
 #include "application.h"
 #include "lvgl_theme.h"
 #include "emote_display.h"
+#include "memory_policy.h"
+#include "lz4_block.h"
 #ifdef HAVE_LVGL
 #include "display/lcd_display.h"
 #endif
@@ -12,6 +15,7 @@
 #include <spi_flash_mmap.h>
 #include <esp_timer.h>
 #include <cbin_font.h>
+#include <cstring>
 
 
 #define TAG "Assets"
@@ -31,6 +35,7 @@ Assets::Assets() {
 }
 
 Assets::~Assets() {
+    ReleaseExpandedAssets();
     if (mmap_handle_ != 0) {
         esp_partition_munmap(mmap_handle_);
     }
@@ -120,7 +125,7 @@ bool Assets::Apply() {
 
     cJSON* version = cJSON_GetObjectItem(root, "version");
     if (cJSON_IsNumber(version)) {
-        if (version->valuedouble > 1) {
+        if (version->valuedouble > ASSETS_SUPPORTED_VERSION) {
             ESP_LOGE(TAG, "The assets version %d is not supported, please upgrade the firmware", version->valueint);
             return false;
         }
@@ -182,11 +187,17 @@ bool Assets::Apply() {
                 cJSON* file = cJSON_GetObjectItem(emoji, "file");
                 cJSON* eaf = cJSON_GetObjectItem(emoji, "eaf");
                 if (cJSON_IsString(name) && cJSON_IsString(file) && (NULL== eaf)) {
-                    if (!GetAssetData(file->valuestring, ptr, size)) {
-                        ESP_LOGE(TAG, "Emoji %s image file %s is not found", name->valuestring, file->valuestring);
-                        continue;
-                    }
-                    custom_emoji_collection->AddEmoji(name->valuestring, new LvglRawImage(ptr, size));
+                    // Only the file name is kept until the emoji is first shown
+                    custom_emoji_collection->AddEmoji(name->valuestring, [this, name = std::string(name->valuestring),
+                            file = std::string(file->valuestring)]() -> LvglImage* {
+                        void* ptr = nullptr;
+                        size_t size = 0;
+                        if (!GetAssetData(file, ptr, size)) {
+                            ESP_LOGE(TAG, "Emoji %s image file %s is not found", name.c_str(), file.c_str());
+                            return nullptr;
+                        }
+                        return new LvglRawImage(ptr, size);
+                    });
                 }
             }
         }
@@ -196,6 +207,8 @@ bool Assets::Apply() {
         if (dark_theme != nullptr) {
             dark_theme->set_emoji_collection(custom_emoji_collection);
         }
+        // Decode the emotions shown right after boot and on the first conversation
+        custom_emoji_collection->Preload({"neutral", "happy", "thinking"}, Board::GetInstance().GetDisplay());
     }
 
     cJSON* skin = cJSON_GetObjectItem(root, "skin");
@@ -391,12 +404,12 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
         mmap_handle_ = 0;
         mmap_root_ = nullptr;
     }
+    ReleaseExpandedAssets();
     checksum_valid_ = false;
     assets_.clear();
 
     // 下载新的资源文件
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(0);
+    auto http = HttpPool::GetInstance().CreateHttp(0);
     
     if (!http->Open("GET", url)) {
         ESP_LOGE(TAG, "Failed to open HTTP connection");
@@ -521,6 +534,9 @@ bool Assets::GetAssetData(const std::string& name, void*& ptr, size_t& size) {
         return false;
     }
     auto data = (const char*)(mmap_root_ + asset->second.offset);
+    if (data[0] == 'Z' && data[1] == 'L') {
+        return ExpandAsset(name, data + 2, asset->second.size, ptr, size);
+    }
     if (data[0] != 'Z' || data[1] != 'Z') {
         ESP_LOGE(TAG, "The asset %s is not valid with magic %02x%02x", name.c_str(), data[0], data[1]);
         return false;
@@ -530,3 +546,51 @@ bool Assets::GetAssetData(const std::string& name, void*& ptr, size_t& size) {
     size = asset->second.size;
     return true;
 }
+
+bool Assets::ExpandAsset(const std::string& name, const char* data, size_t stored_size, void*& ptr, size_t& size) {
+    std::lock_guard<std::mutex> lock(expanded_mutex_);
+    auto it = expanded_assets_.find(name);
+    if (it != expanded_assets_.end()) {
+        ptr = it->second.data;
+        size = it->second.size;
+        return true;
+    }
+
+    // 压缩资源: 4 字节原始大小 + LZ4 block
+    if (stored_size < 4) {
+        ESP_LOGE(TAG, "The compressed asset %s is truncated", name.c_str());
+        return false;
+    }
+    uint32_t raw_size;
+    memcpy(&raw_size, data, sizeof(raw_size));
+
+    auto start_time = esp_timer_get_time();
+    auto& memory = MemoryPolicy::GetInstance();
+    auto buffer = memory.Allocate(kMemoryPoolPsram, raw_size);
+    if (buffer == nullptr) {
+        ESP_LOGE(TAG, "No memory to expand asset %s (%lu bytes)", name.c_str(), raw_size);
+        return false;
+    }
+    int ret = Lz4DecompressBlock(reinterpret_cast<const uint8_t*>(data + 4), stored_size - 4,
+        static_cast<uint8_t*>(buffer), raw_size);
+    if (ret != (int)raw_size) {
+        ESP_LOGE(TAG, "The compressed asset %s is corrupted", name.c_str());
+        memory.Free(buffer);
+        return false;
+    }
+    ESP_LOGI(TAG, "Expanded asset %s from %u to %lu bytes in %d ms", name.c_str(), stored_size, raw_size,
+        int((esp_timer_get_time() - start_time) / 1000));
+
+    expanded_assets_[name] = {buffer, raw_size};
+    ptr = buffer;
+    size = raw_size;
+    return true;
+}
+
+void Assets::ReleaseExpandedAssets() {
+    std::lock_guard<std::mutex> lock(expanded_mutex_);
+    for (auto& [name, asset] : expanded_assets_) {
+        MemoryPolicy::GetInstance().Free(asset.data);
+    }
+    expanded_assets_.clear();
+}
@@ -2,6 +2,7 @@
 #define ASSETS_H
 
 #include <map>
+#include <mutex>
 #include <string>
 #include <functional>
 
@@ -9,6 +10,8 @@
 #include <esp_partition.h>
 #include <model_path.h>
 
+// index.json version 2 may contain LZ4 compressed assets
+#define ASSETS_SUPPORTED_VERSION 2
 
 struct Asset {
     size_t size;
@@ -25,6 +28,8 @@ public:
 
     bool Download(std::string url, std::function<void(int progress, size_t speed)> progress_callback);
     bool Apply();
+    // Compressed assets are expanded into PSRAM on the first call and stay there, the
+    // returned pointer is valid until the next download like that of a raw asset
     bool GetAssetData(const std::string& name, void*& ptr, size_t& size);
 
     inline bool partition_valid() const { return partition_valid_; }
@@ -38,6 +43,8 @@ private:
 
     bool InitializePartition();
     uint32_t CalculateChecksum(const char* data, uint32_t length);
+    bool ExpandAsset(const std::string& name, const char* data, size_t stored_size, void*& ptr, size_t& size);
+    void ReleaseExpandedAssets();
 
     const esp_partition_t* partition_ = nullptr;
     esp_partition_mmap_handle_t mmap_handle_ = 0;
@@ -47,6 +54,13 @@ private:
     std::string default_assets_url_;
     srmodel_list_t* models_list_ = nullptr;
     std::map<std::string, Asset> assets_;
+
+    struct ExpandedAsset {
+        void* data;
+        size_t size;
+    };
+    std::mutex expanded_mutex_;
+    std::map<std::string, ExpandedAsset> expanded_assets_;
 };
 
 #endif
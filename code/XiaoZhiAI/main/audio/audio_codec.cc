@@ -1,6 +1,7 @@
 #include "audio_codec.h"
 #include "board.h"
 #include "settings.h"
+#include "status_model.h"
 
 #include <esp_log.h>
 #include <cstring>
@@ -53,6 +54,8 @@ void AudioCodec::SetOutputVolume(int volume) {
     
     Settings settings("audio", true);
     settings.SetInt("output_volume", output_volume_);
+
+    StatusModel::GetInstance().SetMuted(output_volume_ == 0);
 }
 
 void AudioCodec::SetInputGain(float gain) {
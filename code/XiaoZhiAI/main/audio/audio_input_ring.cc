@@ -0,0 +1,65 @@
+#include "audio_input_ring.h"
+
+#include <algorithm>
+
+int AudioInputRing::Subscribe(Callback callback) {
+    subscribers_.push_back(Subscriber{ .callback = std::move(callback) });
+    return subscribers_.size() - 1;
+}
+
+void AudioInputRing::Enable(int id, size_t chunk_samples) {
+    auto& subscriber = subscribers_[id];
+    if (!subscriber.enabled) {
+        subscriber.enabled = true;
+        subscriber.read_pos = buffer_.size();
+    }
+    subscriber.chunk_samples = chunk_samples;
+}
+
+void AudioInputRing::Disable(int id) {
+    subscribers_[id].enabled = false;
+}
+
+bool AudioInputRing::IsEnabled(int id) const {
+    return subscribers_[id].enabled;
+}
+
+size_t AudioInputRing::GetCaptureSize() const {
+    size_t capture_size = 0;
+    for (auto& subscriber : subscribers_) {
+        if (!subscriber.enabled || subscriber.chunk_samples == 0) {
+            continue;
+        }
+        size_t needed = subscriber.chunk_samples - (buffer_.size() - subscriber.read_pos);
+        if (capture_size == 0 || needed < capture_size) {
+            capture_size = needed;
+        }
+    }
+    return capture_size;
+}
+
+void AudioInputRing::Write(const int16_t* data, size_t samples) {
+    buffer_.insert(buffer_.end(), data, data + samples);
+
+    size_t consumed = buffer_.size();
+    for (auto& subscriber : subscribers_) {
+        if (!subscriber.enabled) {
+            continue;
+        }
+        while (subscriber.chunk_samples > 0 && buffer_.size() - subscriber.read_pos >= subscriber.chunk_samples) {
+            subscriber.callback(buffer_.data() + subscriber.read_pos, subscriber.chunk_samples);
+            subscriber.read_pos += subscriber.chunk_samples;
+        }
+        consumed = std::min(consumed, subscriber.read_pos);
+    }
+
+    // The buffer keeps its capacity, so after the first few chunks this is a short memmove
+    if (consumed > 0) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + consumed);
+        for (auto& subscriber : subscribers_) {
+            if (subscriber.enabled) {
+                subscriber.read_pos -= consumed;
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef AUDIO_INPUT_RING_H
+#define AUDIO_INPUT_RING_H
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+#include "memory_policy.h"
+
+/*
+ * Fans one captured PCM stream out to several consumers.
+ *
+ * Every subscriber has its own chunk size and read position. Write() appends the captured
+ * samples and hands each enabled subscriber contiguous views of its chunk size straight out
+ * of the shared buffer; samples are dropped once every enabled subscriber has read past them.
+ * Sizes are in int16 samples, interleaved channels included.
+ *
+ * Not thread safe: subscribers are enabled, fed and disabled from the audio input task.
+ * The buffer grows to the largest chunk size in use and is kept in PSRAM.
+ */
+class AudioInputRing {
+public:
+    using Callback = std::function<void(const int16_t* data, size_t samples)>;
+
+    int Subscribe(Callback callback);
+    // Start delivering chunks of the given size, from the next written sample on
+    void Enable(int id, size_t chunk_samples);
+    void Disable(int id);
+    bool IsEnabled(int id) const;
+
+    // Samples to capture so at least one enabled subscriber gets a full chunk, 0 if none is enabled
+    size_t GetCaptureSize() const;
+    void Write(const int16_t* data, size_t samples);
+
+private:
+    struct Subscriber {
+        Callback callback;
+        size_t chunk_samples = 0;
+        size_t read_pos = 0;
+        bool enabled = false;
+    };
+    std::vector<Subscriber> subscribers_;
+    PsramVector<int16_t> buffer_;
+};
+
+#endif
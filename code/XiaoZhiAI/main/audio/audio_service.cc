@@ -1,6 +1,8 @@
 #include "audio_service.h"
+#include "power_governor.h"
 #include <esp_log.h>
 #include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -35,7 +37,8 @@ void AudioService::Initialize(AudioCodec* codec) {
 
     /* Setup the audio codec */
     opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+    opus_encoder_ = std::make_unique<OpusStreamEncoder>(16000);
+    // Complexity 5 almost uses up all CPU of ESP32C3 while complexity 0 uses the least
     opus_encoder_->SetComplexity(0);
 
     if (codec->input_sample_rate() != 16000) {
@@ -50,6 +53,9 @@ void AudioService::Initialize(AudioCodec* codec) {
 #endif
 
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
+        if (uplink_gate_enabled_ && !PassUplinkGate(data)) {
+            return;
+        }
         PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
     });
 
@@ -60,6 +66,23 @@ void AudioService::Initialize(AudioCodec* codec) {
         }
     });
 
+    /* Consumers of the captured audio, each fed its own chunk size from one read */
+    audio_testing_input_ = input_ring_.Subscribe([this](const int16_t* data, size_t samples) {
+        // If input channels is 2, we need to fetch the left channel data
+        int channels = codec_->input_channels();
+        auto mono_data = std::vector<int16_t>(samples / channels);
+        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += channels) {
+            mono_data[i] = data[j];
+        }
+        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(mono_data));
+    });
+    wake_word_input_ = input_ring_.Subscribe([this](const int16_t* data, size_t samples) {
+        wake_word_->Feed(data, samples);
+    });
+    audio_processor_input_ = input_ring_.Subscribe([this](const int16_t* data, size_t samples) {
+        audio_processor_->Feed(data, samples);
+    });
+
     esp_timer_create_args_t audio_power_timer_args = {
         .callback = [](void* arg) {
             AudioService* audio_service = (AudioService*)arg;
@@ -174,7 +197,10 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 
     /* Update the last input time */
     last_input_time_ = std::chrono::steady_clock::now();
-    debug_statistics_.input_count++;
+    {
+        std::lock_guard<std::mutex> stats_lock(debug_statistics_mutex_);
+        debug_statistics_.input_count++;
+    }
 
 #if CONFIG_USE_AUDIO_DEBUGGER
     // 音频调试：发送原始音频数据
@@ -188,6 +214,7 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 }
 
 void AudioService::AudioInputTask() {
+    std::vector<int16_t> data;
     while (true) {
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
             AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
@@ -209,48 +236,43 @@ void AudioService::AudioInputTask() {
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
-            if (ReadAudioData(data, 16000, samples)) {
-                // If input channels is 2, we need to fetch the left channel data
-                if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
-                }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
-                continue;
-            }
         }
 
-        /* Feed the wake word */
-        if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
-            int samples = wake_word_->GetFeedSize();
-            if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    wake_word_->Feed(data);
-                    continue;
-                }
+        /* Every running consumer is fed from the same capture */
+        int channels = codec_->input_channels();
+        auto update_input = [this, channels](int id, bool running, size_t samples) {
+            if (running && samples > 0) {
+                input_ring_.Enable(id, samples * channels);
+            } else {
+                input_ring_.Disable(id);
             }
+        };
+        update_input(audio_testing_input_, bits & AS_EVENT_AUDIO_TESTING_RUNNING, OPUS_FRAME_DURATION_MS * 16000 / 1000);
+        update_input(wake_word_input_, bits & AS_EVENT_WAKE_WORD_RUNNING, wake_word_ ? wake_word_->GetFeedSize() : 0);
+        update_input(audio_processor_input_, bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING, audio_processor_->GetFeedSize());
+
+        size_t capture_size = input_ring_.GetCaptureSize();
+        if (capture_size == 0) {
+            ESP_LOGE(TAG, "Should not be here, bits: %lx", bits);
+            break;
+        }
+        if (!ReadAudioData(data, 16000, capture_size / channels)) {
+            ESP_LOGE(TAG, "Failed to read audio data");
+            break;
+        }
+        /* The capture is the frame clock of the wake word and uplink stages, the AFE fetch
+         * tasks and the encoder add their busy time to the same frames */
+        int64_t feed_start = esp_timer_get_time();
+        input_ring_.Write(data.data(), data.size());
+        int64_t feed_time = esp_timer_get_time() - feed_start;
+        int64_t capture_time = capture_size / channels * 1000 / 16;
+        auto& power_governor = PowerGovernor::GetInstance();
+        if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
+            power_governor.ReportLoad(kPowerStageWakeWord, feed_time, capture_time);
         }
-
-        /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
-            int samples = audio_processor_->GetFeedSize();
-            if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    audio_processor_->Feed(std::move(data));
-                    continue;
-                }
-            }
+            power_governor.ReportLoad(kPowerStageUplink, feed_time, capture_time);
         }
-
-        ESP_LOGE(TAG, "Should not be here, bits: %lx", bits);
-        break;
     }
 
     ESP_LOGW(TAG, "Audio input task stopped");
@@ -269,6 +291,8 @@ void AudioService::AudioOutputTask() {
         audio_queue_cv_.notify_all();
         lock.unlock();
 
+        int64_t queue_wait = esp_timer_get_time() - task->enqueue_time;
+
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
@@ -278,7 +302,12 @@ void AudioService::AudioOutputTask() {
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
-        debug_statistics_.playback_count++;
+        {
+            std::lock_guard<std::mutex> stats_lock(debug_statistics_mutex_);
+            debug_statistics_.playback_queue_wait += queue_wait;
+            debug_statistics_.max_playback_queue_wait = std::max(debug_statistics_.max_playback_queue_wait, queue_wait);
+            debug_statistics_.playback_count++;
+        }
 
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
@@ -316,7 +345,10 @@ void AudioService::OpusCodecTask() {
             task->timestamp = packet->timestamp;
 
             SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
+            int64_t decode_start = esp_timer_get_time();
+            bool decoded = opus_decoder_->Decode(std::move(packet->payload), task->pcm);
+            int64_t decode_time = esp_timer_get_time() - decode_start;
+            if (decoded) {
                 // Resample if the sample rate is different
                 if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
                     int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
@@ -324,15 +356,22 @@ void AudioService::OpusCodecTask() {
                     output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
                     task->pcm = std::move(resampled);
                 }
+                PowerGovernor::GetInstance().ReportLoad(kPowerStagePlayback,
+                    esp_timer_get_time() - decode_start, packet->frame_duration * 1000);
 
                 lock.lock();
+                task->enqueue_time = esp_timer_get_time();
                 audio_playback_queue_.push_back(std::move(task));
                 audio_queue_cv_.notify_all();
             } else {
                 ESP_LOGE(TAG, "Failed to decode audio");
                 lock.lock();
             }
-            debug_statistics_.decode_count++;
+            {
+                std::lock_guard<std::mutex> stats_lock(debug_statistics_mutex_);
+                debug_statistics_.decode_time += decode_time;
+                debug_statistics_.decode_count++;
+            }
         }
         
         /* Encode the audio to send queue */
@@ -342,28 +381,41 @@ void AudioService::OpusCodecTask() {
             audio_queue_cv_.notify_all();
             lock.unlock();
 
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
-            }
+            int64_t encode_start = esp_timer_get_time();
+            int64_t queue_wait = encode_start - task->enqueue_time;
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+            /* One task may yield zero or more packets depending on the current frame duration */
+            bool packet_sent = false;
+            opus_encoder_->Encode(task->pcm, [this, &task, &packet_sent](std::vector<uint8_t>&& opus, int duration_ms) {
+                auto packet = std::make_unique<AudioStreamPacket>();
+                packet->frame_duration = duration_ms;
+                packet->sample_rate = 16000;
+                packet->timestamp = task->timestamp;
+                packet->payload = std::move(opus);
+
+                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+                if (task->type == kAudioTaskTypeEncodeToSendQueue) {
                     audio_send_queue_.push_back(std::move(packet));
+                    max_send_queue_depth_ = std::max(max_send_queue_depth_, audio_send_queue_.size());
+                    packet_sent = true;
+                } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+                    audio_testing_queue_.push_back(std::move(packet));
                 }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
-                }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
+            });
+            int64_t encode_time = esp_timer_get_time() - encode_start;
+            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+                PowerGovernor::GetInstance().ReportLoad(kPowerStageUplink, encode_time, 0);
+            }
+            if (packet_sent && callbacks_.on_send_queue_available) {
+                callbacks_.on_send_queue_available();
+            }
+            {
+                std::lock_guard<std::mutex> stats_lock(debug_statistics_mutex_);
+                debug_statistics_.encode_queue_wait += queue_wait;
+                debug_statistics_.max_encode_queue_wait = std::max(debug_statistics_.max_encode_queue_wait, queue_wait);
+                debug_statistics_.encode_time += encode_time;
+                debug_statistics_.encode_count++;
             }
-            debug_statistics_.encode_count++;
             lock.lock();
         }
     }
@@ -405,6 +457,7 @@ void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t
     }
 
     audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
+    task->enqueue_time = esp_timer_get_time();
     audio_encode_queue_.push_back(std::move(task));
     audio_queue_cv_.notify_all();
 }
@@ -420,6 +473,10 @@ bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> pa
     }
     audio_decode_queue_.push_back(std::move(packet));
     audio_queue_cv_.notify_all();
+    if (!playback_active_) {
+        playback_active_ = true;
+        PowerGovernor::GetInstance().Acquire(kPowerStagePlayback);
+    }
     return true;
 }
 
@@ -452,6 +509,20 @@ std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
     return nullptr;
 }
 
+bool AudioService::InitializeWakeWord() {
+    if (!wake_word_) {
+        return false;
+    }
+    if (!wake_word_initialized_) {
+        if (!wake_word_->Initialize(codec_, models_list_)) {
+            ESP_LOGE(TAG, "Failed to initialize wake word");
+            return false;
+        }
+        wake_word_initialized_ = true;
+    }
+    return true;
+}
+
 void AudioService::EnableWakeWordDetection(bool enable) {
     if (!wake_word_) {
         return;
@@ -459,16 +530,18 @@ void AudioService::EnableWakeWordDetection(bool enable) {
 
     ESP_LOGD(TAG, "%s wake word detection", enable ? "Enabling" : "Disabling");
     if (enable) {
-        if (!wake_word_initialized_) {
-            if (!wake_word_->Initialize(codec_, models_list_)) {
-                ESP_LOGE(TAG, "Failed to initialize wake word");
-                return;
-            }
-            wake_word_initialized_ = true;
+        if (!InitializeWakeWord()) {
+            return;
+        }
+        if (!IsWakeWordRunning()) {
+            PowerGovernor::GetInstance().Acquire(kPowerStageWakeWord);
         }
         wake_word_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_WAKE_WORD_RUNNING);
     } else {
+        if (IsWakeWordRunning()) {
+            PowerGovernor::GetInstance().Release(kPowerStageWakeWord);
+        }
         wake_word_->Stop();
         xEventGroupClearBits(event_group_, AS_EVENT_WAKE_WORD_RUNNING);
     }
@@ -478,16 +551,24 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, OPUS_MIN_FRAME_DURATION_MS, models_list_);
             audio_processor_initialized_ = true;
         }
 
         /* We should make sure no audio is playing */
         ResetDecoder();
+        /* Drop the partial frame left over from the previous session */
+        opus_encoder_->ResetState();
         audio_input_need_warmup_ = true;
+        if (!IsAudioProcessorRunning()) {
+            PowerGovernor::GetInstance().Acquire(kPowerStageUplink);
+        }
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
+        if (IsAudioProcessorRunning()) {
+            PowerGovernor::GetInstance().Release(kPowerStageUplink);
+        }
         audio_processor_->Stop();
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     }
@@ -496,6 +577,9 @@ void AudioService::EnableVoiceProcessing(bool enable) {
 void AudioService::EnableAudioTesting(bool enable) {
     ESP_LOGI(TAG, "%s audio testing", enable ? "Enabling" : "Disabling");
     if (enable) {
+        /* Testing packets are replayed locally, use the fixed frame duration */
+        rate_controller_.Reset();
+        opus_encoder_->SetParams(OpusEncodeParams());
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
@@ -509,13 +593,69 @@ void AudioService::EnableAudioTesting(bool enable) {
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, OPUS_MIN_FRAME_DURATION_MS, models_list_);
         audio_processor_initialized_ = true;
     }
 
     audio_processor_->EnableDeviceAec(enable);
 }
 
+void AudioService::EnableUplinkGate(bool enable) {
+#if CONFIG_USE_VAD_GATED_UPLINK
+    ESP_LOGI(TAG, "%s VAD uplink gate", enable ? "Enabling" : "Disabling");
+    uplink_gate_enabled_ = enable;
+    uplink_gate_open_ = false;
+    uplink_gate_hangover_ms_ = 0;
+    uplink_preroll_.clear();
+#endif
+}
+
+/*
+ * Decides whether a processed frame is sent while the uplink gate is enabled.
+ * The VAD state is updated by the same task right before the frames of each fetch are output.
+ * Frames before the speech onset are kept as pre-roll and flushed when the gate opens, because
+ * the VAD needs a few frames to trigger; after the VAD falls silent the gate stays open for the
+ * hangover so word endings are not clipped.
+ */
+bool AudioService::PassUplinkGate(std::vector<int16_t>& pcm) {
+    int frame_ms = pcm.size() * 1000 / 16000;
+    if (voice_detected_) {
+        uplink_gate_hangover_ms_ = UPLINK_GATE_HANGOVER_MS;
+        if (!uplink_gate_open_) {
+            uplink_gate_open_ = true;
+            if (callbacks_.on_uplink_gate_change) {
+                callbacks_.on_uplink_gate_change(true);
+            }
+            while (!uplink_preroll_.empty()) {
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(uplink_preroll_.front()));
+                uplink_preroll_.pop_front();
+            }
+        }
+        return true;
+    }
+
+    if (uplink_gate_open_) {
+        uplink_gate_hangover_ms_ -= frame_ms;
+        if (uplink_gate_hangover_ms_ > 0) {
+            return true;
+        }
+        uplink_gate_open_ = false;
+        if (callbacks_.on_uplink_gate_change) {
+            callbacks_.on_uplink_gate_change(false);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> stats_lock(debug_statistics_mutex_);
+        debug_statistics_.gated_count++;
+    }
+    uplink_preroll_.push_back(std::move(pcm));
+    while (uplink_preroll_.size() * frame_ms > UPLINK_GATE_PREROLL_MS) {
+        uplink_preroll_.pop_front();
+    }
+    return false;
+}
+
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
@@ -632,12 +772,25 @@ void AudioService::ResetDecoder() {
     audio_playback_queue_.clear();
     audio_testing_queue_.clear();
     audio_queue_cv_.notify_all();
+    if (playback_active_) {
+        playback_active_ = false;
+        PowerGovernor::GetInstance().Release(kPowerStagePlayback);
+    }
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
     auto now = std::chrono::steady_clock::now();
     auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
     auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
+    {
+        /* Playback stays a running stage across short gaps between packets */
+        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+        if (playback_active_ && audio_decode_queue_.empty() && audio_playback_queue_.empty() &&
+            output_elapsed >= AUDIO_POWER_CHECK_INTERVAL_MS) {
+            playback_active_ = false;
+            PowerGovernor::GetInstance().Release(kPowerStagePlayback);
+        }
+    }
     if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
         codec_->EnableInput(false);
     }
@@ -674,7 +827,61 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
                 callbacks_.on_wake_word_detected(wake_word);
             }
         });
+        wake_word_->OnSpeechOnset([this]() {
+            if (callbacks_.on_speech_onset) {
+                callbacks_.on_speech_onset();
+            }
+        });
+        wake_word_->OnCommandDetected([this](const std::string& action, const std::string& text) {
+            return callbacks_.on_command_detected && callbacks_.on_command_detected(action, text);
+        });
+    }
+}
+
+void AudioService::UpdateLinkStats(const AudioLinkStats& stats) {
+    size_t max_send_queue_depth;
+    {
+        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+        max_send_queue_depth = max_send_queue_depth_;
+        max_send_queue_depth_ = audio_send_queue_.size();
     }
+    if (rate_controller_.Update(stats, max_send_queue_depth)) {
+        opus_encoder_->SetParams(rate_controller_.params());
+    }
+}
+
+void AudioService::PrintDebugStatistics() {
+    auto now = esp_timer_get_time();
+    DebugStatistics stats;
+    {
+        std::lock_guard<std::mutex> lock(debug_statistics_mutex_);
+        stats = debug_statistics_;
+        debug_statistics_ = DebugStatistics();
+        debug_statistics_.start_time = now;
+    }
+
+    if (stats.start_time == 0 || (stats.encode_count == 0 && stats.decode_count == 0 && stats.gated_count == 0)) {
+        return;
+    }
+    float seconds = (now - stats.start_time) / 1000000.0f;
+    auto average = [](int64_t total, uint32_t count) { return count > 0 ? (int)(total / count) : 0; };
+    ESP_LOGI(TAG, "input %.1f/s, gated %.1f/s, encode %.1f/s avg %dus wait %d/%dus, decode %.1f/s avg %dus, playback %.1f/s wait %d/%dus",
+        stats.input_count / seconds, stats.gated_count / seconds,
+        stats.encode_count / seconds, average(stats.encode_time, stats.encode_count),
+        average(stats.encode_queue_wait, stats.encode_count), (int)stats.max_encode_queue_wait,
+        stats.decode_count / seconds, average(stats.decode_time, stats.decode_count),
+        stats.playback_count / seconds,
+        average(stats.playback_queue_wait, stats.playback_count), (int)stats.max_playback_queue_wait);
+}
+
+AudioQueueDepths AudioService::GetQueueDepths() {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    return AudioQueueDepths{
+        .encode = audio_encode_queue_.size(),
+        .decode = audio_decode_queue_.size(),
+        .send = audio_send_queue_.size(),
+        .playback = audio_playback_queue_.size(),
+    };
 }
 
 bool AudioService::IsAfeWakeWord() {
@@ -13,12 +13,14 @@
 #include <esp_timer.h>
 #include <model_path.h>
 
-#include <opus_encoder.h>
 #include <opus_decoder.h>
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
+#include "opus_stream_encoder.h"
+#include "opus_rate_controller.h"
 #include "audio_processor.h"
+#include "audio_input_ring.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
@@ -30,17 +32,28 @@
  * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
  *
  * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * The MIC is read once per iteration and the same samples are fanned out to every running
+ * consumer (audio testing, wake word, processor) through AudioInputRing.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  * 
  */
 
 #define OPUS_FRAME_DURATION_MS 60
-#define MAX_ENCODE_TASKS_IN_QUEUE 2
+// The processors hand PCM to the encoder in chunks of the shortest frame the encoder may use
+#if CONFIG_USE_ADAPTIVE_OPUS_ENCODER
+#define OPUS_MIN_FRAME_DURATION_MS 20
+#else
+#define OPUS_MIN_FRAME_DURATION_MS OPUS_FRAME_DURATION_MS
+#endif
+#define MAX_ENCODE_TASKS_IN_QUEUE (120 / OPUS_MIN_FRAME_DURATION_MS)
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
 #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_MIN_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+// VAD-gated uplink: audio kept from before the speech onset, and sent after the VAD reports silence
+#define UPLINK_GATE_PREROLL_MS 300
+#define UPLINK_GATE_HANGOVER_MS 600
 #define MAX_TIMESTAMPS_IN_QUEUE 3
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
@@ -55,8 +68,12 @@
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
+    std::function<void(void)> on_speech_onset;
+    // Recognized offline command, returns true if it was handled on the device
+    std::function<bool(const std::string& action, const std::string& text)> on_command_detected;
     std::function<void(bool)> on_vad_change;
     std::function<void(void)> on_audio_testing_queue_full;
+    std::function<void(bool open)> on_uplink_gate_change;
 };
 
 
@@ -70,6 +87,7 @@ struct AudioTask {
     AudioTaskType type;
     std::vector<int16_t> pcm;
     uint32_t timestamp;
+    int64_t enqueue_time = 0;   // esp_timer time when the task entered its queue
 };
 
 struct DebugStatistics {
@@ -77,6 +95,22 @@ struct DebugStatistics {
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    uint32_t gated_count = 0;   // frames held back by the VAD uplink gate
+    /* Time spent in the codec and waiting in the encode / playback queues, in microseconds */
+    int64_t encode_time = 0;
+    int64_t decode_time = 0;
+    int64_t encode_queue_wait = 0;
+    int64_t playback_queue_wait = 0;
+    int64_t max_encode_queue_wait = 0;
+    int64_t max_playback_queue_wait = 0;
+    int64_t start_time = 0;
+};
+
+struct AudioQueueDepths {
+    size_t encode = 0;
+    size_t decode = 0;
+    size_t send = 0;
+    size_t playback = 0;
 };
 
 class AudioService {
@@ -96,10 +130,13 @@ public:
     bool IsAudioProcessorRunning() const { return xEventGroupGetBits(event_group_) & AS_EVENT_AUDIO_PROCESSOR_RUNNING; }
     bool IsAfeWakeWord();
 
+    // Loads the wake word model ahead of the first EnableWakeWordDetection(true)
+    bool InitializeWakeWord();
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    void EnableUplinkGate(bool enable);
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
@@ -109,6 +146,9 @@ public:
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
+    void UpdateLinkStats(const AudioLinkStats& stats);
+    void PrintDebugStatistics();
+    AudioQueueDepths GetQueueDepths();
 
 private:
     AudioCodec* codec_ = nullptr;
@@ -116,11 +156,18 @@ private:
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
+    std::unique_ptr<OpusStreamEncoder> opus_encoder_;
+    OpusRateController rate_controller_;
+    size_t max_send_queue_depth_ = 0;
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
+    AudioInputRing input_ring_;
+    int audio_testing_input_ = -1;
+    int wake_word_input_ = -1;
+    int audio_processor_input_ = -1;
+    std::mutex debug_statistics_mutex_;     // The counters are updated by the audio tasks and reset by the main task
     DebugStatistics debug_statistics_;
     srmodel_list_t* models_list_ = nullptr;
 
@@ -145,6 +192,13 @@ private:
     bool voice_detected_ = false;
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    bool playback_active_ = false;  // The playback stage is acquired from the power governor
+
+    // VAD uplink gate, driven from the audio processor task
+    bool uplink_gate_enabled_ = false;
+    bool uplink_gate_open_ = false;
+    int uplink_gate_hangover_ms_ = 0;
+    std::deque<std::vector<int16_t>> uplink_preroll_;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
@@ -154,6 +208,7 @@ private:
     void AudioOutputTask();
     void OpusCodecTask();
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    bool PassUplinkGate(std::vector<int16_t>& pcm);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
     void CheckAndUpdateAudioPowerState();
 };
@@ -0,0 +1,107 @@
+#include "opus_rate_controller.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "OpusRateController"
+
+// Exponential smoothing factor for loss and latency samples
+#define SMOOTHING 0.3f
+// Consecutive good intervals required before moving to a better tier
+#define RECOVER_INTERVALS 3
+#define MAX_PACKET_LOSS_PERC 30
+
+struct RateTier {
+    int frame_duration_ms;
+    int bitrate;
+    float max_loss;
+    float max_send_latency_ms;
+    int max_backlog_ms;
+};
+
+static const RateTier kTiers[] = {
+    { 20, 24000, 0.01f,  40.0f, 120 },   // good
+    { 40, 16000, 0.05f, 100.0f, 360 },   // fair
+    { 60, 12000, 1.00f,  1e9f, 1 << 30 }, // congested
+};
+static const int kTierCount = sizeof(kTiers) / sizeof(kTiers[0]);
+
+OpusRateController::OpusRateController() {
+    Reset();
+}
+
+void OpusRateController::Reset() {
+    // Start where the fixed encoder used to be and earn the lower-latency tiers
+    tier_ = kTierCount - 1;
+    good_intervals_ = 0;
+    loss_ = 0.0f;
+    send_latency_ms_ = 0.0f;
+    UpdateParams();
+}
+
+bool OpusRateController::Update(const AudioLinkStats& stats, size_t max_send_queue_depth) {
+    if (stats.packets_sent == 0) {
+        // Nothing was sent in this interval, keep the current estimate
+        return false;
+    }
+
+    float uplink_loss = (float)stats.send_failures / stats.packets_sent;
+    uint32_t downlink_total = stats.packets_received + stats.packets_lost;
+    float downlink_loss = downlink_total > 0 ? (float)stats.packets_lost / downlink_total : 0.0f;
+    float loss = std::max(uplink_loss, downlink_loss);
+    float latency = (float)stats.total_send_latency_us / stats.packets_sent / 1000.0f;
+    loss_ += SMOOTHING * (loss - loss_);
+    send_latency_ms_ += SMOOTHING * (latency - send_latency_ms_);
+    int backlog_ms = (int)max_send_queue_depth * params_.frame_duration_ms;
+
+    int target = 0;
+    while (target < kTierCount - 1 &&
+           (loss_ > kTiers[target].max_loss ||
+            send_latency_ms_ > kTiers[target].max_send_latency_ms ||
+            backlog_ms > kTiers[target].max_backlog_ms)) {
+        target++;
+    }
+
+    auto old_params = params_;
+    if (target > tier_) {
+        tier_ = target;
+        good_intervals_ = 0;
+    } else if (target < tier_) {
+        if (++good_intervals_ >= RECOVER_INTERVALS) {
+            tier_--;
+            good_intervals_ = 0;
+        }
+    } else {
+        good_intervals_ = 0;
+    }
+    UpdateParams();
+
+    bool changed = old_params.frame_duration_ms != params_.frame_duration_ms ||
+        old_params.bitrate != params_.bitrate || old_params.fec != params_.fec ||
+        old_params.packet_loss_perc != params_.packet_loss_perc;
+    if (changed) {
+        ESP_LOGI(TAG, "loss=%.1f%% latency=%.0fms backlog=%dms -> frame=%dms bitrate=%d fec=%d",
+            loss_ * 100.0f, send_latency_ms_, backlog_ms, params_.frame_duration_ms, params_.bitrate, params_.fec);
+    }
+    return changed;
+}
+
+void OpusRateController::UpdateParams() {
+    params_.frame_duration_ms = kTiers[tier_].frame_duration_ms;
+    params_.bitrate = kTiers[tier_].bitrate;
+    params_.dtx = true;
+    // FEC only pays off once there is measurable loss
+    params_.packet_loss_perc = std::min((int)(loss_ * 100.0f + 0.5f), MAX_PACKET_LOSS_PERC);
+    params_.fec = params_.packet_loss_perc > 0;
+}
+
+void OpusRateController::DescribeAllowedParams(cJSON* audio_params) {
+    cJSON* frame_durations = cJSON_CreateArray();
+    for (const auto& tier : kTiers) {
+        cJSON_AddItemToArray(frame_durations, cJSON_CreateNumber(tier.frame_duration_ms));
+    }
+    cJSON_AddItemToObject(audio_params, "frame_durations", frame_durations);
+    cJSON_AddNumberToObject(audio_params, "min_bitrate", kTiers[kTierCount - 1].bitrate);
+    cJSON_AddNumberToObject(audio_params, "max_bitrate", kTiers[0].bitrate);
+    cJSON_AddBoolToObject(audio_params, "fec", true);
+}
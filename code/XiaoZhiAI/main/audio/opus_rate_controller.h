@@ -0,0 +1,42 @@
+#ifndef OPUS_RATE_CONTROLLER_H
+#define OPUS_RATE_CONTROLLER_H
+
+#include <cJSON.h>
+
+#include "opus_stream_encoder.h"
+#include "protocol.h"
+
+/*
+ * Picks uplink Opus parameters from measured link quality.
+ *
+ * Every Update() takes the protocol's counters for the last interval (send latency,
+ * send failures, downlink sequence gaps) together with the peak send queue depth,
+ * smooths them and maps the result onto one of three tiers:
+ *   good      -> 20 ms frames, higher bitrate (lowest latency)
+ *   fair      -> 40 ms frames
+ *   congested -> 60 ms frames, lowest bitrate (fewest packets and bytes)
+ * Degrading is immediate, recovering moves one tier at a time after a few good intervals.
+ */
+class OpusRateController {
+public:
+    OpusRateController();
+
+    // Returns true if params() changed
+    bool Update(const AudioLinkStats& stats, size_t max_send_queue_depth);
+    void Reset();
+    const OpusEncodeParams& params() const { return params_; }
+
+    // Add the values the controller may choose from to the hello audio_params
+    static void DescribeAllowedParams(cJSON* audio_params);
+
+private:
+    int tier_;
+    int good_intervals_ = 0;
+    float loss_ = 0.0f;
+    float send_latency_ms_ = 0.0f;
+    OpusEncodeParams params_;
+
+    void UpdateParams();
+};
+
+#endif // OPUS_RATE_CONTROLLER_H
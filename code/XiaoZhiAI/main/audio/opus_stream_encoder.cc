@@ -0,0 +1,109 @@
+#include "opus_stream_encoder.h"
+
+#include <esp_log.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "OpusStreamEncoder"
+
+OpusStreamEncoder::OpusStreamEncoder(int sample_rate, const OpusEncodeParams& params)
+    : sample_rate_(sample_rate) {
+    int error;
+    audio_enc_ = opus_encoder_create(sample_rate, 1, OPUS_APPLICATION_VOIP, &error);
+    if (audio_enc_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+
+    // Sized once for the longest frame, see Encode()
+    in_buffer_.resize(sample_rate / 1000 * OPUS_STREAM_MAX_FRAME_DURATION_MS * 2);
+    ApplyParams(params);
+}
+
+OpusStreamEncoder::~OpusStreamEncoder() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_enc_ != nullptr) {
+        opus_encoder_destroy(audio_enc_);
+    }
+}
+
+void OpusStreamEncoder::ApplyParams(const OpusEncodeParams& params) {
+    int duration_ms = std::clamp(params.frame_duration_ms, 10, OPUS_STREAM_MAX_FRAME_DURATION_MS);
+    frame_size_ = sample_rate_ / 1000 * duration_ms;
+    opus_encoder_ctl(audio_enc_, OPUS_SET_BITRATE(params.bitrate));
+    opus_encoder_ctl(audio_enc_, OPUS_SET_DTX(params.dtx ? 1 : 0));
+    opus_encoder_ctl(audio_enc_, OPUS_SET_INBAND_FEC(params.fec ? 1 : 0));
+    opus_encoder_ctl(audio_enc_, OPUS_SET_PACKET_LOSS_PERC(params.packet_loss_perc));
+    params_ = params;
+    params_.frame_duration_ms = duration_ms;
+}
+
+void OpusStreamEncoder::SetParams(const OpusEncodeParams& params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_params_ = params;
+    params_pending_ = true;
+}
+
+OpusEncodeParams OpusStreamEncoder::GetParams() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return params_pending_ ? pending_params_ : params_;
+}
+
+void OpusStreamEncoder::SetComplexity(int complexity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_enc_ != nullptr) {
+        opus_encoder_ctl(audio_enc_, OPUS_SET_COMPLEXITY(complexity));
+    }
+}
+
+void OpusStreamEncoder::Encode(const std::vector<int16_t>& pcm,
+    std::function<void(std::vector<uint8_t>&& opus, int duration_ms)> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_enc_ == nullptr) {
+        ESP_LOGE(TAG, "Audio encoder is not configured");
+        return;
+    }
+
+    size_t offset = 0;
+    while (offset < pcm.size()) {
+        size_t count = std::min(pcm.size() - offset, in_buffer_.size() - in_buffered_);
+        memcpy(in_buffer_.data() + in_buffered_, pcm.data() + offset, count * sizeof(int16_t));
+        in_buffered_ += count;
+        offset += count;
+
+        size_t consumed = 0;
+        while (true) {
+            // New parameters only take effect between frames
+            if (params_pending_) {
+                ApplyParams(pending_params_);
+                params_pending_ = false;
+            }
+            if (in_buffered_ - consumed < frame_size_) {
+                break;
+            }
+            auto ret = opus_encode(audio_enc_, in_buffer_.data() + consumed, frame_size_, out_buffer_, sizeof(out_buffer_));
+            consumed += frame_size_;
+            if (ret < 0) {
+                ESP_LOGE(TAG, "Failed to encode audio, error code: %d", (int)ret);
+                continue;
+            }
+            if (handler != nullptr) {
+                handler(std::vector<uint8_t>(out_buffer_, out_buffer_ + ret), params_.frame_duration_ms);
+            }
+        }
+
+        // Keep the partial frame at the front; it is always shorter than one frame
+        in_buffered_ -= consumed;
+        if (consumed > 0 && in_buffered_ > 0) {
+            memmove(in_buffer_.data(), in_buffer_.data() + consumed, in_buffered_ * sizeof(int16_t));
+        }
+    }
+}
+
+void OpusStreamEncoder::ResetState() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_enc_ != nullptr) {
+        opus_encoder_ctl(audio_enc_, OPUS_RESET_STATE);
+        in_buffered_ = 0;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef OPUS_STREAM_ENCODER_H
+#define OPUS_STREAM_ENCODER_H
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+#include "opus.h"
+
+#define OPUS_STREAM_MAX_PACKET_SIZE 1000
+#define OPUS_STREAM_MAX_FRAME_DURATION_MS 60
+
+struct OpusEncodeParams {
+    int frame_duration_ms = 60;
+    int bitrate = OPUS_AUTO;    // bps
+    bool dtx = true;
+    bool fec = false;           // in-band FEC
+    int packet_loss_perc = 0;   // expected loss, tunes FEC redundancy
+};
+
+/*
+ * Opus encoder that re-frames an arbitrary PCM stream.
+ *
+ * Frame duration, bitrate, DTX and FEC can be changed at any time; the change takes
+ * effect at the next frame boundary. Input samples are staged in a buffer allocated
+ * once for the longest frame, so switching frame size never reallocates.
+ */
+class OpusStreamEncoder {
+public:
+    OpusStreamEncoder(int sample_rate, const OpusEncodeParams& params = OpusEncodeParams());
+    ~OpusStreamEncoder();
+
+    inline int sample_rate() const {
+        return sample_rate_;
+    }
+
+    void SetComplexity(int complexity);
+    void SetParams(const OpusEncodeParams& params);
+    OpusEncodeParams GetParams();
+    void Encode(const std::vector<int16_t>& pcm, std::function<void(std::vector<uint8_t>&& opus, int duration_ms)> handler);
+    void ResetState();
+
+private:
+    std::mutex mutex_;
+    struct OpusEncoder* audio_enc_ = nullptr;
+    int sample_rate_;
+    OpusEncodeParams params_;
+    OpusEncodeParams pending_params_;
+    bool params_pending_ = false;
+    size_t frame_size_ = 0;
+    std::vector<int16_t> in_buffer_;
+    size_t in_buffered_ = 0;
+    uint8_t out_buffer_[OPUS_STREAM_MAX_PACKET_SIZE];
+
+    void ApplyParams(const OpusEncodeParams& params);
+};
+
+#endif // OPUS_STREAM_ENCODER_H
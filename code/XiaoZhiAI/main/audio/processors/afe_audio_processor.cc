@@ -1,4 +1,5 @@
 #include "afe_audio_processor.h"
+#include "power_governor.h"
 #include <esp_log.h>
 
 #define PROCESSOR_RUNNING 0x01
@@ -88,11 +89,11 @@ size_t AfeAudioProcessor::GetFeedSize() {
     return afe_iface_->get_feed_chunksize(afe_data_);
 }
 
-void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
+void AfeAudioProcessor::Feed(const int16_t* data, size_t samples) {
     if (afe_data_ == nullptr) {
         return;
     }
-    afe_iface_->feed(afe_data_, data.data());
+    afe_iface_->feed(afe_data_, data);
 }
 
 void AfeAudioProcessor::Start() {
@@ -124,10 +125,15 @@ void AfeAudioProcessor::AudioProcessorTask() {
     ESP_LOGI(TAG, "Audio communication task started, feed size: %d fetch size: %d",
         feed_size, fetch_size);
 
+    // AEC, NS and VAD run inside fetch, their CPU time is added to the frames of the audio capture
+    uint32_t last_cpu_time = PowerGovernor::GetTaskCpuTimeUs();
     while (true) {
         xEventGroupWaitBits(event_group_, PROCESSOR_RUNNING, pdFALSE, pdTRUE, portMAX_DELAY);
 
         auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        uint32_t cpu_time = PowerGovernor::GetTaskCpuTimeUs();
+        PowerGovernor::GetInstance().ReportLoad(kPowerStageUplink, cpu_time - last_cpu_time, 0);
+        last_cpu_time = cpu_time;
         if ((xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING) == 0) {
             continue;
         }
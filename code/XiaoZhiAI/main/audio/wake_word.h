@@ -13,8 +13,13 @@ public:
     virtual ~WakeWord() = default;
     
     virtual bool Initialize(AudioCodec* codec, srmodel_list_t* models_list) = 0;
-    virtual void Feed(const std::vector<int16_t>& data) = 0;
+    virtual void Feed(const int16_t* data, size_t samples) = 0;
     virtual void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) = 0;
+    // Called when speech starts while waiting for the wake word, before it can be recognized
+    virtual void OnSpeechOnset(std::function<void()> callback) {}
+    // Called for a recognized command that is not a wake word, returns true if it was handled
+    // on the device. Unhandled commands wake the device like a wake word.
+    virtual void OnCommandDetected(std::function<bool(const std::string& action, const std::string& text)> callback) {}
     virtual void Start() = 0;
     virtual void Stop() = 0;
     virtual size_t GetFeedSize() = 0;
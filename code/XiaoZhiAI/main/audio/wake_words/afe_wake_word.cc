@@ -1,5 +1,6 @@
 #include "afe_wake_word.h"
 #include "audio_service.h"
+#include "power_governor.h"
 
 #include <esp_log.h>
 #include <sstream>
@@ -94,22 +95,27 @@ void AfeWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_
     wake_word_detected_callback_ = callback;
 }
 
+void AfeWakeWord::OnSpeechOnset(std::function<void()> callback) {
+    speech_onset_callback_ = callback;
+}
+
 void AfeWakeWord::Start() {
     xEventGroupSetBits(event_group_, DETECTION_RUNNING_EVENT);
 }
 
 void AfeWakeWord::Stop() {
     xEventGroupClearBits(event_group_, DETECTION_RUNNING_EVENT);
+    is_speaking_ = false;
     if (afe_data_ != nullptr) {
         afe_iface_->reset_buffer(afe_data_);
     }
 }
 
-void AfeWakeWord::Feed(const std::vector<int16_t>& data) {
+void AfeWakeWord::Feed(const int16_t* data, size_t samples) {
     if (afe_data_ == nullptr) {
         return;
     }
-    afe_iface_->feed(afe_data_, data.data());
+    afe_iface_->feed(afe_data_, data);
 }
 
 size_t AfeWakeWord::GetFeedSize() {
@@ -125,10 +131,15 @@ void AfeWakeWord::AudioDetectionTask() {
     ESP_LOGI(TAG, "Audio detection task started, feed size: %d fetch size: %d",
         feed_size, fetch_size);
 
+    // WakeNet runs inside fetch, its CPU time is added to the frames of the audio capture
+    uint32_t last_cpu_time = PowerGovernor::GetTaskCpuTimeUs();
     while (true) {
         xEventGroupWaitBits(event_group_, DETECTION_RUNNING_EVENT, pdFALSE, pdTRUE, portMAX_DELAY);
 
         auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        uint32_t cpu_time = PowerGovernor::GetTaskCpuTimeUs();
+        PowerGovernor::GetInstance().ReportLoad(kPowerStageWakeWord, cpu_time - last_cpu_time, 0);
+        last_cpu_time = cpu_time;
         if (res == nullptr || res->ret_value == ESP_FAIL) {
             continue;;
         }
@@ -136,6 +147,12 @@ void AfeWakeWord::AudioDetectionTask() {
         // Store the wake word data for voice recognition, like who is speaking
         StoreWakeWordData(res->data, res->data_size / sizeof(int16_t));
 
+        bool is_speaking = res->vad_state == VAD_SPEECH;
+        if (is_speaking && !is_speaking_ && speech_onset_callback_) {
+            speech_onset_callback_();
+        }
+        is_speaking_ = is_speaking;
+
         if (res->wakeup_state == WAKENET_DETECTED) {
             Stop();
             last_detected_wake_word_ = wake_words_[res->wakenet_model_index - 1];
@@ -172,12 +189,12 @@ void AfeWakeWord::EncodeWakeWordData() {
         auto this_ = (AfeWakeWord*)arg;
         {
             auto start_time = esp_timer_get_time();
-            auto encoder = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+            auto encoder = std::make_unique<OpusStreamEncoder>(16000);
             encoder->SetComplexity(0); // 0 is the fastest
 
             int packets = 0;
             for (auto& pcm: this_->wake_word_pcm_) {
-                encoder->Encode(std::move(pcm), [this_](std::vector<uint8_t>&& opus) {
+                encoder->Encode(pcm, [this_](std::vector<uint8_t>&& opus, int duration_ms) {
                     std::lock_guard<std::mutex> lock(this_->wake_word_mutex_);
                     this_->wake_word_opus_.emplace_back(std::move(opus));
                     this_->wake_word_cv_.notify_all();
@@ -25,8 +25,9 @@ public:
     ~AfeWakeWord();
 
     bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
-    void Feed(const std::vector<int16_t>& data);
+    void Feed(const int16_t* data, size_t samples);
     void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback);
+    void OnSpeechOnset(std::function<void()> callback);
     void Start();
     void Stop();
     size_t GetFeedSize();
@@ -42,6 +43,8 @@ private:
     std::vector<std::string> wake_words_;
     EventGroupHandle_t event_group_;
     std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
+    std::function<void()> speech_onset_callback_;
+    bool is_speaking_ = false;
     AudioCodec* codec_ = nullptr;
     std::string last_detected_wake_word_;
 
@@ -134,6 +134,10 @@ void CustomWakeWord::OnWakeWordDetected(std::function<void(const std::string& wa
     wake_word_detected_callback_ = callback;
 }
 
+void CustomWakeWord::OnCommandDetected(std::function<bool(const std::string& action, const std::string& text)> callback) {
+    command_detected_callback_ = callback;
+}
+
 void CustomWakeWord::Start() {
     running_ = true;
 }
@@ -142,7 +146,7 @@ void CustomWakeWord::Stop() {
     running_ = false;
 }
 
-void CustomWakeWord::Feed(const std::vector<int16_t>& data) {
+void CustomWakeWord::Feed(const int16_t* data, size_t samples) {
     if (multinet_model_data_ == nullptr || !running_) {
         return;
     }
@@ -150,7 +154,7 @@ void CustomWakeWord::Feed(const std::vector<int16_t>& data) {
     esp_mn_state_t mn_state;
     // If input channels is 2, we need to fetch the left channel data
     if (codec_->input_channels() == 2) {
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
+        auto mono_data = std::vector<int16_t>(samples / 2);
         for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
             mono_data[i] = data[j];
         }
@@ -158,8 +162,8 @@ void CustomWakeWord::Feed(const std::vector<int16_t>& data) {
         StoreWakeWordData(mono_data);
         mn_state = multinet_->detect(multinet_model_data_, const_cast<int16_t*>(mono_data.data()));
     } else {
-        StoreWakeWordData(data);
-        mn_state = multinet_->detect(multinet_model_data_, const_cast<int16_t*>(data.data()));
+        StoreWakeWordData(std::vector<int16_t>(data, data + samples));
+        mn_state = multinet_->detect(multinet_model_data_, const_cast<int16_t*>(data));
     }
     
     if (mn_state == ESP_MN_STATE_DETECTING) {
@@ -170,13 +174,18 @@ void CustomWakeWord::Feed(const std::vector<int16_t>& data) {
             ESP_LOGI(TAG, "Custom wake word detected: command_id=%d, string=%s, prob=%f", 
                     mn_result->command_id[i], mn_result->string, mn_result->prob[i]);
             auto& command = commands_[mn_result->command_id[i] - 1];
-            if (command.action == "wake") {
-                last_detected_wake_word_ = command.text;
-                running_ = false;
-                
-                if (wake_word_detected_callback_) {
-                    wake_word_detected_callback_(last_detected_wake_word_);
-                }
+            if (command.action != "wake" && command_detected_callback_ &&
+                command_detected_callback_(command.action, command.text)) {
+                // 本地已处理，继续监听，不唤醒
+                break;
+            }
+
+            // 唤醒词，或本地无法处理的命令，交给服务器
+            last_detected_wake_word_ = command.text;
+            running_ = false;
+
+            if (wake_word_detected_callback_) {
+                wake_word_detected_callback_(last_detected_wake_word_);
             }
         }
         multinet_->clean(multinet_model_data_);
@@ -218,12 +227,12 @@ void CustomWakeWord::EncodeWakeWordData() {
         auto this_ = (CustomWakeWord*)arg;
         {
             auto start_time = esp_timer_get_time();
-            auto encoder = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+            auto encoder = std::make_unique<OpusStreamEncoder>(16000);
             encoder->SetComplexity(0); // 0 is the fastest
 
             int packets = 0;
             for (auto& pcm: this_->wake_word_pcm_) {
-                encoder->Encode(std::move(pcm), [this_](std::vector<uint8_t>&& opus) {
+                encoder->Encode(pcm, [this_](std::vector<uint8_t>&& opus, int duration_ms) {
                     std::lock_guard<std::mutex> lock(this_->wake_word_mutex_);
                     this_->wake_word_opus_.emplace_back(std::move(opus));
                     this_->wake_word_cv_.notify_all();
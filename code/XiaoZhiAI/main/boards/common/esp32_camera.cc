@@ -15,12 +15,14 @@
 
 #include "board.h"
 #include "display.h"
+#include "http_pool.h"
 #include "esp32_camera.h"
 #include "esp_jpeg_common.h"
 #include "jpg/image_to_jpeg.h"
 #include "jpg/jpeg_to_image.h"
 #include "lvgl_display.h"
 #include "mcp_server.h"
+#include "memory_policy.h"
 #include "system_info.h"
 
 #ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_DEBUG_MODE
@@ -40,7 +42,6 @@
 #error "CONFIG_XIAOZHI_CAMERA_IMAGE_ROTATION_ANGLE is not set"
 #endif  // angle
 #else   // target
-#include "esp_imgfx_rotate.h"
 #if defined(CONFIG_XIAOZHI_CAMERA_IMAGE_ROTATION_ANGLE_90)
 #define IMAGE_ROTATION_ANGLE (90)
 #elif defined(CONFIG_XIAOZHI_CAMERA_IMAGE_ROTATION_ANGLE_270)
@@ -265,11 +266,11 @@ Esp32Camera::Esp32Camera(const esp_video_init_config_t& config) {
     }
 
 #ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
-    frame_.width = setformat.fmt.pix.height;
-    frame_.height = setformat.fmt.pix.width;
+    frame_width_ = setformat.fmt.pix.height;
+    frame_height_ = setformat.fmt.pix.width;
 #else
-    frame_.width = setformat.fmt.pix.width;
-    frame_.height = setformat.fmt.pix.height;
+    frame_width_ = setformat.fmt.pix.width;
+    frame_height_ = setformat.fmt.pix.height;
 #endif
 
     // 申请缓冲并mmap
@@ -361,6 +362,8 @@ Esp32Camera::Esp32Camera(const esp_video_init_config_t& config) {
 }
 
 Esp32Camera::~Esp32Camera() {
+    // 先归还仍被持有的帧缓冲区
+    frame_.reset();
     if (streaming_on_ && video_fd_ >= 0) {
         int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         ioctl(video_fd_, VIDIOC_STREAMOFF, &type);
@@ -383,15 +386,162 @@ void Esp32Camera::SetExplainUrl(const std::string& url, const std::string& token
     explain_token_ = token;
 }
 
-bool Esp32Camera::Capture() {
-    if (encoder_thread_.joinable()) {
-        encoder_thread_.join();
+namespace {
+
+// 直接引用捕获帧数据的预览图像，帧本身由 shared_ptr 保持存活，无需再复制一份
+class FramePreviewImage : public LvglImage {
+public:
+    FramePreviewImage(std::shared_ptr<void> owner, const uint8_t* data, size_t size, int width, int height, int stride)
+        : owner_(std::move(owner)) {
+        memset(&image_dsc_, 0, sizeof(image_dsc_));
+        image_dsc_.data_size = size;
+        image_dsc_.data = data;
+        image_dsc_.header.magic = LV_IMAGE_HEADER_MAGIC;
+        image_dsc_.header.cf = LV_COLOR_FORMAT_RGB565;
+        image_dsc_.header.w = width;
+        image_dsc_.header.h = height;
+        image_dsc_.header.stride = stride;
+    }
+    virtual const lv_img_dsc_t* image_dsc() const override { return &image_dsc_; }
+
+private:
+    std::shared_ptr<void> owner_;
+    lv_img_dsc_t image_dsc_;
+};
+
+size_t BytesPerPixel(v4l2_pix_fmt_t format) {
+    switch (format) {
+        case V4L2_PIX_FMT_GREY:
+            return 1;
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_YUYV:
+            return 2;
+        case V4L2_PIX_FMT_RGB24:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<Esp32Camera::FrameBuffer> Esp32Camera::HoldFrame(const struct v4l2_buffer& buf) {
+    auto frame = new FrameBuffer();
+    frame->data = (uint8_t*)mmap_buffers_[buf.index].start;
+    frame->len = MIN((size_t)buf.bytesused, mmap_buffers_[buf.index].length);
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+    frame->src_width = sensor_width_;
+    frame->src_height = sensor_height_;
+#else
+    frame->src_width = frame_width_;
+    frame->src_height = frame_height_;
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+    frame->width = frame_width_;
+    frame->height = frame_height_;
+    frame->format = sensor_format_;
+
+    int fd = video_fd_;
+    uint32_t index = buf.index;
+    return std::shared_ptr<FrameBuffer>(frame, [fd, index](FrameBuffer* held) {
+        struct v4l2_buffer qbuf = {};
+        qbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        qbuf.memory = V4L2_MEMORY_MMAP;
+        qbuf.index = index;
+        if (ioctl(fd, VIDIOC_QBUF, &qbuf) != 0) {
+            ESP_LOGE(TAG, "VIDIOC_QBUF failed");
+        }
+        delete held;
+    });
+}
+
+/**
+ * @brief 读取帧中输出坐标系下的若干行
+ *
+ * 旋转和字节交换在这里按行完成，输出为 frame.format 的紧密排列像素，
+ * 预览与 JPEG 编码都只需要一个条带大小的缓冲区，而不必生成整帧的旋转副本。
+ */
+bool Esp32Camera::ReadFrameRows(const FrameBuffer& frame, uint16_t y, uint16_t lines, uint8_t* dst) {
+    size_t bpp = BytesPerPixel(frame.format);
+    if (bpp == 0 || y + lines > frame.height) {
+        return false;
+    }
+    size_t row_bytes = (size_t)frame.width * bpp;
+
+    if (frame.rotation == 0) {
+        const uint8_t* src = frame.data + (size_t)y * row_bytes;
+        size_t bytes = (size_t)lines * row_bytes;
+        if (frame.swap_bytes) {
+            auto src16 = (const uint16_t*)src;
+            auto dst16 = (uint16_t*)dst;
+            for (size_t i = 0; i < bytes / 2; i++) {
+                dst16[i] = __builtin_bswap16(src16[i]);
+            }
+        } else {
+            memcpy(dst, src, bytes);
+        }
+        return true;
+    }
+
+    // 顺时针 90°:  dst(x, y) = src(y, H - 1 - x)
+    // 顺时针 270°: dst(x, y) = src(W - 1 - y, x)
+    // 同一输出行对应源图像的一列，逐像素按行跨度步进
+    const size_t src_row_bytes = (size_t)frame.src_width * bpp;
+    const bool cw90 = frame.rotation == 90;
+    const ptrdiff_t step = cw90 ? -(ptrdiff_t)src_row_bytes : (ptrdiff_t)src_row_bytes;
+    const size_t first_row = cw90 ? frame.src_height - 1 : 0;
+    const int sw = frame.swap_bytes ? 1 : 0;
+
+    for (uint16_t row = 0; row < lines; row++) {
+        uint16_t sx = cw90 ? y + row : frame.src_width - 1 - (y + row);
+        uint8_t* d = dst + (size_t)row * row_bytes;
+
+        if (frame.format == V4L2_PIX_FMT_YUYV) {
+            // 重新组合 YUYV 宏像素: 偶数像素取 Y/U，奇数像素取 Y/V
+            const uint8_t* s = frame.data + first_row * src_row_bytes + (size_t)(sx & ~1) * 2;
+            const int y_off = ((sx & 1) ? 2 : 0) ^ sw;
+            const int u_off = 1 ^ sw;
+            const int v_off = 3 ^ sw;
+            for (uint16_t x = 0; x < frame.width; x++, s += step, d += 2) {
+                d[0] = s[y_off];
+                d[1] = (x & 1) ? s[v_off] : s[u_off];
+            }
+            continue;
+        }
+
+        const uint8_t* s = frame.data + first_row * src_row_bytes + (size_t)sx * bpp;
+        switch (bpp) {
+            case 1:
+                for (uint16_t x = 0; x < frame.width; x++, s += step) {
+                    *d++ = s[0];
+                }
+                break;
+            case 2:
+                for (uint16_t x = 0; x < frame.width; x++, s += step, d += 2) {
+                    d[0] = s[sw];
+                    d[1] = s[sw ^ 1];
+                }
+                break;
+            default:
+                for (uint16_t x = 0; x < frame.width; x++, s += step, d += 3) {
+                    d[0] = s[0];
+                    d[1] = s[1];
+                    d[2] = s[2];
+                }
+                break;
+        }
     }
+    return true;
+}
 
+bool Esp32Camera::Capture() {
     if (!streaming_on_ || video_fd_ < 0) {
         return false;
     }
 
+    // 归还上一帧持有的缓冲区，否则单缓冲的 DVP 设备无法继续出帧
+    frame_.reset();
+
+    std::shared_ptr<FrameBuffer> frame;
     for (int i = 0; i < 3; i++) {
         struct v4l2_buffer buf = {};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -400,441 +550,348 @@ bool Esp32Camera::Capture() {
             ESP_LOGE(TAG, "VIDIOC_DQBUF failed");
             return false;
         }
-        if (i == 2) {
-            // 保存帧副本到PSRAM
-            if (frame_.data) {
-                heap_caps_free(frame_.data);
-                frame_.data = nullptr;
-                frame_.format = 0;
-            }
-            frame_.len = buf.bytesused;
-            frame_.data = (uint8_t*)heap_caps_malloc(frame_.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (!frame_.data) {
-                ESP_LOGE(TAG, "alloc frame copy failed: need allocate %lu bytes", buf.bytesused);
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
-                return false;
+        if (i < 2) {
+            if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
+                ESP_LOGE(TAG, "VIDIOC_QBUF failed");
             }
+            continue;
+        }
 
 #ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
-            ESP_LOGW(TAG, "mmap_buffers_[buf.index].length = %d, sensor_width = %d, sensor_height = %d",
-                     mmap_buffers_[buf.index].length, sensor_width_, sensor_height_);
+        ESP_LOGD(TAG, "mmap_buffers_[buf.index].length = %d, sensor_width = %d, sensor_height = %d",
+                 mmap_buffers_[buf.index].length, sensor_width_, sensor_height_);
 #else
-            ESP_LOGW(TAG, "mmap_buffers_[buf.index].length = %d, frame.width = %d, frame.height = %d",
-                     mmap_buffers_[buf.index].length, frame_.width, frame_.height);
+        ESP_LOGD(TAG, "mmap_buffers_[buf.index].length = %d, frame.width = %d, frame.height = %d",
+                 mmap_buffers_[buf.index].length, frame_width_, frame_height_);
 #endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
-            ESP_LOG_BUFFER_HEXDUMP(TAG, mmap_buffers_[buf.index].start, MIN(mmap_buffers_[buf.index].length, 256),
-                                   ESP_LOG_DEBUG);
-
-            switch (sensor_format_) {
-                case V4L2_PIX_FMT_RGB565:
-                case V4L2_PIX_FMT_RGB24:
-                case V4L2_PIX_FMT_YUYV:
-                case V4L2_PIX_FMT_YUV420:
-                case V4L2_PIX_FMT_GREY:
+        ESP_LOG_BUFFER_HEXDUMP(TAG, mmap_buffers_[buf.index].start, MIN(mmap_buffers_[buf.index].length, 256),
+                               ESP_LOG_DEBUG);
+
+        // 第三帧不再复制到 PSRAM，直接持有驱动缓冲区，释放时自动 QBUF
+        frame = HoldFrame(buf);
+    }
+
+    switch (frame->format) {
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_RGB24:
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_YUV420:
+        case V4L2_PIX_FMT_GREY:
 #ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
-                case V4L2_PIX_FMT_JPEG:
+        case V4L2_PIX_FMT_JPEG:
 #endif  // CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
+            break;
+        case V4L2_PIX_FMT_YUV422P:
+            // 这个格式是 422 YUYV，不是 planer
+            frame->format = V4L2_PIX_FMT_YUYV;
+            break;
+        case V4L2_PIX_FMT_RGB565X:
+            // 大端序的 RGB565 在读取时交换为小端序
+            // 目前 esp_video 的大小端都会返回格式为 RGB565，不会返回格式为 RGB565X，此 case 用于未来版本兼容
+            frame->format = V4L2_PIX_FMT_RGB565;
+            frame->swap_bytes = !frame->swap_bytes;
+            break;
+        default:
+            ESP_LOGE(TAG, "unsupported sensor format: 0x%08lx", sensor_format_);
+            return false;
+    }
+
 #ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
-                {
-                    auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
-                    auto dst16 = (uint16_t*)frame_.data;
-                    size_t count = (size_t)mmap_buffers_[buf.index].length / 2;
-                    for (size_t i = 0; i < count; i++) {
-                        dst16[i] = __builtin_bswap16(src16[i]);
-                    }
-                }
-#else
-                    memcpy(frame_.data, mmap_buffers_[buf.index].start,
-                           MIN(mmap_buffers_[buf.index].length, frame_.len));
-#endif  // CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
-                    frame_.format = sensor_format_;
-                    break;
-                case V4L2_PIX_FMT_YUV422P: {
-                    // 这个格式是 422 YUYV，不是 planer
-                    frame_.format = V4L2_PIX_FMT_YUYV;
-#ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
-                    {
-                        auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
-                        auto dst16 = (uint16_t*)frame_.data;
-                        size_t count = (size_t)mmap_buffers_[buf.index].length / 2;
-                        for (size_t i = 0; i < count; i++) {
-                            dst16[i] = __builtin_bswap16(src16[i]);
-                        }
-                    }
-#else
-                    memcpy(frame_.data, mmap_buffers_[buf.index].start,
-                           MIN(mmap_buffers_[buf.index].length, frame_.len));
+    // 字节交换只对 16 位像素格式有意义，推迟到读取时与旋转一起完成
+    if (frame->format == V4L2_PIX_FMT_RGB565 || frame->format == V4L2_PIX_FMT_YUYV) {
+        frame->swap_bytes = !frame->swap_bytes;
+    }
 #endif  // CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
-                    break;
-                }
-                case V4L2_PIX_FMT_RGB565X: {
-                    // 大端序的 RGB565 需要转换为小端序
-                    // 目前 esp_video 的大小端都会返回格式为 RGB565，不会返回格式为 RGB565X，此 case 用于未来版本兼容
-                    auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
-                    auto dst16 = (uint16_t*)frame_.data;
-                    size_t pixel_count = (size_t)frame_.width * (size_t)frame_.height;
-                    for (size_t i = 0; i < pixel_count; i++) {
-                        dst16[i] = __builtin_bswap16(src16[i]);
-                    }
-                    frame_.format = V4L2_PIX_FMT_RGB565;
-                    break;
-                }
-                default:
-                    ESP_LOGE(TAG, "unsupported sensor format: 0x%08lx", sensor_format_);
-                    if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                        ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                    }
-                    return false;
-            }
 
 #ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
 #ifndef CONFIG_SOC_PPA_SUPPORTED
-            uint8_t* rotate_dst =
-                (uint8_t*)heap_caps_aligned_alloc(64, frame_.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (rotate_dst == nullptr) {
+    if (BytesPerPixel(frame->format) == 0) {
+        ESP_LOGE(TAG, "unsupported sensor format for rotation: 0x%08lx", sensor_format_);
+        return false;
+    }
+    frame->rotation = IMAGE_ROTATION_ANGLE;
+#else   // CONFIG_SOC_PPA_SUPPORTED
+    // PPA 直接从驱动缓冲区读取并输出旋转后的 RGB565，输出帧随后被预览和编码共享
+    std::shared_ptr<void> rgb888_holder;
+    const uint8_t* rotate_src = frame->data;
+    ppa_srm_color_mode_t ppa_color_mode;
+    switch (frame->format) {
+        case V4L2_PIX_FMT_RGB565:
+            ppa_color_mode = PPA_SRM_COLOR_MODE_RGB565;
+            break;
+        case V4L2_PIX_FMT_RGB24:
+            ppa_color_mode = PPA_SRM_COLOR_MODE_RGB888;
+            break;
+        case V4L2_PIX_FMT_YUYV: {
+            ESP_LOGW(TAG, "YUYV format is not supported for PPA rotation, using software conversion to RGB888");
+            size_t rgb888_len = (size_t)frame->src_width * frame->src_height * 3;
+            uint8_t* rgb888 = (uint8_t*)MemoryPolicy::GetInstance().Allocate(kMemoryPoolPsram, rgb888_len);
+            if (rgb888 == nullptr) {
                 ESP_LOGE(TAG, "Failed to allocate memory for rotate image");
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
                 return false;
             }
-            uint8_t* rotate_src = (uint8_t*)frame_.data;
-
-            esp_imgfx_rotate_cfg_t rotate_cfg = {
-                .in_res =
-                    {
-                        .width = static_cast<int16_t>(sensor_width_),
-                        .height = static_cast<int16_t>(sensor_height_),
-                    },
-                .degree = IMAGE_ROTATION_ANGLE,
+            rgb888_holder.reset(rgb888, heap_caps_free);
+            esp_imgfx_color_convert_cfg_t convert_cfg = {
+                .in_res = {.width = static_cast<int16_t>(frame->src_width),
+                           .height = static_cast<int16_t>(frame->src_height)},
+                .in_pixel_fmt = frame->swap_bytes ? ESP_IMGFX_PIXEL_FMT_UYVY : ESP_IMGFX_PIXEL_FMT_YUYV,
+                .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888,
             };
-            switch (frame_.format) {
-                case V4L2_PIX_FMT_RGB565:
-                    rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE;
-                    break;
-                case V4L2_PIX_FMT_YUYV:
-                    rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE;
-                    break;
-                case V4L2_PIX_FMT_GREY:
-                    rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_Y;
-                    break;
-                case V4L2_PIX_FMT_RGB24:
-                    rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888;
-                    break;
-                default:
-                    ESP_LOGE(TAG, "unsupported sensor format: 0x%08lx", sensor_format_);
-                    if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                        ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                    }
-                    return false;
-            }
-            esp_imgfx_rotate_handle_t rotate_handle = nullptr;
-            esp_imgfx_err_t imgfx_err = esp_imgfx_rotate_open(&rotate_cfg, &rotate_handle);
-            if (imgfx_err != ESP_IMGFX_ERR_OK || rotate_handle == nullptr) {
-                ESP_LOGE(TAG, "esp_imgfx_rotate_create failed");
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
+            esp_imgfx_color_convert_handle_t convert_handle = nullptr;
+            esp_imgfx_err_t err = esp_imgfx_color_convert_open(&convert_cfg, &convert_handle);
+            if (err != ESP_IMGFX_ERR_OK || convert_handle == nullptr) {
+                ESP_LOGE(TAG, "esp_imgfx_color_convert_open failed");
                 return false;
             }
-
-            esp_imgfx_data_t rotate_input_data = {
-                .data = rotate_src,
-                .data_len = frame_.len,
+            esp_imgfx_data_t convert_input_data = {
+                .data = frame->data,
+                .data_len = static_cast<uint32_t>(frame->len),
             };
-            esp_imgfx_data_t rotate_output_data = {
-                .data = rotate_dst,
-                .data_len = frame_.len,
+            esp_imgfx_data_t convert_output_data = {
+                .data = rgb888,
+                .data_len = static_cast<uint32_t>(rgb888_len),
             };
-
-            imgfx_err = esp_imgfx_rotate_process(rotate_handle, &rotate_input_data, &rotate_output_data);
-            if (imgfx_err != ESP_IMGFX_ERR_OK) {
-                ESP_LOGE(TAG, "esp_imgfx_rotate_process failed");
-                heap_caps_free(rotate_dst);
-                rotate_dst = nullptr;
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
-                esp_imgfx_rotate_close(rotate_handle);
-                rotate_handle = nullptr;
+            err = esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data);
+            esp_imgfx_color_convert_close(convert_handle);
+            if (err != ESP_IMGFX_ERR_OK) {
+                ESP_LOGE(TAG, "esp_imgfx_color_convert_process failed");
                 return false;
             }
+            rotate_src = rgb888;
+            ppa_color_mode = PPA_SRM_COLOR_MODE_RGB888;
+            break;
+        }
+        default:
+            ESP_LOGE(TAG, "unsupported sensor format for PPA rotation: 0x%08lx", sensor_format_);
+            return false;
+    }
 
-            frame_.data = rotate_dst;
+    size_t rotate_len = (size_t)frame->width * frame->height * 2;
+    uint8_t* rotate_dst = (uint8_t*)heap_caps_malloc(rotate_len,
+                                                     MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT | MALLOC_CAP_CACHE_ALIGNED);
+    if (rotate_dst == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate memory for rotate image");
+        return false;
+    }
 
-            heap_caps_free(rotate_src);
-            rotate_src = nullptr;
+    ppa_client_handle_t ppa_client = nullptr;
+    ppa_client_config_t client_cfg = {
+        .oper_type = PPA_OPERATION_SRM,
+        .max_pending_trans_num = 1,
+    };
+    esp_err_t err = ppa_register_client(&client_cfg, &ppa_client);
+    if (err != ESP_OK || ppa_client == nullptr) {
+        ESP_LOGE(TAG, "ppa_register_client failed: %d", (int)err);
+        heap_caps_free(rotate_dst);
+        return false;
+    }
 
-            esp_imgfx_rotate_close(rotate_handle);
-            rotate_handle = nullptr;
-#else   // CONFIG_SOC_PPA_SUPPORTED
-            uint8_t* rotate_src = nullptr;
+    ppa_srm_oper_config_t srm_cfg = {};
+    srm_cfg.in.buffer = (void*)rotate_src;
+    srm_cfg.in.pic_w = frame->src_width;
+    srm_cfg.in.pic_h = frame->src_height;
+    srm_cfg.in.block_w = frame->src_width;
+    srm_cfg.in.block_h = frame->src_height;
+    srm_cfg.in.block_offset_x = 0;
+    srm_cfg.in.block_offset_y = 0;
+    srm_cfg.in.srm_cm = ppa_color_mode;
+
+    srm_cfg.out.buffer = (void*)rotate_dst;
+    srm_cfg.out.buffer_size = rotate_len;
+    srm_cfg.out.pic_w = frame->width;
+    srm_cfg.out.pic_h = frame->height;
+    srm_cfg.out.block_offset_x = 0;
+    srm_cfg.out.block_offset_y = 0;
+    srm_cfg.out.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+
+    // 等比例缩放 1.0
+    srm_cfg.scale_x = 1.0f;
+    srm_cfg.scale_y = 1.0f;
+    srm_cfg.rotation_angle = IMAGE_ROTATION_ANGLE;
+    // RGB565 输入的字节交换交给 PPA 完成
+    srm_cfg.byte_swap = ppa_color_mode == PPA_SRM_COLOR_MODE_RGB565 && frame->swap_bytes;
+    srm_cfg.mode = PPA_TRANS_MODE_BLOCKING;
+    srm_cfg.user_data = nullptr;
+
+    err = ppa_do_scale_rotate_mirror(ppa_client, &srm_cfg);
+    (void)ppa_unregister_client(ppa_client);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ppa_do_scale_rotate_mirror failed: %d", (int)err);
+        heap_caps_free(rotate_dst);
+        return false;
+    }
 
-            ppa_srm_color_mode_t ppa_color_mode;
-            switch (frame_.format) {
-                case V4L2_PIX_FMT_RGB565:
-                    rotate_src = (uint8_t*)frame_.data;
-                    ppa_color_mode = PPA_SRM_COLOR_MODE_RGB565;
-                    break;
-                case V4L2_PIX_FMT_RGB24:
-                    rotate_src = (uint8_t*)frame_.data;
-                    ppa_color_mode = PPA_SRM_COLOR_MODE_RGB888;
-                    break;
-                case V4L2_PIX_FMT_YUYV: {
-                    ESP_LOGW(TAG, "YUYV format is not supported for PPA rotation, using software conversion to RGB888");
-                    rotate_src = (uint8_t*)heap_caps_malloc(frame_.width * frame_.height * 3,
-                                                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (rotate_src == nullptr) {
-                        ESP_LOGE(TAG, "Failed to allocate memory for rotate image");
-                        if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                            ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                        }
-                        return false;
-                    }
-                    esp_imgfx_color_convert_cfg_t convert_cfg = {
-                        .in_res = {.width = static_cast<int16_t>(frame_.width),
-                                   .height = static_cast<int16_t>(frame_.height)},
-                        .in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_YUYV,
-                        .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888,
-                    };
-                    esp_imgfx_color_convert_handle_t convert_handle = nullptr;
-                    esp_imgfx_err_t err = esp_imgfx_color_convert_open(&convert_cfg, &convert_handle);
-                    if (err != ESP_IMGFX_ERR_OK || convert_handle == nullptr) {
-                        ESP_LOGE(TAG, "esp_imgfx_color_convert_open failed");
-                        heap_caps_free(rotate_src);
-                        rotate_src = nullptr;
-                        if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                            ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                        }
-                        return false;
-                    }
-                    esp_imgfx_data_t convert_input_data = {
-                        .data = frame_.data,
-                        .data_len = frame_.len,
-                    };
-                    esp_imgfx_data_t convert_output_data = {
-                        .data = rotate_src,
-                        .data_len = static_cast<uint32_t>(frame_.width * frame_.height * 3),
-                    };
-                    err = esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data);
-                    if (err != ESP_IMGFX_ERR_OK) {
-                        ESP_LOGE(TAG, "esp_imgfx_color_convert_process failed");
-                        heap_caps_free(rotate_src);
-                        rotate_src = nullptr;
-                        esp_imgfx_color_convert_close(convert_handle);
-                        convert_handle = nullptr;
-                        if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                            ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                        }
-                        return false;
-                    }
-                    esp_imgfx_color_convert_close(convert_handle);
-                    convert_handle = nullptr;
-                    ppa_color_mode = PPA_SRM_COLOR_MODE_RGB888;
-                    heap_caps_free(frame_.data);
-                    frame_.data = rotate_src;
-                    frame_.len = frame_.width * frame_.height * 3;
-                    break;
-                }
-                default:
-                    ESP_LOGE(TAG, "unsupported sensor format for PPA rotation: 0x%08lx", sensor_format_);
-                    if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                        ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                    }
-                    return false;
-            }
+    // 旋转完成后立即归还驱动缓冲区
+    auto rotated = new FrameBuffer();
+    rotated->data = rotate_dst;
+    rotated->len = rotate_len;
+    rotated->width = rotated->src_width = frame->width;
+    rotated->height = rotated->src_height = frame->height;
+    rotated->format = V4L2_PIX_FMT_RGB565;
+    rotated->owned = true;
+    frame.reset(rotated, [](FrameBuffer* owned) {
+        heap_caps_free(owned->data);
+        delete owned;
+    });
+#endif  // CONFIG_SOC_PPA_SUPPORTED
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
 
-            uint8_t* rotate_dst = (uint8_t*)heap_caps_malloc(
-                frame_.width * frame_.height * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT | MALLOC_CAP_CACHE_ALIGNED);
-            if (rotate_dst == nullptr) {
-                ESP_LOGE(TAG, "Failed to allocate memory for rotate image");
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
-                return false;
-            }
+    frame_ = frame;
 
-            ppa_client_handle_t ppa_client = nullptr;
-            ppa_client_config_t client_cfg = {
-                .oper_type = PPA_OPERATION_SRM,
-                .max_pending_trans_num = 1,
-            };
-            esp_err_t err = ppa_register_client(&client_cfg, &ppa_client);
-            if (err != ESP_OK || ppa_client == nullptr) {
-                ESP_LOGE(TAG, "ppa_register_client failed: %d", (int)err);
-                heap_caps_free(rotate_dst);
-                rotate_dst = nullptr;
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
-                return false;
-            }
+    // 显示预览图片
+    return ShowPreview(frame);
+}
 
-            ppa_srm_rotation_angle_t ppa_angle = IMAGE_ROTATION_ANGLE;
-
-            ppa_srm_oper_config_t srm_cfg = {};
-            srm_cfg.in.buffer = (void*)rotate_src;
-            srm_cfg.in.pic_w = sensor_width_;
-            srm_cfg.in.pic_h = sensor_height_;
-            srm_cfg.in.block_w = sensor_width_;
-            srm_cfg.in.block_h = sensor_height_;
-            srm_cfg.in.block_offset_x = 0;
-            srm_cfg.in.block_offset_y = 0;
-            srm_cfg.in.srm_cm = ppa_color_mode;
-
-            srm_cfg.out.buffer = (void*)rotate_dst;
-            srm_cfg.out.buffer_size = frame_.len;
-            srm_cfg.out.pic_w = frame_.width;
-            srm_cfg.out.pic_h = frame_.height;
-            srm_cfg.out.block_offset_x = 0;
-            srm_cfg.out.block_offset_y = 0;
-            srm_cfg.out.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
-
-            // 等比例缩放 1.0
-            srm_cfg.scale_x = 1.0f;
-            srm_cfg.scale_y = 1.0f;
-            srm_cfg.rotation_angle = ppa_angle;
-            srm_cfg.mode = PPA_TRANS_MODE_BLOCKING;
-            srm_cfg.user_data = nullptr;
-
-            err = ppa_do_scale_rotate_mirror(ppa_client, &srm_cfg);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "ppa_do_scale_rotate_mirror failed: %d", (int)err);
-                heap_caps_free(rotate_dst);
-                rotate_dst = nullptr;
-                (void)ppa_unregister_client(ppa_client);
-                if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-                    ESP_LOGE(TAG, "Cleanup: VIDIOC_QBUF failed");
-                }
-                return false;
-            }
+bool Esp32Camera::ShowPreview(const std::shared_ptr<FrameBuffer>& frame) {
+    auto display = dynamic_cast<LvglDisplay*>(Board::GetInstance().GetDisplay());
+    if (display == nullptr) {
+        return true;
+    }
 
-            (void)ppa_unregister_client(ppa_client);
+    uint16_t w = frame->width;
+    uint16_t h = frame->height;
+    size_t stride = ((w * 2) + 3) & ~3;  // 4字节对齐
+    size_t preview_len = (size_t)w * h * 2;
 
-            frame_.data = rotate_dst;
-            frame_.len = frame_.width * frame_.height * 2;
-            frame_.format = V4L2_PIX_FMT_RGB565;
-            heap_caps_free(rotate_src);
-            rotate_src = nullptr;
-#endif  // CONFIG_SOC_PPA_SUPPORTED
-#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
-        }
+    // 已经是自有内存中的正向 RGB565 帧（PPA 输出），预览直接共享该帧
+    if (frame->owned && frame->format == V4L2_PIX_FMT_RGB565 && frame->rotation == 0 && !frame->swap_bytes &&
+        frame->len == preview_len) {
+        display->SetPreviewImage(std::make_unique<FramePreviewImage>(frame, frame->data, preview_len, w, h, stride));
+        return true;
+    }
 
-        if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
-            ESP_LOGE(TAG, "VIDIOC_QBUF failed");
+#ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
+    if (frame->format == V4L2_PIX_FMT_JPEG) {
+        uint8_t* out_data = nullptr;  // out data is allocated by jpeg_to_image
+        size_t out_len = 0;
+        size_t out_width = 0;
+        size_t out_height = 0;
+        size_t out_stride = 0;
+
+        esp_err_t ret =
+            jpeg_to_image(frame->data, frame->len, &out_data, &out_len, &out_width, &out_height, &out_stride);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to decode JPEG image: %d (%s)", (int)ret, esp_err_to_name(ret));
+            if (out_data) {
+                heap_caps_free(out_data);
+                out_data = nullptr;
+            }
+            return false;
         }
+        display->SetPreviewImage(std::make_unique<LvglAllocatedImage>(out_data, out_len, out_width, out_height,
+                                                                      out_stride, LV_COLOR_FORMAT_RGB565));
+        return true;
     }
+#endif  // CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
 
-    // 显示预览图片
-    auto display = dynamic_cast<LvglDisplay*>(Board::GetInstance().GetDisplay());
-    if (display != nullptr) {
-        if (!frame_.data) {
-            ESP_LOGE(TAG, "frame.data is null");
-            return false;
+    uint8_t* data = (uint8_t*)MemoryPolicy::GetInstance().Allocate(kMemoryPoolPsram, preview_len);
+    if (data == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate memory for preview image");
+        return false;
+    }
+
+    bool ok = false;
+    switch (frame->format) {
+        case V4L2_PIX_FMT_RGB565:
+            // 旋转与字节交换在同一次拷贝中完成
+            ok = ReadFrameRows(*frame, 0, h, data);
+            break;
+
+        // LVGL 显示 YUV 系的图像似乎都有问题，暂时转换为 RGB565 显示
+        case V4L2_PIX_FMT_YUV420: {
+            // 平面格式无法按行读取，也不会被旋转，整帧转换
+            esp_imgfx_color_convert_cfg_t convert_cfg = {
+                .in_res = {.width = static_cast<int16_t>(w), .height = static_cast<int16_t>(h)},
+                .in_pixel_fmt = static_cast<esp_imgfx_pixel_fmt_t>(frame->format),
+                .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE,
+                .color_space_std = ESP_IMGFX_COLOR_SPACE_STD_BT601,
+            };
+            esp_imgfx_color_convert_handle_t convert_handle = nullptr;
+            if (esp_imgfx_color_convert_open(&convert_cfg, &convert_handle) != ESP_IMGFX_ERR_OK ||
+                convert_handle == nullptr) {
+                ESP_LOGE(TAG, "esp_imgfx_color_convert_open failed");
+                break;
+            }
+            esp_imgfx_data_t convert_input_data = {
+                .data = frame->data,
+                .data_len = static_cast<uint32_t>(frame->len),
+            };
+            esp_imgfx_data_t convert_output_data = {
+                .data = data,
+                .data_len = static_cast<uint32_t>(preview_len),
+            };
+            ok = esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data) ==
+                 ESP_IMGFX_ERR_OK;
+            if (!ok) {
+                ESP_LOGE(TAG, "esp_imgfx_color_convert_process failed");
+            }
+            esp_imgfx_color_convert_close(convert_handle);
+            break;
         }
-        uint16_t w = frame_.width;
-        uint16_t h = frame_.height;
-        size_t lvgl_image_size = frame_.len;
-        size_t stride = ((w * 2) + 3) & ~3;  // 4字节对齐
-        lv_color_format_t color_format = LV_COLOR_FORMAT_RGB565;
-        uint8_t* data = nullptr;
-
-        switch (frame_.format) {
-            // LVGL 显示 YUV 系的图像似乎都有问题，暂时转换为 RGB565 显示
-            case V4L2_PIX_FMT_YUYV:
-            case V4L2_PIX_FMT_YUV420:
-            case V4L2_PIX_FMT_RGB24: {
-                color_format = LV_COLOR_FORMAT_RGB565;
-                data = (uint8_t*)heap_caps_malloc(w * h * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                if (data == nullptr) {
-                    ESP_LOGE(TAG, "Failed to allocate memory for preview image");
-                    return false;
-                }
-                esp_imgfx_color_convert_cfg_t convert_cfg = {
-                    .in_res = {.width = static_cast<int16_t>(frame_.width),
-                               .height = static_cast<int16_t>(frame_.height)},
-                    .in_pixel_fmt = static_cast<esp_imgfx_pixel_fmt_t>(frame_.format),
-                    .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE,
-                    .color_space_std = ESP_IMGFX_COLOR_SPACE_STD_BT601,
-                };
-                esp_imgfx_color_convert_handle_t convert_handle = nullptr;
-                esp_imgfx_err_t err = esp_imgfx_color_convert_open(&convert_cfg, &convert_handle);
-                if (err != ESP_IMGFX_ERR_OK || convert_handle == nullptr) {
-                    ESP_LOGE(TAG, "esp_imgfx_color_convert_open failed");
-                    heap_caps_free(data);
-                    data = nullptr;
-                    return false;
+
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_RGB24: {
+            // 按条带读取（含旋转）并转换，条带缓冲区远小于整帧
+            uint16_t band = 16;
+            while (h % band != 0) {
+                band--;
+            }
+            size_t band_len = (size_t)w * band * BytesPerPixel(frame->format);
+            // 条带缓冲区被反复读写，优先放内部 SRAM，内部 SRAM 紧张时自动退回 PSRAM
+            uint8_t* band_buf = (uint8_t*)MemoryPolicy::GetInstance().Allocate(kMemoryPoolInternal, band_len);
+            if (band_buf == nullptr) {
+                ESP_LOGE(TAG, "Failed to allocate memory for preview band");
+                break;
+            }
+            esp_imgfx_color_convert_cfg_t convert_cfg = {
+                .in_res = {.width = static_cast<int16_t>(w), .height = static_cast<int16_t>(band)},
+                .in_pixel_fmt = static_cast<esp_imgfx_pixel_fmt_t>(frame->format),
+                .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE,
+                .color_space_std = ESP_IMGFX_COLOR_SPACE_STD_BT601,
+            };
+            esp_imgfx_color_convert_handle_t convert_handle = nullptr;
+            if (esp_imgfx_color_convert_open(&convert_cfg, &convert_handle) != ESP_IMGFX_ERR_OK ||
+                convert_handle == nullptr) {
+                ESP_LOGE(TAG, "esp_imgfx_color_convert_open failed");
+                heap_caps_free(band_buf);
+                break;
+            }
+            ok = true;
+            for (uint16_t y = 0; y < h && ok; y += band) {
+                ok = ReadFrameRows(*frame, y, band, band_buf);
+                if (!ok) {
+                    break;
                 }
                 esp_imgfx_data_t convert_input_data = {
-                    .data = frame_.data,
-                    .data_len = frame_.len,
+                    .data = band_buf,
+                    .data_len = static_cast<uint32_t>(band_len),
                 };
                 esp_imgfx_data_t convert_output_data = {
-                    .data = data,
-                    .data_len = static_cast<uint32_t>(w * h * 2),
+                    .data = data + (size_t)y * w * 2,
+                    .data_len = static_cast<uint32_t>((size_t)w * band * 2),
                 };
-                err = esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data);
-                if (err != ESP_IMGFX_ERR_OK) {
+                ok = esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data) ==
+                     ESP_IMGFX_ERR_OK;
+                if (!ok) {
                     ESP_LOGE(TAG, "esp_imgfx_color_convert_process failed");
-                    heap_caps_free(data);
-                    data = nullptr;
-                    esp_imgfx_color_convert_close(convert_handle);
-                    convert_handle = nullptr;
-                    return false;
                 }
-                esp_imgfx_color_convert_close(convert_handle);
-                convert_handle = nullptr;
-                lvgl_image_size = w * h * 2;
-                break;
             }
-
-            case V4L2_PIX_FMT_RGB565:
-                data = (uint8_t*)heap_caps_malloc(w * h * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                if (data == nullptr) {
-                    ESP_LOGE(TAG, "Failed to allocate memory for preview image");
-                    return false;
-                }
-                memcpy(data, frame_.data, frame_.len);
-                lvgl_image_size = frame_.len;  // fallthrough 时兼顾 YUYV 与 RGB565
-                break;
-
-#ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
-            case V4L2_PIX_FMT_JPEG: {
-                uint8_t* out_data = nullptr;  // out data is allocated by jpeg_to_image
-                size_t out_len = 0;
-                size_t out_width = 0;
-                size_t out_height = 0;
-                size_t out_stride = 0;
-
-                esp_err_t ret =
-                    jpeg_to_image(frame_.data, frame_.len, &out_data, &out_len, &out_width, &out_height, &out_stride);
-                if (ret != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to decode JPEG image: %d (%s)", (int)ret, esp_err_to_name(ret));
-                    if (out_data) {
-                        heap_caps_free(out_data);
-                        out_data = nullptr;
-                    }
-                    return false;
-                }
-
-                data = out_data;
-                w = out_width;
-                h = out_height;
-                lvgl_image_size = out_len;
-                stride = out_stride;
-                break;
-            }
-#endif
-            default:
-                ESP_LOGE(TAG, "unsupported frame format: 0x%08lx", frame_.format);
-                return false;
+            esp_imgfx_color_convert_close(convert_handle);
+            heap_caps_free(band_buf);
+            break;
         }
 
-        auto image = std::make_unique<LvglAllocatedImage>(data, lvgl_image_size, w, h, stride, color_format);
-        display->SetPreviewImage(std::move(image));
+        default:
+            ESP_LOGE(TAG, "unsupported frame format: 0x%08lx", frame->format);
+            break;
     }
+
+    if (!ok) {
+        heap_caps_free(data);
+        return false;
+    }
+    display->SetPreviewImage(
+        std::make_unique<LvglAllocatedImage>(data, preview_len, w, h, stride, LV_COLOR_FORMAT_RGB565));
     return true;
 }
 
@@ -880,9 +937,8 @@ bool Esp32Camera::SetVFlip(bool enabled) {
  * 问题对图像进行AI分析并返回结果。
  *
  * 实现特点：
- * - 使用独立线程编码JPEG，与主线程分离
- * - 采用分块传输编码(chunked transfer encoding)优化内存使用
- * - 通过队列机制实现编码线程和发送线程的数据同步
+ * - 旋转、字节交换、颜色转换与JPEG编码在同一遍按条带处理中完成，不生成整帧中间副本
+ * - 每编码完一个块即直接写入分块传输编码(chunked transfer encoding)的请求体
  * - 支持设备ID、客户端ID和认证令牌的HTTP头部配置
  *
  * @param question 要向AI提出的关于图像的问题，将作为表单字段发送
@@ -892,7 +948,6 @@ bool Esp32Camera::SetVFlip(bool enabled) {
  *                  {"success": false, "message": "错误信息"}
  *
  * @note 调用此函数前必须先调用SetExplainUrl()设置服务器URL
- * @note 函数会等待之前的编码线程完成后再开始新的处理
  * @warning 如果摄像头缓冲区为空或网络连接失败，将返回错误信息
  */
 std::string Esp32Camera::Explain(const std::string& question) {
@@ -900,47 +955,13 @@ std::string Esp32Camera::Explain(const std::string& question) {
         throw std::runtime_error("Image explain URL or token is not set");
     }
 
-    // 创建局部的 JPEG 队列, 40 entries is about to store 512 * 40 = 20480 bytes of JPEG data
-    QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
-    if (jpeg_queue == nullptr) {
-        ESP_LOGE(TAG, "Failed to create JPEG queue");
-        throw std::runtime_error("Failed to create JPEG queue");
+    // 上传期间持有帧引用，即使期间再次 Capture 也不会提前归还缓冲区
+    auto frame = frame_;
+    if (!frame) {
+        throw std::runtime_error("No captured image");
     }
 
-    // We spawn a thread to encode the image to JPEG using optimized encoder (cost about 500ms and 8KB SRAM)
-    encoder_thread_ = std::thread([this, jpeg_queue]() {
-        uint16_t w = frame_.width ? frame_.width : 320;
-        uint16_t h = frame_.height ? frame_.height : 240;
-        v4l2_pix_fmt_t enc_fmt = frame_.format;
-        bool ok = image_to_jpeg_cb(
-            frame_.data, frame_.len, w, h, enc_fmt, 80,
-            [](void* arg, size_t index, const void* data, size_t len) -> size_t {
-                auto jpeg_queue = static_cast<QueueHandle_t>(arg);
-                JpegChunk chunk = {.data = nullptr, .len = len};
-                if (index == 0 && data != nullptr && len > 0) {
-                    chunk.data = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (chunk.data == nullptr) {
-                        ESP_LOGE(TAG, "Failed to allocate %zu bytes for JPEG chunk", len);
-                        chunk.len = 0;
-                    } else {
-                        memcpy(chunk.data, data, len);
-                    }
-                } else {
-                    chunk.len = 0;  // Sentinel or error
-                }
-                xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
-                return len;
-            },
-            jpeg_queue);
-
-        if (!ok) {
-            JpegChunk chunk = {.data = nullptr, .len = 0};
-            xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
-        }
-    });
-
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(3);
+    auto http = HttpPool::GetInstance().CreateHttp(3);
     // 构造multipart/form-data请求体
     std::string boundary = "----ESP32_CAMERA_BOUNDARY";
 
@@ -954,17 +975,6 @@ std::string Esp32Camera::Explain(const std::string& question) {
     http->SetHeader("Transfer-Encoding", "chunked");
     if (!http->Open("POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
-        // Clear the queue
-        encoder_thread_.join();
-        JpegChunk chunk;
-        while (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) == pdPASS) {
-            if (chunk.data != nullptr) {
-                heap_caps_free(chunk.data);
-            } else {
-                break;
-            }
-        }
-        vQueueDelete(jpeg_queue);
         throw std::runtime_error("Failed to connect to explain URL");
     }
 
@@ -987,30 +997,44 @@ std::string Esp32Camera::Explain(const std::string& question) {
         http->Write(file_header.c_str(), file_header.size());
     }
 
-    // 第三块：JPEG数据
-    size_t total_sent = 0;
-    bool saw_terminator = false;
-    while (true) {
-        JpegChunk chunk;
-        if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to receive JPEG chunk");
-            break;
+    // 第三块：JPEG数据，编码器每输出一段就直接写入请求体
+    struct UploadContext {
+        Http* http;
+        size_t total_sent;
+    } upload = {http.get(), 0};
+    auto write_cb = [](void* arg, size_t index, const void* data, size_t len) -> size_t {
+        auto upload = static_cast<UploadContext*>(arg);
+        if (data == nullptr || len == 0) {
+            return 0;  // 结束信号
         }
-        if (chunk.data == nullptr) {
-            saw_terminator = true;
-            break;  // The last chunk
+        if (upload->http->Write((const char*)data, len) < 0) {
+            return 0;
         }
-        http->Write((const char*)chunk.data, chunk.len);
-        total_sent += chunk.len;
-        heap_caps_free(chunk.data);
+        upload->total_sent += len;
+        return len;
+    };
+
+    // JPEG 直通、YUV420 以及无需逐行变换时的硬件编码仍走整帧接口，其余按条带融合编码
+    bool whole_frame = BytesPerPixel(frame->format) == 0;
+#ifdef CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
+    whole_frame = whole_frame || (frame->rotation == 0 && !frame->swap_bytes);
+#endif  // CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
+    bool ok;
+    if (whole_frame) {
+        ok = image_to_jpeg_cb(frame->data, frame->len, frame->width, frame->height, frame->format, 80, write_cb,
+                              &upload);
+    } else {
+        ok = image_to_jpeg_strip_cb(
+            frame->width, frame->height, frame->format, 80,
+            [](void* arg, uint16_t y, uint16_t lines, uint8_t* dst) -> bool {
+                return ReadFrameRows(*static_cast<FrameBuffer*>(arg), y, lines, dst);
+            },
+            frame.get(), write_cb, &upload);
     }
-    // Wait for the encoder thread to finish
-    encoder_thread_.join();
-    // 清理队列
-    vQueueDelete(jpeg_queue);
 
-    if (!saw_terminator || total_sent == 0) {
+    if (!ok || upload.total_sent == 0) {
         ESP_LOGE(TAG, "JPEG encoder failed or produced empty output");
+        http->Close();
         throw std::runtime_error("Failed to encode image to JPEG");
     }
 
@@ -1034,6 +1058,6 @@ std::string Esp32Camera::Explain(const std::string& question) {
     // Get remain task stack size
     size_t remain_stack_size = uxTaskGetStackHighWaterMark(nullptr);
     ESP_LOGI(TAG, "Explain image size=%d bytes, compressed size=%d, remain stack size=%d, question=%s\n%s",
-             (int)frame_.len, (int)total_sent, (int)remain_stack_size, question.c_str(), result.c_str());
+             (int)frame->len, (int)upload.total_sent, (int)remain_stack_size, question.c_str(), result.c_str());
     return result;
 }
@@ -3,31 +3,34 @@
 
 #ifndef CONFIG_IDF_TARGET_ESP32
 #include <lvgl.h>
-#include <thread>
 #include <memory>
 #include <vector>
 
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
 
 #include "camera.h"
 #include "jpg/image_to_jpeg.h"
 #include "esp_video_init.h"
 
-struct JpegChunk {
-    uint8_t* data;
-    size_t len;
-};
-
 class Esp32Camera : public Camera {
 private:
+    // 捕获的帧。直接引用 V4L2 mmap 缓冲区时，最后一个引用释放后才会 QBUF 归还驱动；
+    // 旋转和字节交换不在捕获时执行，而是在预览/编码逐行读取时完成
     struct FrameBuffer {
         uint8_t *data = nullptr;
         size_t len = 0;
-        uint16_t width = 0;
-        uint16_t height = 0;
+        uint16_t width = 0;         // 输出（旋转后）宽度
+        uint16_t height = 0;        // 输出（旋转后）高度
+        uint16_t src_width = 0;     // data 中的实际行宽
+        uint16_t src_height = 0;    // data 中的实际行数
+        uint16_t rotation = 0;      // 读取时顺时针旋转角度: 0/90/270
+        bool swap_bytes = false;    // 读取时交换 16 位字节序
+        bool owned = false;         // data 为自有内存而非驱动缓冲区，可被预览直接共享
         v4l2_pix_fmt_t format = 0;
-    } frame_;
+    };
+    std::shared_ptr<FrameBuffer> frame_;
+    uint16_t frame_width_ = 0;
+    uint16_t frame_height_ = 0;
     v4l2_pix_fmt_t sensor_format_ = 0;
 #ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
     uint16_t sensor_width_ = 0;
@@ -39,7 +42,10 @@ private:
     std::vector<MmapBuffer> mmap_buffers_;
     std::string explain_url_;
     std::string explain_token_;
-    std::thread encoder_thread_;
+
+    std::shared_ptr<FrameBuffer> HoldFrame(const struct v4l2_buffer& buf);
+    bool ShowPreview(const std::shared_ptr<FrameBuffer>& frame);
+    static bool ReadFrameRows(const FrameBuffer& frame, uint16_t y, uint16_t lines, uint8_t* dst);
 
 public:
     Esp32Camera(const esp_video_init_config_t& config);
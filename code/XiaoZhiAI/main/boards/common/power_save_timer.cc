@@ -1,6 +1,7 @@
 #include "power_save_timer.h"
 #include "application.h"
 #include "settings.h"
+#include "power_governor.h"
 
 #include <esp_log.h>
 
@@ -20,6 +21,11 @@ PowerSaveTimer::PowerSaveTimer(int cpu_max_freq, int seconds_to_sleep, int secon
         .skip_unhandled_events = true,
     };
     ESP_ERROR_CHECK(esp_timer_create(&timer_args, &power_save_timer_));
+
+    // Awake, the CPU frequency follows the running pipeline stages
+    if (cpu_max_freq_ != -1) {
+        PowerGovernor::GetInstance().SetLimits(cpu_max_freq_, false);
+    }
 }
 
 PowerSaveTimer::~PowerSaveTimer() {
@@ -89,12 +95,7 @@ void PowerSaveTimer::PowerSaveCheck() {
                     codec->EnableInput(false);
                 }
 
-                esp_pm_config_t pm_config = {
-                    .max_freq_mhz = cpu_max_freq_,
-                    .min_freq_mhz = 40,
-                    .light_sleep_enable = true,
-                };
-                esp_pm_configure(&pm_config);
+                PowerGovernor::GetInstance().SetLimits(cpu_max_freq_, true);
             }
         }
     }
@@ -110,12 +111,7 @@ void PowerSaveTimer::WakeUp() {
         in_sleep_mode_ = false;
 
         if (cpu_max_freq_ != -1) {
-            esp_pm_config_t pm_config = {
-                .max_freq_mhz = cpu_max_freq_,
-                .min_freq_mhz = cpu_max_freq_,
-                .light_sleep_enable = false,
-            };
-            esp_pm_configure(&pm_config);
+            PowerGovernor::GetInstance().SetLimits(cpu_max_freq_, false);
 
             // Enable wake word detection
             auto& app = Application::GetInstance();
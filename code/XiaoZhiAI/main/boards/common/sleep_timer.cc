@@ -3,6 +3,7 @@
 #include "board.h"
 #include "display.h"
 #include "settings.h"
+#include "status_model.h"
 
 #include <esp_log.h>
 #include <esp_sleep.h>
@@ -87,8 +88,7 @@ void SleepTimer::CheckTimer() {
         
             app.Schedule([this, &app]() {
                 while (in_light_sleep_mode_) {
-                    auto& board = Board::GetInstance();
-                    board.GetDisplay()->UpdateStatusBar(true);
+                    StatusModel::GetInstance().Refresh(kStatusItemAll);
                     lv_refr_now(nullptr);
                     lvgl_port_stop();
     
@@ -359,6 +359,7 @@ public:
 
     ~ElectronBotController() {
         if (action_task_handle_ != nullptr) {
+            electron_bot_.StopTicks();
             vTaskDelete(action_task_handle_);
             action_task_handle_ = nullptr;
         }
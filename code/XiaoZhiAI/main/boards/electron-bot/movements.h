@@ -21,6 +21,9 @@
 // -- Servo delta limit default. degree / sec
 #define SERVO_LIMIT_DEFAULT 240
 
+// -- Time to blend into a new oscillation from the current pose. ms
+#define MOTION_BLEND_MS 200
+
 // -- Servo indexes for easy access
 #define RIGHT_PITCH 0
 #define RIGHT_ROLL 1
@@ -69,6 +72,9 @@ public:
     void HeadAction(int action, int times = 1, int amount = 10, int period = 500);
     // action: 1=抬头, 2=低头, 3=点头, 4=回中心, 5=连续点头
 
+    // -- Stop the motion tick, e.g. before deleting the task that runs a movement
+    void StopTicks();
+
 private:
     Oscillator servo_[SERVO_COUNT];
 
@@ -76,12 +82,15 @@ private:
     int servo_trim_[SERVO_COUNT];
     int servo_initial_[SERVO_COUNT] = {180, 180, 0, 0, 90, 90};
 
-    unsigned long final_time_;
-    unsigned long partial_time_;
-    float increment_[SERVO_COUNT];
+    //-- Periodic timer that paces all servo updates at OSCILLATOR_TICK_MS
+    esp_timer_handle_t tick_timer_ = nullptr;
+    TaskHandle_t volatile tick_task_ = nullptr;
 
     bool is_otto_resting_;
 
+    void StartTicks();
+    void WaitTick();
+
     void Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
                  double phase_diff[SERVO_COUNT], float steps);
 };
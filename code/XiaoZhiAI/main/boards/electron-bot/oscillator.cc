@@ -5,18 +5,45 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 
 extern unsigned long IRAM_ATTR millis();
 
+//-- Quarter sine wave in Q15, 64 steps per quadrant
+static const int16_t kSineTable[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+//-- sin() of a phase in 1/65536 turns, Q15, linearly interpolated
+static int32_t SineQ15(uint32_t phase) {
+    uint32_t quadrant = (phase >> 14) & 3;
+    uint32_t x = phase & 0x3FFF;
+    if (quadrant & 1) {
+        x = 0x4000 - x;
+    }
+    uint32_t index = x >> 8;
+    int32_t value = kSineTable[index];
+    if (index < 64) {
+        value += ((kSineTable[index + 1] - value) * (int32_t)(x & 0xFF)) >> 8;
+    }
+    return (quadrant & 2) ? -value : value;
+}
+
 Oscillator::Oscillator(int trim) {
     trim_ = trim;
     diff_limit_ = 0;
     is_attached_ = false;
 
-    sampling_period_ = 30;
     period_ = 2000;
-    number_samples_ = period_ / sampling_period_;
-    inc_ = 2 * M_PI / number_samples_;
+    inc_ = 65536 * OSCILLATOR_TICK_MS / period_;
 
     amplitude_ = 45;
     phase_ = 0;
@@ -26,7 +53,6 @@ Oscillator::Oscillator(int trim) {
     rev_ = false;
 
     pos_ = 90;
-    previous_millis_ = 0;
 }
 
 Oscillator::~Oscillator() {
@@ -39,17 +65,6 @@ uint32_t Oscillator::AngleToCompare(int angle) {
            SERVO_MIN_PULSEWIDTH_US;
 }
 
-bool Oscillator::NextSample() {
-    current_millis_ = millis();
-
-    if (current_millis_ - previous_millis_ > sampling_period_) {
-        previous_millis_ = current_millis_;
-        return true;
-    }
-
-    return false;
-}
-
 void Oscillator::Attach(int pin, bool rev) {
     if (is_attached_) {
         Detach();
@@ -97,26 +112,33 @@ void Oscillator::Detach() {
 }
 
 void Oscillator::SetT(unsigned int T) {
-    period_ = T;
+    period_ = std::max(T, (unsigned int)OSCILLATOR_TICK_MS);
+    inc_ = 65536 * OSCILLATOR_TICK_MS / period_;
+}
 
-    number_samples_ = period_ / sampling_period_;
-    inc_ = 2 * M_PI / number_samples_;
+void Oscillator::SetPh(double Ph) {
+    //-- Radians to 1/65536 turns, computed once per movement
+    phase0_ = (uint32_t)(int32_t)std::lround(Ph * 65536 / (2 * M_PI));
 }
 
 void Oscillator::SetPosition(int position) {
     Write(position);
 }
 
-void Oscillator::Refresh() {
-    if (NextSample()) {
-        if (!stop_) {
-            int pos = std::round(amplitude_ * std::sin(phase_ + phase0_) + offset_);
-            if (rev_)
-                pos = -pos;
-            Write(pos + 90);
-        }
+int Oscillator::NextPosition() {
+    int32_t wave = ((int32_t)amplitude_ * SineQ15(phase_ + phase0_) + (1 << 14)) >> 15;
+    int pos = wave + offset_;
+    if (rev_)
+        pos = -pos;
 
-        phase_ = phase_ + inc_;
+    phase_ = phase_ + inc_;
+    return pos + 90;
+}
+
+void Oscillator::Refresh() {
+    int pos = NextPosition();
+    if (!stop_) {
+        Write(pos);
     }
 }
 
@@ -142,7 +164,9 @@ void Oscillator::Write(int position) {
 
     angle = std::min(std::max(angle, 0), 180);
 
-    uint32_t duty = (uint32_t)(((angle / 180.0) * 2.0 + 0.5) * 8191 / 20.0);
+    //-- 0.5ms..2.5ms pulse in a 20ms frame at 13-bit resolution
+    uint32_t duty = (SERVO_MIN_PULSEWIDTH_US + angle * (SERVO_MAX_PULSEWIDTH_US - SERVO_MIN_PULSEWIDTH_US) / 180) *
+                    8191 / SERVO_TIMEBASE_PERIOD;
 
     ESP_ERROR_CHECK(ledc_set_duty(ledc_speed_mode_, ledc_channel_, duty));
     ESP_ERROR_CHECK(ledc_update_duty(ledc_speed_mode_, ledc_channel_));
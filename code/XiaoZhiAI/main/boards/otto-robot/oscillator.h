@@ -27,6 +27,9 @@
 #define SERVO_TIMEBASE_RESOLUTION_HZ 1000000  // 1MHz, 1us per tick
 #define SERVO_TIMEBASE_PERIOD 20000           // 20000 ticks, 20ms
 
+// Servos are updated once per PWM frame by the movement tick timer
+#define OSCILLATOR_TICK_MS 20
+
 class Oscillator {
 public:
     Oscillator(int trim = 0);
@@ -36,7 +39,7 @@ public:
 
     void SetA(unsigned int amplitude) { amplitude_ = amplitude; };
     void SetO(int offset) { offset_ = offset; };
-    void SetPh(double Ph) { phase0_ = Ph; };
+    void SetPh(double Ph);
     void SetT(unsigned int period);
     void SetTrim(int trim) { trim_ = trim; };
     void SetLimiter(int diff_limit) { diff_limit_ = diff_limit; };
@@ -46,11 +49,13 @@ public:
     void Stop() { stop_ = true; };
     void Play() { stop_ = false; };
     void Reset() { phase_ = 0; };
+    //-- Advance by one OSCILLATOR_TICK_MS and return the target position without writing it
+    int NextPosition();
     void Refresh();
     int GetPosition() { return pos_; }
+    bool IsStopped() { return stop_; }
 
 private:
-    bool NextSample();
     void Write(int position);
     uint32_t AngleToCompare(int angle);
 
@@ -61,19 +66,14 @@ private:
     unsigned int amplitude_;  //-- Amplitude (degrees)
     int offset_;              //-- Offset (degrees)
     unsigned int period_;     //-- Period (miliseconds)
-    double phase0_;           //-- Phase (radians)
+    uint32_t phase0_;         //-- Phase (1/65536 turns)
 
     //-- Internal variables
     int pos_;                       //-- Current servo pos
     int pin_;                       //-- Pin where the servo is connected
     int trim_;                      //-- Calibration offset
-    double phase_;                  //-- Current phase
-    double inc_;                    //-- Increment of phase
-    double number_samples_;         //-- Number of samples
-    unsigned int sampling_period_;  //-- sampling period (ms)
-
-    long previous_millis_;
-    long current_millis_;
+    uint32_t phase_;                //-- Current phase (1/65536 turns)
+    uint32_t inc_;                  //-- Increment of phase per tick
 
     //-- Oscillation mode. If true, the servo is stopped
     bool stop_;
@@ -404,7 +404,9 @@ private:
                             controller->otto_.Home(true);
                             break;
                     }
-                    if(params.action_type != ACTION_SIT){
+                    // 队列中还有动作时不回到初始姿态，由下一个动作从当前姿态过渡
+                    bool has_next_action = uxQueueMessagesWaiting(controller->action_queue_) > 0;
+                    if(params.action_type != ACTION_SIT && !has_next_action){
                         if (params.action_type != ACTION_HOME && params.action_type != ACTION_SERVO_SEQUENCE) {
                             controller->otto_.Home(params.action_type != ACTION_HANDS_UP);
                         }
@@ -703,6 +705,7 @@ public:
         mcp_server.AddTool("self.otto.stop", "立即停止所有动作并复位", PropertyList(),
                            [this](const PropertyList& properties) -> ReturnValue {
                                if (action_task_handle_ != nullptr) {
+                                   otto_.StopTicks();
                                    vTaskDelete(action_task_handle_);
                                    action_task_handle_ = nullptr;
                                }
@@ -832,6 +835,7 @@ public:
 
     ~OttoController() {
         if (action_task_handle_ != nullptr) {
+            otto_.StopTicks();
             vTaskDelete(action_task_handle_);
             action_task_handle_ = nullptr;
         }
@@ -17,9 +17,26 @@ Otto::Otto() {
         servo_pins_[i] = -1;
         servo_trim_[i] = 0;
     }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            auto otto = static_cast<Otto*>(arg);
+            TaskHandle_t task = otto->tick_task_;
+            if (task != nullptr) {
+                xTaskNotifyGive(task);
+            }
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "motion_tick",
+        .skip_unhandled_events = true
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &tick_timer_));
 }
 
 Otto::~Otto() {
+    StopTicks();
+    esp_timer_delete(tick_timer_);
     DetachServos();
 }
 
@@ -84,6 +101,27 @@ void Otto::SetTrims(int left_leg, int right_leg, int left_foot, int right_foot,
     }
 }
 
+///////////////////////////////////////////////////////////////////
+//-- MOTION TICK ------------------------------------------------//
+///////////////////////////////////////////////////////////////////
+void Otto::StartTicks() {
+    tick_task_ = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (!esp_timer_is_active(tick_timer_)) {
+        esp_timer_start_periodic(tick_timer_, OSCILLATOR_TICK_MS * 1000);
+    }
+}
+
+void Otto::StopTicks() {
+    esp_timer_stop(tick_timer_);
+    tick_task_ = nullptr;
+}
+
+void Otto::WaitTick() {
+    //-- The timeout only matters after StopTicks() from another task
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OSCILLATOR_TICK_MS * 2));
+}
+
 ///////////////////////////////////////////////////////////////////
 //-- BASIC MOTION FUNCTIONS -------------------------------------//
 ///////////////////////////////////////////////////////////////////
@@ -92,22 +130,22 @@ void Otto::MoveServos(int time, int servo_target[]) {
         SetRestState(false);
     }
 
-    final_time_ = millis() + time;
-    if (time > 10) {
+    StartTicks();
+    int steps = time / OSCILLATOR_TICK_MS;
+    if (steps > 1) {
+        //-- Linear interpolation from the start position, exact at every step
+        int start[SERVO_COUNT];
         for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                increment_[i] = (servo_target[i] - servo_[i].GetPosition()) / (time / 10.0);
-            }
+            start[i] = servo_[i].GetPosition();
         }
 
-        for (int iteration = 1; millis() < final_time_; iteration++) {
-            partial_time_ = millis() + 10;
+        for (int step = 1; step <= steps; step++) {
             for (int i = 0; i < SERVO_COUNT; i++) {
                 if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_[i].GetPosition() + increment_[i]);
+                    servo_[i].SetPosition(start[i] + (servo_target[i] - start[i]) * step / steps);
                 }
             }
-            vTaskDelay(pdMS_TO_TICKS(10));
+            WaitTick();
         }
     } else {
         for (int i = 0; i < SERVO_COUNT; i++) {
@@ -135,10 +173,11 @@ void Otto::MoveServos(int time, int servo_target[]) {
                     servo_[i].SetPosition(servo_target[i]);
                 }
             }
-            vTaskDelay(pdMS_TO_TICKS(10));
+            WaitTick();
             adjustment_count++;
         }
     };
+    StopTicks();
 }
 
 void Otto::MoveSingle(int position, int servo_number) {
@@ -167,18 +206,30 @@ void Otto::OscillateServos(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT],
         }
     }
 
-    double ref = millis();
-    double end_time = period * cycle + ref;
+    //-- Blend from wherever the previous movement left the servos into the oscillation
+    int start[SERVO_COUNT];
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        start[i] = servo_[i].GetPosition();
+    }
+    int blend_ticks = std::max(1, std::min(MOTION_BLEND_MS, period / 4) / OSCILLATOR_TICK_MS);
+    int ticks = (int)(period * cycle) / OSCILLATOR_TICK_MS;
 
-    while (millis() < end_time) {
+    StartTicks();
+    for (int tick = 0; tick < ticks; tick++) {
         for (int i = 0; i < SERVO_COUNT; i++) {
             if (servo_pins_[i] != -1) {
-                servo_[i].Refresh();
+                int pos = servo_[i].NextPosition();
+                if (tick < blend_ticks) {
+                    pos = start[i] + (pos - start[i]) * (tick + 1) / blend_ticks;
+                }
+                if (!servo_[i].IsStopped()) {
+                    servo_[i].SetPosition(pos);
+                }
             }
         }
-        vTaskDelay(5);
+        WaitTick();
     }
-    vTaskDelay(pdMS_TO_TICKS(10));
+    StopTicks();
 }
 
 void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
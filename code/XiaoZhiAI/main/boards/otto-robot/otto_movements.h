@@ -21,6 +21,9 @@
 // -- Servo delta limit default. degree / sec
 #define SERVO_LIMIT_DEFAULT 240
 
+// -- Time to blend into a new oscillation from the current pose. ms
+#define MOTION_BLEND_MS 200
+
 // -- Servo indexes for easy access
 #define LEFT_LEG 0
 #define RIGHT_LEG 1
@@ -96,17 +99,23 @@ public:
     void EnableServoLimit(int speed_limit_degree_per_sec = SERVO_LIMIT_DEFAULT);
     void DisableServoLimit();
 
+    // -- Stop the motion tick, e.g. before deleting the task that runs a movement
+    void StopTicks();
+
 private:
     Oscillator servo_[SERVO_COUNT];
 
     int servo_pins_[SERVO_COUNT];
     int servo_trim_[SERVO_COUNT];
 
-    unsigned long final_time_;
-    unsigned long partial_time_;
-    float increment_[SERVO_COUNT];
+    //-- Periodic timer that paces all servo updates at OSCILLATOR_TICK_MS
+    esp_timer_handle_t tick_timer_ = nullptr;
+    TaskHandle_t volatile tick_task_ = nullptr;
 
     bool is_otto_resting_;
+
+    void StartTicks();
+    void WaitTick();
     bool has_hands_;  // 是否有手部舵机
 
     void Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
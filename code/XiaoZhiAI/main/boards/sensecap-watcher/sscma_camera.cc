@@ -3,6 +3,7 @@
 #include "lvgl_display.h"
 #include "lvgl_image.h"
 #include "board.h"
+#include "http_pool.h"
 #include "system_info.h"
 #include "config.h"
 #include "settings.h"
@@ -10,6 +11,7 @@
 #include <esp_log.h>
 #include <esp_heap_caps.h>
 #include <cstring>
+#include <mbedtls/base64.h>
 #include "application.h"
 #include "sscma_client_commands.h"
 
@@ -679,8 +681,7 @@ std::string SscmaCamera::Explain(const std::string& question) {
         return "{\"success\": false, \"message\": \"Image explain URL or token is not set\"}";
     }
 
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(3);
+    auto http = HttpPool::GetInstance().CreateHttp(3);
     // 构造multipart/form-data请求体
     std::string boundary = "----ESP32_CAMERA_BOUNDARY";
     
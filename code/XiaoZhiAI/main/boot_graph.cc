@@ -0,0 +1,159 @@
+#include "boot_graph.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include <cstdlib>
+
+#define TAG "BootGraph"
+
+BootGraph::BootGraph() {
+    event_group_ = xEventGroupCreate();
+    // Running stages keep a pointer to their entry, so the vector must never reallocate
+    stages_.reserve(BOOT_GRAPH_MAX_STAGES);
+}
+
+BootGraph::~BootGraph() {
+    vEventGroupDelete(event_group_);
+}
+
+int BootGraph::AddStage(const char* name, std::function<void()> action, const std::vector<int>& dependencies,
+                        uint32_t stack_size) {
+    return AddStageInternal(name, std::move(action), dependencies, stack_size);
+}
+
+int BootGraph::AddSignal(const char* name) {
+    return AddStageInternal(name, nullptr, {}, 0);
+}
+
+int BootGraph::AddStageInternal(const char* name, std::function<void()> action, const std::vector<int>& dependencies,
+                                uint32_t stack_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_ || stages_.size() >= BOOT_GRAPH_MAX_STAGES) {
+        ESP_LOGE(TAG, "Cannot add stage %s", name);
+        return -1;
+    }
+
+    int id = stages_.size();
+    EventBits_t bits = 0;
+    for (int dependency : dependencies) {
+        // Only earlier stages can be depended on, which keeps the graph free of cycles
+        if (dependency < 0 || dependency >= id) {
+            ESP_LOGE(TAG, "Stage %s has an invalid dependency %d", name, dependency);
+            return -1;
+        }
+        bits |= 1 << dependency;
+    }
+    stages_.push_back({
+        .graph = this,
+        .id = id,
+        .name = name,
+        .action = std::move(action),
+        .dependencies = bits,
+        .stack_size = stack_size,
+    });
+    return id;
+}
+
+void BootGraph::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    started_ = true;
+    LaunchReadyStages();
+}
+
+void BootGraph::LaunchReadyStages() {
+    auto now = esp_timer_get_time();
+    for (auto& stage : stages_) {
+        if (stage.launched || !stage.action || (stage.dependencies & done_bits_) != stage.dependencies) {
+            continue;
+        }
+        stage.launched = true;
+        stage.ready_us = now;
+        ESP_LOGI(TAG, "Stage %s started at %lld ms", stage.name, now / 1000);
+
+        auto ret = xTaskCreate([](void* arg) {
+            Stage* stage = static_cast<Stage*>(arg);
+            stage->graph->RunStage(*stage);
+            vTaskDelete(NULL);
+        }, stage.name, stage.stack_size, &stage, BOOT_GRAPH_TASK_PRIORITY, nullptr);
+        if (ret != pdPASS) {
+            // The stages depending on it, and the main loop waiting for the codec, would hang.
+            // Restart through the panic handler instead, the memory is gone anyway.
+            ESP_LOGE(TAG, "Failed to create task for stage %s (%lu bytes of stack), aborting", stage.name,
+                (unsigned long)stage.stack_size);
+            abort();
+        }
+    }
+}
+
+void BootGraph::RunStage(Stage& stage) {
+    stage.action();
+    MarkDone(stage.id);
+}
+
+void BootGraph::Complete(int stage) {
+    {
+        // Signals may be completed from any task while stages are still being added
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stage < 0 || stage >= (int)stages_.size() || stages_[stage].action) {
+            ESP_LOGE(TAG, "Stage %d is not a signal", stage);
+            return;
+        }
+    }
+    MarkDone(stage);
+}
+
+void BootGraph::MarkDone(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EventBits_t bit = 1 << id;
+    if (done_bits_ & bit) {
+        return;
+    }
+    auto& stage = stages_[id];
+    stage.done_us = esp_timer_get_time();
+    if (stage.ready_us < 0) {
+        stage.ready_us = stage.done_us;
+    }
+    done_bits_ |= bit;
+    xEventGroupSetBits(event_group_, bit);
+    ESP_LOGI(TAG, "Stage %s done at %lld ms, took %lld ms", stage.name, stage.done_us / 1000,
+        (stage.done_us - stage.ready_us) / 1000);
+
+    if (started_) {
+        LaunchReadyStages();
+    }
+}
+
+bool BootGraph::IsDone(int stage) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stage >= 0 && (done_bits_ & (1 << stage)) != 0;
+}
+
+bool BootGraph::Wait(int stage, TickType_t timeout) {
+    if (stage < 0) {
+        return false;
+    }
+    EventBits_t bit = 1 << stage;
+    return (xEventGroupWaitBits(event_group_, bit, pdFALSE, pdTRUE, timeout) & bit) != 0;
+}
+
+int64_t BootGraph::GetDoneTimeMs(int stage) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stage < 0 || stage >= (int)stages_.size() || stages_[stage].done_us < 0) {
+        return -1;
+    }
+    return stages_[stage].done_us / 1000;
+}
+
+void BootGraph::PrintTimings() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& stage : stages_) {
+        if (stage.done_us < 0) {
+            ESP_LOGI(TAG, "%-12s pending", stage.name);
+            continue;
+        }
+        ESP_LOGI(TAG, "%-12s ready %6lld ms, done %6lld ms, took %6lld ms", stage.name, stage.ready_us / 1000,
+            stage.done_us / 1000, (stage.done_us - stage.ready_us) / 1000);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef BOOT_GRAPH_H
+#define BOOT_GRAPH_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// One event group bit per stage, the upper bits of the event group are reserved
+#define BOOT_GRAPH_MAX_STAGES 24
+#define BOOT_GRAPH_STACK_SIZE (4096 * 2)
+#define BOOT_GRAPH_TASK_PRIORITY 2
+
+/*
+ * Startup stages with declared dependencies. A stage runs on a task of its own as soon
+ * as all of its dependencies are done, so independent stages overlap and the task stack
+ * only exists while the stage runs. Signal stages have no action, they are completed from
+ * outside, e.g. when the network comes up. Every stage records when it became ready and
+ * when it finished, so the critical path of the boot can be read from the log.
+ */
+class BootGraph {
+public:
+    BootGraph();
+    ~BootGraph();
+    BootGraph(const BootGraph&) = delete;
+    BootGraph& operator=(const BootGraph&) = delete;
+
+    // Stages are added before Start(), the returned id is used to declare dependencies
+    int AddStage(const char* name, std::function<void()> action, const std::vector<int>& dependencies = {},
+                 uint32_t stack_size = BOOT_GRAPH_STACK_SIZE);
+    int AddSignal(const char* name);
+
+    // Launch every stage that has no pending dependency
+    void Start();
+    // Mark a signal stage as done, repeated calls are ignored
+    void Complete(int stage);
+    bool IsDone(int stage) const;
+    bool Wait(int stage, TickType_t timeout = portMAX_DELAY);
+
+    // Milliseconds since boot when the stage was done, -1 if it is not
+    int64_t GetDoneTimeMs(int stage) const;
+    void PrintTimings() const;
+
+private:
+    struct Stage {
+        BootGraph* graph;
+        int id;
+        const char* name;
+        std::function<void()> action;     // Empty for signal stages
+        EventBits_t dependencies;
+        uint32_t stack_size;
+        bool launched = false;
+        int64_t ready_us = -1;  // All dependencies done
+        int64_t done_us = -1;
+    };
+
+    mutable std::mutex mutex_;
+    EventGroupHandle_t event_group_;
+    std::vector<Stage> stages_;
+    EventBits_t done_bits_ = 0;
+    bool started_ = false;
+
+    int AddStageInternal(const char* name, std::function<void()> action, const std::vector<int>& dependencies,
+                         uint32_t stack_size);
+    void LaunchReadyStages();
+    void RunStage(Stage& stage);
+    void MarkDone(int stage);
+};
+
+#endif // BOOT_GRAPH_H
@@ -32,7 +32,7 @@ void Display::ShowNotification(const char* notification, int duration_ms) {
     ESP_LOGW(TAG, "ShowNotification: %s", notification);
 }
 
-void Display::UpdateStatusBar(bool update_all) {
+void Display::OnStatusChanged(uint32_t changed, const StatusState& state) {
 }
 
 
@@ -2,6 +2,7 @@
 #define DISPLAY_H
 
 #include "emoji_collection.h"
+#include "status_model.h"
 
 #ifndef CONFIG_USE_EMOTE_MESSAGE_STYLE
 #define HAVE_LVGL 1
@@ -37,7 +38,8 @@ public:
     virtual void SetChatMessage(const char* role, const char* content);
     virtual void SetTheme(Theme* theme);
     virtual Theme* GetTheme() { return current_theme_; }
-    virtual void UpdateStatusBar(bool update_all = false);
+    // Redraw the status bar items that changed, see StatusModel
+    virtual void OnStatusChanged(uint32_t changed, const StatusState& state);
     virtual void SetPowerSaveMode(bool on);
 
     inline int width() const { return width_; }
@@ -469,9 +469,9 @@ void EmoteDisplay::ShowNotification(const char* notification, int duration_ms)
     SetUIDisplayMode(UIDisplayMode::SHOW_TIPS, this);
 }
 
-void EmoteDisplay::UpdateStatusBar(bool update_all)
+void EmoteDisplay::OnStatusChanged(uint32_t changed, const StatusState& state)
 {
-    if (!engine_) {
+    if (!engine_ || !(changed & kStatusItemClock)) {
         return;
     }
 
@@ -64,7 +64,7 @@ public:
     virtual void SetChatMessage(const char* role, const char* content) override;
     virtual void SetTheme(Theme* theme) override;
     virtual void ShowNotification(const char* notification, int duration_ms = 3000) override;
-    virtual void UpdateStatusBar(bool update_all = false) override;
+    virtual void OnStatusChanged(uint32_t changed, const StatusState& state) override;
     virtual void SetPowerSaveMode(bool on) override;
     virtual void SetPreviewImage(const void* image);
 
@@ -2,6 +2,7 @@
 #define LCD_DISPLAY_H
 
 #include "lvgl_display.h"
+#include "lvgl_theme.h"
 #include "gif/lvgl_gif.h"
 
 #include <esp_lcd_panel_io.h>
@@ -29,12 +30,13 @@ protected:
     lv_obj_t* preview_image_ = nullptr;
     lv_obj_t* emoji_label_ = nullptr;
     lv_obj_t* emoji_image_ = nullptr;
-    std::unique_ptr<LvglGif> gif_controller_ = nullptr;
+    std::shared_ptr<LvglGif> gif_controller_ = nullptr;  // Owned by the emoji collection cache
     lv_obj_t* emoji_box_ = nullptr;
     lv_obj_t* chat_message_label_ = nullptr;
     esp_timer_handle_t preview_timer_ = nullptr;
     std::unique_ptr<LvglImage> preview_image_cached_ = nullptr;
     bool hide_subtitle_ = false;  // Control whether to hide chat messages/subtitles
+    LvglThemeStyles styles_;      // Shared by all themed objects, rewritten by SetTheme
 
     void InitializeLcdThemes();
     void SetupUI();
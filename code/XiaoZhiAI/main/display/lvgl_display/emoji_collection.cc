@@ -1,28 +1,131 @@
 #include "emoji_collection.h"
+#include "display.h"
 
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <unordered_map>
 #include <string>
 
 #define TAG "EmojiCollection"
 
+// Size of the decoder gifdec allocates for the logical screen in the GIF header
+static size_t GetGifDecoderSize(const lv_img_dsc_t* image_dsc) {
+    if (image_dsc == nullptr || image_dsc->data == nullptr || image_dsc->data_size < 10) {
+        return 0;
+    }
+    auto data = image_dsc->data;
+    size_t width = data[6] | (data[7] << 8);
+    size_t height = data[8] | (data[9] << 8);
+    return sizeof(gd_GIF) + 5 * width * height;
+}
+
 void EmojiCollection::AddEmoji(const std::string& name, LvglImage* image) {
-    emoji_collection_[name] = image;
+    std::lock_guard<std::mutex> lock(mutex_);
+    emoji_collection_[name].image = image;
+}
+
+void EmojiCollection::AddEmoji(const std::string& name, std::function<LvglImage*()> loader) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    emoji_collection_[name].loader = std::move(loader);
 }
 
 const LvglImage* EmojiCollection::GetEmojiImage(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = emoji_collection_.find(name);
     if (it != emoji_collection_.end()) {
-        return it->second;
+        auto& entry = it->second;
+        if (entry.image == nullptr && entry.loader) {
+            entry.image = entry.loader();
+            entry.loader = nullptr;
+        }
+        return entry.image;
     }
 
     ESP_LOGW(TAG, "Emoji not found: %s", name);
     return nullptr;
 }
 
+std::shared_ptr<LvglGif> EmojiCollection::GetEmojiGif(const char* name) {
+    auto image = GetEmojiImage(name);
+    if (image == nullptr || !image->IsGif()) {
+        return nullptr;
+    }
+    return DecodeGif(image, true);
+}
+
+std::shared_ptr<LvglGif> EmojiCollection::DecodeGif(const LvglImage* image, bool evict) {
+    auto image_dsc = image->image_dsc();
+    size_t size = GetGifDecoderSize(image_dsc);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = gif_cache_.begin(); it != gif_cache_.end(); ++it) {
+            if (it->data == image_dsc->data) {
+                gif_cache_.splice(gif_cache_.begin(), gif_cache_, it);
+                return it->gif;
+            }
+        }
+        // A preload never pushes out what was already shown
+        if (!evict && gif_cache_bytes_ + size > EMOJI_GIF_CACHE_BYTES) {
+            return nullptr;
+        }
+    }
+
+    auto gif = std::make_shared<LvglGif>(image_dsc);
+    if (!gif->IsLoaded()) {
+        return nullptr;
+    }
+
+    std::list<CachedGif> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        gif_cache_.push_front({image_dsc->data, size, gif});
+        gif_cache_bytes_ += size;
+        // The entry just added stays even if it alone exceeds the budget
+        while (gif_cache_.size() > 1 && gif_cache_bytes_ > EMOJI_GIF_CACHE_BYTES) {
+            gif_cache_bytes_ -= gif_cache_.back().size;
+            evicted.splice(evicted.begin(), gif_cache_, std::prev(gif_cache_.end()));
+        }
+    }
+    if (!evicted.empty()) {
+        ESP_LOGD(TAG, "Evicted %u GIF decoders, %u bytes cached", (unsigned)evicted.size(), (unsigned)gif_cache_bytes_);
+    }
+    return gif;
+}
+
+void EmojiCollection::Preload(const std::vector<std::string>& names, Display* display) {
+    struct PreloadArgs {
+        std::shared_ptr<EmojiCollection> collection;
+        std::vector<std::string> names;
+        Display* display;
+    };
+    auto args = new PreloadArgs{shared_from_this(), names, display};
+
+    auto ret = xTaskCreate([](void* arg) {
+        auto args = static_cast<PreloadArgs*>(arg);
+        for (auto& name : args->names) {
+            auto image = args->collection->GetEmojiImage(name.c_str());
+            if (image == nullptr || !image->IsGif()) {
+                continue;
+            }
+            // One emoji per lock, so the UI keeps running between the decodes
+            DisplayLockGuard lock(args->display);
+            if (args->collection->DecodeGif(image, false) != nullptr) {
+                ESP_LOGI(TAG, "Preloaded emoji %s", name.c_str());
+            }
+        }
+        delete args;
+        vTaskDelete(NULL);
+    }, "emoji_preload", 4096, args, 1, nullptr);
+    if (ret != pdPASS) {
+        ESP_LOGW(TAG, "Failed to create emoji preload task");
+        delete args;
+    }
+}
+
 EmojiCollection::~EmojiCollection() {
     for (auto it = emoji_collection_.begin(); it != emoji_collection_.end(); ++it) {
-        delete it->second;
+        delete it->second.image;
     }
     emoji_collection_.clear();
 }
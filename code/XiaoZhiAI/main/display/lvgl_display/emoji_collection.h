@@ -2,23 +2,59 @@
 #define EMOJI_COLLECTION_H
 
 #include "lvgl_image.h"
+#include "gif/lvgl_gif.h"
 
 #include <lvgl.h>
 
+#include <functional>
+#include <list>
 #include <map>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <vector>
 
+// Budget for decoded GIF emojis kept around after they were shown
+#if CONFIG_SPIRAM
+#define EMOJI_GIF_CACHE_BYTES (1024 * 1024)
+#else
+#define EMOJI_GIF_CACHE_BYTES (128 * 1024)
+#endif
+
+class Display;
 
 // Define interface for emoji collection
-class EmojiCollection {
+class EmojiCollection : public std::enable_shared_from_this<EmojiCollection> {
 public:
     virtual void AddEmoji(const std::string& name, LvglImage* image);
+    // The image is created by the loader when the emoji is first used
+    virtual void AddEmoji(const std::string& name, std::function<LvglImage*()> loader);
     virtual const LvglImage* GetEmojiImage(const char* name);
     virtual ~EmojiCollection();
 
+    // Decoder of a GIF emoji, decoded on first use and kept in an LRU cache.
+    // Must be called with the display locked.
+    std::shared_ptr<LvglGif> GetEmojiGif(const char* name);
+    // Decode GIF emojis on a background task while the cache budget allows it
+    void Preload(const std::vector<std::string>& names, Display* display);
+
 private:
-    std::map<std::string, LvglImage*> emoji_collection_;
+    struct Entry {
+        LvglImage* image = nullptr;
+        std::function<LvglImage*()> loader;
+    };
+    struct CachedGif {
+        const void* data;       // Emojis sharing a GIF file share the decoder
+        size_t size;
+        std::shared_ptr<LvglGif> gif;
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, Entry> emoji_collection_;
+    std::list<CachedGif> gif_cache_;    // Most recently used first
+    size_t gif_cache_bytes_ = 0;
+
+    std::shared_ptr<LvglGif> DecodeGif(const LvglImage* image, bool evict);
 };
 
 class Twemoji32 : public EmojiCollection {
@@ -1,5 +1,7 @@
 #include "lvgl_gif.h"
+#include "power_governor.h"
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <cstring>
 
 #define TAG "LvglGif"
@@ -65,7 +67,7 @@ void LvglGif::Start() {
     }
 
     if (timer_) {
-        playing_ = true;
+        SetPlaying(true);
         last_call_ = lv_tick_get();
         lv_timer_resume(timer_);
         lv_timer_reset(timer_);
@@ -79,7 +81,7 @@ void LvglGif::Start() {
 
 void LvglGif::Pause() {
     if (timer_) {
-        playing_ = false;
+        SetPlaying(false);
         lv_timer_pause(timer_);
         ESP_LOGD(TAG, "GIF animation paused");
     }
@@ -92,7 +94,7 @@ void LvglGif::Resume() {
     }
 
     if (timer_) {
-        playing_ = true;
+        SetPlaying(true);
         lv_timer_resume(timer_);
         ESP_LOGD(TAG, "GIF animation resumed");
     }
@@ -100,7 +102,7 @@ void LvglGif::Resume() {
 
 void LvglGif::Stop() {
     if (timer_) {
-        playing_ = false;
+        SetPlaying(false);
         lv_timer_pause(timer_);
     }
 
@@ -111,6 +113,15 @@ void LvglGif::Stop() {
     }
 }
 
+void LvglGif::Release() {
+    Stop();
+    if (timer_) {
+        lv_timer_delete(timer_);
+        timer_ = nullptr;
+    }
+    frame_callback_ = nullptr;
+}
+
 bool LvglGif::IsPlaying() const {
     return playing_;
 }
@@ -164,12 +175,13 @@ void LvglGif::NextFrame() {
     }
 
     last_call_ = lv_tick_get();
+    int64_t frame_start = esp_timer_get_time();
 
     // Get next frame
     int has_next = gd_get_frame(gif_);
     if (has_next == 0) {
         // Animation finished, pause timer
-        playing_ = false;
+        SetPlaying(false);
         if (timer_) {
             lv_timer_pause(timer_);
         }
@@ -185,6 +197,22 @@ void LvglGif::NextFrame() {
             frame_callback_();
         }
     }
+
+    // The next frame is due after the delay of this one
+    PowerGovernor::GetInstance().ReportLoad(kPowerStageUi, esp_timer_get_time() - frame_start,
+        gif_->gce.delay * 10000);
+}
+
+void LvglGif::SetPlaying(bool playing) {
+    if (playing_ == playing) {
+        return;
+    }
+    playing_ = playing;
+    if (playing) {
+        PowerGovernor::GetInstance().Acquire(kPowerStageUi);
+    } else {
+        PowerGovernor::GetInstance().Release(kPowerStageUi);
+    }
 }
 
 void LvglGif::Cleanup() {
@@ -200,7 +228,7 @@ void LvglGif::Cleanup() {
         gif_ = nullptr;
     }
 
-    playing_ = false;
+    SetPlaying(false);
     loaded_ = false;
     
     // Clear image descriptor
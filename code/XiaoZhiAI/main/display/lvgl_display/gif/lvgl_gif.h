@@ -38,6 +38,12 @@ public:
      */
     void Stop();
 
+    /**
+     * Stop GIF animation and delete its timer, so the decoder can be kept
+     * in a cache and destroyed without the LVGL lock. Start() plays it again.
+     */
+    void Release();
+
     /**
      * Check if GIF is currently playing
      */
@@ -93,6 +99,11 @@ private:
      * Update to next frame
      */
     void NextFrame();
+
+    /**
+     * Update the playing state, a playing GIF holds the UI stage of the power governor
+     */
+    void SetPlaying(bool playing);
     
     /**
      * Cleanup resources
@@ -13,18 +13,13 @@
 #include "driver/jpeg_encode.h"
 #endif
 #include "image_to_jpeg.h"
+#include "memory_policy.h"
 
 #define TAG "image_to_jpeg"
 
+// 图像缓冲区一律放在 PSRAM，避免小图挤占内部 SRAM；返回的指针可用 free() 释放
 static void* malloc_psram(size_t size) {
-    void* p = malloc(size);
-    if (p)
-        return p;
-#if (CONFIG_SPIRAM_SUPPORT && (CONFIG_SPIRAM_USE_CAPS_ALLOC || CONFIG_SPIRAM_USE_MALLOC))
-    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-#else
-    return NULL;
-#endif
+    return MemoryPolicy::GetInstance().Allocate(kMemoryPoolPsram, size);
 }
 
 static __always_inline uint8_t expand_5_to_8(uint8_t v) {
@@ -428,7 +423,7 @@ bool image_to_jpeg(uint8_t* src, size_t src_len, uint16_t width, uint16_t height
                    uint8_t quality, uint8_t** out, size_t* out_len) {
 #ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
     if (format == V4L2_PIX_FMT_JPEG) {
-        uint8_t * out_data = (uint8_t*)heap_caps_malloc(src_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        uint8_t * out_data = (uint8_t*)malloc_psram(src_len);
         if (!out_data) {
             ESP_LOGE(TAG, "Failed to allocate memory for JPEG output");
             return false;
@@ -465,3 +460,182 @@ bool image_to_jpeg_cb(uint8_t* src, size_t src_len, uint16_t width, uint16_t hei
 #endif
     return encode_with_esp_new_jpeg(src, src_len, width, height, format, quality, NULL, NULL, cb, arg);
 }
+
+// 单个条带的目标大小，实际行数取块行数 (MCU 高度) 的整数倍
+#define JPEG_STRIP_BAND_BYTES (64 * 1024)
+
+bool image_to_jpeg_strip_cb(uint16_t width, uint16_t height, v4l2_pix_fmt_t format, uint8_t quality,
+                            jpg_strip_fill_cb fill, void* fill_arg, jpg_out_cb cb, void* arg) {
+    if (width == 0 || height == 0 || fill == nullptr || cb == nullptr) {
+        return false;
+    }
+    if (quality < 1)
+        quality = 1;
+    if (quality > 100)
+        quality = 100;
+
+    // 条带输入格式 -> 编码器输入格式
+    int src_bpp = 2;
+    jpeg_pixel_format_t enc_src_type = JPEG_PIXEL_FORMAT_YCbYCr;
+    bool need_convert = true;
+    esp_imgfx_pixel_fmt_t in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE;
+    switch (format) {
+        case V4L2_PIX_FMT_RGB565:
+            in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE;
+            break;
+        case V4L2_PIX_FMT_RGB565X:
+            in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_BE;
+            break;
+        case V4L2_PIX_FMT_RGB24:
+            in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888;
+            src_bpp = 3;
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            need_convert = false;
+            break;
+        case V4L2_PIX_FMT_GREY:
+            enc_src_type = JPEG_PIXEL_FORMAT_GRAY;
+            src_bpp = 1;
+            need_convert = false;
+            break;
+        default:
+            ESP_LOGE(TAG, "strip: unsupported format: 0x%08lx", format);
+            return false;
+    }
+    int enc_bpp = (enc_src_type == JPEG_PIXEL_FORMAT_GRAY) ? 1 : 2;
+
+    jpeg_enc_config_t cfg = DEFAULT_JPEG_ENC_CONFIG();
+    cfg.width = width;
+    cfg.height = height;
+    cfg.src_type = enc_src_type;
+    cfg.subsampling = (enc_src_type == JPEG_PIXEL_FORMAT_GRAY) ? JPEG_SUBSAMPLE_GRAY : JPEG_SUBSAMPLE_420;
+    cfg.quality = quality;
+    cfg.rotate = JPEG_ROTATE_0D;
+    cfg.task_enable = false;
+
+    jpeg_enc_handle_t h = NULL;
+    jpeg_error_t ret = jpeg_enc_open(&cfg, &h);
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "strip: jpeg_enc_open failed: %d", (int)ret);
+        return false;
+    }
+
+    // 块编码模式每次必须输入 block_size 字节，即 block_lines 行完整像素
+    int block_size = jpeg_enc_get_block_size(h);
+    int enc_row_bytes = (int)width * enc_bpp;
+    if (block_size <= 0 || block_size % enc_row_bytes != 0) {
+        ESP_LOGE(TAG, "strip: unexpected block size %d for width %u", block_size, width);
+        jpeg_enc_close(h);
+        return false;
+    }
+    int block_lines = block_size / enc_row_bytes;
+    int blocks_per_band = JPEG_STRIP_BAND_BYTES / block_size;
+    if (blocks_per_band < 1)
+        blocks_per_band = 1;
+    int total_blocks = ((int)height + block_lines - 1) / block_lines;
+    if (blocks_per_band > total_blocks)
+        blocks_per_band = total_blocks;
+    int band_lines = block_lines * blocks_per_band;
+    int src_row_bytes = (int)width * src_bpp;
+
+    // 输出不分条带：编码器在调用方传入的同一缓冲区中按自己的偏移连续追加码流，换用较小的
+    // 缓冲区或轮换缓冲区都会让它越界写入，已交给回调的部分也不能复用。缓冲区必须容纳整张
+    // JPEG，大小与整帧编码相同，高质量或噪声较多的画面按每像素 1 字节估算会不够
+    size_t out_cap = (size_t)width * (size_t)height * 3 / 2 + 64 * 1024;
+
+    // 条带与输出缓冲区只在本次编码内使用，从同一块 PSRAM 中分配，结束时一起释放
+    size_t src_band_len = (size_t)band_lines * src_row_bytes;
+    size_t enc_band_len = need_convert ? (size_t)band_lines * enc_row_bytes : 0;
+    MemoryArena arena(kMemoryPoolPsram, src_band_len + enc_band_len + out_cap + 3 * MEMORY_ARENA_ALIGNMENT);
+    uint8_t* src_band = (uint8_t*)arena.Calloc(src_band_len);
+    uint8_t* enc_band = need_convert ? (uint8_t*)arena.Calloc(enc_band_len) : src_band;
+    uint8_t* outbuf = (uint8_t*)arena.Allocate(out_cap);
+    esp_imgfx_color_convert_handle_t convert_handle = nullptr;
+    bool success = false;
+    int out_len = 0;
+    size_t flushed = 0;
+    int blocks_done = 0;
+
+    if (src_band == nullptr || enc_band == nullptr || outbuf == nullptr) {
+        ESP_LOGE(TAG, "strip: alloc buffers failed");
+        goto cleanup;
+    }
+
+    if (need_convert) {
+        esp_imgfx_color_convert_cfg_t convert_cfg = {
+            .in_res = {.width = static_cast<int16_t>(width),
+                       .height = static_cast<int16_t>(band_lines)},
+            .in_pixel_fmt = in_pixel_fmt,
+            .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_YUYV,
+            .color_space_std = ESP_IMGFX_COLOR_SPACE_STD_BT601,
+        };
+        if (esp_imgfx_color_convert_open(&convert_cfg, &convert_handle) != ESP_IMGFX_ERR_OK || convert_handle == nullptr) {
+            ESP_LOGE(TAG, "strip: esp_imgfx_color_convert_open failed");
+            convert_handle = nullptr;
+            goto cleanup;
+        }
+    }
+
+    for (int y = 0; y < height && blocks_done < total_blocks; y += band_lines) {
+        int lines = height - y;
+        if (lines > band_lines)
+            lines = band_lines;
+        if (!fill(fill_arg, (uint16_t)y, (uint16_t)lines, src_band)) {
+            ESP_LOGE(TAG, "strip: fill band at line %d failed", y);
+            goto cleanup;
+        }
+        // 最后一个条带不足整块时，复制最后一行补齐
+        int padded_lines = ((lines + block_lines - 1) / block_lines) * block_lines;
+        for (int i = lines; i < padded_lines; i++) {
+            memcpy(src_band + i * src_row_bytes, src_band + (lines - 1) * src_row_bytes, src_row_bytes);
+        }
+
+        if (need_convert) {
+            esp_imgfx_data_t convert_input_data = {
+                .data = src_band,
+                .data_len = static_cast<uint32_t>(band_lines * src_row_bytes),
+            };
+            esp_imgfx_data_t convert_output_data = {
+                .data = enc_band,
+                .data_len = static_cast<uint32_t>(band_lines * enc_row_bytes),
+            };
+            if (esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data) != ESP_IMGFX_ERR_OK) {
+                ESP_LOGE(TAG, "strip: esp_imgfx_color_convert_process failed");
+                goto cleanup;
+            }
+        }
+
+        for (int i = 0; i < padded_lines / block_lines; i++) {
+            ret = jpeg_enc_process_with_block(h, enc_band + i * block_size, block_size, outbuf, (int)out_cap, &out_len);
+            if (ret < JPEG_ERR_OK) {
+                ESP_LOGE(TAG, "strip: jpeg_enc_process_with_block failed: %d", (int)ret);
+                goto cleanup;
+            }
+            blocks_done++;
+
+            // 已写入输出缓冲区的码流不会再被修改，立即交给回调
+            if ((size_t)out_len > flushed) {
+                size_t len = (size_t)out_len - flushed;
+                if (cb(arg, flushed, outbuf + flushed, len) < len) {
+                    ESP_LOGE(TAG, "strip: output callback aborted at %u bytes", (unsigned)flushed);
+                    goto cleanup;
+                }
+                flushed = (size_t)out_len;
+            }
+        }
+    }
+
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "strip: encoder did not finish after %d blocks", blocks_done);
+        goto cleanup;
+    }
+    cb(arg, flushed, NULL, 0);  // 结束信号
+    success = true;
+
+cleanup:
+    if (convert_handle) {
+        esp_imgfx_color_convert_close(convert_handle);
+    }
+    jpeg_enc_close(h);
+    return success;
+}
@@ -63,6 +63,39 @@ bool image_to_jpeg(uint8_t *src, size_t src_len, uint16_t width, uint16_t height
 bool image_to_jpeg_cb(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, 
                       v4l2_pix_fmt_t format, uint8_t quality, jpg_out_cb cb, void *arg);
 
+// 条带填充回调函数类型
+// arg: 用户自定义参数, y: 条带起始行, lines: 条带行数, dst: 条带缓冲区 (width * lines 个像素，按 format 紧密排列)
+// 返回: true 成功, false 失败（编码中止）
+typedef bool (*jpg_strip_fill_cb)(void *arg, uint16_t y, uint16_t lines, uint8_t *dst);
+
+/**
+ * @brief 按水平条带流式编码JPEG（回调版本）
+ * 
+ * 源图像不需要一次性存在于内存中，适合屏幕截图等可以分段渲染的场景：
+ * - 通过 fill 回调逐条带获取像素，只分配一个条带大小的输入缓冲区
+ * - 条带内完成颜色转换（RGB565/RGB565X/RGB24 -> YUYV），无需整帧字节交换
+ * - 每编码完一个块即通过 cb 输出已生成的JPEG数据，便于边编码边上传
+ * 
+ * 只有源图像按条带处理，输出不是：esp_new_jpeg 块编码模式把整张 JPEG 连续写入同一个输出
+ * 缓冲区，已交给 cb 的部分也不能复用，因此仍需分配 width * height * 3 / 2 + 64KB 的输出
+ * 缓冲区，输出部分的峰值内存与整帧编码相同，节省的只是源图像和颜色转换的整帧缓冲区。
+ * 
+ * 仅使用软件编码器 (esp_new_jpeg 块编码模式)。
+ * 
+ * @param width     图像宽度
+ * @param height    图像高度
+ * @param format    条带像素格式 (V4L2_PIX_FMT_RGB565, V4L2_PIX_FMT_RGB565X, V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_GREY)
+ * @param quality   JPEG质量 (1-100)
+ * @param fill      条带填充回调函数
+ * @param fill_arg  传递给填充回调函数的用户参数
+ * @param cb        输出回调函数，返回值小于 len 时编码中止
+ * @param arg       传递给输出回调函数的用户参数
+ * 
+ * @return true 成功, false 失败
+ */
+bool image_to_jpeg_strip_cb(uint16_t width, uint16_t height, v4l2_pix_fmt_t format, uint8_t quality,
+                            jpg_strip_fill_cb fill, void *fill_arg, jpg_out_cb cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
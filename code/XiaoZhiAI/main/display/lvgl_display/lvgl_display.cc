@@ -13,6 +13,10 @@
 #include "assets/lang_config.h"
 #include "jpg/image_to_jpeg.h"
 
+#if CONFIG_LV_USE_SNAPSHOT
+#include <lvgl_private.h>
+#endif
+
 #define TAG "Display"
 
 LvglDisplay::LvglDisplay() {
@@ -30,14 +34,6 @@ LvglDisplay::LvglDisplay() {
         .skip_unhandled_events = false,
     };
     ESP_ERROR_CHECK(esp_timer_create(&notification_timer_args, &notification_timer_));
-
-    // Create a power management lock
-    auto ret = esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "display_update", &pm_lock_);
-    if (ret == ESP_ERR_NOT_SUPPORTED) {
-        ESP_LOGI(TAG, "Power management not supported");
-    } else {
-        ESP_ERROR_CHECK(ret);
-    }
 }
 
 LvglDisplay::~LvglDisplay() {
@@ -64,9 +60,6 @@ LvglDisplay::~LvglDisplay() {
     if( low_battery_popup_ != nullptr ) {
         lv_obj_del(low_battery_popup_);
     }
-    if (pm_lock_ != nullptr) {
-        esp_pm_lock_delete(pm_lock_);
-    }
 }
 
 void LvglDisplay::SetStatus(const char* status) {
@@ -78,7 +71,9 @@ void LvglDisplay::SetStatus(const char* status) {
     lv_obj_remove_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
 
-    last_status_update_time_ = std::chrono::system_clock::now();
+    last_status_update_us_ = esp_timer_get_time();
+    // Bring the clock back once the status has been readable for a while
+    StatusModel::GetInstance().RefreshClockAfter(STATUS_TEXT_HOLD_MS);
 }
 
 void LvglDisplay::ShowNotification(const std::string &notification, int duration_ms) {
@@ -98,52 +93,26 @@ void LvglDisplay::ShowNotification(const char* notification, int duration_ms) {
     ESP_ERROR_CHECK(esp_timer_start_once(notification_timer_, duration_ms * 1000));
 }
 
-void LvglDisplay::UpdateStatusBar(bool update_all) {
+void LvglDisplay::OnStatusChanged(uint32_t changed, const StatusState& state) {
     auto& app = Application::GetInstance();
-    auto& board = Board::GetInstance();
-    auto codec = board.GetAudioCodec();
-
-    // Update mute icon
-    {
-        DisplayLockGuard lock(this);
-        if (mute_label_ == nullptr) {
-            return;
-        }
+    DisplayLockGuard lock(this);
+    if (mute_label_ == nullptr) {
+        return;
+    }
 
-        // Update icon if mute state changes
-        if (codec->output_volume() == 0 && !muted_) {
-            muted_ = true;
-            lv_label_set_text(mute_label_, FONT_AWESOME_VOLUME_XMARK);
-        } else if (codec->output_volume() > 0 && muted_) {
-            muted_ = false;
-            lv_label_set_text(mute_label_, "");
-        }
+    if (changed & kStatusItemMute) {
+        lv_label_set_text(mute_label_, state.muted ? FONT_AWESOME_VOLUME_XMARK : "");
     }
 
-    // Update time
-    if (app.GetDeviceState() == kDeviceStateIdle) {
-        if (last_status_update_time_ + std::chrono::seconds(10) < std::chrono::system_clock::now()) {
-            // Set status to clock "HH:MM"
-            time_t now = time(NULL);
-            struct tm* tm = localtime(&now);
-            // Check if the we have already set the time
-            if (tm->tm_year >= 2025 - 1900) {
-                char time_str[16];
-                strftime(time_str, sizeof(time_str), "%H:%M", tm);
-                SetStatus(time_str);
-            } else {
-                ESP_LOGW(TAG, "System time is not set, tm_year: %d", tm->tm_year);
-            }
-        }
+    // Show the clock "HH:MM" in idle when the status text has been shown long enough
+    if ((changed & kStatusItemClock) && !state.clock.empty() && app.GetDeviceState() == kDeviceStateIdle &&
+        esp_timer_get_time() - last_status_update_us_ >= STATUS_TEXT_HOLD_MS * 1000LL) {
+        lv_label_set_text(status_label_, state.clock.c_str());
     }
 
-    esp_pm_lock_acquire(pm_lock_);
-    // Update battery icon
-    int battery_level;
-    bool charging, discharging;
-    const char* icon = nullptr;
-    if (board.GetBatteryLevel(battery_level, charging, discharging)) {
-        if (charging) {
+    if ((changed & kStatusItemBattery) && state.has_battery) {
+        const char* icon = nullptr;
+        if (state.charging) {
             icon = FONT_AWESOME_BATTERY_BOLT;
         } else {
             const char* levels[] = {
@@ -154,16 +123,15 @@ void LvglDisplay::UpdateStatusBar(bool update_all) {
                 FONT_AWESOME_BATTERY_FULL, // 80-99%
                 FONT_AWESOME_BATTERY_FULL, // 100%
             };
-            icon = levels[battery_level / 20];
+            icon = levels[state.battery_level / 20];
         }
-        DisplayLockGuard lock(this);
         if (battery_label_ != nullptr && battery_icon_ != icon) {
             battery_icon_ = icon;
             lv_label_set_text(battery_label_, battery_icon_);
         }
 
         if (low_battery_popup_ != nullptr) {
-            if (strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging) {
+            if (strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && state.discharging) {
                 if (lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // Show if low battery popup is hidden
                     lv_obj_remove_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
                     app.PlaySound(Lang::Sounds::OGG_LOW_BATTERY);
@@ -177,29 +145,11 @@ void LvglDisplay::UpdateStatusBar(bool update_all) {
         }
     }
 
-    // Update network icon every 10 seconds
-    static int seconds_counter = 0;
-    if (update_all || seconds_counter++ % 10 == 0) {
-        // Don't read 4G network status during firmware upgrade to avoid occupying UART resources
-        auto device_state = Application::GetInstance().GetDeviceState();
-        static const std::vector<DeviceState> allowed_states = {
-            kDeviceStateIdle,
-            kDeviceStateStarting,
-            kDeviceStateWifiConfiguring,
-            kDeviceStateListening,
-            kDeviceStateActivating,
-        };
-        if (std::find(allowed_states.begin(), allowed_states.end(), device_state) != allowed_states.end()) {
-            icon = board.GetNetworkStateIcon();
-            if (network_label_ != nullptr && icon != nullptr && network_icon_ != icon) {
-                DisplayLockGuard lock(this);
-                network_icon_ = icon;
-                lv_label_set_text(network_label_, network_icon_);
-            }
-        }
+    if ((changed & kStatusItemNetwork) && network_label_ != nullptr && state.network_icon != nullptr &&
+        network_icon_ != state.network_icon) {
+        network_icon_ = state.network_icon;
+        lv_label_set_text(network_label_, network_icon_);
     }
-
-    esp_pm_lock_release(pm_lock_);
 }
 
 void LvglDisplay::SetPreviewImage(std::unique_ptr<LvglImage> image) {
@@ -216,40 +166,96 @@ void LvglDisplay::SetPowerSaveMode(bool on) {
 }
 
 bool LvglDisplay::SnapshotToJpeg(std::string& jpeg_data, int quality) {
+    jpeg_data.clear();
+    return SnapshotToJpeg([&jpeg_data](const char* data, size_t len) {
+        jpeg_data.append(data, len);
+        return true;
+    }, quality);
+}
+
 #if CONFIG_LV_USE_SNAPSHOT
-    DisplayLockGuard lock(this);
+struct SnapshotBandContext {
+    LvglDisplay* display;
+    lv_obj_t* screen;
+    lv_area_t coords;
+    std::function<bool(const char* data, size_t len)>* writer;
+};
+#endif
 
-    lv_obj_t* screen = lv_screen_active();
-    lv_draw_buf_t* draw_buffer = lv_snapshot_take(screen, LV_COLOR_FORMAT_RGB565);
-    if (draw_buffer == nullptr) {
-        ESP_LOGE(TAG, "Failed to take snapshot, draw_buffer is nullptr");
+bool LvglDisplay::SnapshotToJpeg(std::function<bool(const char* data, size_t len)> writer, int quality) {
+#if CONFIG_LV_USE_SNAPSHOT
+    SnapshotBandContext context = {
+        .display = this,
+        .screen = nullptr,
+        .coords = {},
+        .writer = &writer,
+    };
+    {
+        DisplayLockGuard lock(this);
+        context.screen = lv_screen_active();
+        lv_obj_update_layout(context.screen);
+        lv_obj_get_coords(context.screen, &context.coords);
+    }
+    int32_t width = lv_area_get_width(&context.coords);
+    int32_t height = lv_area_get_height(&context.coords);
+    if (width <= 0 || height <= 0) {
+        ESP_LOGE(TAG, "Invalid screen size %dx%d", (int)width, (int)height);
         return false;
     }
 
-    // swap bytes
-    uint16_t* data = (uint16_t*)draw_buffer->data;
-    size_t pixel_count = draw_buffer->data_size / 2;
-    for (size_t i = 0; i < pixel_count; i++) {
-        data[i] = __builtin_bswap16(data[i]);
-    }
+    // Each band is rendered straight into the encoder's strip buffer. Tagging the native RGB565
+    // pixels as RGB565X lets the color converter absorb the byte swap that used to be a separate
+    // pass over the whole frame. The display lock is only held while a band is rendered, so the
+    // upload does not stall the UI.
+    bool ret = image_to_jpeg_strip_cb(width, height, V4L2_PIX_FMT_RGB565X, quality,
+        [](void* arg, uint16_t y, uint16_t lines, uint8_t* dst) -> bool {
+        auto context = static_cast<SnapshotBandContext*>(arg);
+        int32_t width = lv_area_get_width(&context->coords);
+        uint32_t stride = width * 2;
 
-    // Clear output string and use callback version to avoid pre-allocating large memory blocks
-    jpeg_data.clear();
+        lv_draw_buf_t draw_buf;
+        if (lv_draw_buf_init(&draw_buf, width, lines, LV_COLOR_FORMAT_RGB565, stride, dst, stride * lines) != LV_RESULT_OK) {
+            return false;
+        }
+        lv_draw_buf_clear(&draw_buf, nullptr);
 
-    // Use callback-based JPEG encoder to further save memory
-    bool ret = image_to_jpeg_cb((uint8_t*)draw_buffer->data, draw_buffer->data_size, draw_buffer->header.w, draw_buffer->header.h, V4L2_PIX_FMT_RGB565, quality,
-        [](void *arg, size_t index, const void *data, size_t len) -> size_t {
-        std::string* output = static_cast<std::string*>(arg);
-        if (data && len > 0) {
-            output->append(static_cast<const char*>(data), len);
+        lv_area_t band_area = context->coords;
+        band_area.y1 = context->coords.y1 + y;
+        band_area.y2 = band_area.y1 + lines - 1;
+
+        DisplayLockGuard lock(context->display);
+        lv_layer_t layer;
+        lv_layer_init(&layer);
+        layer.draw_buf = &draw_buf;
+        layer.buf_area = band_area;
+        layer.color_format = LV_COLOR_FORMAT_RGB565;
+        layer._clip_area = band_area;
+        layer.phy_clip_area = band_area;
+
+        lv_display_t* disp_old = lv_refr_get_disp_refreshing();
+        lv_display_t* disp_new = lv_obj_get_display(context->screen);
+        lv_layer_t* layer_old = disp_new->layer_head;
+        disp_new->layer_head = &layer;
+        lv_refr_set_disp_refreshing(disp_new);
+        lv_obj_redraw(&layer, context->screen);
+        while (layer.draw_task_head) {
+            lv_draw_dispatch_wait_for_request();
+            lv_draw_dispatch();
         }
-        return len;
-    }, &jpeg_data);
+        disp_new->layer_head = layer_old;
+        lv_refr_set_disp_refreshing(disp_old);
+        return true;
+    }, &context,
+        [](void* arg, size_t index, const void* data, size_t len) -> size_t {
+        auto context = static_cast<SnapshotBandContext*>(arg);
+        if (data == nullptr || len == 0) {
+            return 0;
+        }
+        return (*context->writer)(static_cast<const char*>(data), len) ? len : 0;
+    }, &context);
     if (!ret) {
-        ESP_LOGE(TAG, "Failed to convert image to JPEG");
+        ESP_LOGE(TAG, "Failed to convert snapshot to JPEG");
     }
-
-    lv_draw_buf_destroy(draw_buffer);
     return ret;
 #else
     ESP_LOGE(TAG, "LV_USE_SNAPSHOT is not enabled");
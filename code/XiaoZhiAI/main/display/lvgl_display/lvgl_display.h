@@ -7,10 +7,9 @@
 #include <lvgl.h>
 #include <esp_timer.h>
 #include <esp_log.h>
-#include <esp_pm.h>
 
 #include <string>
-#include <chrono>
+#include <functional>
 
 class LvglDisplay : public Display {
 public:
@@ -21,12 +20,13 @@ public:
     virtual void ShowNotification(const char* notification, int duration_ms = 3000);
     virtual void ShowNotification(const std::string &notification, int duration_ms = 3000);
     virtual void SetPreviewImage(std::unique_ptr<LvglImage> image);
-    virtual void UpdateStatusBar(bool update_all = false);
+    virtual void OnStatusChanged(uint32_t changed, const StatusState& state);
     virtual void SetPowerSaveMode(bool on);
     virtual bool SnapshotToJpeg(std::string& jpeg_data, int quality = 80);
+    // Render the screen in horizontal bands and stream the JPEG data to writer as it is encoded
+    virtual bool SnapshotToJpeg(std::function<bool(const char* data, size_t len)> writer, int quality = 80);
 
 protected:
-    esp_pm_lock_handle_t pm_lock_ = nullptr;
     lv_display_t *display_ = nullptr;
 
     lv_obj_t *network_label_ = nullptr;
@@ -39,9 +39,8 @@ protected:
     
     const char* battery_icon_ = nullptr;
     const char* network_icon_ = nullptr;
-    bool muted_ = false;
 
-    std::chrono::system_clock::time_point last_status_update_time_;
+    int64_t last_status_update_us_ = 0;
     esp_timer_handle_t notification_timer_ = nullptr;
 
     friend class DisplayLockGuard;
@@ -14,6 +14,89 @@ lv_color_t LvglTheme::ParseColor(const std::string& color) {
     return lv_color_black();
 }
 
+LvglThemeStyles::LvglThemeStyles() {
+    lv_style_t* styles[] = {
+        &screen, &container, &bar, &transparent, &icon, &large_icon, &chat_area,
+        &bubble, &user_bubble, &assistant_bubble, &system_bubble, &low_battery,
+    };
+    for (auto style : styles) {
+        lv_style_init(style);
+    }
+}
+
+LvglThemeStyles::~LvglThemeStyles() {
+    lv_style_t* styles[] = {
+        &screen, &container, &bar, &transparent, &icon, &large_icon, &chat_area,
+        &bubble, &user_bubble, &assistant_bubble, &system_bubble, &low_battery,
+    };
+    for (auto style : styles) {
+        lv_style_reset(style);
+    }
+}
+
+void LvglThemeStyles::Apply(LvglTheme* theme) {
+    auto text_font = theme->text_font()->font();
+    auto icon_font = theme->icon_font()->font();
+    auto large_icon_font = theme->large_icon_font()->font();
+
+    lv_style_set_text_font(&screen, text_font);
+    lv_style_set_text_color(&screen, theme->text_color());
+    lv_style_set_bg_color(&screen, theme->background_color());
+
+    lv_style_set_radius(&container, 0);
+    lv_style_set_pad_all(&container, 0);
+    lv_style_set_pad_row(&container, 0);
+    lv_style_set_border_width(&container, 0);
+    lv_style_set_bg_color(&container, theme->background_color());
+    lv_style_set_border_color(&container, theme->border_color());
+    lv_style_set_text_color(&container, theme->text_color());
+    auto background_image = theme->background_image();
+    lv_style_set_bg_image_src(&container, background_image != nullptr ? background_image->image_dsc() : nullptr);
+
+    lv_style_set_radius(&bar, 0);
+    lv_style_set_bg_opa(&bar, LV_OPA_50);
+    lv_style_set_bg_color(&bar, theme->background_color());
+    lv_style_set_text_color(&bar, theme->text_color());
+    lv_style_set_border_width(&bar, 0);
+    lv_style_set_pad_ver(&bar, theme->spacing(2));
+    lv_style_set_pad_hor(&bar, theme->spacing(4));
+
+    lv_style_set_bg_opa(&transparent, LV_OPA_TRANSP);
+    lv_style_set_border_width(&transparent, 0);
+    lv_style_set_pad_all(&transparent, 0);
+    lv_style_set_text_color(&transparent, theme->text_color());
+
+    // Large text fonts get the large icon font in the status bar as well
+    lv_style_set_text_font(&icon, text_font->line_height >= 40 ? large_icon_font : icon_font);
+
+    lv_style_set_text_font(&large_icon, large_icon_font);
+
+    lv_style_set_radius(&chat_area, 0);
+    lv_style_set_border_width(&chat_area, 0);
+    lv_style_set_pad_all(&chat_area, theme->spacing(4));
+    lv_style_set_pad_row(&chat_area, theme->spacing(4));
+    lv_style_set_bg_color(&chat_area, theme->chat_background_color());
+    // The container background, or its image, shows through between the bubbles
+    lv_style_set_bg_opa(&chat_area, LV_OPA_TRANSP);
+    lv_style_set_text_color(&chat_area, theme->text_color());
+
+    lv_style_set_radius(&bubble, 8);
+    lv_style_set_border_width(&bubble, 0);
+    lv_style_set_border_color(&bubble, theme->border_color());
+    lv_style_set_pad_all(&bubble, theme->spacing(4));
+    lv_style_set_bg_opa(&bubble, LV_OPA_70);
+    lv_style_set_flex_grow(&bubble, 0);
+    lv_style_set_text_color(&bubble, theme->text_color());
+
+    lv_style_set_bg_color(&user_bubble, theme->user_bubble_color());
+    lv_style_set_bg_color(&assistant_bubble, theme->assistant_bubble_color());
+    lv_style_set_bg_color(&system_bubble, theme->system_bubble_color());
+    lv_style_set_text_color(&system_bubble, theme->system_text_color());
+
+    lv_style_set_radius(&low_battery, theme->spacing(4));
+    lv_style_set_bg_color(&low_battery, theme->low_battery_color());
+}
+
 LvglThemeManager::LvglThemeManager() {
 }
 
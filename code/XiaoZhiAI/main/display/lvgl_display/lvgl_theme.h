@@ -76,6 +76,35 @@ private:
 };
 
 
+// Shared styles compiled from an LvglTheme. UI objects reference these instead of
+// carrying their own local style copies, so switching themes only rewrites the
+// styles and LVGL refreshes every object that uses them in a single pass.
+// Every box style carries the theme text color, which its labels inherit.
+class LvglThemeStyles {
+public:
+    LvglThemeStyles();
+    // Objects using the styles must be deleted first
+    ~LvglThemeStyles();
+
+    // Fill the styles from the theme. Call lv_obj_report_style_change(nullptr)
+    // afterwards if objects already use them.
+    void Apply(LvglTheme* theme);
+
+    lv_style_t screen;              // Screen background, text font and color inherited by all labels
+    lv_style_t container;           // Full screen root container
+    lv_style_t bar;                 // Semi-transparent top and bottom bars
+    lv_style_t transparent;         // Layout-only boxes without background, border or padding
+    lv_style_t icon;                // Status bar icons
+    lv_style_t large_icon;          // Centered emoji / logo icon
+    lv_style_t chat_area;           // Scrolling message list
+    lv_style_t bubble;              // Shape shared by all message bubbles
+    lv_style_t user_bubble;
+    lv_style_t assistant_bubble;
+    lv_style_t system_bubble;       // Also sets the text color of system messages
+    lv_style_t low_battery;
+};
+
+
 class LvglThemeManager {
 public:
     static LvglThemeManager& GetInstance() {
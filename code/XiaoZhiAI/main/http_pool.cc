@@ -0,0 +1,243 @@
+#include "http_pool.h"
+#include "board.h"
+#include "application.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#define TAG "HttpPool"
+
+// Buffers the request setup until Open() knows the server, then runs the
+// request on a pooled connection to that server or on a new one.
+class PooledHttp : public Http {
+public:
+    PooledHttp(HttpPool& pool, NetworkInterface* network, int connect_id)
+        : pool_(pool), network_(network), connect_id_(connect_id) {}
+
+    ~PooledHttp() {
+        Close();
+    }
+
+    void SetTimeout(int timeout_ms) override {
+        timeout_ms_ = timeout_ms;
+    }
+
+    void SetHeader(const std::string& key, const std::string& value) override {
+        headers_.emplace_back(key, value);
+    }
+
+    void SetContent(std::string&& content) override {
+        content_ = std::move(content);
+    }
+
+    void SetKeepAlive(bool enable) override {
+        keep_alive_ = enable;
+    }
+
+    bool Open(const std::string& method, const std::string& url) override {
+        Close();
+
+        auto scheme_end = url.find("://");
+        if (scheme_end == std::string::npos) {
+            ESP_LOGE(TAG, "Invalid URL: %s", url.c_str());
+            return false;
+        }
+        origin_ = url.substr(0, url.find('/', scheme_end + 3));
+
+        http_ = pool_.Take(network_, origin_, connect_id_);
+        if (timeout_ms_ > 0) {
+            http_->SetTimeout(timeout_ms_);
+        }
+        for (auto& [key, value] : headers_) {
+            http_->SetHeader(key, value);
+        }
+        headers_.clear();
+        if (content_.has_value()) {
+            http_->SetContent(std::move(*content_));
+            content_ = std::nullopt;
+        }
+        http_->SetKeepAlive(keep_alive_);
+
+        drained_ = false;
+        body_read_ = 0;
+        if (!http_->Open(method, url)) {
+            last_error_ = http_->GetLastError();
+            http_.reset();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() override {
+        if (!http_) {
+            return;
+        }
+        std::string connection = http_->GetResponseHeader("Connection");
+        std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+        if (keep_alive_ && drained_ && connection.find("keep-alive") != std::string::npos) {
+            pool_.Release(network_, origin_, std::move(http_));
+        } else {
+            http_->Close();
+            http_.reset();
+        }
+    }
+
+    int Read(char* buffer, size_t buffer_size) override {
+        if (!http_) {
+            return -1;
+        }
+        int ret = http_->Read(buffer, buffer_size);
+        if (ret > 0) {
+            body_read_ += ret;
+        }
+        // Callers that read Content-Length bytes do not call Read() again for the end.
+        // A chunked body has no length and only ends with a read of 0.
+        size_t body_length = http_->GetBodyLength();
+        if (ret == 0 || (body_length > 0 && body_read_ >= body_length)) {
+            drained_ = true;
+        }
+        return ret;
+    }
+
+    int Write(const char* buffer, size_t buffer_size) override {
+        return http_ ? http_->Write(buffer, buffer_size) : -1;
+    }
+
+    int GetStatusCode() override {
+        return http_ ? http_->GetStatusCode() : -1;
+    }
+
+    std::string GetResponseHeader(const std::string& key) const override {
+        return http_ ? http_->GetResponseHeader(key) : "";
+    }
+
+    size_t GetBodyLength() override {
+        return http_ ? http_->GetBodyLength() : 0;
+    }
+
+    std::string ReadAll() override {
+        if (!http_) {
+            return "";
+        }
+        auto body = http_->ReadAll();
+        drained_ = true;
+        return body;
+    }
+
+    int GetLastError() override {
+        return http_ ? http_->GetLastError() : last_error_;
+    }
+
+private:
+    HttpPool& pool_;
+    NetworkInterface* network_;
+    int connect_id_;
+    int timeout_ms_ = 0;
+    bool keep_alive_ = true;
+    bool drained_ = false;
+    size_t body_read_ = 0;
+    int last_error_ = 0;
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::optional<std::string> content_;
+    std::string origin_;
+    std::unique_ptr<Http> http_;
+};
+
+HttpPool::HttpPool() {
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            // Closing a TLS connection may block, which would hold up every other timer
+            auto pool = static_cast<HttpPool*>(arg);
+            Application::GetInstance().Schedule([pool]() {
+                pool->CloseExpired();
+            });
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "http_pool_idle",
+        .skip_unhandled_events = true
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &idle_timer_));
+}
+
+HttpPool::~HttpPool() {
+    esp_timer_stop(idle_timer_);
+    esp_timer_delete(idle_timer_);
+}
+
+std::unique_ptr<Http> HttpPool::CreateHttp(int connect_id) {
+    auto& board = Board::GetInstance();
+    auto network = board.GetNetwork();
+    // The modem HTTP stacks do not keep connections alive, and their
+    // connect ids are a scarce resource that must not be held while idle
+    if (board.GetBoardType() != "wifi") {
+        return network->CreateHttp(connect_id);
+    }
+    return std::make_unique<PooledHttp>(*this, network, connect_id);
+}
+
+std::unique_ptr<Http> HttpPool::Take(NetworkInterface* network, const std::string& origin, int connect_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_connections_.begin(); it != idle_connections_.end(); ++it) {
+        if (it->network == network && it->origin == origin) {
+            auto http = std::move(it->http);
+            idle_connections_.erase(it);
+            ESP_LOGD(TAG, "Reusing connection to %s", origin.c_str());
+            return http;
+        }
+    }
+    return network->CreateHttp(connect_id);
+}
+
+void HttpPool::Release(NetworkInterface* network, const std::string& origin, std::unique_ptr<Http> http) {
+    std::unique_ptr<Http> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_connections_.size() >= HTTP_POOL_MAX_IDLE_CONNECTIONS) {
+            evicted = std::move(idle_connections_.front().http);
+            idle_connections_.pop_front();
+        }
+        idle_connections_.push_back({network, origin, std::move(http), esp_timer_get_time()});
+        if (!esp_timer_is_active(idle_timer_)) {
+            esp_timer_start_once(idle_timer_, HTTP_POOL_IDLE_TIMEOUT_MS * 1000);
+        }
+    }
+    // Close outside the lock, the TCP teardown may block
+    if (evicted) {
+        evicted->Close();
+    }
+}
+
+void HttpPool::CloseExpired() {
+    std::list<IdleConnection> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = esp_timer_get_time();
+        while (!idle_connections_.empty() &&
+               now - idle_connections_.front().idle_since_us >= HTTP_POOL_IDLE_TIMEOUT_MS * 1000LL) {
+            expired.splice(expired.end(), idle_connections_, idle_connections_.begin());
+        }
+        if (!idle_connections_.empty()) {
+            auto remaining = HTTP_POOL_IDLE_TIMEOUT_MS * 1000LL - (now - idle_connections_.front().idle_since_us);
+            esp_timer_start_once(idle_timer_, remaining);
+        }
+    }
+    for (auto& connection : expired) {
+        ESP_LOGD(TAG, "Closing idle connection to %s", connection.origin.c_str());
+        connection.http->Close();
+    }
+}
+
+void HttpPool::Clear() {
+    std::list<IdleConnection> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        esp_timer_stop(idle_timer_);
+        idle.swap(idle_connections_);
+    }
+    for (auto& connection : idle) {
+        connection.http->Close();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <http.h>
+#include <network_interface.h>
+#include <esp_timer.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Idle keep-alive connections are closed after this long
+#define HTTP_POOL_IDLE_TIMEOUT_MS 30000
+#define HTTP_POOL_MAX_IDLE_CONNECTIONS 2
+
+// Keeps finished keep-alive HTTP connections per scheme://host:port so that
+// the next request to the same server skips the TCP and TLS handshake.
+// Http objects created here return their connection to the pool on Close()
+// or destruction when the response was read to the end and the server agreed
+// to keep the connection alive; otherwise the connection is closed as usual.
+class HttpPool {
+public:
+    static HttpPool& GetInstance() {
+        static HttpPool instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    HttpPool(const HttpPool&) = delete;
+    HttpPool& operator=(const HttpPool&) = delete;
+
+    std::unique_ptr<Http> CreateHttp(int connect_id = -1);
+    // Close all idle connections
+    void Clear();
+
+private:
+    HttpPool();
+    ~HttpPool();
+
+    struct IdleConnection {
+        NetworkInterface* network;
+        std::string origin;
+        std::unique_ptr<Http> http;
+        int64_t idle_since_us;
+    };
+
+    std::mutex mutex_;
+    std::list<IdleConnection> idle_connections_;
+    esp_timer_handle_t idle_timer_ = nullptr;
+
+    friend class PooledHttp;
+    std::unique_ptr<Http> Take(NetworkInterface* network, const std::string& origin, int connect_id);
+    void Release(NetworkInterface* network, const std::string& origin, std::unique_ptr<Http> http);
+    void CloseExpired();
+};
+
+#endif // HTTP_POOL_H
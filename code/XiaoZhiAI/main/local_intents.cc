@@ -0,0 +1,84 @@
+#include "local_intents.h"
+#include "application.h"
+#include "board.h"
+#include "audio_codec.h"
+#include "mcp_server.h"
+#include "backlight.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "LocalIntents"
+
+static const char* const kBuiltinIntents[] = {
+    "volume_up", "volume_down", "brightness_up", "brightness_down", "stop",
+};
+
+void LocalIntents::SplitAction(const std::string& action, std::string& name, std::string& arguments) {
+    auto pos = action.find(' ');
+    if (pos == std::string::npos) {
+        name = action;
+        arguments.clear();
+        return;
+    }
+    name = action.substr(0, pos);
+    arguments = action.substr(action.find_first_not_of(' ', pos));
+}
+
+bool LocalIntents::CanHandle(const std::string& action) {
+    std::string name, arguments;
+    SplitAction(action, name, arguments);
+    for (auto intent : kBuiltinIntents) {
+        if (name == intent) {
+            return true;
+        }
+    }
+    return McpServer::GetInstance().HasTool(name);
+}
+
+bool LocalIntents::Execute(const std::string& action) {
+    std::string name, arguments;
+    SplitAction(action, name, arguments);
+
+    bool handled = false;
+    bool success = ExecuteBuiltin(name, handled);
+    if (!handled) {
+        success = McpServer::GetInstance().CallToolLocally(name, arguments);
+    }
+    ESP_LOGI(TAG, "Intent %s %s", action.c_str(), success ? "done" : "failed");
+    return success;
+}
+
+bool LocalIntents::ExecuteBuiltin(const std::string& name, bool& handled) {
+    auto& board = Board::GetInstance();
+    auto& mcp_server = McpServer::GetInstance();
+    handled = true;
+
+    // Volume and brightness go through the same tools the server would call
+    if (name == "volume_up" || name == "volume_down") {
+        int step = name == "volume_up" ? LOCAL_INTENT_STEP : -LOCAL_INTENT_STEP;
+        int volume = std::clamp(board.GetAudioCodec()->output_volume() + step, 0, 100);
+        return mcp_server.CallToolLocally("self.audio_speaker.set_volume",
+            "{\"volume\":" + std::to_string(volume) + "}");
+    }
+    if (name == "brightness_up" || name == "brightness_down") {
+        auto backlight = board.GetBacklight();
+        if (backlight == nullptr) {
+            return false;
+        }
+        int step = name == "brightness_up" ? LOCAL_INTENT_STEP : -LOCAL_INTENT_STEP;
+        int brightness = std::clamp(backlight->brightness() + step, 0, 100);
+        return mcp_server.CallToolLocally("self.screen.set_brightness",
+            "{\"brightness\":" + std::to_string(brightness) + "}");
+    }
+    if (name == "stop") {
+        auto& app = Application::GetInstance();
+        if (app.GetDeviceState() == kDeviceStateSpeaking) {
+            app.AbortSpeaking(kAbortReasonNone);
+        }
+        return true;
+    }
+
+    handled = false;
+    return false;
+}
@@ -0,0 +1,41 @@
+#ifndef LOCAL_INTENTS_H
+#define LOCAL_INTENTS_H
+
+#include <string>
+
+// Step of the volume and brightness commands, in percent
+#define LOCAL_INTENT_STEP 10
+
+/*
+ * Offline commands recognized by MultiNet, executed on the device without a server
+ * round trip. The action of a command in the assets index.json is either a built-in
+ * intent (volume_up, volume_down, brightness_up, brightness_down, stop) or the name of
+ * a registered MCP tool, optionally followed by its arguments as a JSON object:
+ *
+ *     {"command": "zuo xia", "text": "坐下", "action": "self.otto.action {\"action\":\"sit\"}"}
+ *
+ * Commands whose action cannot be handled here wake the device and go to the server.
+ */
+class LocalIntents {
+public:
+    static LocalIntents& GetInstance() {
+        static LocalIntents instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    LocalIntents(const LocalIntents&) = delete;
+    LocalIntents& operator=(const LocalIntents&) = delete;
+
+    // Cheap check used on the audio task before the action is scheduled
+    bool CanHandle(const std::string& action);
+    // Must be called on the main task
+    bool Execute(const std::string& action);
+
+private:
+    LocalIntents() = default;
+
+    static void SplitAction(const std::string& action, std::string& name, std::string& arguments);
+    bool ExecuteBuiltin(const std::string& name, bool& handled);
+};
+
+#endif // LOCAL_INTENTS_H
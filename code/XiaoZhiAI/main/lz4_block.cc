@@ -0,0 +1,73 @@
+#include "lz4_block.h"
+
+#include <cstring>
+
+// Lengths of 15 are extended by bytes that are added up until one is below 255
+static bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+int Lz4DecompressBlock(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity) {
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + src_size;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_capacity;
+
+    while (ip < ip_end) {
+        uint8_t token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !ReadLength(ip, ip_end, literal_length)) {
+            return -1;
+        }
+        if (literal_length > (size_t)(ip_end - ip) || literal_length > (size_t)(op_end - op)) {
+            return -1;
+        }
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        // The last sequence has literals only
+        if (ip == ip_end) {
+            break;
+        }
+
+        if (ip_end - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return -1;
+        }
+
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !ReadLength(ip, ip_end, match_length)) {
+            return -1;
+        }
+        match_length += 4;
+        if (match_length > (size_t)(op_end - op)) {
+            return -1;
+        }
+
+        // Matches may overlap the bytes they produce, copy forward one byte at a time
+        const uint8_t* match = op - offset;
+        if (offset >= match_length) {
+            memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            for (size_t i = 0; i < match_length; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op - dst;
+}
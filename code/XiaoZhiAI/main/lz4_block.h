@@ -0,0 +1,18 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Decoder for the LZ4 block format (no frame header), as produced by
+ * lz4.block.compress(data, store_size=False) on the host. It needs no memory of its
+ * own and checks every read and write against the buffer bounds, so a corrupted
+ * block fails instead of overrunning.
+ *
+ * Returns the number of bytes written to dst, or -1 if the block is malformed or
+ * does not fit.
+ */
+int Lz4DecompressBlock(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity);
+
+#endif // LZ4_BLOCK_H
@@ -9,21 +9,39 @@
 #include <algorithm>
 #include <cstring>
 #include <esp_pthread.h>
+#include <mbedtls/base64.h>
 
 #include "application.h"
 #include "display.h"
 #include "oled_display.h"
 #include "board.h"
 #include "settings.h"
+#include "http_pool.h"
+#include "memory_policy.h"
 #include "lvgl_theme.h"
 #include "lvgl_display.h"
+#include "performance_profiler.h"
 
 #define TAG "MCP"
 
 McpServer::McpServer() {
+    esp_timer_create_args_t deadline_timer_args = {
+        .callback = [](void* arg) {
+            static_cast<McpServer*>(arg)->CheckDeadlines();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "mcp_deadline",
+        .skip_unhandled_events = true
+    };
+    esp_timer_create(&deadline_timer_args, &deadline_timer_);
 }
 
 McpServer::~McpServer() {
+    if (deadline_timer_ != nullptr) {
+        esp_timer_stop(deadline_timer_);
+        esp_timer_delete(deadline_timer_);
+    }
     for (auto tool : tools_) {
         delete tool;
     }
@@ -117,7 +135,7 @@ void McpServer::AddCommonTools() {
                 }
                 auto question = properties["question"].value<std::string>();
                 return camera->Explain(question);
-            });
+            }, {.async = true, .max_concurrency = 1, .deadline_ms = 60000});
     }
 #endif
 
@@ -148,6 +166,29 @@ void McpServer::AddUserOnlyTools() {
             return true;
         });
 
+#if CONFIG_USE_PERFORMANCE_PROFILER
+    AddUserOnlyTool("self.get_performance_stats",
+        "Get the recent CPU load, heap, audio queue depths and per-task CPU / stack usage sampled by the profiler.\n"
+        "Args:\n"
+        "  `binary`: Return the samples as a base64 encoded binary dump instead of JSON",
+        PropertyList({
+            Property("binary", kPropertyTypeBoolean, false)
+        }),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto& profiler = PerformanceProfiler::GetInstance();
+            if (!properties["binary"].value<bool>()) {
+                return profiler.GetStatsJson();
+            }
+            auto dump = profiler.GetBinaryDump();
+            size_t dlen = 0, olen = 0;
+            mbedtls_base64_encode(nullptr, 0, &dlen, (const unsigned char*)dump.data(), dump.size());
+            std::string encoded(dlen, 0);
+            mbedtls_base64_encode((unsigned char*)encoded.data(), encoded.size(), &olen, (const unsigned char*)dump.data(), dump.size());
+            encoded.resize(olen);
+            return encoded;
+        }, {.reentrant = true});
+#endif
+
     // Firmware upgrade
     AddUserOnlyTool("self.upgrade_firmware", "Upgrade firmware from a specific URL. This will download and install the firmware, then reboot the device.",
         PropertyList({
@@ -157,6 +198,8 @@ void McpServer::AddUserOnlyTools() {
             auto url = properties["url"].value<std::string>();
             ESP_LOGI(TAG, "User requested firmware upgrade from URL: %s", url.c_str());
             
+            // The upgrade closes the audio channel and changes the device state, which belongs
+            // to the main task, so it cannot run on a worker
             auto& app = Application::GetInstance();
             app.Schedule([url, &app]() {
                 bool success = app.UpgradeFirmware(url);
@@ -184,7 +227,7 @@ void McpServer::AddUserOnlyTools() {
                     cJSON_AddBoolToObject(json, "monochrome", false);
                 }
                 return json;
-            });
+            }, {.reentrant = true});
 
 #if CONFIG_LV_USE_SNAPSHOT
         AddUserOnlyTool("self.screen.snapshot", "Snapshot the screen and upload it to a specific URL",
@@ -192,21 +235,14 @@ void McpServer::AddUserOnlyTools() {
                 Property("url", kPropertyTypeString),
                 Property("quality", kPropertyTypeInteger, 80, 1, 100)
             }),
-            [display](const PropertyList& properties) -> ReturnValue {
+            [this, display](const PropertyList& properties) -> ReturnValue {
                 auto url = properties["url"].value<std::string>();
                 auto quality = properties["quality"].value<int>();
 
-                std::string jpeg_data;
-                if (!display->SnapshotToJpeg(jpeg_data, quality)) {
-                    throw std::runtime_error("Failed to snapshot screen");
-                }
-
-                ESP_LOGI(TAG, "Upload snapshot %u bytes to %s", jpeg_data.size(), url.c_str());
-                
                 // 构造multipart/form-data请求体
                 std::string boundary = "----ESP32_SCREEN_SNAPSHOT_BOUNDARY";
                 
-                auto http = Board::GetInstance().GetNetwork()->CreateHttp(3);
+                auto http = HttpPool::GetInstance().CreateHttp(3);
                 http->SetHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
                 if (!http->Open("POST", url)) {
                     throw std::runtime_error("Failed to open URL: " + url);
@@ -221,8 +257,20 @@ void McpServer::AddUserOnlyTools() {
                     http->Write(file_header.c_str(), file_header.size());
                 }
 
-                // JPEG数据
-                http->Write((const char*)jpeg_data.data(), jpeg_data.size());
+                // JPEG数据：按条带编码，边编码边以 chunked 方式上传
+                size_t jpeg_size = 0;
+                bool success = display->SnapshotToJpeg([this, &http, &jpeg_size](const char* data, size_t len) {
+                    if (IsToolCallCancelled() || http->Write(data, len) < 0) {
+                        return false;
+                    }
+                    jpeg_size += len;
+                    return true;
+                }, quality);
+                if (!success) {
+                    http->Close();
+                    throw std::runtime_error("Failed to snapshot screen");
+                }
+                ESP_LOGI(TAG, "Uploaded snapshot %u bytes to %s", jpeg_size, url.c_str());
 
                 {
                     // multipart尾部
@@ -239,7 +287,7 @@ void McpServer::AddUserOnlyTools() {
                 http->Close();
                 ESP_LOGI(TAG, "Snapshot screen result: %s", result.c_str());
                 return true;
-            });
+            }, {.async = true, .max_concurrency = 1, .deadline_ms = 30000});
         
         AddUserOnlyTool("self.screen.preview_image", "Preview an image on the screen",
             PropertyList({
@@ -247,7 +295,7 @@ void McpServer::AddUserOnlyTools() {
             }),
             [display](const PropertyList& properties) -> ReturnValue {
                 auto url = properties["url"].value<std::string>();
-                auto http = Board::GetInstance().GetNetwork()->CreateHttp(3);
+                auto http = HttpPool::GetInstance().CreateHttp(3);
 
                 if (!http->Open("GET", url)) {
                     throw std::runtime_error("Failed to open URL: " + url);
@@ -258,7 +306,7 @@ void McpServer::AddUserOnlyTools() {
                 }
 
                 size_t content_length = http->GetBodyLength();
-                char* data = (char*)heap_caps_malloc(content_length, MALLOC_CAP_8BIT);
+                char* data = (char*)MemoryPolicy::GetInstance().Allocate(kMemoryPoolPsram, content_length);
                 if (data == nullptr) {
                     throw std::runtime_error("Failed to allocate memory for image: " + url);
                 }
@@ -279,7 +327,7 @@ void McpServer::AddUserOnlyTools() {
                 auto image = std::make_unique<LvglAllocatedImage>(data, content_length);
                 display->SetPreviewImage(std::move(image));
                 return true;
-            });
+            }, {.async = true, .max_concurrency = 1, .deadline_ms = 30000});
 #endif // CONFIG_LV_USE_SNAPSHOT
     }
 #endif // HAVE_LVGL
@@ -311,12 +359,12 @@ void McpServer::AddTool(McpTool* tool) {
     tools_.push_back(tool);
 }
 
-void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback) {
-    AddTool(new McpTool(name, description, properties, callback));
+void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback, const McpToolOptions& options) {
+    AddTool(new McpTool(name, description, properties, callback, options));
 }
 
-void McpServer::AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback) {
-    auto tool = new McpTool(name, description, properties, callback);
+void McpServer::AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback, const McpToolOptions& options) {
+    auto tool = new McpTool(name, description, properties, callback, options);
     tool->set_user_only(true);
     AddTool(tool);
 }
@@ -351,6 +399,51 @@ void McpServer::ParseCapabilities(const cJSON* capabilities) {
 }
 
 void McpServer::ParseMessage(const cJSON* json) {
+    if (cJSON_IsArray(json)) {
+        ParseBatch(json);
+    } else {
+        ParseRequest(json, nullptr);
+    }
+}
+
+// Whether the request is answered, mirrors the checks in ParseRequest()
+static bool ExpectsReply(const cJSON* json, int& id) {
+    auto version = cJSON_GetObjectItem(json, "jsonrpc");
+    auto method = cJSON_GetObjectItem(json, "method");
+    auto params = cJSON_GetObjectItem(json, "params");
+    auto id_item = cJSON_GetObjectItem(json, "id");
+    if (!cJSON_IsString(version) || strcmp(version->valuestring, "2.0") != 0 || !cJSON_IsString(method) ||
+        strncmp(method->valuestring, "notifications", 13) == 0 || (params != nullptr && !cJSON_IsObject(params)) ||
+        !cJSON_IsNumber(id_item)) {
+        return false;
+    }
+    id = id_item->valueint;
+    return true;
+}
+
+void McpServer::ParseBatch(const cJSON* json) {
+    int count = cJSON_GetArraySize(json);
+    if (count == 0) {
+        ESP_LOGE(TAG, "Empty JSONRPC batch");
+        return;
+    }
+
+    // Register every reply up front, the first ones may be sent before the last request is parsed
+    auto batch = std::make_shared<Batch>();
+    for (int i = 0; i < count; i++) {
+        int id;
+        if (ExpectsReply(cJSON_GetArrayItem(json, i), id)) {
+            batch->pending_ids.push_back(id);
+        }
+    }
+    ESP_LOGI(TAG, "JSONRPC batch of %d requests, %u replies", count, (unsigned)batch->pending_ids.size());
+
+    for (int i = 0; i < count; i++) {
+        ParseRequest(cJSON_GetArrayItem(json, i), batch);
+    }
+}
+
+void McpServer::ParseRequest(const cJSON* json, const std::shared_ptr<Batch>& batch) {
     // Check JSONRPC version
     auto version = cJSON_GetObjectItem(json, "jsonrpc");
     if (version == nullptr || !cJSON_IsString(version) || strcmp(version->valuestring, "2.0") != 0) {
@@ -366,6 +459,14 @@ void McpServer::ParseMessage(const cJSON* json) {
     }
     
     auto method_str = std::string(method->valuestring);
+    if (method_str == "notifications/cancelled") {
+        auto params = cJSON_GetObjectItem(json, "params");
+        auto request_id = cJSON_IsObject(params) ? cJSON_GetObjectItem(params, "requestId") : nullptr;
+        if (cJSON_IsNumber(request_id)) {
+            CancelToolCall(request_id->valueint);
+        }
+        return;
+    }
     if (method_str.find("notifications") == 0) {
         return;
     }
@@ -395,7 +496,7 @@ void McpServer::ParseMessage(const cJSON* json) {
         std::string message = "{\"protocolVersion\":\"2024-11-05\",\"capabilities\":{\"tools\":{}},\"serverInfo\":{\"name\":\"" BOARD_NAME "\",\"version\":\"";
         message += app_desc->version;
         message += "\"}}";
-        ReplyResult(id_int, message);
+        ReplyResult(id_int, message, batch);
     } else if (method_str == "tools/list") {
         std::string cursor_str = "";
         bool list_user_only_tools = false;
@@ -409,50 +510,103 @@ void McpServer::ParseMessage(const cJSON* json) {
                 list_user_only_tools = with_user_tools->valueint == 1;
             }
         }
-        GetToolsList(id_int, cursor_str, list_user_only_tools);
+        GetToolsList(id_int, cursor_str, list_user_only_tools, batch);
     } else if (method_str == "tools/call") {
         if (!cJSON_IsObject(params)) {
             ESP_LOGE(TAG, "tools/call: Missing params");
-            ReplyError(id_int, "Missing params");
+            ReplyError(id_int, "Missing params", batch);
             return;
         }
         auto tool_name = cJSON_GetObjectItem(params, "name");
         if (!cJSON_IsString(tool_name)) {
             ESP_LOGE(TAG, "tools/call: Missing name");
-            ReplyError(id_int, "Missing name");
+            ReplyError(id_int, "Missing name", batch);
             return;
         }
         auto tool_arguments = cJSON_GetObjectItem(params, "arguments");
         if (tool_arguments != nullptr && !cJSON_IsObject(tool_arguments)) {
             ESP_LOGE(TAG, "tools/call: Invalid arguments");
-            ReplyError(id_int, "Invalid arguments");
+            ReplyError(id_int, "Invalid arguments", batch);
             return;
         }
-        DoToolCall(id_int, std::string(tool_name->valuestring), tool_arguments);
+        DoToolCall(id_int, std::string(tool_name->valuestring), tool_arguments, batch);
     } else {
         ESP_LOGE(TAG, "Method not implemented: %s", method_str.c_str());
-        ReplyError(id_int, "Method not implemented: " + method_str);
+        ReplyError(id_int, "Method not implemented: " + method_str, batch);
     }
 }
 
-void McpServer::ReplyResult(int id, const std::string& result) {
+void McpServer::ReplyResult(int id, const std::string& result, const std::shared_ptr<Batch>& batch) {
     std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
     payload += std::to_string(id) + ",\"result\":";
     payload += result;
     payload += "}";
-    Application::GetInstance().SendMcpMessage(payload);
+    SendReply(id, TextStream(std::move(payload)), batch);
+}
+
+void McpServer::ReplyResult(int id, TextStream&& result, const std::shared_ptr<Batch>& batch) {
+    TextStream payload("{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) + ",\"result\":");
+    payload.Append(std::move(result));
+    payload.Append("}");
+    SendReply(id, std::move(payload), batch);
 }
 
-void McpServer::ReplyError(int id, const std::string& message) {
+void McpServer::ReplyError(int id, const std::string& message, const std::shared_ptr<Batch>& batch) {
     std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
     payload += std::to_string(id);
     payload += ",\"error\":{\"message\":\"";
     payload += message;
     payload += "\"}}";
-    Application::GetInstance().SendMcpMessage(payload);
+    SendReply(id, TextStream(std::move(payload)), batch);
+}
+
+void McpServer::SendReply(int id, TextStream&& payload, const std::shared_ptr<Batch>& batch) {
+    bool completed = false;
+    if (batch != nullptr) {
+        std::lock_guard<std::mutex> lock(batches_mutex_);
+        auto& ids = batch->pending_ids;
+        auto id_it = std::find(ids.begin(), ids.end(), id);
+        if (id_it != ids.end()) {
+            ids.erase(id_it);
+            batch->responses.Append(batch->response_count++ == 0 ? "[" : ",");
+            batch->responses.Append(std::move(payload));
+            if (!ids.empty()) {
+                return;
+            }
+            completed = true;
+        }
+    }
+
+    if (!completed) {
+        Application::GetInstance().SendMcpMessage(std::move(payload));
+        return;
+    }
+    // All replies of the batch go out in one message
+    batch->responses.Append("]");
+    Application::GetInstance().SendMcpMessage(std::move(batch->responses));
+}
+
+void McpServer::DropReply(int id, const std::shared_ptr<Batch>& batch) {
+    if (batch == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(batches_mutex_);
+        auto& ids = batch->pending_ids;
+        auto id_it = std::find(ids.begin(), ids.end(), id);
+        if (id_it == ids.end()) {
+            return;
+        }
+        ids.erase(id_it);
+        if (!ids.empty() || batch->response_count == 0) {
+            return;
+        }
+    }
+    batch->responses.Append("]");
+    Application::GetInstance().SendMcpMessage(std::move(batch->responses));
 }
 
-void McpServer::GetToolsList(int id, const std::string& cursor, bool list_user_only_tools) {
+void McpServer::GetToolsList(int id, const std::string& cursor, bool list_user_only_tools, const std::shared_ptr<Batch>& batch) {
     const int max_payload_size = 8000;
     std::string json = "{\"tools\":[";
     
@@ -495,7 +649,7 @@ void McpServer::GetToolsList(int id, const std::string& cursor, bool list_user_o
     if (json.back() == '[' && !tools_.empty()) {
         // 如果没有添加任何tool，返回错误
         ESP_LOGE(TAG, "tools/list: Failed to add tool %s because of payload size limit", next_cursor.c_str());
-        ReplyError(id, "Failed to add tool " + next_cursor + " because of payload size limit");
+        ReplyError(id, "Failed to add tool " + next_cursor + " because of payload size limit", batch);
         return;
     }
 
@@ -505,22 +659,19 @@ void McpServer::GetToolsList(int id, const std::string& cursor, bool list_user_o
         json += "],\"nextCursor\":\"" + next_cursor + "\"}";
     }
     
-    ReplyResult(id, json);
+    ReplyResult(id, json, batch);
 }
 
-void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments) {
+McpTool* McpServer::FindTool(const std::string& name) {
     auto tool_iter = std::find_if(tools_.begin(), tools_.end(), 
-                                 [&tool_name](const McpTool* tool) { 
-                                     return tool->name() == tool_name; 
+                                 [&name](const McpTool* tool) { 
+                                     return tool->name() == name; 
                                  });
-    
-    if (tool_iter == tools_.end()) {
-        ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
-        ReplyError(id, "Unknown tool: " + tool_name);
-        return;
-    }
+    return tool_iter != tools_.end() ? *tool_iter : nullptr;
+}
 
-    PropertyList arguments = (*tool_iter)->properties();
+bool McpServer::ParseToolArguments(const McpTool* tool, const cJSON* tool_arguments, PropertyList& arguments, std::string& error) {
+    arguments = tool->properties();
     try {
         for (auto& argument : arguments) {
             bool found = false;
@@ -539,25 +690,274 @@ void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* to
             }
 
             if (!argument.has_default_value() && !found) {
-                ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
-                ReplyError(id, "Missing valid argument: " + argument.name());
-                return;
+                error = "Missing valid argument: " + argument.name();
+                return false;
             }
         }
     } catch (const std::exception& e) {
-        ESP_LOGE(TAG, "tools/call: %s", e.what());
-        ReplyError(id, e.what());
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+bool McpServer::CallToolLocally(const std::string& name, const std::string& arguments_json) {
+    auto tool = FindTool(name);
+    if (tool == nullptr) {
+        ESP_LOGE(TAG, "Local call: Unknown tool: %s", name.c_str());
+        return false;
+    }
+
+    cJSON* json = arguments_json.empty() ? nullptr : cJSON_Parse(arguments_json.c_str());
+    PropertyList arguments;
+    std::string error;
+    bool success = ParseToolArguments(tool, json, arguments, error);
+    cJSON_Delete(json);
+    if (!success) {
+        ESP_LOGE(TAG, "Local call %s: %s", name.c_str(), error.c_str());
+        return false;
+    }
+
+    // Same as tools/call, a slow tool must not hold up the caller
+    if (tool->options().async) {
+        QueueToolCall(-1, tool, std::move(arguments), nullptr, true);
+        return true;
+    }
+
+    try {
+        auto result = tool->Call(arguments);
+        ESP_LOGI(TAG, "Local call %s: %s", name.c_str(), result.ToString().c_str());
+    } catch (const std::exception& e) {
+        ESP_LOGE(TAG, "Local call %s: %s", name.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, const std::shared_ptr<Batch>& batch) {
+    auto tool = FindTool(tool_name);
+    if (tool == nullptr) {
+        ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
+        ReplyError(id, "Unknown tool: " + tool_name, batch);
+        return;
+    }
+
+    PropertyList arguments;
+    std::string error;
+    if (!ParseToolArguments(tool, tool_arguments, arguments, error)) {
+        ESP_LOGE(TAG, "tools/call: %s", error.c_str());
+        ReplyError(id, error, batch);
+        return;
+    }
+
+    // Reentrant tools of a batch run next to each other on the workers
+    auto& options = tool->options();
+    if (options.async || (batch != nullptr && options.reentrant)) {
+        QueueToolCall(id, tool, std::move(arguments), batch);
         return;
     }
 
     // Use main thread to call the tool
     auto& app = Application::GetInstance();
-    app.Schedule([this, id, tool_iter, arguments = std::move(arguments)]() {
+    app.Schedule([this, id, tool, arguments = std::move(arguments), batch]() {
         try {
-            ReplyResult(id, (*tool_iter)->Call(arguments));
+            ReplyResult(id, tool->Call(arguments), batch);
         } catch (const std::exception& e) {
             ESP_LOGE(TAG, "tools/call: %s", e.what());
-            ReplyError(id, e.what());
+            ReplyError(id, e.what(), batch);
         }
     });
 }
+
+void McpServer::QueueToolCall(int id, McpTool* tool, PropertyList&& arguments, const std::shared_ptr<Batch>& batch, bool local) {
+    auto call = std::make_shared<ToolCall>();
+    call->id = id;
+    call->local = local;
+    call->batch = batch;
+    call->tool = tool;
+    call->arguments = std::move(arguments);
+    call->deadline_us = tool->options().deadline_ms > 0 ? esp_timer_get_time() + tool->options().deadline_ms * 1000LL : 0;
+
+    bool start_worker = false;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        pending_calls_.push_back(call);
+        if (idle_workers_ == 0 && worker_count_ < MCP_WORKER_COUNT) {
+            worker_count_++;
+            start_worker = true;
+        }
+    }
+    calls_cv_.notify_all();
+
+    if (start_worker) {
+        auto ret = xTaskCreate([](void* arg) {
+            static_cast<McpServer*>(arg)->WorkerTask();
+            vTaskDelete(NULL);
+        }, "mcp_worker", MCP_WORKER_STACK_SIZE, this, MCP_WORKER_PRIORITY, nullptr);
+        if (ret != pdPASS) {
+            // A running worker still picks the call up, or the deadline replies
+            ESP_LOGE(TAG, "Failed to create MCP worker");
+            std::lock_guard<std::mutex> lock(calls_mutex_);
+            worker_count_--;
+        }
+    }
+    if (call->deadline_us > 0 && !esp_timer_is_active(deadline_timer_)) {
+        esp_timer_start_periodic(deadline_timer_, 1000000);
+    }
+}
+
+std::list<std::shared_ptr<McpServer::ToolCall>>::iterator McpServer::FindRunnableCall() {
+    for (auto it = pending_calls_.begin(); it != pending_calls_.end(); ++it) {
+        auto tool = (*it)->tool;
+        int running = std::count_if(running_calls_.begin(), running_calls_.end(),
+            [tool](const std::shared_ptr<ToolCall>& call) { return call->tool == tool; });
+        if (running < tool->options().max_concurrency) {
+            return it;
+        }
+    }
+    return pending_calls_.end();
+}
+
+void McpServer::WorkerTask() {
+    std::unique_lock<std::mutex> lock(calls_mutex_);
+    while (true) {
+        auto it = FindRunnableCall();
+        if (it == pending_calls_.end()) {
+            idle_workers_++;
+            bool has_call = calls_cv_.wait_for(lock, std::chrono::milliseconds(MCP_WORKER_IDLE_TIMEOUT_MS), [this]() {
+                return FindRunnableCall() != pending_calls_.end();
+            });
+            idle_workers_--;
+            if (!has_call) {
+                worker_count_--;
+                return;
+            }
+            continue;
+        }
+
+        auto call = *it;
+        call->worker = xTaskGetCurrentTaskHandle();
+        running_calls_.splice(running_calls_.end(), pending_calls_, it);
+        lock.unlock();
+
+        std::optional<TextStream> result;
+        std::string error;
+        try {
+            result = call->tool->Call(call->arguments);
+        } catch (const std::exception& e) {
+            ESP_LOGE(TAG, "tools/call: %s", e.what());
+            error = e.what();
+        }
+
+        lock.lock();
+        running_calls_.remove(call);
+        bool reply = !call->cancelled && !call->replied;
+        bool timed_out = call->replied;
+        call->replied = true;
+        lock.unlock();
+        // A slot of this tool is free again
+        calls_cv_.notify_all();
+
+        if (call->local) {
+            if (result.has_value()) {
+                ESP_LOGI(TAG, "Local call %s: %s", call->tool->name().c_str(), result->ToString().c_str());
+            } else {
+                ESP_LOGE(TAG, "Local call %s: %s", call->tool->name().c_str(), error.c_str());
+            }
+        } else if (reply) {
+            if (result.has_value()) {
+                ReplyResult(call->id, std::move(*result), call->batch);
+            } else {
+                ReplyError(call->id, error, call->batch);
+            }
+        } else {
+            ESP_LOGI(TAG, "Discarded the result of tool call %d", call->id);
+            if (call->cancelled && !timed_out) {
+                DropReply(call->id, call->batch);
+            }
+        }
+        lock.lock();
+    }
+}
+
+void McpServer::CancelToolCall(int id) {
+    std::shared_ptr<ToolCall> dropped;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        for (auto it = pending_calls_.begin(); it != pending_calls_.end(); ++it) {
+            if ((*it)->id == id && !(*it)->local) {
+                ESP_LOGI(TAG, "Cancelled queued tool call %d", id);
+                dropped = *it;
+                pending_calls_.erase(it);
+                break;
+            }
+        }
+        for (auto& call : running_calls_) {
+            if (!dropped && call->id == id && !call->local) {
+                // The tool cannot be interrupted, it may poll IsToolCallCancelled()
+                ESP_LOGI(TAG, "Cancelled running tool call %d", id);
+                call->cancelled = true;
+                break;
+            }
+        }
+    }
+    // May complete a batch and send it, which must not hold up the workers
+    if (dropped) {
+        DropReply(id, dropped->batch);
+    }
+}
+
+bool McpServer::IsToolCallCancelled() {
+    auto worker = xTaskGetCurrentTaskHandle();
+    std::lock_guard<std::mutex> lock(calls_mutex_);
+    for (auto& call : running_calls_) {
+        if (call->worker == worker) {
+            return call->cancelled || call->replied;
+        }
+    }
+    return false;
+}
+
+void McpServer::CheckDeadlines() {
+    std::vector<std::shared_ptr<ToolCall>> expired;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        auto now = esp_timer_get_time();
+        bool has_deadline = false;
+        for (auto it = pending_calls_.begin(); it != pending_calls_.end();) {
+            auto& call = *it;
+            if (call->deadline_us > 0 && now >= call->deadline_us) {
+                if (call->local) {
+                    ESP_LOGW(TAG, "Local call %s timed out", call->tool->name().c_str());
+                } else {
+                    expired.push_back(call);
+                }
+                it = pending_calls_.erase(it);
+                continue;
+            }
+            has_deadline |= call->deadline_us > 0;
+            ++it;
+        }
+        for (auto& call : running_calls_) {
+            if (call->replied || call->cancelled || call->deadline_us == 0) {
+                continue;
+            }
+            if (now >= call->deadline_us) {
+                // The worker finishes the call on its own time and drops the result
+                if (!call->local) {
+                    expired.push_back(call);
+                }
+                call->replied = true;
+                continue;
+            }
+            has_deadline = true;
+        }
+        if (!has_deadline) {
+            esp_timer_stop(deadline_timer_);
+        }
+    }
+    for (auto& call : expired) {
+        ESP_LOGW(TAG, "Tool call %d timed out", call->id);
+        ReplyError(call->id, "Tool call timed out", call->batch);
+    }
+}
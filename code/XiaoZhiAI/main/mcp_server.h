@@ -9,40 +9,52 @@
 #include <optional>
 #include <stdexcept>
 #include <thread>
-#include <mbedtls/base64.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include <cJSON.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "text_stream.h"
+
+// Workers for asynchronous tools, started on demand and stopped when idle
+#define MCP_WORKER_COUNT 2
+#define MCP_WORKER_STACK_SIZE (4096 * 2)
+#define MCP_WORKER_PRIORITY 1
+#define MCP_WORKER_IDLE_TIMEOUT_MS 10000
 
 class ImageContent {
 private:
-    std::string encoded_data_;
+    std::string data_;
     std::string mime_type_;
 
-    static std::string Base64Encode(const std::string& data) {
-        size_t dlen = 0, olen = 0;
-        mbedtls_base64_encode((unsigned char*)nullptr, 0, &dlen, (const unsigned char*)data.data(), data.size());
-        std::string result(dlen, 0);
-        mbedtls_base64_encode((unsigned char*)result.data(), result.size(), &olen, (const unsigned char*)data.data(), data.size());
+    static std::string QuoteJson(const std::string& text) {
+        cJSON* item = cJSON_CreateString(text.c_str());
+        char* json_str = cJSON_PrintUnformatted(item);
+        std::string result(json_str);
+        cJSON_free(json_str);
+        cJSON_Delete(item);
         return result;
     }
 
 public:
-    ImageContent(const std::string& mime_type, const std::string& data) {
-        mime_type_ = mime_type;
-        // base64 encode data
-        encoded_data_ = Base64Encode(data);
-    }
-
-    std::string to_json() const {
-        cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "type", "image");
-        cJSON_AddStringToObject(json, "mimeType", mime_type_.c_str());
-        cJSON_AddStringToObject(json, "data", encoded_data_.c_str());
-        char* json_str = cJSON_PrintUnformatted(json);
-        std::string result(json_str);
-        cJSON_free(json_str);
-        cJSON_Delete(json);
-        return result;
+    ImageContent(const std::string& mime_type, std::string data)
+        : data_(std::move(data)), mime_type_(mime_type) {}
+
+    // Appends {"type":"image","mimeType":...,"data":...} as a quoted JSON string, the way
+    // tool results embed images. The raw image moves into the stream and is base64
+    // encoded only while the message is sent.
+    void MoveToJsonString(TextStream& stream) {
+        std::string prefix = "{\"type\":\"image\",\"mimeType\":" + QuoteJson(mime_type_) + ",\"data\":\"";
+        prefix = QuoteJson(prefix);
+        prefix.pop_back();  // Leave the string open for the data
+        stream.Append(std::move(prefix));
+        stream.AppendBase64(std::move(data_));
+        stream.Append("\\\"}\"");
     }
 };
 
@@ -205,6 +217,17 @@ public:
     }
 };
 
+struct McpToolOptions {
+    // Sync tools run on the main task and must return quickly. Async tools run on
+    // the MCP workers, so slow I/O does not hold up audio and UI updates.
+    bool async = false;
+    int max_concurrency = 1;    // Calls of an async tool running at the same time
+    int deadline_ms = 0;        // Async calls not done by then get an error reply, 0 for none
+    // Safe to run on a worker next to other calls, so the calls of a JSON-RPC batch
+    // may run in parallel even if the tool is sync
+    bool reentrant = false;
+};
+
 class McpTool {
 private:
     std::string name_;
@@ -212,22 +235,26 @@ private:
     PropertyList properties_;
     std::function<ReturnValue(const PropertyList&)> callback_;
     bool user_only_ = false;
+    McpToolOptions options_;
 
 public:
     McpTool(const std::string& name, 
             const std::string& description, 
             const PropertyList& properties, 
-            std::function<ReturnValue(const PropertyList&)> callback)
+            std::function<ReturnValue(const PropertyList&)> callback,
+            const McpToolOptions& options = {})
         : name_(name), 
         description_(description), 
         properties_(properties), 
-        callback_(callback) {}
+        callback_(callback),
+        options_(options) {}
 
     void set_user_only(bool user_only) { user_only_ = user_only; }
     inline const std::string& name() const { return name_; }
     inline const std::string& description() const { return description_; }
     inline const PropertyList& properties() const { return properties_; }
     inline bool user_only() const { return user_only_; }
+    inline const McpToolOptions& options() const { return options_; }
 
     std::string to_json() const {
         std::vector<std::string> required = properties_.GetRequired();
@@ -269,45 +296,45 @@ public:
         return result;
     }
 
-    std::string Call(const PropertyList& properties) {
+    TextStream Call(const PropertyList& properties) {
         ReturnValue return_value = callback_(properties);
-        // 返回结果
-        cJSON* result = cJSON_CreateObject();
-        cJSON* content = cJSON_CreateArray();
-
+        // 图片结果流式编码，避免整张图片的 base64 副本在多层 JSON 之间反复拷贝
         if (std::holds_alternative<ImageContent*>(return_value)) {
             auto image_content = std::get<ImageContent*>(return_value);
-            cJSON* image = cJSON_CreateObject();
-            cJSON_AddStringToObject(image, "type", "image");
-            cJSON_AddStringToObject(image, "image", image_content->to_json().c_str());
-            cJSON_AddItemToArray(content, image);
+            TextStream result("{\"content\":[{\"type\":\"image\",\"image\":");
+            image_content->MoveToJsonString(result);
+            result.Append("}],\"isError\":false}");
             delete image_content;
-        } else {
-            cJSON* text = cJSON_CreateObject();
-            cJSON_AddStringToObject(text, "type", "text");
-            if (std::holds_alternative<std::string>(return_value)) {
-                cJSON_AddStringToObject(text, "text", std::get<std::string>(return_value).c_str());
-            } else if (std::holds_alternative<bool>(return_value)) {
-                cJSON_AddStringToObject(text, "text", std::get<bool>(return_value) ? "true" : "false");
-            } else if (std::holds_alternative<int>(return_value)) {
-                cJSON_AddStringToObject(text, "text", std::to_string(std::get<int>(return_value)).c_str());
-            } else if (std::holds_alternative<cJSON*>(return_value)) {
-                cJSON* json = std::get<cJSON*>(return_value);
-                char* json_str = cJSON_PrintUnformatted(json);
-                cJSON_AddStringToObject(text, "text", json_str);
-                cJSON_free(json_str);
-                cJSON_Delete(json);
-            }
-            cJSON_AddItemToArray(content, text);
+            return result;
+        }
+
+        // 返回结果
+        cJSON* result = cJSON_CreateObject();
+        cJSON* content = cJSON_CreateArray();
+        cJSON* text = cJSON_CreateObject();
+        cJSON_AddStringToObject(text, "type", "text");
+        if (std::holds_alternative<std::string>(return_value)) {
+            cJSON_AddStringToObject(text, "text", std::get<std::string>(return_value).c_str());
+        } else if (std::holds_alternative<bool>(return_value)) {
+            cJSON_AddStringToObject(text, "text", std::get<bool>(return_value) ? "true" : "false");
+        } else if (std::holds_alternative<int>(return_value)) {
+            cJSON_AddStringToObject(text, "text", std::to_string(std::get<int>(return_value)).c_str());
+        } else if (std::holds_alternative<cJSON*>(return_value)) {
+            cJSON* json = std::get<cJSON*>(return_value);
+            char* json_str = cJSON_PrintUnformatted(json);
+            cJSON_AddStringToObject(text, "text", json_str);
+            cJSON_free(json_str);
+            cJSON_Delete(json);
         }
+        cJSON_AddItemToArray(content, text);
         cJSON_AddItemToObject(result, "content", content);
         cJSON_AddBoolToObject(result, "isError", false);
 
         auto json_str = cJSON_PrintUnformatted(result);
-        std::string result_str(json_str);
+        TextStream result_stream(json_str);
         cJSON_free(json_str);
         cJSON_Delete(result);
-        return result_str;
+        return result_stream;
     }
 };
 
@@ -321,22 +348,75 @@ public:
     void AddCommonTools();
     void AddUserOnlyTools();
     void AddTool(McpTool* tool);
-    void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
-    void AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
+    void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback, const McpToolOptions& options = {});
+    void AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback, const McpToolOptions& options = {});
     void ParseMessage(const cJSON* json);
     void ParseMessage(const std::string& message);
 
+    bool HasTool(const std::string& name) { return FindTool(name) != nullptr; }
+    // Runs a tool without a JSON-RPC request, e.g. for an offline command. Sync tools run on
+    // the calling task, async tools are queued on the workers and true only means queued.
+    bool CallToolLocally(const std::string& name, const std::string& arguments_json = "");
+
+    // For async tools to poll from their callback: true once the call was cancelled
+    // by the client or its deadline passed, the result would be discarded anyway
+    bool IsToolCallCancelled();
+
 private:
     McpServer();
     ~McpServer();
 
-    void ParseCapabilities(const cJSON* capabilities);
-
-    void ReplyResult(int id, const std::string& result);
-    void ReplyError(int id, const std::string& message);
+    // Replies of a JSON-RPC batch, sent together once the last one is in. Requests keep a
+    // pointer to their batch, a single request with the id of a batch request is not taken in
+    struct Batch {
+        std::vector<int> pending_ids;
+        TextStream responses;
+        int response_count = 0;
+    };
+
+    struct ToolCall {
+        int id;
+        McpTool* tool;
+        PropertyList arguments;
+        int64_t deadline_us;    // 0 for none
+        TaskHandle_t worker = nullptr;
+        bool cancelled = false;
+        bool replied = false;
+        bool local = false;     // From CallToolLocally, the result is logged instead of sent
+        std::shared_ptr<Batch> batch;   // nullptr outside a batch
+    };
+
+    // Guards the pending replies of every batch
+    std::mutex batches_mutex_;
+    std::mutex calls_mutex_;
+    std::condition_variable calls_cv_;
+    std::list<std::shared_ptr<ToolCall>> pending_calls_;
+    std::list<std::shared_ptr<ToolCall>> running_calls_;
+    int worker_count_ = 0;
+    int idle_workers_ = 0;
+    esp_timer_handle_t deadline_timer_ = nullptr;
 
-    void GetToolsList(int id, const std::string& cursor, bool list_user_only_tools);
-    void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments);
+    void ParseCapabilities(const cJSON* capabilities);
+    void ParseBatch(const cJSON* json);
+    void ParseRequest(const cJSON* json, const std::shared_ptr<Batch>& batch);
+
+    // The batch of the request, nullptr sends the reply on its own
+    void ReplyResult(int id, const std::string& result, const std::shared_ptr<Batch>& batch);
+    void ReplyResult(int id, TextStream&& result, const std::shared_ptr<Batch>& batch);
+    void ReplyError(int id, const std::string& message, const std::shared_ptr<Batch>& batch);
+    void SendReply(int id, TextStream&& payload, const std::shared_ptr<Batch>& batch);
+    // The request will not be answered, e.g. it was cancelled
+    void DropReply(int id, const std::shared_ptr<Batch>& batch);
+
+    void GetToolsList(int id, const std::string& cursor, bool list_user_only_tools, const std::shared_ptr<Batch>& batch);
+    McpTool* FindTool(const std::string& name);
+    bool ParseToolArguments(const McpTool* tool, const cJSON* tool_arguments, PropertyList& arguments, std::string& error);
+    void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, const std::shared_ptr<Batch>& batch);
+    void QueueToolCall(int id, McpTool* tool, PropertyList&& arguments, const std::shared_ptr<Batch>& batch, bool local = false);
+    void CancelToolCall(int id);
+    void CheckDeadlines();
+    void WorkerTask();
+    std::list<std::shared_ptr<ToolCall>>::iterator FindRunnableCall();
 
     std::vector<McpTool*> tools_;
 };
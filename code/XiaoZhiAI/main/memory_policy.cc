@@ -0,0 +1,164 @@
+#include "memory_policy.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "MemoryPolicy"
+
+#define INTERNAL_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define DMA_CAPS (MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#if CONFIG_SPIRAM
+#define PSRAM_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define PSRAM_CAPS INTERNAL_CAPS
+#endif
+
+static void* HeapAllocate(size_t size, size_t alignment, uint32_t caps) {
+    if (alignment > 0) {
+        return heap_caps_aligned_alloc(alignment, size, caps);
+    }
+    return heap_caps_malloc(size, caps);
+}
+
+static bool InternalHasRoom(size_t size) {
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL) >= size + MEMORY_INTERNAL_RESERVE_BYTES;
+}
+
+void* MemoryPolicy::Allocate(MemoryPool pool, size_t size, size_t alignment) {
+    auto& counters = counters_[pool];
+    void* ptr = nullptr;
+    bool fallback = false;
+
+    switch (pool) {
+    case kMemoryPoolDma:
+        // Peripherals cannot use anything else, so the reserve does not apply
+        ptr = HeapAllocate(size, alignment, DMA_CAPS);
+        break;
+    case kMemoryPoolInternal:
+        if (InternalHasRoom(size)) {
+            ptr = HeapAllocate(size, alignment, INTERNAL_CAPS);
+        }
+#if CONFIG_SPIRAM
+        if (ptr == nullptr) {
+            ptr = HeapAllocate(size, alignment, PSRAM_CAPS);
+            fallback = ptr != nullptr;
+        }
+#endif
+        break;
+    case kMemoryPoolPsram:
+    default:
+        ptr = HeapAllocate(size, alignment, PSRAM_CAPS);
+#if CONFIG_SPIRAM
+        if (ptr == nullptr && InternalHasRoom(size)) {
+            ptr = HeapAllocate(size, alignment, INTERNAL_CAPS);
+            fallback = ptr != nullptr;
+        }
+#endif
+        break;
+    }
+
+    if (ptr == nullptr) {
+        counters.failures++;
+        ESP_LOGW(TAG, "Failed to allocate %u bytes from %s pool", (unsigned)size, GetPoolName(pool));
+        return nullptr;
+    }
+    counters.allocations++;
+    if (fallback) {
+        counters.fallbacks++;
+        ESP_LOGD(TAG, "%s pool request of %u bytes served by the fallback heap", GetPoolName(pool), (unsigned)size);
+    }
+    return ptr;
+}
+
+void* MemoryPolicy::Calloc(MemoryPool pool, size_t size, size_t alignment) {
+    void* ptr = Allocate(pool, size, alignment);
+    if (ptr != nullptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+MemoryPoolStats MemoryPolicy::GetStats(MemoryPool pool) const {
+    uint32_t caps = pool == kMemoryPoolDma ? DMA_CAPS : pool == kMemoryPoolInternal ? INTERNAL_CAPS : PSRAM_CAPS;
+    auto& counters = counters_[pool];
+    MemoryPoolStats stats = {
+        .allocations = counters.allocations.load(),
+        .fallbacks = counters.fallbacks.load(),
+        .failures = counters.failures.load(),
+        .free_bytes = heap_caps_get_free_size(caps),
+        .minimum_free_bytes = heap_caps_get_minimum_free_size(caps),
+        .largest_free_block = heap_caps_get_largest_free_block(caps),
+    };
+    return stats;
+}
+
+const char* MemoryPolicy::GetPoolName(MemoryPool pool) {
+    switch (pool) {
+    case kMemoryPoolDma:
+        return "dma";
+    case kMemoryPoolInternal:
+        return "internal";
+    case kMemoryPoolPsram:
+        return "psram";
+    default:
+        return "unknown";
+    }
+}
+
+MemoryArena::MemoryArena(MemoryPool pool, size_t block_size) : pool_(pool), block_size_(block_size) {
+}
+
+MemoryArena::~MemoryArena() {
+    Reset();
+}
+
+void* MemoryArena::Allocate(size_t size, size_t alignment) {
+    if (alignment == 0) {
+        alignment = 1;
+    }
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (head_ != nullptr) {
+            uintptr_t base = reinterpret_cast<uintptr_t>(head_ + 1);
+            uintptr_t start = (base + head_->offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            if (start + size <= base + head_->size) {
+                used_ += start + size - (base + head_->offset);
+                head_->offset = start + size - base;
+                return reinterpret_cast<void*>(start);
+            }
+        }
+        if (attempt > 0) {
+            break;
+        }
+        // The remainder of the current block is given up, blocks are never revisited
+        size_t block_size = std::max(block_size_, size + alignment);
+        auto block = static_cast<Block*>(MemoryPolicy::GetInstance().Allocate(pool_, sizeof(Block) + block_size));
+        if (block == nullptr) {
+            return nullptr;
+        }
+        block->next = head_;
+        block->size = block_size;
+        block->offset = 0;
+        head_ = block;
+        capacity_ += block_size;
+    }
+    return nullptr;
+}
+
+void* MemoryArena::Calloc(size_t size, size_t alignment) {
+    void* ptr = Allocate(size, alignment);
+    if (ptr != nullptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void MemoryArena::Reset() {
+    while (head_ != nullptr) {
+        Block* next = head_->next;
+        MemoryPolicy::GetInstance().Free(head_);
+        head_ = next;
+    }
+    used_ = 0;
+    capacity_ = 0;
+}
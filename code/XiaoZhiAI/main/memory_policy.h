@@ -0,0 +1,147 @@
+#ifndef MEMORY_POLICY_H
+#define MEMORY_POLICY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <esp_heap_caps.h>
+
+// Internal SRAM that pooled allocations leave to the stacks, drivers and Wi-Fi.
+// A request that would dip below it is placed in PSRAM instead, or fails.
+#define MEMORY_INTERNAL_RESERVE_BYTES (24 * 1024)
+#define MEMORY_ARENA_BLOCK_SIZE (16 * 1024)
+#define MEMORY_ARENA_ALIGNMENT 16
+
+enum MemoryPool {
+    kMemoryPoolDma,         // DMA capable internal SRAM for peripheral buffers, never falls back
+    kMemoryPoolInternal,    // Fast internal SRAM for hot buffers, falls back to PSRAM
+    kMemoryPoolPsram,       // Bulk buffers, internal SRAM only on boards without PSRAM
+    kMemoryPoolCount
+};
+
+struct MemoryPoolStats {
+    uint32_t allocations;   // Successful requests
+    uint32_t fallbacks;     // Requests served from the other memory type
+    uint32_t failures;
+    size_t free_bytes;      // Of the preferred memory type
+    size_t minimum_free_bytes;
+    size_t largest_free_block;
+};
+
+/*
+ * Central placement policy for buffers owned by this firmware. Pointers come straight
+ * from heap_caps and may be released with MemoryPolicy::Free(), heap_caps_free() or
+ * free(), so they can be handed to C libraries and LVGL image descriptors unchanged.
+ */
+class MemoryPolicy {
+public:
+    static MemoryPolicy& GetInstance() {
+        static MemoryPolicy instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    MemoryPolicy(const MemoryPolicy&) = delete;
+    MemoryPolicy& operator=(const MemoryPolicy&) = delete;
+
+    // alignment 0 means the heap default
+    void* Allocate(MemoryPool pool, size_t size, size_t alignment = 0);
+    void* Calloc(MemoryPool pool, size_t size, size_t alignment = 0);
+    void Free(void* ptr) {
+        heap_caps_free(ptr);
+    }
+
+    MemoryPoolStats GetStats(MemoryPool pool) const;
+    static const char* GetPoolName(MemoryPool pool);
+
+private:
+    MemoryPolicy() = default;
+
+    struct Counters {
+        std::atomic<uint32_t> allocations{0};
+        std::atomic<uint32_t> fallbacks{0};
+        std::atomic<uint32_t> failures{0};
+    };
+    Counters counters_[kMemoryPoolCount];
+};
+
+// std compatible allocator bound to a pool, e.g. for large std::vector buffers
+template <typename T, MemoryPool Pool>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U, Pool>;
+    };
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, Pool>&) noexcept {}
+
+    T* allocate(size_t n) {
+        void* ptr = MemoryPolicy::GetInstance().Allocate(Pool, n * sizeof(T), alignof(T) > 4 ? alignof(T) : 0);
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t) noexcept {
+        MemoryPolicy::GetInstance().Free(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U, Pool>&) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U, Pool>&) const noexcept {
+        return false;
+    }
+};
+
+template <typename T>
+using PsramVector = std::vector<T, PoolAllocator<T, kMemoryPoolPsram>>;
+
+/*
+ * Bump allocator for the scratch buffers of one request (an image encode, a download),
+ * all released together when the arena is destroyed or Reset(). Allocations never move
+ * and are not freed one by one. Requests larger than the block size get a block of
+ * their own, so sizing the first block for the whole job makes it a single heap call.
+ */
+class MemoryArena {
+public:
+    MemoryArena(MemoryPool pool, size_t block_size = MEMORY_ARENA_BLOCK_SIZE);
+    ~MemoryArena();
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    // Returns nullptr when the pool is exhausted
+    void* Allocate(size_t size, size_t alignment = MEMORY_ARENA_ALIGNMENT);
+    void* Calloc(size_t size, size_t alignment = MEMORY_ARENA_ALIGNMENT);
+    // Release every block, invalidating all pointers handed out
+    void Reset();
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;        // Usable bytes after the header
+        size_t offset;
+    };
+
+    MemoryPool pool_;
+    size_t block_size_;
+    Block* head_ = nullptr;     // Current block, older blocks follow
+    size_t used_ = 0;
+    size_t capacity_ = 0;
+};
+
+#endif // MEMORY_POLICY_H
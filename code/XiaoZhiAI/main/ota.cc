@@ -1,6 +1,10 @@
 #include "ota.h"
 #include "system_info.h"
 #include "settings.h"
+#include "http_pool.h"
+#include "memory_policy.h"
+#include "ota_delta.h"
+#include "lz4_block.h"
 #include "assets/lang_config.h"
 
 #include <cJSON.h>
@@ -10,6 +14,7 @@
 #include <esp_app_format.h>
 #include <esp_efuse.h>
 #include <esp_efuse_table.h>
+#include <mbedtls/sha256.h>
 #ifdef SOC_HMAC_SUPPORTED
 #include <esp_hmac.h>
 #endif
@@ -21,6 +26,79 @@
 
 #define TAG "Ota"
 
+// Resume point of an interrupted delta upgrade, saved in NVS
+#define DELTA_SETTINGS_NS "ota"
+
+static void ClearDeltaCheckpoint() {
+    Settings settings(DELTA_SETTINGS_NS, true);
+    if (!settings.GetString("delta_url").empty()) {
+        settings.EraseAll();
+        Settings::Flush();
+    }
+}
+
+static std::string EncodeHex(const void* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    auto bytes = static_cast<const uint8_t*>(data);
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++) {
+        hex.push_back(digits[bytes[i] >> 4]);
+        hex.push_back(digits[bytes[i] & 0x0F]);
+    }
+    return hex;
+}
+
+static bool DecodeHex(const std::string& hex, void* data, size_t size) {
+    if (hex.size() != size * 2) {
+        return false;
+    }
+    auto bytes = static_cast<uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        auto byte = hex.substr(i * 2, 2);
+        char* end;
+        bytes[i] = strtoul(byte.c_str(), &end, 16);
+        if (*end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads exactly size bytes, false on an error or a premature end of the body
+static bool ReadFully(Http* http, void* buffer, size_t size) {
+    auto data = static_cast<char*>(buffer);
+    while (size > 0) {
+        int ret = http->Read(data, size);
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to read HTTP data: %d", ret);
+            return false;
+        }
+        data += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+static bool PartitionSha256(const esp_partition_t* partition, size_t size, uint8_t sha256[32]) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    uint8_t buffer[1024];
+    bool success = true;
+    for (size_t offset = 0; offset < size; offset += sizeof(buffer)) {
+        size_t n = std::min(sizeof(buffer), size - offset);
+        if (esp_partition_read(partition, offset, buffer, n) != ESP_OK) {
+            success = false;
+            break;
+        }
+        mbedtls_sha256_update(&ctx, buffer, n);
+    }
+    mbedtls_sha256_finish(&ctx, sha256);
+    mbedtls_sha256_free(&ctx);
+    return success;
+}
+
 
 Ota::Ota() {
 #ifdef ESP_EFUSE_BLOCK_USR_DATA
@@ -51,8 +129,7 @@ std::string Ota::GetCheckVersionUrl() {
 
 std::unique_ptr<Http> Ota::SetupHttp() {
     auto& board = Board::GetInstance();
-    auto network = board.GetNetwork();
-    auto http = network->CreateHttp(0);
+    auto http = HttpPool::GetInstance().CreateHttp(0);
     auto user_agent = SystemInfo::GetUserAgent();
     http->SetHeader("Activation-Version", has_serial_number_ ? "2" : "1");
     http->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
@@ -218,6 +295,9 @@ esp_err_t Ota::CheckVersion() {
         if (cJSON_IsString(url)) {
             firmware_url_ = url->valuestring;
         }
+        // Patch from the running firmware (identified by elf_sha256) to this version
+        cJSON *delta_url = cJSON_GetObjectItem(firmware, "delta_url");
+        firmware_delta_url_ = cJSON_IsString(delta_url) ? delta_url->valuestring : "";
 
         if (cJSON_IsString(version) && cJSON_IsString(url)) {
             // Check if the version is newer, for example, 0.1.0 is newer than 0.0.1
@@ -271,11 +351,12 @@ bool Ota::Upgrade(const std::string& firmware_url, std::function<void(int progre
     }
 
     ESP_LOGI(TAG, "Writing to partition %s at offset 0x%lx", update_partition->label, update_partition->address);
+    // The full image overwrites whatever an interrupted delta upgrade left behind
+    ClearDeltaCheckpoint();
     bool image_header_checked = false;
     std::string image_header;
 
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(0);
+    auto http = HttpPool::GetInstance().CreateHttp(0);
     if (!http->Open("GET", firmware_url)) {
         ESP_LOGE(TAG, "Failed to open HTTP connection");
         return false;
@@ -367,6 +448,203 @@ bool Ota::Upgrade(const std::string& firmware_url, std::function<void(int progre
     return true;
 }
 
+esp_err_t Ota::UpgradeDelta(const std::string& patch_url, std::function<void(int progress, size_t speed)> callback) {
+    ESP_LOGI(TAG, "Upgrading firmware with delta patch from %s", patch_url.c_str());
+    auto source_partition = esp_ota_get_running_partition();
+    auto update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL) {
+        ESP_LOGE(TAG, "Failed to get update partition");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Continue where an interrupted run of the same patch stopped
+    OtaDeltaHeader header;
+    size_t patch_offset = 0, source_position = 0, target_position = 0;
+    bool resume = false;
+    {
+        Settings settings(DELTA_SETTINGS_NS);
+        if (settings.GetString("delta_url") == patch_url &&
+            DecodeHex(settings.GetString("delta_header"), &header, sizeof(header))) {
+            patch_offset = settings.GetInt("delta_patch");
+            source_position = settings.GetInt("delta_source");
+            target_position = settings.GetInt("delta_target");
+            resume = patch_offset > sizeof(header);
+        }
+    }
+
+    auto http = HttpPool::GetInstance().CreateHttp(0);
+    if (resume) {
+        http->SetHeader("Range", "bytes=" + std::to_string(patch_offset) + "-");
+    }
+    if (!http->Open("GET", patch_url)) {
+        ESP_LOGE(TAG, "Failed to open HTTP connection");
+        return ESP_FAIL;
+    }
+
+    int status_code = http->GetStatusCode();
+    if (resume && status_code == 200) {
+        ESP_LOGW(TAG, "Server does not support ranges, starting the patch over");
+        resume = false;
+    } else if (status_code != 200 && status_code != 206) {
+        ESP_LOGE(TAG, "Failed to get patch, status code: %d", status_code);
+        // No patch for this firmware on the server, the full image is needed
+        return status_code >= 400 && status_code < 500 ? ESP_ERR_NOT_SUPPORTED : ESP_FAIL;
+    }
+    // The body starts at the requested range, the header is part of it when starting over
+    size_t patch_size = (resume ? patch_offset : 0) + http->GetBodyLength();
+    if (!resume) {
+        patch_offset = source_position = target_position = 0;
+        if (!ReadFully(http.get(), &header, sizeof(header))) {
+            return ESP_FAIL;
+        }
+        patch_offset = sizeof(header);
+    }
+
+    if (memcmp(header.magic, OTA_DELTA_MAGIC, sizeof(header.magic)) != 0 ||
+        header.chunk_size == 0 || header.chunk_size > OTA_DELTA_MAX_CHUNK_SIZE ||
+        header.source_size > source_partition->size || header.target_size > update_partition->size) {
+        ESP_LOGE(TAG, "Invalid patch header");
+        ClearDeltaCheckpoint();
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint8_t sha256[32];
+    if (!PartitionSha256(source_partition, header.source_size, sha256) ||
+        memcmp(sha256, header.source_sha256, sizeof(sha256)) != 0) {
+        ESP_LOGE(TAG, "Patch was not made for the running firmware");
+        ClearDeltaCheckpoint();
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_ota_handle_t update_handle = 0;
+    esp_err_t err;
+    if (resume) {
+        ESP_LOGI(TAG, "Resuming at patch offset %u, target offset %u", patch_offset, target_position);
+        err = esp_ota_resume(update_partition, OTA_WITH_SEQUENTIAL_WRITES, target_position, &update_handle);
+    } else {
+        ClearDeltaCheckpoint();
+        err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &update_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to begin OTA: %s", esp_err_to_name(err));
+        ClearDeltaCheckpoint();
+        return ESP_FAIL;
+    }
+
+    // Memory use is bounded by the chunk size of the patch, whatever the image size is
+    auto& memory = MemoryPolicy::GetInstance();
+    auto payload = static_cast<uint8_t*>(memory.Allocate(kMemoryPoolPsram, header.chunk_size));
+    auto records = static_cast<uint8_t*>(memory.Allocate(kMemoryPoolPsram, header.chunk_size));
+
+    OtaDeltaDecoder decoder(header.source_size, header.target_size,
+        [source_partition](size_t offset, uint8_t* data, size_t size) {
+            return esp_partition_read(source_partition, offset, data, size) == ESP_OK;
+        },
+        [update_handle](const uint8_t* data, size_t size) {
+            esp_err_t err = esp_ota_write(update_handle, data, size);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to write OTA data: %s", esp_err_to_name(err));
+            }
+            return err == ESP_OK;
+        });
+    decoder.Seek(source_position, target_position);
+
+    err = payload != nullptr && records != nullptr ? ESP_OK : ESP_ERR_NO_MEM;
+    size_t recent_read = 0, last_checkpoint = target_position;
+    auto last_calc_time = esp_timer_get_time();
+    while (err == ESP_OK && !decoder.done()) {
+        OtaDeltaChunkHeader chunk;
+        if (!ReadFully(http.get(), &chunk, sizeof(chunk))) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (chunk.raw_size > header.chunk_size || chunk.payload_size > chunk.raw_size) {
+            ESP_LOGE(TAG, "Invalid chunk at patch offset %u", patch_offset);
+            err = ESP_ERR_NOT_SUPPORTED;
+            break;
+        }
+        if (!ReadFully(http.get(), payload, chunk.payload_size)) {
+            err = ESP_FAIL;
+            break;
+        }
+
+        const uint8_t* data = payload;
+        if (chunk.payload_size < chunk.raw_size) {
+            if (Lz4DecompressBlock(payload, chunk.payload_size, records, chunk.raw_size) != (int)chunk.raw_size) {
+                ESP_LOGE(TAG, "Corrupted chunk at patch offset %u", patch_offset);
+                err = ESP_ERR_NOT_SUPPORTED;
+                break;
+            }
+            data = records;
+        }
+        if (!decoder.ApplyChunk(data, chunk.raw_size)) {
+            err = ESP_ERR_NOT_SUPPORTED;
+            break;
+        }
+        patch_offset += sizeof(chunk) + chunk.payload_size;
+        recent_read += sizeof(chunk) + chunk.payload_size;
+
+        // Flash encryption writes 16 byte blocks, a resume point must not split one
+        if (decoder.target_position() - last_checkpoint >= OTA_DELTA_CHECKPOINT_BYTES &&
+            decoder.target_position() % 16 == 0) {
+            Settings settings(DELTA_SETTINGS_NS, true);
+            settings.SetString("delta_url", patch_url);
+            settings.SetString("delta_header", EncodeHex(&header, sizeof(header)));
+            settings.SetInt("delta_patch", patch_offset);
+            settings.SetInt("delta_source", decoder.source_position());
+            settings.SetInt("delta_target", decoder.target_position());
+            Settings::Flush();
+            last_checkpoint = decoder.target_position();
+        }
+
+        // Calculate speed and progress every second
+        if (esp_timer_get_time() - last_calc_time >= 1000000 || decoder.done()) {
+            size_t progress = patch_offset * 100 / patch_size;
+            ESP_LOGI(TAG, "Progress: %u%% (%u/%u), Speed: %uB/s", progress, patch_offset, patch_size, recent_read);
+            if (callback) {
+                callback(progress, recent_read);
+            }
+            last_calc_time = esp_timer_get_time();
+            recent_read = 0;
+        }
+    }
+    http->Close();
+    memory.Free(payload);
+    memory.Free(records);
+
+    if (err != ESP_OK) {
+        // The bytes written so far stay in the partition for the next attempt
+        esp_ota_abort(update_handle);
+        if (err == ESP_ERR_NOT_SUPPORTED) {
+            ClearDeltaCheckpoint();
+        }
+        return err;
+    }
+
+    ClearDeltaCheckpoint();
+    err = esp_ota_end(update_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to end OTA: %s", esp_err_to_name(err));
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Hash what actually landed in flash, which also covers the bytes of earlier attempts
+    if (!PartitionSha256(update_partition, header.target_size, sha256) ||
+        memcmp(sha256, header.target_sha256, sizeof(sha256)) != 0) {
+        ESP_LOGE(TAG, "Patched image does not match the expected hash");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    err = esp_ota_set_boot_partition(update_partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set boot partition: %s", esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Delta upgrade successful");
+    return ESP_OK;
+}
+
 bool Ota::StartUpgrade(std::function<void(int progress, size_t speed)> callback) {
     return Upgrade(firmware_url_, callback);
 }
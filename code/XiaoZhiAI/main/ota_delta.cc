@@ -0,0 +1,93 @@
+#include "ota_delta.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "OtaDelta"
+
+static bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) {
+            return false;
+        }
+        uint8_t byte = *p++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+OtaDeltaDecoder::OtaDeltaDecoder(size_t source_size, size_t target_size, SourceReader reader, TargetWriter writer)
+    : source_size_(source_size), target_size_(target_size), reader_(std::move(reader)), writer_(std::move(writer)) {
+}
+
+void OtaDeltaDecoder::Seek(size_t source_position, size_t target_position) {
+    source_position_ = source_position;
+    target_position_ = target_position;
+}
+
+bool OtaDeltaDecoder::ApplyChunk(const uint8_t* records, size_t size) {
+    const uint8_t* p = records;
+    const uint8_t* end = records + size;
+    while (p < end) {
+        uint32_t diff_length, extra_length, zigzag_seek;
+        if (!ReadVarint(p, end, diff_length) || !ReadVarint(p, end, extra_length) || !ReadVarint(p, end, zigzag_seek)) {
+            ESP_LOGE(TAG, "Truncated record header");
+            return false;
+        }
+        if ((size_t)(end - p) < (size_t)diff_length + extra_length ||
+            target_size_ - target_position_ < (size_t)diff_length + extra_length) {
+            ESP_LOGE(TAG, "Record exceeds the chunk or the target");
+            return false;
+        }
+
+        if (!ApplyDiff(p, diff_length)) {
+            return false;
+        }
+        p += diff_length;
+
+        if (extra_length > 0 && !writer_(p, extra_length)) {
+            return false;
+        }
+        p += extra_length;
+        target_position_ += extra_length;
+
+        int32_t seek = (int32_t)(zigzag_seek >> 1) ^ -(int32_t)(zigzag_seek & 1);
+        int64_t position = (int64_t)source_position_ + seek;
+        if (position < 0 || position > (int64_t)source_size_) {
+            ESP_LOGE(TAG, "Seek outside of the source: %lld", position);
+            return false;
+        }
+        source_position_ = position;
+    }
+    return true;
+}
+
+bool OtaDeltaDecoder::ApplyDiff(const uint8_t* diff, size_t size) {
+    if (source_size_ - std::min(source_position_, source_size_) < size) {
+        ESP_LOGE(TAG, "Diff exceeds the source");
+        return false;
+    }
+
+    uint8_t buffer[512];
+    while (size > 0) {
+        size_t n = std::min(size, sizeof(buffer));
+        if (!reader_(source_position_, buffer, n)) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            buffer[i] += diff[i];
+        }
+        if (!writer_(buffer, n)) {
+            return false;
+        }
+        diff += n;
+        size -= n;
+        source_position_ += n;
+        target_position_ += n;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Patch format produced by scripts/ota_delta/ota_delta.py, see the script for the layout
+#define OTA_DELTA_MAGIC "XZD1"
+#define OTA_DELTA_MAX_CHUNK_SIZE (64 * 1024)
+// Target bytes written between two saved resume points
+#define OTA_DELTA_CHECKPOINT_BYTES (64 * 1024)
+
+struct __attribute__((packed)) OtaDeltaHeader {
+    char magic[4];
+    uint32_t chunk_size;
+    uint32_t source_size;
+    uint8_t source_sha256[32];
+    uint32_t target_size;
+    uint8_t target_sha256[32];
+};
+
+struct __attribute__((packed)) OtaDeltaChunkHeader {
+    uint32_t payload_size;  // Equal to raw_size for a stored chunk, smaller for LZ4
+    uint32_t raw_size;
+};
+
+/*
+ * Applies the bsdiff style records of a patch chunk by chunk. Each record copies a run
+ * of the source with a byte-wise difference added, appends literal bytes and moves the
+ * source position. Records never span chunks, so the decoder state between chunks is
+ * just the two positions, which is what a resume point stores. Where the source is read
+ * from and the target written to is up to the caller.
+ */
+class OtaDeltaDecoder {
+public:
+    using SourceReader = std::function<bool(size_t offset, uint8_t* data, size_t size)>;
+    using TargetWriter = std::function<bool(const uint8_t* data, size_t size)>;
+
+    OtaDeltaDecoder(size_t source_size, size_t target_size, SourceReader reader, TargetWriter writer);
+
+    void Seek(size_t source_position, size_t target_position);
+    // Takes the decompressed records of one chunk, false if they are malformed or the
+    // source or target could not be accessed
+    bool ApplyChunk(const uint8_t* records, size_t size);
+
+    size_t source_position() const { return source_position_; }
+    size_t target_position() const { return target_position_; }
+    bool done() const { return target_position_ == target_size_; }
+
+private:
+    size_t source_size_;
+    size_t target_size_;
+    SourceReader reader_;
+    TargetWriter writer_;
+    size_t source_position_ = 0;
+    size_t target_position_ = 0;
+
+    bool ApplyDiff(const uint8_t* diff, size_t size);
+};
+
+#endif // OTA_DELTA_H
@@ -0,0 +1,203 @@
+#include "performance_profiler.h"
+#include "application.h"
+#include "memory_policy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cJSON.h>
+
+#define TAG "Profiler"
+
+PerformanceProfiler::PerformanceProfiler() {
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            // Walking the task list takes longer than an esp_timer callback should, and the
+            // timer task is too small for uxTaskGetSystemState with many tasks
+            auto profiler = (PerformanceProfiler*)arg;
+            Application::GetInstance().Schedule([profiler]() {
+                profiler->TakeSample();
+            });
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "profiler_timer",
+        .skip_unhandled_events = true
+    };
+    esp_timer_create(&timer_args, &timer_handle_);
+}
+
+PerformanceProfiler::~PerformanceProfiler() {
+    if (timer_handle_ != nullptr) {
+        esp_timer_stop(timer_handle_);
+        esp_timer_delete(timer_handle_);
+    }
+}
+
+void PerformanceProfiler::Start(int interval_ms) {
+    Stop();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        interval_ms_ = interval_ms;
+        sample_head_ = 0;
+        sample_count_ = 0;
+        tasks_.clear();
+    }
+    // The first sample only records the run time counters the next one is compared against
+    TakeSample();
+    esp_timer_start_periodic(timer_handle_, interval_ms * 1000);
+    ESP_LOGI(TAG, "Sampling every %d ms", interval_ms);
+}
+
+void PerformanceProfiler::Stop() {
+    if (esp_timer_is_active(timer_handle_)) {
+        esp_timer_stop(timer_handle_);
+    }
+}
+
+void PerformanceProfiler::TakeSample() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Only grows when tasks are created, the buffer is reused afterwards
+    size_t capacity = uxTaskGetNumberOfTasks() + 4;
+    if (task_status_.size() < capacity) {
+        task_status_.resize(capacity);
+    }
+    configRUN_TIME_COUNTER_TYPE run_time;
+    size_t task_count = uxTaskGetSystemState(task_status_.data(), task_status_.size(), &run_time);
+    uint32_t elapsed = run_time - last_run_time_;
+    bool first_sample = last_run_time_ == 0 || elapsed == 0;
+    last_run_time_ = run_time;
+
+    PerformanceSample sample = {};
+    std::vector<TaskUsage> tasks;
+    tasks.reserve(task_count);
+    for (size_t i = 0; i < task_count; i++) {
+        auto& status = task_status_[i];
+        TaskUsage usage = {
+            .handle = status.xHandle,
+            .name = {},
+            .run_time = status.ulRunTimeCounter,
+            .cpu = 0,
+            .stack_free = (uint32_t)status.usStackHighWaterMark * sizeof(StackType_t),
+        };
+        strncpy(usage.name, status.pcTaskName, sizeof(usage.name) - 1);
+
+        auto previous = std::find_if(tasks_.begin(), tasks_.end(), [&](const TaskUsage& task) {
+            return task.handle == status.xHandle;
+        });
+        if (!first_sample && previous != tasks_.end()) {
+            uint32_t task_elapsed = status.ulRunTimeCounter - previous->run_time;
+            usage.cpu = std::min<uint32_t>(100, task_elapsed * 100ULL / ((uint64_t)elapsed * CONFIG_FREERTOS_NUMBER_OF_CORES));
+            for (int core = 0; core < CONFIG_FREERTOS_NUMBER_OF_CORES && core < 2; core++) {
+                if (status.xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+                    sample.core_load[core] = 100 - std::min<uint32_t>(100, task_elapsed * 100ULL / elapsed);
+                }
+            }
+        }
+        tasks.push_back(usage);
+    }
+    tasks_ = std::move(tasks);
+    if (first_sample) {
+        return;
+    }
+
+    sample.timestamp_ms = esp_timer_get_time() / 1000;
+    sample.free_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    sample.min_free_internal = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    sample.largest_internal_block = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    sample.free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    sample.largest_psram_block = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+
+    auto depths = Application::GetInstance().GetAudioService().GetQueueDepths();
+    sample.encode_queue = std::min<size_t>(255, depths.encode);
+    sample.decode_queue = std::min<size_t>(255, depths.decode);
+    sample.send_queue = std::min<size_t>(255, depths.send);
+    sample.playback_queue = std::min<size_t>(255, depths.playback);
+
+    samples_[sample_head_] = sample;
+    sample_head_ = (sample_head_ + 1) % PERFORMANCE_PROFILER_HISTORY;
+    sample_count_ = std::min<size_t>(sample_count_ + 1, PERFORMANCE_PROFILER_HISTORY);
+}
+
+std::string PerformanceProfiler::GetStatsJson() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "interval_ms", interval_ms_);
+
+    // Histories are stored per field, oldest first, to keep the payload small
+    cJSON* history = cJSON_CreateObject();
+    const char* fields[] = { "timestamp_ms", "free_internal", "min_free_internal", "largest_internal_block",
+        "free_psram", "largest_psram_block", "core0_load", "core1_load",
+        "encode_queue", "decode_queue", "send_queue", "playback_queue" };
+    const size_t field_count = sizeof(fields) / sizeof(fields[0]);
+    cJSON* arrays[field_count];
+    for (size_t i = 0; i < field_count; i++) {
+        arrays[i] = cJSON_AddArrayToObject(history, fields[i]);
+    }
+    size_t start = (sample_head_ + PERFORMANCE_PROFILER_HISTORY - sample_count_) % PERFORMANCE_PROFILER_HISTORY;
+    for (size_t n = 0; n < sample_count_; n++) {
+        auto& sample = samples_[(start + n) % PERFORMANCE_PROFILER_HISTORY];
+        double values[field_count] = { (double)sample.timestamp_ms, (double)sample.free_internal,
+            (double)sample.min_free_internal, (double)sample.largest_internal_block, (double)sample.free_psram,
+            (double)sample.largest_psram_block, (double)sample.core_load[0], (double)sample.core_load[1],
+            (double)sample.encode_queue, (double)sample.decode_queue, (double)sample.send_queue,
+            (double)sample.playback_queue };
+        for (size_t i = 0; i < field_count; i++) {
+            cJSON_AddItemToArray(arrays[i], cJSON_CreateNumber(values[i]));
+        }
+    }
+    cJSON_AddItemToObject(root, "history", history);
+
+    cJSON* tasks = cJSON_CreateArray();
+    for (auto& usage : tasks_) {
+        cJSON* task = cJSON_CreateObject();
+        cJSON_AddStringToObject(task, "name", usage.name);
+        cJSON_AddNumberToObject(task, "cpu", usage.cpu);
+        cJSON_AddNumberToObject(task, "stack_free", usage.stack_free);
+        cJSON_AddItemToArray(tasks, task);
+    }
+    cJSON_AddItemToObject(root, "tasks", tasks);
+
+    auto& memory_policy = MemoryPolicy::GetInstance();
+    cJSON* pools = cJSON_CreateObject();
+    for (int i = 0; i < kMemoryPoolCount; i++) {
+        auto pool = static_cast<MemoryPool>(i);
+        auto stats = memory_policy.GetStats(pool);
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "allocations", stats.allocations);
+        cJSON_AddNumberToObject(item, "fallbacks", stats.fallbacks);
+        cJSON_AddNumberToObject(item, "failures", stats.failures);
+        cJSON_AddNumberToObject(item, "free", stats.free_bytes);
+        cJSON_AddNumberToObject(item, "min_free", stats.minimum_free_bytes);
+        cJSON_AddNumberToObject(item, "largest_block", stats.largest_free_block);
+        cJSON_AddItemToObject(pools, MemoryPolicy::GetPoolName(pool), item);
+    }
+    cJSON_AddItemToObject(root, "pools", pools);
+
+    auto json_str = cJSON_PrintUnformatted(root);
+    std::string result(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return result;
+}
+
+std::string PerformanceProfiler::GetBinaryDump() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::string dump;
+    dump.reserve(8 + sample_count_ * sizeof(PerformanceSample));
+    dump.push_back(PERFORMANCE_PROFILER_DUMP_VERSION);
+    dump.push_back(sizeof(PerformanceSample));
+    uint16_t count = sample_count_;
+    dump.append((const char*)&count, sizeof(count));
+    uint32_t interval = interval_ms_;
+    dump.append((const char*)&interval, sizeof(interval));
+    size_t start = (sample_head_ + PERFORMANCE_PROFILER_HISTORY - sample_count_) % PERFORMANCE_PROFILER_HISTORY;
+    for (size_t n = 0; n < sample_count_; n++) {
+        dump.append((const char*)&samples_[(start + n) % PERFORMANCE_PROFILER_HISTORY], sizeof(PerformanceSample));
+    }
+    return dump;
+}
@@ -0,0 +1,75 @@
+#ifndef _PERFORMANCE_PROFILER_H_
+#define _PERFORMANCE_PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+#define PERFORMANCE_PROFILER_HISTORY 64
+#define PERFORMANCE_PROFILER_DUMP_VERSION 1
+
+// One system-wide sample, also the record layout of the binary dump (little endian)
+struct PerformanceSample {
+    uint32_t timestamp_ms;
+    uint32_t free_internal;
+    uint32_t min_free_internal;
+    uint32_t largest_internal_block;
+    uint32_t free_psram;
+    uint32_t largest_psram_block;
+    uint8_t core_load[2];           // percent busy of each core, 0 for a missing core
+    uint8_t encode_queue;
+    uint8_t decode_queue;
+    uint8_t send_queue;
+    uint8_t playback_queue;
+    uint16_t reserved;
+} __attribute__((packed));
+
+/*
+ * Samples CPU load, heap and audio queue depths on the main task at a fixed rate into a
+ * ring of PERFORMANCE_PROFILER_HISTORY samples. Per-task CPU usage and stack high-water
+ * marks are only kept for the latest interval.
+ */
+class PerformanceProfiler {
+public:
+    static PerformanceProfiler& GetInstance() {
+        static PerformanceProfiler instance;
+        return instance;
+    }
+
+    void Start(int interval_ms);
+    void Stop();
+
+    std::string GetStatsJson();
+    // Header {u8 version, u8 sample size, u16 count, u32 interval_ms} followed by the samples, oldest first
+    std::string GetBinaryDump();
+
+private:
+    PerformanceProfiler();
+    ~PerformanceProfiler();
+
+    struct TaskUsage {
+        TaskHandle_t handle;
+        char name[configMAX_TASK_NAME_LEN];
+        uint32_t run_time;
+        uint8_t cpu;                // percent of all cores during the last interval
+        uint32_t stack_free;        // high-water mark, in bytes
+    };
+
+    std::mutex mutex_;
+    esp_timer_handle_t timer_handle_ = nullptr;
+    int interval_ms_ = 0;
+    PerformanceSample samples_[PERFORMANCE_PROFILER_HISTORY];
+    size_t sample_head_ = 0;
+    size_t sample_count_ = 0;
+    std::vector<TaskStatus_t> task_status_;
+    std::vector<TaskUsage> tasks_;
+    configRUN_TIME_COUNTER_TYPE last_run_time_ = 0;
+
+    void TakeSample();
+};
+
+#endif // _PERFORMANCE_PROFILER_H_
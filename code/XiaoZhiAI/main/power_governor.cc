@@ -0,0 +1,187 @@
+#include "power_governor.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <algorithm>
+
+#define TAG "PowerGovernor"
+
+static const char* const kStageNames[kPowerStageCount] = {
+    "wake_word",
+    "uplink",
+    "playback",
+    "ui",
+};
+
+// CPU frequencies the DFS driver can switch between, XTAL is only used as the sleep minimum
+static const int kFrequencyLadder[] = {80, 160, 240};
+
+PowerGovernor::~PowerGovernor() {
+    if (cpu_lock_ != nullptr) {
+        if (cpu_lock_held_) {
+            esp_pm_lock_release(cpu_lock_);
+        }
+        esp_pm_lock_delete(cpu_lock_);
+    }
+}
+
+void PowerGovernor::SetLimits(int max_freq_mhz, bool light_sleep) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cpu_lock_ == nullptr) {
+        auto ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "power_governor", &cpu_lock_);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Power management not supported: %s", esp_err_to_name(ret));
+            cpu_lock_ = nullptr;
+            return;
+        }
+    }
+
+    level_count_ = 0;
+    for (int frequency : kFrequencyLadder) {
+        if (frequency <= max_freq_mhz) {
+            frequencies_[level_count_++] = frequency;
+        }
+    }
+    if (level_count_ == 0) {
+        ESP_LOGE(TAG, "Invalid max frequency %d MHz", max_freq_mhz);
+        enabled_ = false;
+        return;
+    }
+
+    // Stages start at the highest level and come down once their load is known
+    for (auto& stage : stages_) {
+        if (stage.level < 0 || stage.level >= level_count_) {
+            stage.level = level_count_ - 1;
+        }
+    }
+    light_sleep_ = light_sleep;
+    enabled_ = true;
+    configured_max_mhz_ = 0;
+    Apply();
+}
+
+void PowerGovernor::Acquire(PowerStage stage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = stages_[stage];
+    if (++state.active == 1) {
+        // Busy time reported while the stage was stopped has no deadline to go with
+        state.busy_us = 0;
+        state.deadline_us = 0;
+        if (enabled_) {
+            Apply();
+        }
+    }
+}
+
+void PowerGovernor::Release(PowerStage stage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = stages_[stage];
+    if (state.active == 0) {
+        ESP_LOGW(TAG, "Stage %s released more often than acquired", kStageNames[stage]);
+        return;
+    }
+    if (--state.active == 0 && enabled_) {
+        Apply();
+    }
+}
+
+void PowerGovernor::ReportLoad(PowerStage stage, int64_t busy_us, int64_t deadline_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_ || busy_us < 0 || deadline_us < 0) {
+        return;
+    }
+
+    auto& state = stages_[stage];
+    int64_t now_us = esp_timer_get_time();
+    if (state.busy_us == 0 && state.deadline_us == 0) {
+        state.window_start_us = now_us;
+    }
+    state.busy_us += busy_us;
+    state.deadline_us += deadline_us;
+
+    bool frame_missed = deadline_us > 0 && busy_us * 100 >= deadline_us * POWER_GOVERNOR_MISS_LOAD_PERCENT;
+    bool window_missed = state.deadline_us >= POWER_GOVERNOR_MISS_WINDOW_MS * 1000LL &&
+        state.busy_us * 100 >= state.deadline_us * POWER_GOVERNOR_MISS_LOAD_PERCENT;
+    if (frame_missed || window_missed) {
+        ESP_LOGD(TAG, "Stage %s busy %lld of %lld us", kStageNames[stage], state.busy_us, state.deadline_us);
+        state.busy_us = 0;
+        state.deadline_us = 0;
+        state.window_start_us = now_us;
+        if (state.level < level_count_ - 1) {
+            state.level = level_count_ - 1;
+            ESP_LOGI(TAG, "Stage %s is close to its deadline, raised to %d MHz", kStageNames[stage],
+                frequencies_[state.level]);
+            Apply();
+        }
+        return;
+    }
+
+    if (state.deadline_us > 0 && now_us - state.window_start_us >= POWER_GOVERNOR_WINDOW_MS * 1000LL) {
+        EvaluateWindow(state, now_us);
+    }
+}
+
+void PowerGovernor::EvaluateWindow(StageState& state, int64_t now_us) {
+    // The window ran at the configured frequency, the load scales inversely with the frequency
+    int64_t load = state.busy_us * configured_max_mhz_;
+    int target = level_count_ - 1;
+    for (int i = 0; i < level_count_; i++) {
+        if (load * 100 <= state.deadline_us * POWER_GOVERNOR_TARGET_LOAD_PERCENT * frequencies_[i]) {
+            target = i;
+            break;
+        }
+    }
+    state.busy_us = 0;
+    state.deadline_us = 0;
+    state.window_start_us = now_us;
+
+    // Go down one step per window, up at once
+    int level = target < state.level ? state.level - 1 : target;
+    if (level != state.level) {
+        ESP_LOGD(TAG, "Stage %s %d -> %d MHz", kStageNames[&state - stages_],
+            frequencies_[state.level], frequencies_[level]);
+        state.level = level;
+        Apply();
+    }
+}
+
+void PowerGovernor::Apply() {
+    int required = 0;
+    for (auto& stage : stages_) {
+        if (stage.active > 0) {
+            required = std::max(required, frequencies_[stage.level]);
+        }
+    }
+    bool busy = required > 0;
+
+    // Without running stages the limit goes back up, so Wi-Fi and drivers holding their own locks are not slowed down
+    int max_mhz = busy ? required : frequencies_[level_count_ - 1];
+    if (max_mhz != configured_max_mhz_ || light_sleep_ != configured_light_sleep_) {
+        int min_mhz = light_sleep_ ? POWER_GOVERNOR_SLEEP_MIN_FREQ_MHZ : POWER_GOVERNOR_AWAKE_MIN_FREQ_MHZ;
+        esp_pm_config_t pm_config = {
+            .max_freq_mhz = max_mhz,
+            .min_freq_mhz = std::min(min_mhz, max_mhz),
+            .light_sleep_enable = light_sleep_,
+        };
+        auto ret = esp_pm_configure(&pm_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to configure %d MHz: %s", max_mhz, esp_err_to_name(ret));
+            return;
+        }
+        configured_max_mhz_ = max_mhz;
+        configured_light_sleep_ = light_sleep_;
+        // Loads measured so far belong to the old frequency
+        for (auto& stage : stages_) {
+            stage.busy_us = 0;
+            stage.deadline_us = 0;
+        }
+    }
+
+    if (busy && !cpu_lock_held_) {
+        esp_pm_lock_acquire(cpu_lock_);
+        cpu_lock_held_ = true;
+    } else if (!busy && cpu_lock_held_) {
+        esp_pm_lock_release(cpu_lock_);
+        cpu_lock_held_ = false;
+    }
+}
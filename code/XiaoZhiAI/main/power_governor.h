@@ -0,0 +1,104 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <esp_pm.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_timer.h>
+
+#include <cstdint>
+#include <mutex>
+
+// Load is averaged over this window before the frequency of a stage is lowered
+#define POWER_GOVERNOR_WINDOW_MS 2000
+// Share of the frame deadline a stage may use at the chosen frequency, the rest is headroom
+#define POWER_GOVERNOR_TARGET_LOAD_PERCENT 60
+// A frame, or the frames of this short window, above this share of the deadline raise the stage at once
+#define POWER_GOVERNOR_MISS_LOAD_PERCENT 90
+#define POWER_GOVERNOR_MISS_WINDOW_MS 200
+// Lowest CPU frequency while awake, the APB clock of I2S, SPI and Wi-Fi needs 80 MHz anyway
+#define POWER_GOVERNOR_AWAKE_MIN_FREQ_MHZ 80
+#define POWER_GOVERNOR_SLEEP_MIN_FREQ_MHZ 40
+
+enum PowerStage {
+    kPowerStageWakeWord,    // Wake word detection only
+    kPowerStageUplink,      // AFE and Opus encoding
+    kPowerStagePlayback,    // Opus decoding and playback
+    kPowerStageUi,          // UI animation
+    kPowerStageCount,
+};
+
+/*
+ * Sets the CPU frequency from the work that is actually running. Each pipeline stage is
+ * acquired while it runs and reports how long its frames take against their deadlines.
+ * A stage has one source of deadlines, e.g. the audio capture, other tasks working on the
+ * same frames report their busy time without a deadline.
+ * Every stage keeps its own frequency level: the lowest one whose predicted load stays
+ * under the target, lowered one step per window and raised at once when a frame gets
+ * close to its deadline. While any stage is active a CPU lock holds the highest level
+ * of the active stages, otherwise the CPU falls to the minimum frequency.
+ *
+ * The governor stays disabled until a board sets the limits, which is done by
+ * PowerSaveTimer on boards that pass a cpu_max_freq. It also needs CONFIG_PM_ENABLE,
+ * which is off in the default sdkconfig, otherwise every call is a no-op. The battery
+ * boards that pass -1 (xingzhi-cube, kevin-box-2, sensecap-watcher) do not use it yet.
+ */
+class PowerGovernor {
+public:
+    static PowerGovernor& GetInstance() {
+        static PowerGovernor instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    PowerGovernor(const PowerGovernor&) = delete;
+    PowerGovernor& operator=(const PowerGovernor&) = delete;
+
+    // Highest CPU frequency and whether light sleep is allowed, enables the governor
+    void SetLimits(int max_freq_mhz, bool light_sleep);
+
+    // Calls are counted like esp_pm locks, every Acquire needs a Release
+    void Acquire(PowerStage stage);
+    void Release(PowerStage stage);
+    // Time spent on one frame of the stage and the time the frame covers, a deadline of 0
+    // adds busy time to frames whose deadline is reported by another task
+    void ReportLoad(PowerStage stage, int64_t busy_us, int64_t deadline_us);
+
+    // CPU time of the calling task in microseconds, for tasks that block inside the work they measure.
+    // Without run time stats this is the wall time, which overestimates the load and keeps the stage fast.
+    static uint32_t GetTaskCpuTimeUs() {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER
+        return ulTaskGetRunTimeCounter(xTaskGetCurrentTaskHandle());
+#else
+        return (uint32_t)esp_timer_get_time();
+#endif
+    }
+
+private:
+    PowerGovernor() = default;
+    ~PowerGovernor();
+
+    struct StageState {
+        int active = 0;
+        int level = -1;         // Index into frequencies_, -1 until the limits are set
+        int64_t busy_us = 0;
+        int64_t deadline_us = 0;
+        int64_t window_start_us = 0;
+    };
+
+    std::mutex mutex_;
+    bool enabled_ = false;
+    bool light_sleep_ = false;
+    int frequencies_[3] = {};
+    int level_count_ = 0;
+    int configured_max_mhz_ = 0;
+    bool configured_light_sleep_ = false;
+    StageState stages_[kPowerStageCount];
+    esp_pm_lock_handle_t cpu_lock_ = nullptr;
+    bool cpu_lock_held_ = false;
+
+    void EvaluateWindow(StageState& stage, int64_t now_us);
+    void Apply();
+};
+
+#endif // POWER_GOVERNOR_H
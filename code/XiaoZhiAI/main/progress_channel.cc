@@ -0,0 +1,67 @@
+#include "progress_channel.h"
+
+#include <esp_log.h>
+
+#define TAG "ProgressChannel"
+
+ProgressChannel::ProgressChannel() {
+    auto ret = xTaskCreate([](void* arg) {
+        static_cast<ProgressChannel*>(arg)->ConsumerTask();
+        vTaskDelete(NULL);
+    }, "progress", PROGRESS_CHANNEL_STACK_SIZE, this, PROGRESS_CHANNEL_TASK_PRIORITY, &task_handle_);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create progress task");
+        task_handle_ = nullptr;
+    }
+}
+
+ProgressChannel::~ProgressChannel() {
+    if (task_handle_ != nullptr) {
+        vTaskDelete(task_handle_);
+    }
+}
+
+void ProgressChannel::SetConsumer(std::function<void(const ProgressReport& report)> consumer) {
+    std::lock_guard<std::mutex> lock(consumer_mutex_);
+    consumer_ = std::move(consumer);
+}
+
+void ProgressChannel::Publish(int progress, size_t speed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.progress = progress;
+        pending_.speed = speed;
+        has_pending_ = true;
+    }
+    if (task_handle_ != nullptr) {
+        xTaskNotifyGive(task_handle_);
+    }
+}
+
+void ProgressChannel::Drain() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        has_pending_ = false;
+    }
+    std::lock_guard<std::mutex> lock(consumer_mutex_);
+}
+
+void ProgressChannel::ConsumerTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        std::lock_guard<std::mutex> consumer_lock(consumer_mutex_);
+        ProgressReport report;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!has_pending_) {
+                continue;
+            }
+            report = pending_;
+            has_pending_ = false;
+        }
+        if (consumer_) {
+            consumer_(report);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef PROGRESS_CHANNEL_H
+#define PROGRESS_CHANNEL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <functional>
+#include <mutex>
+
+#define PROGRESS_CHANNEL_STACK_SIZE 4096
+#define PROGRESS_CHANNEL_TASK_PRIORITY 2
+
+struct ProgressReport {
+    int progress = 0;       // Percent
+    size_t speed = 0;       // Bytes per second
+};
+
+/*
+ * Progress of long operations like downloads and firmware upgrades. Publishing only
+ * overwrites a single latest-value slot and wakes the consumer task, so it never blocks
+ * and never allocates in the middle of a flash write loop. The consumer task is created
+ * once and sees the latest report, reports published while it is busy are coalesced.
+ */
+class ProgressChannel {
+public:
+    static ProgressChannel& GetInstance() {
+        static ProgressChannel instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    ProgressChannel(const ProgressChannel&) = delete;
+    ProgressChannel& operator=(const ProgressChannel&) = delete;
+
+    // Renders the reports, runs on the channel task
+    void SetConsumer(std::function<void(const ProgressReport& report)> consumer);
+    void Publish(int progress, size_t speed);
+    // Drop the pending report and wait for the consumer, so it does not overwrite what is shown next
+    void Drain();
+
+private:
+    ProgressChannel();
+    ~ProgressChannel();
+
+    std::mutex mutex_;
+    std::mutex consumer_mutex_;     // Held while the consumer runs
+    std::function<void(const ProgressReport&)> consumer_;
+    ProgressReport pending_;
+    bool has_pending_ = false;
+    TaskHandle_t task_handle_ = nullptr;
+
+    void ConsumerTask();
+};
+
+#endif // PROGRESS_CHANNEL_H
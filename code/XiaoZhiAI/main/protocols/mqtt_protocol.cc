@@ -4,6 +4,7 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <cstring>
 #include <arpa/inet.h>
 #include "assets/lang_config.h"
@@ -185,7 +186,10 @@ bool MqttProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         return false;
     }
 
-    return udp_->Send(encrypted) > 0;
+    auto start_time = esp_timer_get_time();
+    bool success = udp_->Send(encrypted) > 0;
+    RecordAudioSent(esp_timer_get_time() - start_time, success);
+    return success;
 }
 
 void MqttProtocol::CloseAudioChannel() {
@@ -253,9 +257,15 @@ bool MqttProtocol::OpenAudioChannel() {
             ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
             return;
         }
+        uint32_t lost = 0;
         if (sequence != remote_sequence_ + 1) {
             ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
+            // The first packet of a channel may start anywhere, only count gaps after it
+            if (remote_sequence_ != 0 && sequence > remote_sequence_) {
+                lost = sequence - remote_sequence_ - 1;
+            }
         }
+        RecordAudioReceived(lost);
 
         size_t decrypted_size = data.size() - aes_nonce_.size();
         size_t nc_off = 0;
@@ -298,12 +308,18 @@ std::string MqttProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "aec", true);
 #endif
     cJSON_AddBoolToObject(features, "mcp", true);
+#if CONFIG_USE_VAD_GATED_UPLINK
+    cJSON_AddBoolToObject(features, "vad_gate", true);
+#endif
     cJSON_AddItemToObject(root, "features", features);
     cJSON* audio_params = cJSON_CreateObject();
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
     cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+#if CONFIG_USE_ADAPTIVE_OPUS_ENCODER
+    OpusRateController::DescribeAllowedParams(audio_params);
+#endif
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
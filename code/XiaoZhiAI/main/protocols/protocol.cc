@@ -73,11 +73,29 @@ void Protocol::SendStopListening() {
     SendText(message);
 }
 
+void Protocol::SendVadState(bool speaking) {
+    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"vad\",\"state\":\"";
+    message += speaking ? "start" : "stop";
+    message += "\"}";
+    SendText(message);
+}
+
 void Protocol::SendMcpMessage(const std::string& payload) {
     std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"mcp\",\"payload\":" + payload + "}";
     SendText(message);
 }
 
+void Protocol::SendMcpMessage(TextStream&& payload) {
+    TextStream message("{\"session_id\":\"" + session_id_ + "\",\"type\":\"mcp\",\"payload\":");
+    message.Append(std::move(payload));
+    message.Append("}");
+    SendTextStream(message);
+}
+
+bool Protocol::SendTextStream(TextStream& stream) {
+    return SendText(stream.ToString());
+}
+
 bool Protocol::IsTimeout() const {
     const int kTimeoutSeconds = 120;
     auto now = std::chrono::steady_clock::now();
@@ -88,3 +106,25 @@ bool Protocol::IsTimeout() const {
     }
     return timeout;
 }
+
+AudioLinkStats Protocol::TakeAudioLinkStats() {
+    std::lock_guard<std::mutex> lock(link_stats_mutex_);
+    AudioLinkStats stats = link_stats_;
+    link_stats_ = AudioLinkStats();
+    return stats;
+}
+
+void Protocol::RecordAudioSent(int64_t latency_us, bool success) {
+    std::lock_guard<std::mutex> lock(link_stats_mutex_);
+    link_stats_.packets_sent++;
+    link_stats_.total_send_latency_us += latency_us;
+    if (!success) {
+        link_stats_.send_failures++;
+    }
+}
+
+void Protocol::RecordAudioReceived(uint32_t lost) {
+    std::lock_guard<std::mutex> lock(link_stats_mutex_);
+    link_stats_.packets_received++;
+    link_stats_.packets_lost += lost;
+}
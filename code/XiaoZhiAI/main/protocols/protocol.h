@@ -4,8 +4,12 @@
 #include <cJSON.h>
 #include <string>
 #include <functional>
+#include <memory>
 #include <chrono>
 #include <vector>
+#include <mutex>
+
+#include "text_stream.h"
 
 struct AudioStreamPacket {
     int sample_rate = 0;
@@ -14,6 +18,15 @@ struct AudioStreamPacket {
     std::vector<uint8_t> payload;
 };
 
+// Audio link counters accumulated by the protocol since the last TakeAudioLinkStats()
+struct AudioLinkStats {
+    uint32_t packets_sent = 0;
+    uint32_t send_failures = 0;
+    uint64_t total_send_latency_us = 0;
+    uint32_t packets_received = 0;
+    uint32_t packets_lost = 0;      // Gaps in the incoming sequence numbers
+};
+
 struct BinaryProtocol2 {
     uint16_t version;
     uint16_t type;          // Message type (0: OPUS, 1: JSON)
@@ -67,12 +80,18 @@ public:
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
+    // Start connecting in the background so a following OpenAudioChannel() can reuse the connection
+    virtual void PrewarmAudioChannel() {}
     virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
     virtual void SendAbortSpeaking(AbortReason reason);
     virtual void SendMcpMessage(const std::string& message);
+    virtual void SendMcpMessage(TextStream&& payload);
+    virtual void SendVadState(bool speaking);
+
+    AudioLinkStats TakeAudioLinkStats();
 
 protected:
     std::function<void(const cJSON* root)> on_incoming_json_;
@@ -88,10 +107,16 @@ protected:
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
+    std::mutex link_stats_mutex_;
+    AudioLinkStats link_stats_;
 
     virtual bool SendText(const std::string& text) = 0;
+    // Sends one text message produced piece by piece. The default assembles it and calls SendText().
+    virtual bool SendTextStream(TextStream& stream);
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
+    void RecordAudioSent(int64_t latency_us, bool success);
+    void RecordAudioReceived(uint32_t lost);
 };
 
 #endif // PROTOCOL_H
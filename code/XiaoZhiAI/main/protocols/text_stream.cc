@@ -0,0 +1,116 @@
+#include "text_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Encodes up to 3 bytes into 4 characters, padding with '='
+static void EncodeBase64Group(const uint8_t* src, size_t len, char* dst) {
+    uint32_t value = src[0] << 16;
+    if (len > 1) {
+        value |= src[1] << 8;
+    }
+    if (len > 2) {
+        value |= src[2];
+    }
+    dst[0] = kBase64Alphabet[(value >> 18) & 0x3F];
+    dst[1] = kBase64Alphabet[(value >> 12) & 0x3F];
+    dst[2] = len > 1 ? kBase64Alphabet[(value >> 6) & 0x3F] : '=';
+    dst[3] = len > 2 ? kBase64Alphabet[value & 0x3F] : '=';
+}
+
+TextStream::TextStream(std::string text) {
+    Append(std::move(text));
+}
+
+void TextStream::Append(std::string text) {
+    if (!text.empty()) {
+        segments_.push_back({std::move(text), false});
+    }
+}
+
+void TextStream::Append(TextStream&& other) {
+    for (size_t i = other.segment_index_; i < other.segments_.size(); i++) {
+        auto& segment = other.segments_[i];
+        if (i == other.segment_index_ && other.offset_ > 0) {
+            segment.data.erase(0, other.offset_);
+        }
+        segments_.push_back(std::move(segment));
+    }
+    other.segments_.clear();
+    other.segment_index_ = 0;
+    other.offset_ = 0;
+}
+
+void TextStream::AppendBase64(std::string data) {
+    if (!data.empty()) {
+        segments_.push_back({std::move(data), true});
+    }
+}
+
+size_t TextStream::length() const {
+    size_t total = 0;
+    for (size_t i = segment_index_; i < segments_.size(); i++) {
+        auto& segment = segments_[i];
+        size_t size = segment.data.size() - (i == segment_index_ ? offset_ : 0);
+        total += segment.base64 ? (size + 2) / 3 * 4 : size;
+    }
+    return total;
+}
+
+bool TextStream::eof() const {
+    return segment_index_ >= segments_.size();
+}
+
+size_t TextStream::Read(char* buffer, size_t size) {
+    size_t written = 0;
+    while (segment_index_ < segments_.size() && written < size) {
+        auto& segment = segments_[segment_index_];
+        size_t remaining = segment.data.size() - offset_;
+        size_t space = size - written;
+
+        if (!segment.base64) {
+            size_t n = std::min(remaining, space);
+            memcpy(buffer + written, segment.data.data() + offset_, n);
+            offset_ += n;
+            written += n;
+        } else {
+            auto src = reinterpret_cast<const uint8_t*>(segment.data.data()) + offset_;
+            size_t groups = std::min((remaining + 2) / 3, space / 4);
+            if (groups == 0) {
+                break;
+            }
+            for (size_t i = 0; i < groups; i++) {
+                size_t len = std::min<size_t>(3, remaining - i * 3);
+                EncodeBase64Group(src + i * 3, len, buffer + written);
+                written += 4;
+            }
+            offset_ = std::min(segment.data.size(), offset_ + groups * 3);
+        }
+
+        if (offset_ == segment.data.size()) {
+            // Release the source as soon as it was sent
+            std::string().swap(segment.data);
+            segment_index_++;
+            offset_ = 0;
+        }
+    }
+    return written;
+}
+
+std::string TextStream::ToString() {
+    std::string result;
+    result.resize(length());
+    size_t total = 0;
+    while (total < result.size()) {
+        size_t n = Read(&result[total], result.size() - total);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    result.resize(total);
+    return result;
+}
@@ -0,0 +1,49 @@
+#ifndef TEXT_STREAM_H
+#define TEXT_STREAM_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/*
+ * A text message built from segments and produced piece by piece while it is sent.
+ * Binary segments are base64 encoded on the fly, so a large payload such as an image
+ * is never held as a whole encoded copy. Segments are released once they were read.
+ */
+class TextStream {
+public:
+    TextStream() = default;
+    explicit TextStream(std::string text);
+    TextStream(TextStream&&) = default;
+    TextStream& operator=(TextStream&&) = default;
+    TextStream(const TextStream&) = delete;
+    TextStream& operator=(const TextStream&) = delete;
+
+    void Append(std::string text);
+    void Append(TextStream&& other);
+    // Appends the base64 encoding of the bytes
+    void AppendBase64(std::string data);
+
+    // Bytes left to read
+    size_t length() const;
+    bool eof() const;
+
+    // Copies the next bytes of the message, returns 0 at the end. Base64 is produced in
+    // whole 4 byte groups, so a call may return fewer bytes than requested, or 0 with a
+    // buffer smaller than 4 bytes.
+    size_t Read(char* buffer, size_t size);
+    // Reads the rest of the message into one string
+    std::string ToString();
+
+private:
+    struct Segment {
+        std::string data;
+        bool base64;
+    };
+
+    std::vector<Segment> segments_;
+    size_t segment_index_ = 0;
+    size_t offset_ = 0;     // Read position in the source bytes of the current segment
+};
+
+#endif // TEXT_STREAM_H
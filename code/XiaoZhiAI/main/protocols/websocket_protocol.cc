@@ -7,6 +7,7 @@
 #include <cstring>
 #include <cJSON.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <arpa/inet.h>
 #include "assets/lang_config.h"
 
@@ -30,6 +31,10 @@ bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         return false;
     }
 
+    // The write blocks until the frame is handed to TCP, so its duration tracks uplink congestion
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    auto start_time = esp_timer_get_time();
+    bool success;
     if (version_ == 2) {
         std::string serialized;
         serialized.resize(sizeof(BinaryProtocol2) + packet->payload.size());
@@ -41,7 +46,7 @@ bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         bp2->payload_size = htonl(packet->payload.size());
         memcpy(bp2->payload, packet->payload.data(), packet->payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        success = websocket_->Send(serialized.data(), serialized.size(), true);
     } else if (version_ == 3) {
         std::string serialized;
         serialized.resize(sizeof(BinaryProtocol3) + packet->payload.size());
@@ -51,10 +56,12 @@ bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         bp3->payload_size = htons(packet->payload.size());
         memcpy(bp3->payload, packet->payload.data(), packet->payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        success = websocket_->Send(serialized.data(), serialized.size(), true);
     } else {
-        return websocket_->Send(packet->payload.data(), packet->payload.size(), true);
+        success = websocket_->Send(packet->payload.data(), packet->payload.size(), true);
     }
+    RecordAudioSent(esp_timer_get_time() - start_time, success);
+    return success;
 }
 
 bool WebsocketProtocol::SendText(const std::string& text) {
@@ -62,6 +69,7 @@ bool WebsocketProtocol::SendText(const std::string& text) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(send_mutex_);
     if (!websocket_->Send(text)) {
         ESP_LOGE(TAG, "Failed to send text: %s", text.c_str());
         SetError(Lang::Strings::SERVER_ERROR);
@@ -71,15 +79,136 @@ bool WebsocketProtocol::SendText(const std::string& text) {
     return true;
 }
 
+bool WebsocketProtocol::SendTextStream(TextStream& stream) {
+    if (websocket_ == nullptr || !websocket_->IsConnected()) {
+        return false;
+    }
+
+    size_t total_length = stream.length();
+    std::string fragment(WEBSOCKET_PROTOCOL_TEXT_FRAGMENT_SIZE, '\0');
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    do {
+        size_t length = 0;
+        while (length < fragment.size() && !stream.eof()) {
+            size_t n = stream.Read(&fragment[length], fragment.size() - length);
+            if (n == 0) {
+                break;
+            }
+            length += n;
+        }
+        // The last fragment carries FIN, it may be empty when the message ends on a fragment boundary
+        if (!websocket_->Send(fragment.data(), length, false, stream.eof())) {
+            ESP_LOGE(TAG, "Failed to send text stream of %u bytes", (unsigned)total_length);
+            SetError(Lang::Strings::SERVER_ERROR);
+            return false;
+        }
+    } while (!stream.eof());
+
+    return true;
+}
+
 bool WebsocketProtocol::IsAudioChannelOpened() const {
     return websocket_ != nullptr && websocket_->IsConnected() && !error_occurred_ && !IsTimeout();
 }
 
 void WebsocketProtocol::CloseAudioChannel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        channel_opened_ = false;
+    }
     websocket_.reset();
 }
 
-bool WebsocketProtocol::OpenAudioChannel() {
+void WebsocketProtocol::PrewarmAudioChannel() {
+#if CONFIG_USE_WEBSOCKET_PREWARM
+    if (IsAudioChannelOpened()) {
+        return;
+    }
+
+    // A stale channel may still hold the modem socket we are about to reuse
+    websocket_.reset();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (prewarm_task_ != nullptr) {
+        // Already connecting or holding a warm connection
+        return;
+    }
+    channel_opened_ = false;
+    warm_unclaimed_ = true;
+
+    xEventGroupClearBits(event_group_handle_, WEBSOCKET_PROTOCOL_PREWARM_READY_EVENT | WEBSOCKET_PROTOCOL_PREWARM_CLAIM_EVENT);
+    xTaskCreate([](void* arg) {
+        auto protocol = (WebsocketProtocol*)arg;
+        protocol->PrewarmTask();
+        vTaskDelete(NULL);
+    }, "ws_prewarm", 4096 * 2, this, 2, &prewarm_task_);
+#endif
+}
+
+void WebsocketProtocol::PrewarmTask() {
+    const int kPingIntervalSeconds = 10;
+    auto start_time = esp_timer_get_time();
+    std::string error;
+    auto websocket = Connect(error);
+    if (websocket == nullptr) {
+        ESP_LOGW(TAG, "Prewarm failed: %s", error.c_str());
+    } else {
+        ESP_LOGI(TAG, "Prewarmed connection ready in %d ms", (int)((esp_timer_get_time() - start_time) / 1000));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        warm_websocket_ = std::move(websocket);
+    }
+    xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_PREWARM_READY_EVENT);
+
+    // Keep the connection alive until it is claimed or stays unused for too long
+    start_time = esp_timer_get_time();
+    std::unique_ptr<WebSocket> unused;
+    while (true) {
+        auto bits = xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_PREWARM_CLAIM_EVENT, pdTRUE, pdFALSE,
+            pdMS_TO_TICKS(kPingIntervalSeconds * 1000));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bits & WEBSOCKET_PROTOCOL_PREWARM_CLAIM_EVENT || warm_websocket_ == nullptr) {
+            break;
+        }
+        auto idle_seconds = (esp_timer_get_time() - start_time) / 1000000;
+        if (!warm_websocket_->IsConnected() || idle_seconds >= CONFIG_WEBSOCKET_PREWARM_IDLE_TIMEOUT) {
+            ESP_LOGI(TAG, "Dropping unused prewarmed connection");
+            unused = std::move(warm_websocket_);
+            pending_messages_.clear();
+            break;
+        }
+        warm_websocket_->Ping();
+    }
+    // Destroy outside the lock, the receive callbacks of the socket take it too
+    unused.reset();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    prewarm_task_ = nullptr;
+}
+
+void WebsocketProtocol::ClaimWarmChannel() {
+    // Messages arriving during the replay are held too, so they are delivered after the earlier ones
+    std::unique_lock<std::mutex> lock(mutex_);
+    warm_unclaimed_ = false;
+    while (!pending_messages_.empty()) {
+        auto messages = std::move(pending_messages_);
+        pending_messages_.clear();
+        lock.unlock();
+        for (auto& message : messages) {
+            auto root = cJSON_Parse(message.c_str());
+            if (root != nullptr && on_incoming_json_ != nullptr) {
+                on_incoming_json_(root);
+            }
+            cJSON_Delete(root);
+        }
+        lock.lock();
+    }
+    channel_opened_ = true;
+}
+
+std::unique_ptr<WebSocket> WebsocketProtocol::Connect(std::string& error) {
     Settings settings("websocket", false);
     std::string url = settings.GetString("url");
     std::string token = settings.GetString("token");
@@ -88,13 +217,11 @@ bool WebsocketProtocol::OpenAudioChannel() {
         version_ = version;
     }
 
-    error_occurred_ = false;
-
     auto network = Board::GetInstance().GetNetwork();
-    websocket_ = network->CreateWebSocket(1);
-    if (websocket_ == nullptr) {
+    auto websocket = network->CreateWebSocket(1);
+    if (websocket == nullptr) {
         ESP_LOGE(TAG, "Failed to create websocket");
-        return false;
+        return nullptr;
     }
 
     if (!token.empty()) {
@@ -102,13 +229,13 @@ bool WebsocketProtocol::OpenAudioChannel() {
         if (token.find(" ") == std::string::npos) {
             token = "Bearer " + token;
         }
-        websocket_->SetHeader("Authorization", token.c_str());
+        websocket->SetHeader("Authorization", token.c_str());
     }
-    websocket_->SetHeader("Protocol-Version", std::to_string(version_).c_str());
-    websocket_->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
-    websocket_->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
+    websocket->SetHeader("Protocol-Version", std::to_string(version_).c_str());
+    websocket->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
+    websocket->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
 
-    websocket_->OnData([this](const char* data, size_t len, bool binary) {
+    websocket->OnData([this](const char* data, size_t len, bool binary) {
         if (binary) {
             if (on_incoming_audio_ != nullptr) {
                 if (version_ == 2) {
@@ -145,50 +272,113 @@ bool WebsocketProtocol::OpenAudioChannel() {
                 }
             }
         } else {
-            // Parse JSON data
-            auto root = cJSON_Parse(data);
+            // Parse JSON data, the message is not null-terminated
+            auto root = cJSON_ParseWithLength(data, len);
             auto type = cJSON_GetObjectItem(root, "type");
             if (cJSON_IsString(type)) {
                 if (strcmp(type->valuestring, "hello") == 0) {
                     ParseServerHello(root);
                 } else {
-                    if (on_incoming_json_ != nullptr) {
-                        on_incoming_json_(root);
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    if (!channel_opened_) {
+                        // Prewarmed connection, deliver once the channel is opened
+                        pending_messages_.emplace_back(data, len);
+                    } else {
+                        lock.unlock();
+                        if (on_incoming_json_ != nullptr) {
+                            on_incoming_json_(root);
+                        }
                     }
                 }
             } else {
-                ESP_LOGE(TAG, "Missing message type, data: %s", data);
+                ESP_LOGE(TAG, "Missing message type, data: %.*s", (int)len, data);
             }
             cJSON_Delete(root);
         }
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
-    websocket_->OnDisconnected([this]() {
+    websocket->OnDisconnected([this]() {
         ESP_LOGI(TAG, "Websocket disconnected");
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (warm_unclaimed_) {
+                return;
+            }
+        }
         if (on_audio_channel_closed_ != nullptr) {
             on_audio_channel_closed_();
         }
     });
 
     ESP_LOGI(TAG, "Connecting to websocket server: %s with version: %d", url.c_str(), version_);
-    if (!websocket_->Connect(url.c_str())) {
-        ESP_LOGE(TAG, "Failed to connect to websocket server, code=%d", websocket_->GetLastError());
-        SetError(Lang::Strings::SERVER_NOT_CONNECTED);
-        return false;
+    if (!websocket->Connect(url.c_str())) {
+        ESP_LOGE(TAG, "Failed to connect to websocket server, code=%d", websocket->GetLastError());
+        error = Lang::Strings::SERVER_NOT_CONNECTED;
+        return nullptr;
     }
 
     // Send hello message to describe the client
+    xEventGroupClearBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT);
     auto message = GetHelloMessage();
-    if (!SendText(message)) {
-        return false;
+    if (!websocket->Send(message)) {
+        ESP_LOGE(TAG, "Failed to send text: %s", message.c_str());
+        error = Lang::Strings::SERVER_ERROR;
+        return nullptr;
     }
 
     // Wait for server hello
     EventBits_t bits = xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(10000));
     if (!(bits & WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT)) {
         ESP_LOGE(TAG, "Failed to receive server hello");
-        SetError(Lang::Strings::SERVER_TIMEOUT);
+        error = Lang::Strings::SERVER_TIMEOUT;
+        return nullptr;
+    }
+    return websocket;
+}
+
+bool WebsocketProtocol::OpenAudioChannel() {
+    error_occurred_ = false;
+
+#if CONFIG_USE_WEBSOCKET_PREWARM
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (prewarm_task_ != nullptr) {
+            // The prewarm connect is bounded by the socket timeouts and the hello wait
+            lock.unlock();
+            xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_PREWARM_READY_EVENT, pdFALSE, pdFALSE, portMAX_DELAY);
+            lock.lock();
+        }
+        websocket_ = std::move(warm_websocket_);
+        xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_PREWARM_CLAIM_EVENT);
+    }
+    if (websocket_ != nullptr && websocket_->IsConnected()) {
+        ESP_LOGI(TAG, "Using prewarmed connection, session: %s", session_id_.c_str());
+        last_incoming_time_ = std::chrono::steady_clock::now();
+        ClaimWarmChannel();
+        if (on_audio_channel_opened_ != nullptr) {
+            on_audio_channel_opened_();
+        }
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_messages_.clear();
+    }
+    websocket_.reset();
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        channel_opened_ = true;
+        warm_unclaimed_ = false;
+    }
+    std::string error;
+    websocket_ = Connect(error);
+    if (websocket_ == nullptr) {
+        if (!error.empty()) {
+            SetError(error);
+        }
         return false;
     }
 
@@ -209,6 +399,9 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "aec", true);
 #endif
     cJSON_AddBoolToObject(features, "mcp", true);
+#if CONFIG_USE_VAD_GATED_UPLINK
+    cJSON_AddBoolToObject(features, "vad_gate", true);
+#endif
     cJSON_AddItemToObject(root, "features", features);
     cJSON_AddStringToObject(root, "transport", "websocket");
     cJSON* audio_params = cJSON_CreateObject();
@@ -216,6 +409,9 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
     cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+#if CONFIG_USE_ADAPTIVE_OPUS_ENCODER
+    OpusRateController::DescribeAllowedParams(audio_params);
+#endif
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -7,8 +7,14 @@
 #include <web_socket.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
+#include <freertos/task.h>
 
 #define WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT (1 << 0)
+#define WEBSOCKET_PROTOCOL_PREWARM_READY_EVENT (1 << 1)
+#define WEBSOCKET_PROTOCOL_PREWARM_CLAIM_EVENT (1 << 2)
+
+// Streamed text messages are sent as continuation frames of this size
+#define WEBSOCKET_PROTOCOL_TEXT_FRAGMENT_SIZE 4096
 
 class WebsocketProtocol : public Protocol {
 public:
@@ -20,14 +26,30 @@ public:
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
+    void PrewarmAudioChannel() override;
 
 private:
     EventGroupHandle_t event_group_handle_;
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
-
+    // Keeps audio frames out of a fragmented text message
+    std::mutex send_mutex_;
+
+    // A connection that finished the hello handshake before the channel was requested.
+    // Server messages received on it are held until OpenAudioChannel() claims it.
+    std::mutex mutex_;
+    bool channel_opened_ = false;
+    bool warm_unclaimed_ = false;   // Its disconnect is not a closed audio channel
+    std::unique_ptr<WebSocket> warm_websocket_;
+    std::vector<std::string> pending_messages_;
+    TaskHandle_t prewarm_task_ = nullptr;
+
+    std::unique_ptr<WebSocket> Connect(std::string& error);
+    void PrewarmTask();
+    void ClaimWarmChannel();
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;
+    bool SendTextStream(TextStream& stream) override;
     std::string GetHelloMessage();
 };
 
@@ -1,108 +1,274 @@
 #include "settings.h"
+#include "application.h"
 
 #include <esp_log.h>
+#include <esp_system.h>
 #include <nvs_flash.h>
 
 #define TAG "Settings"
 
+std::mutex Settings::mutex_;
+std::mutex Settings::flush_mutex_;
+std::map<std::string, Settings::Namespace> Settings::namespaces_;
+esp_timer_handle_t Settings::commit_timer_ = nullptr;
+
 Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
-    nvs_open(ns.c_str(), read_write_ ? NVS_READWRITE : NVS_READONLY, &nvs_handle_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    store_ = &LoadNamespace(ns);
 }
 
 Settings::~Settings() {
-    if (nvs_handle_ != 0) {
-        if (read_write_ && dirty_) {
-            ESP_ERROR_CHECK(nvs_commit(nvs_handle_));
+    if (dirty_) {
+        ScheduleCommit();
+    }
+}
+
+Settings::Namespace& Settings::LoadNamespace(const std::string& ns) {
+    auto& store = namespaces_[ns];
+    if (store.loaded) {
+        return store;
+    }
+    store.loaded = true;
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(ns.c_str(), NVS_READONLY, &nvs_handle) != ESP_OK) {
+        // The namespace has not been created yet
+        return store;
+    }
+
+    nvs_iterator_t it = nullptr;
+    esp_err_t ret = nvs_entry_find(NVS_DEFAULT_PART_NAME, ns.c_str(), NVS_TYPE_ANY, &it);
+    while (ret == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        Value value;
+        value.type = info.type;
+        bool ok = false;
+        switch (info.type) {
+        case NVS_TYPE_STR: {
+            size_t length = 0;
+            if (nvs_get_str(nvs_handle, info.key, nullptr, &length) == ESP_OK) {
+                value.text.resize(length);
+                ok = nvs_get_str(nvs_handle, info.key, value.text.data(), &length) == ESP_OK;
+                while (!value.text.empty() && value.text.back() == '\0') {
+                    value.text.pop_back();
+                }
+            }
+            break;
+        }
+        case NVS_TYPE_I32:
+            ok = nvs_get_i32(nvs_handle, info.key, &value.number) == ESP_OK;
+            break;
+        case NVS_TYPE_U8: {
+            uint8_t number;
+            ok = nvs_get_u8(nvs_handle, info.key, &number) == ESP_OK;
+            value.number = number;
+            break;
+        }
+        default:
+            // Blobs and other types are not accessed through Settings
+            break;
+        }
+        if (ok) {
+            store.values[info.key] = std::move(value);
         }
-        nvs_close(nvs_handle_);
+        ret = nvs_entry_next(&it);
     }
+    nvs_release_iterator(it);
+    nvs_close(nvs_handle);
+
+    ESP_LOGD(TAG, "Loaded %u keys from namespace %s", (unsigned)store.values.size(), ns.c_str());
+    return store;
 }
 
-std::string Settings::GetString(const std::string& key, const std::string& default_value) {
-    if (nvs_handle_ == 0) {
-        return default_value;
+void Settings::ScheduleCommit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (commit_timer_ == nullptr) {
+        esp_timer_create_args_t timer_args = {
+            .callback = [](void* arg) {
+                // NVS writes may erase a flash page, which would hold up every other timer
+                Application::GetInstance().Schedule([]() {
+                    Settings::Flush();
+                });
+            },
+            .arg = nullptr,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "settings_commit",
+            .skip_unhandled_events = true
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &commit_timer_));
+        // Make sure changes still waiting for the timer survive a reboot
+        esp_register_shutdown_handler(&Settings::Flush);
     }
+    esp_timer_stop(commit_timer_);
+    esp_timer_start_once(commit_timer_, SETTINGS_COMMIT_DELAY_MS * 1000);
+}
 
-    size_t length = 0;
-    if (nvs_get_str(nvs_handle_, key.c_str(), nullptr, &length) != ESP_OK) {
-        return default_value;
+void Settings::Flush() {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+
+    // Copy the changes and write them without the cache lock, an NVS commit may erase a
+    // flash page and readers must not wait for it
+    std::map<std::string, Namespace> changes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [ns, store] : namespaces_) {
+            if (!store.erase_all && store.dirty_keys.empty()) {
+                continue;
+            }
+            auto& change = changes[ns];
+            change.erase_all = store.erase_all;
+            for (auto& key : store.dirty_keys) {
+                auto it = store.values.find(key);
+                if (it != store.values.end()) {
+                    change.values[key] = it->second;
+                }
+            }
+            change.dirty_keys = std::move(store.dirty_keys);
+            store.dirty_keys.clear();
+            store.erase_all = false;
+        }
     }
 
-    std::string value;
-    value.resize(length);
-    ESP_ERROR_CHECK(nvs_get_str(nvs_handle_, key.c_str(), value.data(), &length));
-    while (!value.empty() && value.back() == '\0') {
-        value.pop_back();
+    for (auto& [ns, change] : changes) {
+        nvs_handle_t nvs_handle;
+        esp_err_t ret = nvs_open(ns.c_str(), NVS_READWRITE, &nvs_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to open namespace %s: %s", ns.c_str(), esp_err_to_name(ret));
+            continue;
+        }
+
+        if (change.erase_all) {
+            ret = nvs_erase_all(nvs_handle);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to erase namespace %s: %s", ns.c_str(), esp_err_to_name(ret));
+            }
+        }
+
+        for (auto& key : change.dirty_keys) {
+            auto it = change.values.find(key);
+            if (it == change.values.end()) {
+                ret = nvs_erase_key(nvs_handle, key.c_str());
+                if (ret == ESP_ERR_NVS_NOT_FOUND) {
+                    ret = ESP_OK;
+                }
+            } else if (it->second.type == NVS_TYPE_STR) {
+                ret = nvs_set_str(nvs_handle, key.c_str(), it->second.text.c_str());
+            } else if (it->second.type == NVS_TYPE_I32) {
+                ret = nvs_set_i32(nvs_handle, key.c_str(), it->second.number);
+            } else {
+                ret = nvs_set_u8(nvs_handle, key.c_str(), it->second.number ? 1 : 0);
+            }
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to write %s.%s: %s", ns.c_str(), key.c_str(), esp_err_to_name(ret));
+            }
+        }
+
+        ret = nvs_commit(nvs_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to commit namespace %s: %s", ns.c_str(), esp_err_to_name(ret));
+        }
+        nvs_close(nvs_handle);
     }
-    return value;
 }
 
-void Settings::SetString(const std::string& key, const std::string& value) {
-    if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_str(nvs_handle_, key.c_str(), value.c_str()));
-        dirty_ = true;
-    } else {
+void Settings::Invalidate() {
+    // A flush in progress would write its copy over the erased partition
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (commit_timer_ != nullptr) {
+        esp_timer_stop(commit_timer_);
+    }
+    // Keep the entries so that live Settings objects stay valid
+    for (auto& [ns, store] : namespaces_) {
+        store.loaded = false;
+        store.erase_all = false;
+        store.values.clear();
+        store.dirty_keys.clear();
+    }
+}
+
+void Settings::Set(const std::string& key, Value&& value) {
+    if (!read_write_) {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadNamespace(ns_);
+    auto it = store_->values.find(key);
+    if (it != store_->values.end() && it->second.type == value.type &&
+        it->second.number == value.number && it->second.text == value.text) {
+        return;
     }
+    store_->values[key] = std::move(value);
+    store_->dirty_keys.insert(key);
+    dirty_ = true;
 }
 
-int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
-    if (nvs_handle_ == 0) {
+std::string Settings::GetString(const std::string& key, const std::string& default_value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadNamespace(ns_);
+    auto it = store_->values.find(key);
+    if (it == store_->values.end() || it->second.type != NVS_TYPE_STR) {
         return default_value;
     }
+    return it->second.text;
+}
 
-    int32_t value;
-    if (nvs_get_i32(nvs_handle_, key.c_str(), &value) != ESP_OK) {
+void Settings::SetString(const std::string& key, const std::string& value) {
+    Set(key, Value{NVS_TYPE_STR, 0, value});
+}
+
+int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadNamespace(ns_);
+    auto it = store_->values.find(key);
+    if (it == store_->values.end() || it->second.type != NVS_TYPE_I32) {
         return default_value;
     }
-    return value;
+    return it->second.number;
 }
 
 void Settings::SetInt(const std::string& key, int32_t value) {
-    if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_i32(nvs_handle_, key.c_str(), value));
-        dirty_ = true;
-    } else {
-        ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
-    }
+    Set(key, Value{NVS_TYPE_I32, value, ""});
 }
 
 bool Settings::GetBool(const std::string& key, bool default_value) {
-    if (nvs_handle_ == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadNamespace(ns_);
+    auto it = store_->values.find(key);
+    if (it == store_->values.end() || it->second.type != NVS_TYPE_U8) {
         return default_value;
     }
-
-    uint8_t value;
-    if (nvs_get_u8(nvs_handle_, key.c_str(), &value) != ESP_OK) {
-        return default_value;
-    }
-    return value != 0;
+    return it->second.number != 0;
 }
 
 void Settings::SetBool(const std::string& key, bool value) {
-    if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_u8(nvs_handle_, key.c_str(), value ? 1 : 0));
-        dirty_ = true;
-    } else {
-        ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
-    }
+    Set(key, Value{NVS_TYPE_U8, value ? 1 : 0, ""});
 }
 
 void Settings::EraseKey(const std::string& key) {
-    if (read_write_) {
-        auto ret = nvs_erase_key(nvs_handle_, key.c_str());
-        if (ret != ESP_ERR_NVS_NOT_FOUND) {
-            ESP_ERROR_CHECK(ret);
-        }
-    } else {
+    if (!read_write_) {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
+        return;
     }
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadNamespace(ns_);
+    store_->values.erase(key);
+    store_->dirty_keys.insert(key);
+    dirty_ = true;
 }
 
 void Settings::EraseAll() {
-    if (read_write_) {
-        ESP_ERROR_CHECK(nvs_erase_all(nvs_handle_));
-    } else {
+    if (!read_write_) {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
+        return;
     }
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadNamespace(ns_);
+    store_->values.clear();
+    store_->dirty_keys.clear();
+    store_->erase_all = true;
+    dirty_ = true;
 }
@@ -2,8 +2,21 @@
 #define SETTINGS_H
 
 #include <string>
+#include <map>
+#include <set>
+#include <mutex>
 #include <nvs_flash.h>
+#include <esp_timer.h>
 
+// Changes are kept in RAM and written to NVS once no setting was changed for this long
+#define SETTINGS_COMMIT_DELAY_MS 2000
+
+// Each namespace is read from NVS once and then served from a process-wide cache.
+// Writes update the cache immediately and are committed on the main task, or on
+// esp_restart() through a shutdown handler. A panic, watchdog reset or power loss
+// within SETTINGS_COMMIT_DELAY_MS of a write loses it, call Flush() after writes that
+// must survive one. Namespaces written directly through the NVS API by other
+// components are not reloaded until Invalidate() is called.
 class Settings {
 public:
     Settings(const std::string& ns, bool read_write = false);
@@ -18,11 +31,39 @@ public:
     void EraseKey(const std::string& key);
     void EraseAll();
 
+    // Write all pending changes to NVS now
+    static void Flush();
+    // Drop the cache and all pending changes, e.g. after the NVS partition was erased
+    static void Invalidate();
+
 private:
+    struct Value {
+        nvs_type_t type = NVS_TYPE_ANY;
+        int32_t number = 0;
+        std::string text;
+    };
+
+    struct Namespace {
+        bool loaded = false;
+        bool erase_all = false;
+        std::map<std::string, Value> values;
+        std::set<std::string> dirty_keys;   // Removed from values means erased
+    };
+
+    static std::mutex mutex_;
+    // Held for a whole flush so that an older copy of the changes is never written after a newer one
+    static std::mutex flush_mutex_;
+    static std::map<std::string, Namespace> namespaces_;
+    static esp_timer_handle_t commit_timer_;
+
     std::string ns_;
-    nvs_handle_t nvs_handle_ = 0;
+    Namespace* store_ = nullptr;
     bool read_write_ = false;
     bool dirty_ = false;
+
+    static Namespace& LoadNamespace(const std::string& ns);
+    static void ScheduleCommit();
+    void Set(const std::string& key, Value&& value);
 };
 
 #endif
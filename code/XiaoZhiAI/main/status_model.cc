@@ -0,0 +1,206 @@
+#include "status_model.h"
+#include "application.h"
+#include "board.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <ctime>
+
+#define TAG "StatusModel"
+
+StatusModel::StatusModel() {
+    esp_timer_create_args_t poll_timer_args = {
+        .callback = [](void* arg) {
+            auto self = static_cast<StatusModel*>(arg);
+            Application::GetInstance().Schedule([self]() {
+                self->Refresh(kStatusItemBattery | kStatusItemNetwork);
+            });
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "status_poll",
+        .skip_unhandled_events = true
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&poll_timer_args, &poll_timer_));
+
+    esp_timer_create_args_t clock_timer_args = {
+        .callback = [](void* arg) {
+            auto self = static_cast<StatusModel*>(arg);
+            Application::GetInstance().Schedule([self]() {
+                self->Refresh(kStatusItemClock);
+                self->ScheduleClock();
+            });
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "status_clock",
+        .skip_unhandled_events = true
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&clock_timer_args, &clock_timer_));
+
+    // The ADC and the 4G UART need the full APB clock while they are read
+    auto ret = esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "status_poll", &pm_lock_);
+    if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGE(TAG, "Failed to create PM lock: %s", esp_err_to_name(ret));
+    }
+}
+
+StatusModel::~StatusModel() {
+    esp_timer_stop(poll_timer_);
+    esp_timer_delete(poll_timer_);
+    esp_timer_stop(clock_timer_);
+    esp_timer_delete(clock_timer_);
+    if (pm_lock_ != nullptr) {
+        esp_pm_lock_delete(pm_lock_);
+    }
+}
+
+void StatusModel::Subscribe(std::function<void(uint32_t changed, const StatusState& state)> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_.push_back(std::move(callback));
+}
+
+void StatusModel::Start() {
+    esp_timer_start_periodic(poll_timer_, STATUS_POLL_INTERVAL_MS * 1000);
+    ScheduleClock();
+}
+
+StatusState StatusModel::GetState() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+void StatusModel::Refresh(uint32_t items) {
+    uint32_t changed = 0;
+    if (items & (kStatusItemBattery | kStatusItemNetwork)) {
+        if (pm_lock_ != nullptr) {
+            esp_pm_lock_acquire(pm_lock_);
+        }
+        if (items & kStatusItemBattery) {
+            changed |= ReadBattery();
+        }
+        if (items & kStatusItemNetwork) {
+            changed |= ReadNetwork();
+        }
+        if (pm_lock_ != nullptr) {
+            esp_pm_lock_release(pm_lock_);
+        }
+    }
+    if (items & kStatusItemClock) {
+        changed |= ReadClock();
+    }
+    if (items & kStatusItemMute) {
+        auto codec = Board::GetInstance().GetAudioCodec();
+        if (codec != nullptr) {
+            SetMuted(codec->output_volume() == 0);
+        }
+    }
+    Publish(changed);
+}
+
+void StatusModel::SetMuted(bool muted) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_.muted == muted) {
+            return;
+        }
+        state_.muted = muted;
+    }
+    Publish(kStatusItemMute);
+}
+
+void StatusModel::RefreshClockAfter(int delay_ms) {
+    // The latest request wins, it belongs to the status text shown last
+    std::lock_guard<std::mutex> lock(mutex_);
+    clock_request_us_ = esp_timer_get_time() + delay_ms * 1000LL;
+    ScheduleClockLocked();
+}
+
+uint32_t StatusModel::ReadBattery() {
+    StatusState battery;
+    battery.has_battery = Board::GetInstance().GetBatteryLevel(battery.battery_level, battery.charging, battery.discharging);
+    battery.battery_level = std::clamp(battery.battery_level, 0, 100);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (battery.has_battery == state_.has_battery && battery.battery_level == state_.battery_level &&
+        battery.charging == state_.charging && battery.discharging == state_.discharging) {
+        return 0;
+    }
+    state_.has_battery = battery.has_battery;
+    state_.battery_level = battery.battery_level;
+    state_.charging = battery.charging;
+    state_.discharging = battery.discharging;
+    return kStatusItemBattery;
+}
+
+uint32_t StatusModel::ReadNetwork() {
+    // Don't read 4G network status during firmware upgrade or a conversation to avoid occupying UART resources
+    auto device_state = Application::GetInstance().GetDeviceState();
+    static const DeviceState allowed_states[] = {
+        kDeviceStateIdle,
+        kDeviceStateStarting,
+        kDeviceStateWifiConfiguring,
+        kDeviceStateListening,
+        kDeviceStateActivating,
+    };
+    if (std::find(std::begin(allowed_states), std::end(allowed_states), device_state) == std::end(allowed_states)) {
+        return 0;
+    }
+
+    auto icon = Board::GetInstance().GetNetworkStateIcon();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (icon == nullptr || icon == state_.network_icon) {
+        return 0;
+    }
+    state_.network_icon = icon;
+    return kStatusItemNetwork;
+}
+
+uint32_t StatusModel::ReadClock() {
+    time_t now = time(NULL);
+    struct tm* tm = localtime(&now);
+    std::string clock;
+    // Check if the we have already set the time
+    if (tm->tm_year >= 2025 - 1900) {
+        char time_str[16];
+        strftime(time_str, sizeof(time_str), "%H:%M", tm);
+        clock = time_str;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    state_.clock = clock;
+    // Delivered on every tick of its own schedule, subscribers decide whether to show it
+    return kStatusItemClock;
+}
+
+void StatusModel::ScheduleClock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScheduleClockLocked();
+}
+
+void StatusModel::ScheduleClockLocked() {
+    // Wake up right after the next minute boundary, or earlier for a pending request
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = now_us + ((60 - time(NULL) % 60) * 1000 + 50) * 1000LL;
+    if (clock_request_us_ > now_us && clock_request_us_ < next_us) {
+        next_us = clock_request_us_;
+    }
+    esp_timer_stop(clock_timer_);
+    esp_timer_start_once(clock_timer_, next_us - now_us);
+}
+
+void StatusModel::Publish(uint32_t changed) {
+    if (changed == 0) {
+        return;
+    }
+    std::vector<std::function<void(uint32_t, const StatusState&)>> subscribers;
+    StatusState state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers = subscribers_;
+        state = state_;
+    }
+    for (auto& subscriber : subscribers) {
+        subscriber(changed, state);
+    }
+}
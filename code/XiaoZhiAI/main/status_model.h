@@ -0,0 +1,85 @@
+#ifndef STATUS_MODEL_H
+#define STATUS_MODEL_H
+
+#include <esp_timer.h>
+#include <esp_pm.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Battery and network have no change notification on most boards and are polled at this rate
+#define STATUS_POLL_INTERVAL_MS 10000
+// A status text stays this long before the clock replaces it in idle
+#define STATUS_TEXT_HOLD_MS 10000
+
+enum StatusItem : uint32_t {
+    kStatusItemMute = 1 << 0,
+    kStatusItemBattery = 1 << 1,
+    kStatusItemNetwork = 1 << 2,
+    kStatusItemClock = 1 << 3,
+    kStatusItemAll = kStatusItemMute | kStatusItemBattery | kStatusItemNetwork | kStatusItemClock,
+};
+
+struct StatusState {
+    bool muted = false;
+    bool has_battery = false;
+    int battery_level = 0;
+    bool charging = false;
+    bool discharging = false;
+    const char* network_icon = nullptr;
+    std::string clock;      // "HH:MM", empty until the system time is set
+};
+
+/*
+ * Values shown in the status bar. Each source updates its item on a real transition
+ * (mute, network connect) or on its own schedule (battery and network polling, clock on
+ * minute boundaries), and subscribers are told which items changed, so the display only
+ * redraws those and the CPU is not woken every second for nothing. Sources are read on
+ * the main task, which keeps slow reads like 4G AT commands off the timer task.
+ */
+class StatusModel {
+public:
+    static StatusModel& GetInstance() {
+        static StatusModel instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    StatusModel(const StatusModel&) = delete;
+    StatusModel& operator=(const StatusModel&) = delete;
+
+    // Callbacks run on the task that published the change
+    void Subscribe(std::function<void(uint32_t changed, const StatusState& state)> callback);
+    void Start();
+
+    // Re-read the given items now, subscribers are notified of the ones that changed
+    void Refresh(uint32_t items);
+    // Push a mute change from the codec
+    void SetMuted(bool muted);
+    // Deliver a clock update after the delay, e.g. once a status text has been shown long enough
+    void RefreshClockAfter(int delay_ms);
+
+    StatusState GetState();
+
+private:
+    StatusModel();
+    ~StatusModel();
+
+    std::mutex mutex_;
+    StatusState state_;
+    std::vector<std::function<void(uint32_t, const StatusState&)>> subscribers_;
+    esp_timer_handle_t poll_timer_ = nullptr;
+    esp_timer_handle_t clock_timer_ = nullptr;
+    esp_pm_lock_handle_t pm_lock_ = nullptr;
+    int64_t clock_request_us_ = 0;
+
+    uint32_t ReadBattery();
+    uint32_t ReadNetwork();
+    uint32_t ReadClock();
+    void ScheduleClock();
+    void ScheduleClockLocked();
+    void Publish(uint32_t changed);
+};
+
+#endif // STATUS_MODEL_H
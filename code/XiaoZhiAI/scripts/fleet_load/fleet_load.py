@@ -0,0 +1,424 @@
+# 设备集群压测工具
+# 以固件相同的 WebSocket 协议模拟 N 台设备：hello 握手、开始监听、按 60ms 节拍上传 P3 中的 Opus 包、
+# 应答 MCP initialize / tools/list / tools/call，并统计每个会话的延迟与吞吐。
+# 另提供 serve 子命令作为本地替身服务器，便于脱离云端在单机上回归测试；
+# frames 子命令输出设备发送的各帧，host/tests/test_fleet_frames 用它与固件逐字节比对。
+import argparse
+import asyncio
+import json
+import random
+import struct
+import time
+import sys
+import uuid
+
+try:
+    import websockets
+except ImportError:
+    # frames 子命令不需要 websockets
+    websockets = None
+
+OPUS_FRAME_DURATION_MS = 60
+HELLO_TIMEOUT_S = 10
+
+
+def load_p3_packets(path):
+    """
+    读取p3格式文件中的Opus包
+    p3格式: [1字节类型, 1字节保留, 2字节长度, Opus数据]
+    """
+    packets = []
+    with open(path, 'rb') as f:
+        while True:
+            header = f.read(4)
+            if len(header) < 4:
+                break
+            _, _, data_len = struct.unpack('>BBH', header)
+            data = f.read(data_len)
+            if len(data) < data_len:
+                break
+            packets.append(data)
+    return packets
+
+
+def pack_audio(version, payload, timestamp):
+    """与 WebsocketProtocol::SendAudio 相同的二进制封装"""
+    if version == 2:
+        # BinaryProtocol2: version, type, reserved, timestamp, payload_size (网络字节序)
+        return struct.pack('>HHIII', version, 0, 0, timestamp, len(payload)) + payload
+    if version == 3:
+        # BinaryProtocol3: type, reserved, payload_size
+        return struct.pack('>BBH', 0, 0, len(payload)) + payload
+    return payload
+
+
+def to_json(message):
+    """与固件 cJSON_PrintUnformatted 相同的紧凑格式"""
+    return json.dumps(message, separators=(',', ':'))
+
+
+def hello_message(version, features):
+    """与 WebsocketProtocol::GetHelloMessage 相同的 hello 消息, features 为固件开启的可选特性"""
+    # 键的顺序与固件一致: aec 在 mcp 之前, vad_gate 在 mcp 之后
+    feature_flags = {}
+    if "aec" in features:
+        feature_flags["aec"] = True
+    feature_flags["mcp"] = True
+    if "vad_gate" in features:
+        feature_flags["vad_gate"] = True
+    return to_json({
+        "type": "hello",
+        "version": version,
+        "features": feature_flags,
+        "transport": "websocket",
+        "audio_params": {"format": "opus", "sample_rate": 16000, "channels": 1,
+                         "frame_duration": OPUS_FRAME_DURATION_MS},
+    })
+
+
+def listen_message(session_id, state):
+    """与 Protocol::SendStartListening(kListeningModeManualStop) / SendStopListening 相同"""
+    message = {"session_id": session_id, "type": "listen", "state": state}
+    if state == "start":
+        message["mode"] = "manual"
+    return to_json(message)
+
+
+def unpack_audio(version, data):
+    if version == 2:
+        _, _, _, _, size = struct.unpack('>HHIII', data[:16])
+        return data[16:16 + size]
+    if version == 3:
+        _, _, size = struct.unpack('>BBH', data[:4])
+        return data[4:4 + size]
+    return data
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    values = sorted(values)
+    k = (len(values) - 1) * p / 100
+    lo = int(k)
+    hi = min(lo + 1, len(values) - 1)
+    return values[lo] + (values[hi] - values[lo]) * (k - lo)
+
+
+# 与 McpServer 回复格式一致的工具列表，供服务器 tools/list 使用
+FAKE_TOOLS = [
+    {
+        "name": "self.get_device_status",
+        "description": "Provides the real-time information of the device.",
+        "inputSchema": {"type": "object", "properties": {}},
+    },
+    {
+        "name": "self.audio_speaker.set_volume",
+        "description": "Set the volume of the audio speaker.",
+        "inputSchema": {
+            "type": "object",
+            "properties": {"volume": {"type": "integer", "minimum": 0, "maximum": 100}},
+            "required": ["volume"],
+        },
+    },
+]
+
+
+class SessionStats:
+    def __init__(self, index):
+        self.index = index
+        self.connect_ms = None      # TCP/TLS + WebSocket 升级
+        self.hello_ms = None        # 发送 hello 到收到服务器 hello
+        self.response_ms = []       # 每轮停止监听到首个 tts start 或音频包
+        self.mcp_replies = 0
+        self.bytes_up = 0
+        self.bytes_down = 0
+        self.packets_up = 0
+        self.packets_down = 0
+        self.error = None
+
+
+class FakeDevice:
+    def __init__(self, index, args, packets):
+        self.index = index
+        self.args = args
+        self.packets = packets
+        self.stats = SessionStats(index)
+        self.session_id = ""
+        self.ws = None
+        self.server_hello = asyncio.Event()
+        self.first_response = None
+        self.tts_stopped = asyncio.Event()
+
+    def headers(self):
+        mac = "02:%02x:%02x:%02x:%02x:%02x" % (
+            (self.index >> 24) & 0xff, (self.index >> 16) & 0xff,
+            (self.index >> 8) & 0xff, self.index & 0xff, random.randint(0, 255))
+        return {
+            "Authorization": "Bearer " + self.args.token,
+            "Protocol-Version": str(self.args.protocol_version),
+            "Device-Id": mac,
+            "Client-Id": str(uuid.uuid4()),
+        }
+
+    async def send_text(self, text):
+        self.stats.bytes_up += len(text)
+        await self.ws.send(text)
+
+    async def send_mcp(self, payload):
+        await self.send_text(to_json({"session_id": self.session_id, "type": "mcp", "payload": payload}))
+        self.stats.mcp_replies += 1
+
+    async def handle_mcp(self, payload):
+        method = payload.get("method")
+        rpc_id = payload.get("id")
+        if rpc_id is None:
+            return
+        if method == "initialize":
+            result = {
+                "protocolVersion": "2024-11-05",
+                "capabilities": {"tools": {}},
+                "serverInfo": {"name": "fleet-load", "version": "1.0.0"},
+            }
+        elif method == "tools/list":
+            result = {"tools": FAKE_TOOLS}
+        elif method == "tools/call":
+            result = {"content": [{"type": "text", "text": "true"}], "isError": False}
+        else:
+            await self.send_mcp({"jsonrpc": "2.0", "id": rpc_id,
+                                 "error": {"message": "Method not implemented: " + str(method)}})
+            return
+        await self.send_mcp({"jsonrpc": "2.0", "id": rpc_id, "result": result})
+
+    async def receive_loop(self):
+        async for message in self.ws:
+            if isinstance(message, bytes):
+                self.stats.bytes_down += len(message)
+                self.stats.packets_down += 1
+                if self.first_response is not None and not self.first_response.done():
+                    self.first_response.set_result(time.perf_counter())
+                continue
+            self.stats.bytes_down += len(message)
+            root = json.loads(message)
+            msg_type = root.get("type")
+            if msg_type == "hello":
+                self.session_id = root.get("session_id", "")
+                self.server_hello.set()
+            elif msg_type == "mcp":
+                await self.handle_mcp(root.get("payload", {}))
+            elif msg_type == "tts":
+                state = root.get("state")
+                if state == "start":
+                    if self.first_response is not None and not self.first_response.done():
+                        self.first_response.set_result(time.perf_counter())
+                elif state == "stop":
+                    self.tts_stopped.set()
+
+    async def run_turn(self):
+        loop = asyncio.get_running_loop()
+        self.first_response = loop.create_future()
+        self.tts_stopped.clear()
+        await self.send_text(listen_message(self.session_id, "start"))
+
+        # 按固件的帧节拍发送，避免突发写入掩盖服务器的真实处理能力
+        start = time.perf_counter()
+        for i, payload in enumerate(self.packets):
+            timestamp = i * OPUS_FRAME_DURATION_MS
+            data = pack_audio(self.args.protocol_version, payload, timestamp)
+            await self.ws.send(data)
+            self.stats.bytes_up += len(data)
+            self.stats.packets_up += 1
+            delay = start + (i + 1) * OPUS_FRAME_DURATION_MS / 1000 - time.perf_counter()
+            if delay > 0:
+                await asyncio.sleep(delay)
+
+        await self.send_text(listen_message(self.session_id, "stop"))
+        stop_time = time.perf_counter()
+        try:
+            responded = await asyncio.wait_for(self.first_response, self.args.response_timeout)
+            self.stats.response_ms.append((responded - stop_time) * 1000)
+            await asyncio.wait_for(self.tts_stopped.wait(), self.args.response_timeout)
+        except asyncio.TimeoutError:
+            self.stats.error = "response timeout"
+
+    async def run(self):
+        try:
+            begin = time.perf_counter()
+            self.ws = await websockets.connect(self.args.url, additional_headers=self.headers(),
+                                               max_size=None)
+            self.stats.connect_ms = (time.perf_counter() - begin) * 1000
+        except Exception as e:
+            self.stats.error = "connect failed: %s" % e
+            return self.stats
+
+        receiver = asyncio.create_task(self.receive_loop())
+        try:
+            begin = time.perf_counter()
+            await self.send_text(hello_message(self.args.protocol_version, self.args.feature))
+            await asyncio.wait_for(self.server_hello.wait(), HELLO_TIMEOUT_S)
+            self.stats.hello_ms = (time.perf_counter() - begin) * 1000
+
+            for _ in range(self.args.turns):
+                await self.run_turn()
+                if self.stats.error:
+                    break
+        except asyncio.TimeoutError:
+            self.stats.error = "server hello timeout"
+        except websockets.ConnectionClosed as e:
+            self.stats.error = "connection closed: %s" % e
+        finally:
+            receiver.cancel()
+            await self.ws.close()
+        return self.stats
+
+
+def print_frames(args):
+    """按发送顺序输出一轮对话中设备发出的各帧: 请求头、文本消息原文、二进制帧的十六进制"""
+    packets = load_p3_packets(args.audio)
+    out = sys.stdout
+    out.write("header Authorization: Bearer %s\n" % args.token)
+    out.write("header Protocol-Version: %d\n" % args.protocol_version)
+    out.write("text %s\n" % hello_message(args.protocol_version, args.feature))
+    out.write("text %s\n" % listen_message(args.session_id, "start"))
+    for i, payload in enumerate(packets):
+        out.write("binary %s\n" % pack_audio(args.protocol_version, payload, i * OPUS_FRAME_DURATION_MS).hex())
+    out.write("text %s\n" % listen_message(args.session_id, "stop"))
+
+
+def print_report(stats, elapsed):
+    ok = [s for s in stats if s.error is None]
+    print("\n会话: %d 成功 / %d 失败, 总耗时 %.1fs" % (len(ok), len(stats) - len(ok), elapsed))
+
+    def row(name, values):
+        if not values:
+            print("  %-12s -" % name)
+            return
+        print("  %-12s p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f ms" % (
+            name, percentile(values, 50), percentile(values, 90), percentile(values, 99), max(values)))
+
+    row("connect", [s.connect_ms for s in stats if s.connect_ms is not None])
+    row("hello", [s.hello_ms for s in stats if s.hello_ms is not None])
+    row("response", [v for s in stats for v in s.response_ms])
+
+    bytes_up = sum(s.bytes_up for s in stats)
+    bytes_down = sum(s.bytes_down for s in stats)
+    print("  上行 %d 包 %.1f KB/s, 下行 %d 包 %.1f KB/s, MCP 应答 %d" % (
+        sum(s.packets_up for s in stats), bytes_up / 1024 / elapsed,
+        sum(s.packets_down for s in stats), bytes_down / 1024 / elapsed,
+        sum(s.mcp_replies for s in stats)))
+
+    errors = {}
+    for s in stats:
+        if s.error:
+            errors[s.error] = errors.get(s.error, 0) + 1
+    for error, count in errors.items():
+        print("  错误 x%d: %s" % (count, error))
+
+
+async def run_fleet(args):
+    if args.audio:
+        packets = load_p3_packets(args.audio)
+    else:
+        # 没有音频文件时用随机负载，只压测传输层（真实服务器会解码失败）
+        packets = [random.randbytes(args.packet_size) for _ in range(args.packets)]
+    if not packets:
+        raise SystemExit("音频文件中没有可用的 Opus 包")
+
+    devices = [FakeDevice(i, args, packets) for i in range(args.devices)]
+    tasks = []
+    begin = time.perf_counter()
+    for device in devices:
+        tasks.append(asyncio.create_task(device.run()))
+        # 按设定的速率逐台上线，模拟真实的连接爬坡
+        if args.ramp > 0:
+            await asyncio.sleep(1 / args.ramp)
+    stats = await asyncio.gather(*tasks)
+    print_report(stats, time.perf_counter() - begin)
+
+
+async def serve_session(ws, args):
+    """本地替身服务器：回应 hello，探测 MCP，停止监听后回放收到的音频"""
+    version = int(ws.request.headers.get("Protocol-Version", "1"))
+    session_id = uuid.uuid4().hex[:8]
+    uplink = []
+    rpc_id = 0
+
+    async for message in ws:
+        if isinstance(message, bytes):
+            uplink.append(unpack_audio(version, message))
+            continue
+        root = json.loads(message)
+        msg_type = root.get("type")
+        if msg_type == "hello":
+            await ws.send(json.dumps({
+                "type": "hello", "transport": "websocket", "session_id": session_id,
+                "audio_params": {"format": "opus", "sample_rate": 24000, "channels": 1,
+                                 "frame_duration": OPUS_FRAME_DURATION_MS},
+            }))
+            if root.get("features", {}).get("mcp"):
+                for method in ("initialize", "tools/list"):
+                    rpc_id += 1
+                    await ws.send(json.dumps({"session_id": session_id, "type": "mcp", "payload": {
+                        "jsonrpc": "2.0", "method": method, "id": rpc_id, "params": {}}}))
+        elif msg_type == "listen" and root.get("state") == "start":
+            uplink.clear()
+        elif msg_type == "listen" and root.get("state") == "stop":
+            await asyncio.sleep(args.think_ms / 1000)
+            await ws.send(json.dumps({"session_id": session_id, "type": "stt", "text": "fleet load"}))
+            await ws.send(json.dumps({"session_id": session_id, "type": "tts", "state": "start"}))
+            for i, payload in enumerate(uplink[:args.reply_packets]):
+                await ws.send(pack_audio(version, payload, i * OPUS_FRAME_DURATION_MS))
+            await ws.send(json.dumps({"session_id": session_id, "type": "tts", "state": "stop"}))
+
+
+async def run_server(args):
+    async with websockets.serve(lambda ws: serve_session(ws, args), args.host, args.port, max_size=None):
+        print(f"替身服务器已启动: ws://{args.host}:{args.port}")
+        await asyncio.Future()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='小智设备集群压测工具')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    run = sub.add_parser('run', help='模拟多台设备连接服务器')
+    run.add_argument('url', help='WebSocket 服务器地址, 例如 ws://127.0.0.1:8765')
+    run.add_argument('-n', '--devices', type=int, default=10, help='模拟设备数量')
+    run.add_argument('-t', '--turns', type=int, default=3, help='每台设备的对话轮数')
+    run.add_argument('-a', '--audio', help='上行音频 p3 文件')
+    run.add_argument('--packets', type=int, default=50, help='无音频文件时每轮发送的包数')
+    run.add_argument('--packet-size', type=int, default=60, help='无音频文件时每包字节数')
+    run.add_argument('--token', default='test-token', help='Authorization 令牌')
+    run.add_argument('--protocol-version', type=int, default=1, choices=[1, 2, 3], help='二进制协议版本')
+    run.add_argument('--ramp', type=float, default=20, help='每秒新建的连接数, 0 表示同时连接')
+    run.add_argument('--response-timeout', type=float, default=15, help='等待服务器回复的超时秒数')
+    run.add_argument('--feature', action='append', default=[], choices=['aec', 'vad_gate'],
+                     help='固件开启的可选特性, 写入 hello 的 features, 可重复')
+
+    serve = sub.add_parser('serve', help='启动本地替身服务器')
+    serve.add_argument('--host', default='127.0.0.1')
+    serve.add_argument('--port', type=int, default=8765)
+    serve.add_argument('--think-ms', type=int, default=200, help='停止监听到开始回复的模拟延迟')
+    serve.add_argument('--reply-packets', type=int, default=20, help='回放给设备的音频包数')
+
+    frames = sub.add_parser('frames', help='输出一台设备一轮对话发出的各帧, 供主机测试比对')
+    frames.add_argument('-a', '--audio', required=True, help='上行音频 p3 文件')
+    frames.add_argument('--session-id', default='', help='服务器 hello 中的 session_id')
+    frames.add_argument('--token', default='test-token', help='Authorization 令牌')
+    frames.add_argument('--protocol-version', type=int, default=1, choices=[1, 2, 3], help='二进制协议版本')
+    frames.add_argument('--feature', action='append', default=[], choices=['aec', 'vad_gate'],
+                        help='固件开启的可选特性, 可重复')
+
+    args = parser.parse_args()
+    if args.command == 'frames':
+        print_frames(args)
+        return
+    if websockets is None:
+        raise SystemExit("缺少 websockets, 请先执行 pip install -r requirements.txt")
+    try:
+        asyncio.run(run_fleet(args) if args.command == 'run' else run_server(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
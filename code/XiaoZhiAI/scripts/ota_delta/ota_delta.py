@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+# 固件差分升级工具
+# diff:  根据设备上运行的旧固件和新固件生成差分包（XZD1 格式），由设备端 Ota::UpgradeDelta 流式应用
+# apply: 在主机上应用差分包，校验结果与新固件逐字节一致，用于发布前验证
+#
+# 差分包格式（小端）：
+#   头部 80 字节: "XZD1", chunk_size(u32), source_size(u32), source_sha256[32], target_size(u32), target_sha256[32]
+#   分块序列:     payload_size(u32), raw_size(u32), payload
+#                 payload_size < raw_size 时 payload 为 LZ4 block，相等时为原始数据
+#   分块解压后是 bsdiff 风格的记录，每条记录不跨分块:
+#                 diff_len(varint), extra_len(varint), seek(zigzag varint), diff[diff_len], extra[extra_len]
+#                 新固件 = 旧固件[pos, pos+diff_len) 逐字节加 diff，再接 extra；之后 pos += diff_len + seek
+#
+# 安装了 bsdiff4 / lz4 时使用它们，否则使用脚本内置的纯 Python 实现（较慢，但结果格式相同）。
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b'XZD1'
+HEADER_FORMAT = '<4sII32sI32s'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+CHUNK_HEADER_FORMAT = '<II'
+CHUNK_HEADER_SIZE = struct.calcsize(CHUNK_HEADER_FORMAT)
+DEFAULT_CHUNK_SIZE = 16 * 1024
+MAX_CHUNK_SIZE = 64 * 1024      # 与 OTA_DELTA_MAX_CHUNK_SIZE 一致
+MAX_RECORD_HEADER_SIZE = 15     # 3 个 varint, 每个最多 5 字节
+
+SEED_SIZE = 16
+SEED_STEP = 4
+
+
+# ---------------------------------------------------------------- LZ4 block
+
+def lz4_compress(data):
+    try:
+        import lz4.block
+        return lz4.block.compress(data, store_size=False)
+    except ImportError:
+        pass
+
+    # 贪心匹配，遵守 LZ4 的结尾规则: 最后 5 字节必须是字面量，最后一个匹配在结尾 12 字节之前开始
+    n = len(data)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    match_limit = n - 12
+    while i < match_limit:
+        key = data[i:i + 4]
+        candidate = table.get(key)
+        table[key] = i
+        if candidate is None or i - candidate > 0xFFFF:
+            i += 1
+            continue
+        length = 4
+        while i + length < n - 5 and data[candidate + length] == data[i + length]:
+            length += 1
+        _lz4_sequence(out, data[anchor:i], i - candidate, length)
+        i += length
+        anchor = i
+    _lz4_sequence(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+
+def _lz4_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def _lz4_sequence(out, literals, offset, match_length):
+    literal_length = len(literals)
+    token_match = 0
+    if match_length:
+        token_match = min(match_length - 4, 15)
+    out.append((min(literal_length, 15) << 4) | token_match)
+    if literal_length >= 15:
+        _lz4_length(out, literal_length - 15)
+    out += literals
+    if match_length:
+        out += struct.pack('<H', offset)
+        if match_length - 4 >= 15:
+            _lz4_length(out, match_length - 4 - 15)
+
+
+def lz4_decompress(data, raw_size):
+    try:
+        import lz4.block
+        return lz4.block.decompress(data, uncompressed_size=raw_size)
+    except ImportError:
+        pass
+
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        token = data[i]
+        i += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                length += data[i]
+                i += 1
+                if data[i - 1] != 255:
+                    break
+        out += data[i:i + length]
+        i += length
+        if i >= len(data):
+            break
+        offset = data[i] | (data[i + 1] << 8)
+        i += 2
+        length = token & 0x0F
+        if length == 15:
+            while True:
+                length += data[i]
+                i += 1
+                if data[i - 1] != 255:
+                    break
+        length += 4
+        start = len(out) - offset
+        for k in range(length):
+            out.append(out[start + k])
+    if len(out) != raw_size:
+        raise ValueError('LZ4 块解压长度不符')
+    return bytes(out)
+
+
+# ---------------------------------------------------------------- 差分
+
+def bsdiff_control(source, target):
+    """返回 bsdiff 风格的控制三元组 [(diff_len, extra_len, seek)]"""
+    try:
+        import bsdiff4.core
+        control, _, _ = bsdiff4.core.diff(source, target)
+        return [tuple(c) for c in control]
+    except ImportError:
+        pass
+
+    index = {}
+    for s in range(len(source) - SEED_SIZE, -1, -SEED_STEP):
+        index[source[s:s + SEED_SIZE]] = s
+
+    control = []
+    t = 0
+    s = 0
+    while t < len(target):
+        length = approximate_match(source, target, s, t)
+        extra_start = t + length
+        j = extra_start
+        next_s = None
+        while j + SEED_SIZE <= len(target):
+            next_s = index.get(target[j:j + SEED_SIZE])
+            if next_s is not None:
+                break
+            j += 1
+        if next_s is None:
+            j = len(target)
+            next_s = s + length
+        control.append((length, j - extra_start, next_s - (s + length)))
+        t = j
+        s = next_s
+    return control
+
+
+def approximate_match(source, target, s, t):
+    """从 source[s] / target[t] 开始的近似匹配长度，与 bsdiff 相同取 2*相同字节数-长度 最大处"""
+    if s < 0:
+        return 0
+    limit = min(len(source) - s, len(target) - t)
+    score = 0
+    best_score = 0
+    best_length = 0
+    k = 0
+    while k < limit and k - best_length <= 64:
+        score += 1 if source[s + k] == target[t + k] else -1
+        k += 1
+        if score > best_score:
+            best_score = score
+            best_length = k
+    return best_length
+
+
+def encode_varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def build_records(source, target, control, chunk_size):
+    """把控制三元组编码为记录，并按分块大小拆分，返回各分块的原始数据"""
+    chunks = []
+    current = bytearray()
+    s = 0
+    t = 0
+    for diff_len, extra_len, seek in control:
+        while True:
+            room = chunk_size - len(current) - MAX_RECORD_HEADER_SIZE
+            if room <= 0:
+                chunks.append(bytes(current))
+                current = bytearray()
+                continue
+            take_diff = min(diff_len, room)
+            take_extra = min(extra_len, room - take_diff) if take_diff == diff_len else 0
+            last = take_diff == diff_len and take_extra == extra_len
+            record_seek = seek if last else 0
+
+            current += encode_varint(take_diff)
+            current += encode_varint(take_extra)
+            current += encode_varint(zigzag(record_seek))
+            current += bytes((target[t + k] - source[s + k]) & 0xFF for k in range(take_diff))
+            current += target[t + take_diff:t + take_diff + take_extra]
+            s += take_diff + record_seek
+            t += take_diff + take_extra
+            diff_len -= take_diff
+            extra_len -= take_extra
+            if last:
+                break
+    if current:
+        chunks.append(bytes(current))
+    if t != len(target):
+        raise ValueError('控制数据没有覆盖整个新固件')
+    return chunks
+
+
+def make_patch(source, target, chunk_size):
+    control = bsdiff_control(source, target)
+    out = bytearray(struct.pack(HEADER_FORMAT, MAGIC, chunk_size,
+                                len(source), hashlib.sha256(source).digest(),
+                                len(target), hashlib.sha256(target).digest()))
+    for raw in build_records(source, target, control, chunk_size):
+        compressed = lz4_compress(raw)
+        payload = compressed if len(compressed) < len(raw) else raw
+        out += struct.pack(CHUNK_HEADER_FORMAT, len(payload), len(raw))
+        out += payload
+    return bytes(out)
+
+
+# ---------------------------------------------------------------- 应用
+
+def decode_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def apply_patch(source, patch):
+    magic, chunk_size, source_size, source_sha256, target_size, target_sha256 = \
+        struct.unpack_from(HEADER_FORMAT, patch)
+    if magic != MAGIC:
+        raise ValueError('不是 XZD1 差分包')
+    if hashlib.sha256(source[:source_size]).digest() != source_sha256:
+        raise ValueError('旧固件与差分包不匹配')
+
+    target = bytearray()
+    s = 0
+    pos = HEADER_SIZE
+    while pos < len(patch):
+        payload_size, raw_size = struct.unpack_from(CHUNK_HEADER_FORMAT, patch, pos)
+        pos += CHUNK_HEADER_SIZE
+        payload = patch[pos:pos + payload_size]
+        pos += payload_size
+        raw = payload if payload_size == raw_size else lz4_decompress(payload, raw_size)
+
+        i = 0
+        while i < len(raw):
+            diff_len, i = decode_varint(raw, i)
+            extra_len, i = decode_varint(raw, i)
+            seek, i = decode_varint(raw, i)
+            seek = (seek >> 1) ^ -(seek & 1)
+            target += bytes((source[s + k] + raw[i + k]) & 0xFF for k in range(diff_len))
+            i += diff_len
+            target += raw[i:i + extra_len]
+            i += extra_len
+            s += diff_len + seek
+
+    if len(target) != target_size or hashlib.sha256(target).digest() != target_sha256:
+        raise ValueError('应用结果校验失败')
+    return bytes(target)
+
+
+def read_file(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='小智固件差分升级工具')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    diff = sub.add_parser('diff', help='生成差分包，并在主机上应用一次确认结果一致')
+    diff.add_argument('source', help='设备上正在运行的固件 (xiaozhi.bin)')
+    diff.add_argument('target', help='新固件')
+    diff.add_argument('patch', help='输出的差分包')
+    diff.add_argument('--chunk-size', type=int, default=DEFAULT_CHUNK_SIZE,
+                      help=f'分块大小，决定设备端的内存占用，最大 {MAX_CHUNK_SIZE}')
+
+    apply = sub.add_parser('apply', help='应用差分包')
+    apply.add_argument('source')
+    apply.add_argument('patch')
+    apply.add_argument('target', help='输出的新固件')
+
+    args = parser.parse_args()
+    if args.command == 'diff':
+        if not 256 <= args.chunk_size <= MAX_CHUNK_SIZE:
+            sys.exit(f'分块大小必须在 256 到 {MAX_CHUNK_SIZE} 之间')
+        source = read_file(args.source)
+        target = read_file(args.target)
+        patch = make_patch(source, target, args.chunk_size)
+        if apply_patch(source, patch) != target:
+            sys.exit('差分包验证失败')
+        with open(args.patch, 'wb') as f:
+            f.write(patch)
+        print(f'{args.patch}: {len(patch)} 字节, 新固件 {len(target)} 字节 ({len(patch) * 100 / len(target):.1f}%)')
+    else:
+        target = apply_patch(read_file(args.source), read_file(args.patch))
+        with open(args.target, 'wb') as f:
+            f.write(target)
+        print(f'{args.target}: {len(target)} 字节, 校验通过')
+
+
+if __name__ == "__main__":
+    main()
@@ -276,10 +276,11 @@ def process_board_collection(target_board_dir, res_path, assets_dir):
     
     return emoji_collection, icon_collection, layout_json
 
-def generate_index_json(assets_dir, srmodels, text_font, emoji_collection, icon_collection, layout_json):
+def generate_index_json(assets_dir, srmodels, text_font, emoji_collection, icon_collection, layout_json, compress):
     """Generate index.json file"""
     index_data = {
-        "version": 1
+        # Version 2 may contain compressed assets, which older firmware rejects by the version
+        "version": 2 if compress else 1
     }
     
     if srmodels:
@@ -305,7 +306,7 @@ def generate_index_json(assets_dir, srmodels, text_font, emoji_collection, icon_
     print(f"Generated: {index_path}")
 
 
-def generate_config_json(build_dir, assets_dir):
+def generate_config_json(build_dir, assets_dir, compress):
     """Generate config.json file"""
     # Get absolute path of current working directory
     workspace_dir = os.path.abspath(os.path.join(os.path.dirname(__file__)))
@@ -325,7 +326,8 @@ def generate_config_json(build_dir, assets_dir):
         "support_sqoi": False,
         "support_raw": False,
         "support_raw_dither": False,
-        "support_raw_bgr": False
+        "support_raw_bgr": False,
+        "compress": compress
     }
     
     # Write config.json
@@ -345,6 +347,8 @@ def main():
 
     parser.add_argument('--res_path', help='Path to res directory')
     parser.add_argument('--target_board', help='Path to target board directory')
+    parser.add_argument('--compress', nargs='+', default=[], metavar='PATTERN',
+                        help='LZ4 compress the assets matching these file name patterns, e.g. srmodels.bin "*.bin"')
     
     args = parser.parse_args()
     
@@ -375,10 +379,10 @@ def main():
         layout_json = []
     
     # Generate index.json
-    generate_index_json(assets_dir, srmodels, text_font, emoji_collection, icon_collection, layout_json)
+    generate_index_json(assets_dir, srmodels, text_font, emoji_collection, icon_collection, layout_json, args.compress)
     
     # Generate config.json
-    config_path = generate_config_json(build_dir, assets_dir)
+    config_path = generate_config_json(build_dir, assets_dir, args.compress)
     
     # Use spiffs_assets_gen.py to package final build/assets.bin
     try:
@@ -2,6 +2,7 @@
 # SPDX-License-Identifier: Apache-2.0
 import io
 import os
+import fnmatch
 import argparse
 import json
 import shutil
@@ -22,6 +23,10 @@ from packaging import version
 
 sys.dont_write_bytecode = True
 
+# Shared with the delta OTA tool, the device decodes both with the same LZ4 block decoder
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'ota_delta'))
+from ota_delta import lz4_compress
+
 GREEN = '\033[1;32m'
 RED = '\033[1;31m'
 RESET = '\033[0m'
@@ -45,6 +50,7 @@ class PackModelsConfig:
     image_file: str
     assets_path: str
     name_length: int
+    compress: List[str]
 
 def generate_header_filename(path):
     asset_name = os.path.basename(path)
@@ -429,13 +435,23 @@ def pack_assets(config: PackModelsConfig):
             else:
                 width, height = 0, 0
 
-        file_info_list.append((file_name, len(merged_data), file_size, width, height))
-        # Add 0x5A5A prefix to merged_data
-        merged_data.extend(b'\x5A' * 2)
-
         with open(file_path, 'rb') as bin_file:
             bin_data = bin_file.read()
 
+        # Raw assets start with "ZZ" and are used in place from the mmap,
+        # LZ4 assets start with "ZL" and the raw size, and are expanded into PSRAM on first use
+        magic = b'\x5A' * 2
+        # index.json stays raw so that older firmware can still read the version from it
+        if file_name != 'index.json' and any(fnmatch.fnmatch(file_name, pattern) for pattern in config.compress):
+            compressed = lz4_compress(bin_data)
+            if len(compressed) + 4 < len(bin_data):
+                print(f'Compressed {file_name}: {len(bin_data)} -> {len(compressed) + 4} bytes')
+                magic = b'ZL'
+                bin_data = len(bin_data).to_bytes(4, byteorder='little') + compressed
+                file_size = len(bin_data)
+
+        file_info_list.append((file_name, len(merged_data), file_size, width, height))
+        merged_data.extend(magic)
         merged_data.extend(bin_data)
 
     total_files = len(file_info_list)
@@ -557,7 +573,8 @@ def process_assets_build(config_data):
         include_path=include_path,
         image_file=image_file,
         assets_path=assets_path,
-        name_length=name_length
+        name_length=name_length,
+        compress=config_data.get('compress', [])
     )
 
     print('--support_format:', support_format)